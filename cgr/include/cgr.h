@@ -1,39 +1,157 @@
 
 #pragma once
+#include <stdint.h>
 #include "contact.h"
 
 typedef struct
 {
-    int *idxs;   // índices de contactos que salen de un nodo
+    int *idxs;   // índices de contactos del nodo (vista sobre el pool CSR del índice)
     int count;
     int cap;
 } IndexList;
 
 typedef struct
 {
-    IndexList *by_from; // tamaño = node_cap
+    IndexList *by_from; // tamaño = node_cap; contactos que SALEN de cada nodo
+    IndexList *by_to;   // tamaño = node_cap; contactos que LLEGAN a cada nodo, por t_end (NULL si perezoso)
     int node_cap;
+    int *from_pool;     // almacenamiento CSR de by_from (N índices contiguos por nodo)
+    int *to_pool;       // almacenamiento CSR de by_to
+    // Vista SoA opcional (neighbor_index_attach_soa): columnas t_start | t_end |
+    // setup_s | rate | owlt en el orden de from_pool, separadas soa_n posiciones
+    const Contact *soa_plan; // plan del que se copiaron (NULL = sin vista)
+    double *soa;
+    int soa_n;
 } NeighborIndex;
 
+#define NI_LAZY_BY_TO 0x1   // no construir by_to hasta neighbor_index_ensure_by_to()
+
 NeighborIndex* build_neighbor_index(const Contact *C, int N);
+NeighborIndex* build_neighbor_index_ex(const Contact *C, int N, int flags);
+NeighborIndex* build_neighbor_index_parallel(const Contact *C, int N, int flags, int threads);
+int neighbor_index_ensure_by_to(NeighborIndex *ni, const Contact *C, int N);
 void free_neighbor_index(NeighborIndex* ni);
 
+// Copia la geometría de C (N contactos, el mismo plan del índice) en columnas
+// contiguas por nodo de salida. Con ella la búsqueda k=1 evalúa los vecinos de
+// cada nodo con el kernel vectorial de eta_kernel.h, pero solo cuando se le
+// pasa ese mismo puntero C y sin overlay. Es una instantánea: si t_start,
+// t_end, setup_s, rate_bps u owlt cambian in situ hay que volver a llamarla
+// (residual_bytes no se copia y puede cambiar libremente). 0 o -1.
+int neighbor_index_attach_soa(NeighborIndex *ni, const Contact *C, int N);
+
 typedef struct
 {
     const int *banned_ids;        // array de contact.id prohibidos (puede ser NULL)
     int banned_count;             // tamaño de banned_ids
     const int *forced_prefix_ids; // contactos que DEBEN usarse al principio (puede ser NULL)
     int forced_count;             // longitud del prefijo forzado
+    const unsigned char *banned_mask; // máscara por ÍNDICE de contacto (tamaño N, puede ser NULL)
+    double eta_bound;             // > 0: cota absoluta; se poda todo lo que llegue después (0 = sin cota)
 } CgrFilters;
 
 Route cgr_best_route(const Contact *C, int N, const CgrParams *P, const NeighborIndex *NI);
 
 Route cgr_best_route_filtered(const Contact *C, int N, const CgrParams *P,const NeighborIndex *NI, const CgrFilters *F);
 
+// Motivo por el que un contacto no sirve para continuar la ruta (el primero que falla)
+typedef enum
+{
+    CGR_REJ_NONE = 0,     // viable
+    CGR_REJ_CLOSED,       // se llega después de t_end
+    CGR_REJ_NO_WINDOW,    // el establecimiento consume lo que queda de ventana
+    CGR_REJ_CAPACITY,     // residual o capacidad de la ventana < bundle
+    CGR_REJ_NO_FIT,       // la transmisión no acaba antes de t_end
+    CGR_REJ_EXPIRED,      // llegaría después de la expiración del bundle
+    CGR_REJ_COUNT
+} CgrReject;
+
+// Contadores acumulados por un workspace (cgr_workspace_stats)
+typedef struct
+{
+    uint64_t queries, found;
+    uint64_t pops;            // labels extraídas del heap
+    uint64_t stale;           // ...de ellas obsoletas (ya mejoradas)
+    uint64_t improved;        // labels mejoradas y encoladas
+    uint64_t bulk_evals;      // contactos evaluados por eta_bulk (vista SoA)
+    uint64_t bulk_rejects;    // ...rechazados dentro del kernel (sin motivo)
+    uint64_t reject[CGR_REJ_COUNT]; // evaluaciones por resultado ([CGR_REJ_NONE] = viables)
+} CgrSearchStats;
+
+const char* cgr_reject_name(CgrReject r);
+
+// Estado reutilizable de cgr_best_route_ws (labels + heap) para planes de hasta N
+// contactos. Un workspace no es compartible entre hilos: uno por hilo.
+typedef struct CgrWorkspace CgrWorkspace;
+CgrWorkspace* cgr_workspace_new(int N);
+void cgr_workspace_free(CgrWorkspace *ws);
+// Contadores de todas las búsquedas hechas con ws desde su creación o el último reset
+void cgr_workspace_stats(const CgrWorkspace *ws, CgrSearchStats *out);
+void cgr_workspace_stats_reset(CgrWorkspace *ws);
+void cgr_search_stats_add(CgrSearchStats *acc, const CgrSearchStats *s);
+
+// Igual que cgr_best_route_filtered (F puede ser NULL) sin reservar ni inicializar
+// O(N) por consulta: apto para muchas consultas seguidas sobre el mismo plan
+Route cgr_best_route_ws(const Contact *C, int N, const CgrParams *P, const NeighborIndex *NI,
+                        const CgrFilters *F, CgrWorkspace *ws);
+
 Routes cgr_k_routes(const Contact *C_in, int N, const CgrParams *P, const NeighborIndex *NI, int K);
 
 Routes cgr_k_yen(const Contact *C, int N, const CgrParams *P, const NeighborIndex *NI, int K);
 
+#define CGR_YEN_UNBOUNDED 0x1   // búsquedas de desvío sin cota (referencia para comparar)
+
+/* Como cgr_k_yen. Por defecto cada búsqueda de desvío recibe como eta_bound la
+   mejor alternativa ya vista en la ronda, o la segunda mejor de la ronda
+   anterior (sigue disponible y no repetida), y poda todo lo que llegue más
+   tarde. El resultado es el mismo que sin cota salvo desempates entre ETAs
+   iguales. */
+Routes cgr_k_yen_ex(const Contact *C, int N, const CgrParams *P, const NeighborIndex *NI, int K, int flags);
+
+// Búsqueda inversa: salida más tardía desde src que aún llega a dst antes de `deadline`
+// (absoluto; si <= 0 se usa P->t0 + P->expiry). P->t0 es la salida más temprana admitida.
+// La ruta devuelta tiene eta = llegada real saliendo en *out_ldt.
+Route cgr_latest_departure(const Contact *C, int N, const CgrParams *P, const NeighborIndex *NI,
+                           double deadline, double *out_ldt);
+
+// ETA de una ruta ya calculada saliendo de su origen en P->t0, con el mismo
+// modelo de contactos que la búsqueda (ventana, tolerancias, residual >= bundle,
+// overlay y expiración de P). Recorre R->contact_idxs sobre C, que tiene que ser
+// el plan en el que se calculó. DBL_MAX si algún salto ya no es viable;
+// *bottleneck (si no es NULL) = menor residual de los saltos.
+double cgr_route_eta(const Contact *C, int N, const Route *R, const CgrParams *P, double *bottleneck);
+
+
+// Contactos probabilísticos (Contact.p_fail)
+typedef enum
+{
+    CGR_PROB_MAX_DELIVERY,   // máxima probabilidad de entrega antes del deadline; empate → menor eta
+    CGR_PROB_MIN_EXPECTED    // mínima p·(eta - t0) + (1 - p)·fail_cost
+} CgrProbMode;
+
+typedef struct
+{
+    CgrProbMode mode;
+    double deadline;     // absoluto; <= 0 usa P->t0 + P->expiry (o sin límite)
+    double fail_cost;    // coste de un bundle perdido (s, relativo a t0); <= 0 = deadline - t0
+    int max_labels;      // labels no dominadas por contacto (0 = 8)
+} CgrProbCfg;
+
+#define CGR_PROB_K_MAX 12    // la fiabilidad conjunta es exponencial en K
+
+// Ruta óptima según cfg->mode; *out_p = probabilidad de entrega de la ruta
+Route cgr_prob_route(const Contact *C, int N, const CgrParams *P, const NeighborIndex *NI,
+                     const CgrProbCfg *cfg, double *out_p);
+
+// Hasta K rutas (K <= CGR_PROB_K_MAX) elegidas para maximizar P(alguna entrega)
+// enviando copias por todas; *out_p = esa probabilidad conjunta
+Routes cgr_prob_k_routes(const Contact *C, int N, const CgrParams *P, const NeighborIndex *NI,
+                         const CgrProbCfg *cfg, int K, double *out_p);
+
+// P(al menos una de las rutas entrega) contando una vez los contactos compartidos,
+// por índice de contacto: dos copias periodizadas de un id son contactos distintos
+// (solo las CGR_PROB_K_MAX primeras; 0 si alguna ruta no trae contact_idxs de C)
+double cgr_routes_delivery_prob(const Contact *C, int N, const Routes *RS);
 
 void free_route(Route *r);
 void free_routes(Routes *rs);
@@ -0,0 +1,66 @@
+#pragma once
+#include "contact.h"
+
+/* Fachada del núcleo de enrutamiento para WebAssembly (make wasm).
+ * Experimental: el objetivo wasm y web/bench.html no se han ejecutado aún
+ * con emcc; solo la fachada nativa está probada.
+ *
+ * El módulo guarda UN plan en su memoria lineal. El navegador lo rellena sin
+ * copias: cgrw_plan_alloc reserva N Contact y devuelve su dirección, y JS
+ * escribe los campos con vistas Int32Array / Float64Array sobre esa zona
+ * (cgrw_layout da el tamaño de Contact y el offset de cada campo). Después
+ * cgrw_plan_commit construye el índice de vecinos y la vista SoA. Cambiar
+ * residual_bytes o p_fail en la vista no requiere otro commit; cambiar la
+ * geometría (nodos, ventana, owlt, rate, setup) sí.
+ *
+ * Las consultas dejan sus rutas en un buffer de resultados del módulo
+ * (ids concatenados + offsets + ETAs), que JS lee también con vistas. Todo
+ * es de un solo hilo: en wasm sin hilos cgr.c usa las rutas en serie.
+ *
+ * Fuera de Emscripten CGRW_EXPORT no hace nada y el fichero compila como C
+ * normal (para probar la fachada de forma nativa).
+ */
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/emscripten.h>
+#define CGRW_EXPORT EMSCRIPTEN_KEEPALIVE
+#else
+#define CGRW_EXPORT
+#endif
+
+// Campos de cgrw_layout(): [0] = sizeof(Contact), [1..] = offsetof de cada campo
+enum
+{
+    CGRW_L_SIZE = 0,
+    CGRW_L_ID, CGRW_L_FROM, CGRW_L_TO,
+    CGRW_L_T_START, CGRW_L_T_END, CGRW_L_OWLT, CGRW_L_RATE, CGRW_L_SETUP,
+    CGRW_L_RESIDUAL, CGRW_L_P_FAIL,
+    CGRW_L_COUNT
+};
+
+CGRW_EXPORT const int* cgrw_layout(void);
+
+// Plan vacío de n contactos (a cero) en sustitución del actual; NULL sin memoria
+CGRW_EXPORT Contact* cgrw_plan_alloc(int n);
+// Sustituye el plan por el CSV de text (formato de load_contacts_csv; el texto
+// se modifica) y lo deja listo como cgrw_plan_commit. Contactos leídos o -1.
+CGRW_EXPORT int cgrw_plan_load_csv(char *text, int len);
+CGRW_EXPORT Contact* cgrw_plan_ptr(void);
+CGRW_EXPORT int cgrw_plan_count(void);
+// Índice de vecinos + vista SoA + workspace del plan actual. 0 o -1. Un plan
+// de 0 contactos es válido: las consultas devuelven 0 rutas.
+CGRW_EXPORT int cgrw_plan_commit(void);
+CGRW_EXPORT void cgrw_plan_free(void);
+
+// Mejor ruta (cgr_best_route_ws). expiry relativo a t0 (0 = sin límite).
+// Rutas en el buffer de resultados (0 o 1) o -1 (sin plan / parámetros).
+CGRW_EXPORT int cgrw_route(int src, int dst, double t0, double bytes, double expiry);
+// Hasta K rutas: yen != 0 usa cgr_k_yen, si no cgr_k_routes (consumo de capacidad)
+CGRW_EXPORT int cgrw_k_routes(int src, int dst, double t0, double bytes, double expiry, int K, int yen);
+
+// Buffer de resultados de la última consulta: la ruta r usa los ids
+// ids[offsets[r] .. offsets[r+1]) y llega en etas[r]
+CGRW_EXPORT int cgrw_result_count(void);
+CGRW_EXPORT const int* cgrw_result_ids(void);
+CGRW_EXPORT const int* cgrw_result_offsets(void);
+CGRW_EXPORT const double* cgrw_result_etas(void);
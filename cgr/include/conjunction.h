@@ -0,0 +1,84 @@
+#pragma once
+#include <stdint.h>
+#include "sgp4.h"
+
+/* Cribado de conjunciones sobre un catálogo completo (SGP4).
+ *
+ * Todos los objetos se propagan en instantes t_begin + k·step_s y en cada
+ * instante una rejilla uniforme (hash espacial de celdas de lado = volumen
+ * de cribado) da los pares cercanos en O(n) en vez de O(n²). El volumen de
+ * cribado es threshold + vrel·step/2: el muestreo más cercano al instante de
+ * máxima aproximación (TCA) está como mucho a step/2 de él, así que ningún
+ * encuentro por debajo del umbral se escapa entre muestras.
+ * Por cada par candidato el movimiento relativo lineal estima el TCA; solo
+ * la muestra que "posee" ese TCA (|TCA - t_k| <= step/2) lo refina, con
+ * iteraciones de Newton sobre la velocidad radial relativa evaluando SGP4
+ * exacto, hasta < 0.1 ms. Los tramos de pasos se reparten entre hilos.
+ * Antes, un prefiltro descarta los pares cuyas bandas perigeo/apogeo no se
+ * solapan o cuyos planos orbitales los mantienen separados (ver
+ * conjunction.c); los objetos sin ningún par posible no se propagan.
+ */
+
+typedef struct
+{
+    double t_begin, t_end;  // intervalo (s Unix UTC)
+    double step_s;          // paso de cribado (<= 0 = 20 s)
+    double threshold_km;    // distancia de máxima aproximación a reportar
+    double vrel_max_kms;    // cota de velocidad relativa (<= 0 = 2·máx |v| del catálogo)
+    int threads;            // <= 0 = 1
+    int no_prefilter;       // 1 = sin prefiltro de bandas/planos (comparación)
+} ConjConfig;
+
+typedef struct
+{
+    int a, b;               // índices en el catálogo (a < b)
+    double tca;             // instante de máxima aproximación (s Unix UTC)
+    double miss_km;         // distancia en el TCA
+    double vrel_kms;        // velocidad relativa en el TCA
+} Conjunction;
+
+typedef struct
+{
+    Conjunction *items;     // ordenadas por TCA
+    int count;
+    int objects;            // objetos propagables
+    int skipped;            // con error de inicialización (espacio profundo, ...)
+    int steps;
+    double screen_km;       // volumen de cribado usado
+    uint64_t candidates;    // pares dentro del volumen de cribado (suma sobre pasos)
+    uint64_t refined;       // pares refinados con SGP4
+    double elapsed_s;
+    // Prefiltro (bandas perigeo/apogeo sobre todo el intervalo, planos por épocas)
+    uint64_t pairs_total;   // n(n-1)/2 de objetos propagables
+    uint64_t pairs_band;    // pares con bandas radiales solapadas
+    uint64_t pairs_plane;   // pares que pasan también los planos (primera época)
+    int epochs;
+    double epoch_s;         // duración de las épocas del filtro de planos
+    double active_frac;     // fracción de objeto·paso que se propagan
+    double prefilter_s;
+} ConjResult;
+
+// 0 o -1 (parámetros inválidos / sin memoria)
+int conj_screen(const Sgp4Sat *S, int n, const ConjConfig *cfg, ConjResult *out);
+void conj_result_free(ConjResult *r);
+
+/* Ventanas de proximidad (generación de planes de contacto ISL): intervalos
+   en que dos objetos están a <= cfg->threshold_km, con la misma rejilla. Los
+   bordes tienen la resolución del paso (muestra primera/última dentro). */
+typedef struct
+{
+    int a, b;               // índices en el catálogo (a < b)
+    double t_start, t_end;  // s Unix UTC
+    double min_km, max_km;  // rango mínimo / máximo muestreado
+} ProxWindow;
+
+typedef struct
+{
+    ProxWindow *items;      // ordenadas por (a, b, t_start)
+    int count;
+    int steps;
+    double elapsed_s;
+} ProxResult;
+
+int conj_proximity(const Sgp4Sat *S, int n, const ConjConfig *cfg, ProxResult *out);
+void prox_result_free(ProxResult *r);
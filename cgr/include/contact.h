@@ -14,6 +14,7 @@ typedef struct
     double rate_bps;      // capacidad (bps)
     double setup_s;       // retardo de establecimiento (s)
     double residual_bytes;// capacidad aún disponible (bytes) para el bundle
+    double p_fail;        // probabilidad de que el contacto falle (0 = fiable; p_success = 1 - p_fail)
 } Contact;
 
 // Etiqueta de estado para Dijkstra temporal (una por contacto).
@@ -28,11 +29,22 @@ typedef struct
 typedef struct
 {
     int *contact_ids;  // ids de los contactos en orden (no índices)
+    int *contact_idxs; // índices en C[] de los mismos saltos (comparte la reserva de contact_ids;
+                       // NULL si la ruta no salió de cgr.c). Un plan periodizado repite ids:
+                       // para cargar o vetar el contacto usado, usar estos índices
     int hops;          // número de saltos (contactos)
     double eta;        // ETA final (s)
     bool found;        // true si hay ruta
+    // Validez (solo con found): la misma secuencia de contactos sigue siendo
+    // viable saliendo en cualquier t <= valid_until (no necesariamente óptima)
+    // mientras ningún salto baje de bundle_bytes de residual. Quien enruta
+    // periódicamente puede reutilizar la ruta hasta entonces.
+    double valid_until;      // salida más tardía (s, absoluta; incluye el deadline si lo hay)
+    double bottleneck_bytes; // menor residual_bytes de los saltos al calcularla
 } Route;
 
+struct CgrOverlay;   // penalty.h
+
 // Parámetros de un enrutamiento (para un bundle)
 typedef struct
 {
@@ -41,6 +53,7 @@ typedef struct
     double t0;          // tiempo de salida/creación del bundle (s)
     double bundle_bytes;// tamaño del bundle (bytes)
     double expiry;      // tiempo de expiración relativo (s); 0 = sin restricción
+    const struct CgrOverlay *overlay; // penalización aprendida por contacto (NULL = ninguna)
 } CgrParams;
 
 // Conjunto de rutas (K rutas)
@@ -1,6 +1,23 @@
 
 #pragma once
+#include <stddef.h>
 #include "contact.h"
 
 int load_contacts_csv(const char *path, Contact **out_contacts);
 
+// Igual que load_contacts_csv, troceando el fichero en `threads` bloques
+// (cortados en fin de línea) que se parsean en paralelo. Conserva el orden.
+int load_contacts_csv_parallel(const char *path, int threads, Contact **out_contacts);
+
+// Igual que load_contacts_csv sobre el texto ya en memoria (len bytes; no hace
+// falta terminador). Modifica el texto: corta las líneas en su sitio.
+int load_contacts_csv_text(char *text, size_t len, Contact **out_contacts);
+
+
+// Lector incremental (memoria acotada): devuelve hasta `cap` contactos por llamada,
+// 0 al final del fichero. Mismo formato que load_contacts_csv.
+typedef struct CsvReader CsvReader;
+CsvReader* csv_reader_open(const char *path);
+int csv_reader_next(CsvReader *r, Contact *out, int cap);
+int csv_reader_rewind(CsvReader *r);
+void csv_reader_close(CsvReader *r);
@@ -0,0 +1,117 @@
+#pragma once
+#include <stdint.h>
+#include "contact.h"
+
+/* Matrices de llegada más temprana todos-contra-todos (analítica offline).
+ *
+ * Para cada nodo origen y cada instante de salida t_begin + k·step_s se
+ * calcula la llegada más temprana a todos los nodos con el mismo modelo de
+ * contacto que cgr_best_route (setup, tasa, owlt, capacidad residual; sin
+ * overlay ni expiración). Con FIFO (salir antes nunca llega más tarde) basta
+ * una etiqueta por NODO, así que cada búsqueda es un Dijkstra sobre los nodos
+ * del plan en lugar de uno por par:
+ *   - el plan se reordena una vez en una estructura expandida en el tiempo:
+ *     por cada enlace (u, v), sus contactos en columnas (SoA) ordenados por
+ *     t_end junto al mínimo t_start restante; dos búsquedas binarias dejan
+ *     solo los contactos abiertos que aún pueden mejorar la llegada a v;
+ *   - si las llegadas del primer salto no cambian respecto al paso anterior
+ *     (el origen sigue esperando al mismo contacto) la fila se reutiliza
+ *     sin buscar;
+ *   - los orígenes se reparten entre hilos.
+ */
+
+typedef struct
+{
+    double t_begin;         // primera salida (s)
+    double step_s;          // separación entre salidas (s)
+    int steps;              // salidas por origen
+    double bundle_bytes;    // tamaño del bundle
+    int threads;            // <= 0 = 1
+} EaConfig;
+
+typedef struct
+{
+    int n_nodes;            // nodos del plan (filas y columnas), ids crecientes
+    int *node_ids;          // [n_nodes]
+    int steps;
+    double t_begin, step_s, bundle_bytes;
+    float *latency;         // [(paso·n + origen)·n + destino]: llegada - salida (s), NAN = inalcanzable
+    uint64_t searches;      // búsquedas ejecutadas
+    uint64_t reused;        // filas reutilizadas del paso anterior
+    uint64_t evals;         // contactos evaluados
+    double elapsed_s;       // tiempo de pared del cálculo
+} EaMatrix;
+
+// Latencia de la celda (paso, origen, destino) en índices compactos
+static inline float ea_at(const EaMatrix *m, int step, int src, int dst) {
+    return m->latency[((size_t)step * m->n_nodes + src) * m->n_nodes + dst];
+}
+
+// Posición compacta de un id de nodo o -1
+int ea_node_index(const EaMatrix *m, int node_id);
+
+// Devuelve 0 o -1 (parámetros inválidos / sin memoria)
+int ea_compute(const Contact *C, int N, const EaConfig *cfg, EaMatrix *out);
+void ea_matrix_free(EaMatrix *m);
+
+/* Formato binario .cgea (little-endian):
+ *   cabecera (48 B): "CGEA" | u32 versión | u32 n_nodes | u32 steps |
+ *                    f64 t_begin | f64 step_s | f64 bundle_bytes | u32 0 | u32 0
+ *   i32 node_ids[n_nodes]               (estrictamente crecientes)
+ *   f32 latency[steps][n_nodes][n_nodes]  (NaN = inalcanzable)
+ * Las estadísticas de cálculo no se guardan. 0 o -1; la lectura también
+ * rechaza node_ids desordenados o repetidos y tamaños que no caben en memoria. */
+int ea_matrix_write(const char *path, const EaMatrix *m);
+int ea_matrix_read(const char *path, EaMatrix *m);
+
+/* Alcanzabilidad bit-paralela: qué orígenes llegan a cada nodo antes de
+ * t + window saliendo todos en t, para t = t_begin + k·step_s (mismo modelo
+ * de contacto que arriba).
+ *
+ * Barrido por eventos en orden temporal: inicios de contacto (lista ordenada
+ * por t_start) y llegadas (heap). Cada nodo guarda el conjunto de orígenes que
+ * ya lo alcanzaron como un bitset de EA_REACH_BITS orígenes; una llegada solo
+ * propaga los bits NUEVOS, con OR/AND-NOT vectoriales sobre el bitset entero:
+ *   - en el inicio de un contacto, todos los orígenes que esperan en su nodo
+ *     salen juntos (misma llegada);
+ *   - una llegada con el contacto ya abierto sale por él en el acto.
+ * Cada bit entra en cada nodo una sola vez, y como los eventos se procesan
+ * en orden temporal lo hace con la llegada más temprana: el resultado es
+ * exacto. Con más de EA_REACH_BITS orígenes se hacen varias pasadas; las
+ * pasadas de todas las salidas se reparten entre hilos y la estructura
+ * ordenada del plan se construye una sola vez. */
+
+#define EA_REACH_BITS 256
+
+typedef struct
+{
+    double t_begin;         // primera salida (s)
+    double step_s;          // separación entre salidas (s)
+    int steps;              // salidas (<= 0 = 1)
+    double window;          // plazo: llegada <= salida + window
+    double bundle_bytes;
+    int threads;            // <= 0 = 1
+} EaReachConfig;
+
+typedef struct
+{
+    int n_nodes;            // nodos del plan, ids crecientes (como EaMatrix)
+    int *node_ids;          // [n_nodes]
+    int words;              // palabras de 64 bits por fila
+    int steps;
+    double t_begin, step_s, window, bundle_bytes;
+    uint64_t *bits;         // [(paso·n + destino)·words + origen/64], bit origen%64
+    uint64_t events;        // llegadas con bits nuevos procesadas
+    double elapsed_s;
+} EaReach;
+
+static inline int ea_reach_test(const EaReach *r, int step, int src, int dst) {
+    size_t row = (size_t)step * r->n_nodes + dst;
+    return (int)((r->bits[row * r->words + (src >> 6)] >> (src & 63)) & 1u);
+}
+
+int ea_reach_compute(const Contact *C, int N, const EaReachConfig *cfg, EaReach *out);
+void ea_reach_free(EaReach *r);
+int ea_reach_node_index(const EaReach *r, int node_id);
+// Orígenes que alcanzan dst (índice compacto) en la salida step
+int ea_reach_count(const EaReach *r, int step, int dst);
@@ -0,0 +1,60 @@
+#pragma once
+#include <float.h>
+
+/* Evaluación en bloque del ETA de muchos contactos a la vez.
+ *
+ * Fusiona contact_is_viable + eta_contact de cgr.c en una sola pasada sobre
+ * columnas (SoA) y devuelve el ETA de cada contacto (DBL_MAX si no es
+ * viable) más la lista compacta de posiciones viables. La capacidad
+ * residual NO forma parte del kernel: cambia entre consultas (consumo) y
+ * quien llama la comprueba solo sobre los supervivientes.
+ *
+ * Variantes escalar / AVX2 / AVX-512 elegidas por CPUID en el primer uso;
+ * todas producen resultados idénticos bit a bit a la versión escalar de
+ * cgr.c (mismas operaciones en el mismo orden, sin FMA).
+ */
+
+#define CGR_EPS_TIME  1e-12   // tolerancia temporal del modelo de contactos (s)
+#define CGR_EPS_BYTES 1e-9    // tolerancia de capacidad (bytes)
+
+typedef enum
+{
+    CGR_SIMD_SCALAR = 0,
+    CGR_SIMD_AVX2   = 1,
+    CGR_SIMD_AVX512 = 2
+} CgrSimdLevel;
+
+// Columnas de los contactos a evaluar (rate ya acotada a >= 1 bps)
+typedef struct
+{
+    const double *t_start, *t_end, *setup, *rate, *owlt;
+} EtaSoA;
+
+// Un contacto k de S (referencia escalar: misma secuencia que contact_eval de cgr.c)
+static inline double eta_soa_one(const EtaSoA *S, int k, double t_in, double bytes, double expiry_abs) {
+    double te = S->t_end[k];
+    if (t_in > te + CGR_EPS_TIME) return DBL_MAX;
+    double start = (t_in < S->t_start[k]) ? S->t_start[k] : t_in;
+    double window = te - start - S->setup[k];
+    if (window <= CGR_EPS_TIME) return DBL_MAX;
+    if (window * S->rate[k] + CGR_EPS_BYTES < bytes) return DBL_MAX;
+    double finish = start + S->setup[k] + bytes / S->rate[k];
+    if (finish > te + CGR_EPS_TIME) return DBL_MAX;
+    double eta = finish + S->owlt[k];
+    if (expiry_abs > 0.0 && eta > expiry_abs + CGR_EPS_TIME) return DBL_MAX;
+    return eta;
+}
+
+// Evalúa n contactos saliendo a t_in. eta[k] = ETA al final del contacto k o
+// DBL_MAX; sel[0..m) = posiciones viables en orden creciente. Devuelve m.
+// expiry_abs <= 0 = sin expiración.
+int eta_bulk(const EtaSoA *S, int n, double t_in, double bytes, double expiry_abs,
+             double *eta, int *sel);
+
+// Mejor nivel soportado por la CPU / nivel en uso
+CgrSimdLevel cgr_simd_detect(void);
+CgrSimdLevel cgr_simd_level(void);
+// Fuerza un nivel (acotado a lo soportado) y devuelve el aplicado. Para
+// pruebas y benchmarks; es seguro con búsquedas en curso.
+CgrSimdLevel cgr_simd_force(CgrSimdLevel level);
+const char* cgr_simd_name(CgrSimdLevel level);
@@ -0,0 +1,66 @@
+#pragma once
+#include <stdbool.h>
+#include "cgr.h"
+
+// Ruta registrada en el índice de impacto (una por bundle/alternativa)
+typedef struct
+{
+    int bundle_id;        // id del bundle propietario (libre para el llamante)
+    CgrParams params;     // parámetros con los que se calculó la ruta
+    Route route;          // copia propia de la ruta
+    bool committed;       // true si la ruta consumió capacidad en el plan
+    double *taken;        // con committed: bytes descontados de verdad en cada salto
+    bool active;          // false si el hueco quedó libre
+} TrackedRoute;
+
+// Índice invertido contacto → rutas que lo usan
+typedef struct
+{
+    TrackedRoute *routes;   // rutas registradas (el handle es la posición)
+    int count;
+    int cap;
+    IndexList *by_contact;  // tamaño = n_contacts; handles de ruta por índice de contacto
+    int n_contacts;
+    int *id_keys;           // ids de contacto ordenados (mapa id → índice)
+    int *id_vals;           // índice en C[] de cada id_keys[i]
+} ImpactIndex;
+
+typedef struct
+{
+    int banned_contacts;    // contactos vetados (ids + nodos caídos)
+    int affected;           // rutas afectadas
+    int rerouted;           // rutas recalculadas con éxito
+    int lost;               // rutas sin alternativa
+} ImpactStats;
+
+ImpactIndex* impact_new(const Contact *C, int N);
+void impact_free(ImpactIndex *ix);
+
+// Índice en C[] de un id de contacto (-1 si no existe). Con ids duplicados devuelve el primero.
+int impact_contact_index(const ImpactIndex *ix, int contact_id);
+
+// Registrar rutas producidas por cgr_best_route / cgr_k_routes / cgr_k_yen (se copian).
+// Se indexan por Route.contact_idxs (el contacto usado, aunque el plan repita ids):
+// rutas sin contact_idxs o de otro plan se rechazan (-1).
+int impact_track(ImpactIndex *ix, int bundle_id, const CgrParams *P, const Route *R);
+void impact_track_routes(ImpactIndex *ix, int bundle_id, const CgrParams *P, const Routes *RS);
+// Deja de seguir la ruta; si estaba comprometida devuelve a C[] lo que consumió
+void impact_untrack(ImpactIndex *ix, Contact *C, int handle);
+
+// Consumir capacidad de la ruta en C[] y registrarla como comprometida. Devuelve el handle.
+// La residual no baja de 0; se anota lo descontado en cada salto para poder devolverlo exacto.
+int impact_commit(ImpactIndex *ix, Contact *C, int bundle_id, const CgrParams *P, const Route *R);
+
+// Handles de rutas activas que usan algún contacto caído o algún contacto de/hacia un nodo caído.
+// Escribe como mucho `cap` handles (ascendentes) y devuelve el total afectado.
+int impact_affected(const ImpactIndex *ix, const Contact *C, const NeighborIndex *NI,
+                    const int *failed_ids, int n_failed_ids,
+                    const int *failed_nodes, int n_failed_nodes,
+                    int *out_handles, int cap);
+
+// Veta contactos/nodos y recalcula SOLO las rutas afectadas (en orden de registro).
+// Las comprometidas devuelven su capacidad antes de recalcular y la vuelven a consumir.
+// El plan no se marca como caído: para búsquedas posteriores, vetar también vía CgrFilters.
+ImpactStats impact_reroute(ImpactIndex *ix, Contact *C, int N, const NeighborIndex *NI,
+                           const int *failed_ids, int n_failed_ids,
+                           const int *failed_nodes, int n_failed_nodes);
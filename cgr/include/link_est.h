@@ -0,0 +1,90 @@
+#pragma once
+#include <stdatomic.h>
+#include <stdint.h>
+
+/* Estimadores por enlace (from → to) alimentados por informes de entrega.
+ *
+ * Cada salto transmitido puede informar de la tasa conseguida, el retardo
+ * extra observado y si falló. La tabla guarda por enlace EWMAs de la razón
+ * de tasa (conseguida / planificada), del retardo y de la tasa de fallos,
+ * más una ventana circular de los últimos retardos para percentiles.
+ *
+ * Todo es sin bloqueos: la inserción de enlaces nuevos es un CAS sobre la
+ * clave (direccionamiento abierto, capacidad fija) y las actualizaciones son
+ * CAS/stores atómicos, así que los hilos que reportan no compiten con los que
+ * enrutan. Los lectores ven valores completos aunque no necesariamente
+ * coherentes entre campos (un informe puede estar a medio aplicar).
+ *
+ * La búsqueda no lee la ventana: cada informe recalcula y publica el coste
+ * derivado (retardo representativo + factor de ralentización), que es lo que
+ * consulta overlay_setup() vía CgrOverlay.links.
+ */
+
+#define LINK_WINDOW 16            // retardos recientes por enlace
+
+typedef struct
+{
+    _Atomic uint64_t key;         // (from, to) + 1; 0 = hueco libre
+    _Atomic uint32_t n;           // informes recibidos
+    _Atomic uint32_t n_fail;
+    _Atomic uint32_t wpos;        // siguiente posición de la ventana (módulo LINK_WINDOW)
+    _Atomic float    win[LINK_WINDOW];
+    _Atomic double   rate_ratio;  // EWMA de conseguida / planificada (1 = nominal)
+    _Atomic double   delay_s;     // EWMA del retardo extra
+    _Atomic double   fail;        // EWMA de fallos [0..1]
+    // Coste publicado para la búsqueda
+    _Atomic double   cost_delay;  // retardo extra representativo (s)
+    _Atomic double   cost_slow;   // tiempo de transmisión extra por segundo nominal (>= 0)
+} LinkEst;
+
+typedef struct LinkTable
+{
+    LinkEst *slots;
+    uint32_t mask;                // capacidad - 1 (potencia de 2)
+    double alpha;                 // peso EWMA de cada informe
+    double quantile;              // percentil de la ventana como retardo (<0 = usar EWMA)
+    _Atomic uint32_t used;
+    _Atomic uint64_t dropped;     // informes sin hueco (tabla llena)
+} LinkTable;
+
+// Informe de un salto transmitido
+typedef struct
+{
+    int from, to;
+    double planned_bps;           // tasa del plan (<= 0 = desconocida)
+    double achieved_bps;          // tasa conseguida (<= 0 = desconocida)
+    double extra_delay_s;         // retardo sobre lo previsto (cola, reintentos...)
+    int failed;                   // 1 = el salto no entregó el bundle
+} HopReport;
+
+// Instantánea de un enlace
+typedef struct
+{
+    uint32_t n, n_fail;
+    double rate_ratio, delay_s, fail;
+    double delay_p50, delay_p95;  // sobre la ventana (0 sin muestras)
+    double cost_delay, cost_slow;
+} LinkStats;
+
+// `links` se redondea a potencia de 2 (x2 para mantener la ocupación <= 50%)
+LinkTable* link_table_new(int links, double alpha, double quantile);
+void link_table_free(LinkTable *T);
+
+// Hueco del enlace, creándolo si no existe. -1 si la tabla está llena.
+int link_slot(LinkTable *T, int from, int to);
+// Hueco del enlace sin crearlo (-1 si no existe)
+int link_find(const LinkTable *T, int from, int to);
+
+// Aplica un informe. Devuelve el hueco actualizado o -1 (tabla llena).
+int link_report(LinkTable *T, const HopReport *r);
+
+int link_stats(const LinkTable *T, int from, int to, LinkStats *out);
+
+// Retardo extra que la búsqueda añade a un contacto del enlace `slot`
+// para transmitir `bytes` a la tasa nominal `rate_bps`
+static inline double link_cost(const LinkTable *T, int slot, double bytes, double rate_bps) {
+    const LinkEst *e = &T->slots[slot];
+    double rate = rate_bps > 1.0 ? rate_bps : 1.0;
+    return atomic_load_explicit(&e->cost_delay, memory_order_relaxed)
+         + atomic_load_explicit(&e->cost_slow, memory_order_relaxed) * (bytes / rate);
+}
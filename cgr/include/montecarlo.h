@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include "cgr.h"
+
+/* Evaluación Monte Carlo de la robustez de un plan.
+ *
+ * Cada ensayo perturba el plan (elimina contactos, desplaza t_start/t_end,
+ * escala rate_bps) y enruta el mismo conjunto de consultas con cgr_best_route_ws.
+ * Las perturbaciones se muestrean por saltos geométricos, así que un ensayo
+ * cuesta O(contactos perturbados), no O(N):
+ *   - cada hilo copia el plan UNA vez y por ensayo escribe solo los contactos
+ *     que cambian, guardando el original en un registro de deshacer que se
+ *     aplica al terminar (copia en escritura sobre la copia privada);
+ *   - los contactos eliminados se marcan en una máscara (CgrFilters.banned_mask)
+ *     en vez de sacarlos del plan;
+ *   - from/to nunca cambian, así que el NeighborIndex se comparte sin tocarlo.
+ * Cada ensayo usa su propio generador sembrado con (seed, ensayo): el
+ * resultado no depende del número de hilos ni del reparto.
+ */
+
+typedef struct
+{
+    double p_drop;          // probabilidad de eliminar cada contacto
+    double p_jitter;        // probabilidad de desplazar la ventana de un contacto
+    double jitter_s;        // desplazamiento uniforme en ±jitter_s (independiente en cada extremo)
+    double p_rate;          // probabilidad de escalar rate_bps
+    double rate_lo, rate_hi;// factor de escala uniforme en [rate_lo, rate_hi]
+} McPerturb;
+
+typedef struct
+{
+    int trials;
+    int threads;            // <= 0 = 1
+    uint64_t seed;
+    McPerturb pert;
+} McConfig;
+
+typedef struct
+{
+    int trials, nq;
+    float *latency;         // [ensayo * nq + q]: eta - t0, NAN si no se entregó
+    double *base_latency;   // [q] sobre el plan sin perturbar (NAN = sin ruta)
+    uint32_t *delivered;    // [q] ensayos con entrega
+    uint64_t perturbed;     // contactos modificados o eliminados (suma de todos los ensayos)
+    double elapsed_s;       // tiempo de pared de los ensayos
+} McResult;
+
+typedef struct
+{
+    int n;                  // muestras entregadas
+    double delivery;        // fracción de (ensayo, consulta) entregados
+    double mean, p50, p90, p99, max;   // latencia de las entregadas (s)
+} McSummary;
+
+// Ejecuta cfg->trials ensayos de las nq consultas Q sobre el plan C (con su índice NI).
+// Devuelve 0 o -1 (parámetros inválidos / sin memoria).
+int mc_run(const Contact *C, int N, const NeighborIndex *NI, const CgrParams *Q, int nq,
+           const McConfig *cfg, McResult *out);
+void mc_result_free(McResult *r);
+
+// Distribución de la consulta q, o de todas juntas si q < 0
+int mc_summary(const McResult *r, int q, McSummary *s);
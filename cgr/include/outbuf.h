@@ -0,0 +1,56 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "contact.h"
+
+/* Buffer de salida con formateo propio de enteros y dobles.
+ *
+ * Todo se acumula en memoria y ob_flush() lo vuelca con un único write(2)
+ * (reintentando escrituras parciales). Con flush_at > 0 el buffer se vuelca
+ * solo al superar ese tamaño, lo que permite emitir NDJSON en streaming sin
+ * crecer indefinidamente. No reserva memoria salvo para crecer el buffer.
+ */
+
+typedef struct
+{
+    char  *buf;
+    size_t len, cap;
+    int    fd;          // destino de ob_flush (-1 = solo memoria)
+    size_t flush_at;    // umbral de volcado automático en ob_end_record (0 = manual)
+    int    err;         // 1 si falló una reserva o un write
+} OutBuf;
+
+void ob_init(OutBuf *ob, int fd, size_t flush_at);
+void ob_free(OutBuf *ob);
+int  ob_flush(OutBuf *ob);        // 0 ok, -1 error
+void ob_reset(OutBuf *ob);        // descarta el contenido sin escribirlo
+// Fin de registro: vuelca si se superó flush_at
+void ob_end_record(OutBuf *ob);
+
+void ob_write(OutBuf *ob, const void *p, size_t n);
+void ob_putc(OutBuf *ob, char c);
+void ob_puts(OutBuf *ob, const char *s);
+void ob_int(OutBuf *ob, long long v);
+// Igual que printf("%.*f", decimals, v) (decimals <= 9)
+void ob_fixed(OutBuf *ob, double v, int decimals);
+// Texto que strtod devuelve exactamente a v: decimales fijos si bastan 9 o
+// menos, si no el primero de %.15g / %.16g / %.17g que vuelve a v. No es
+// siempre la representación mínima (1e15 sale como 1000000000000000).
+void ob_double(OutBuf *ob, double v);
+
+// Binario little-endian
+void ob_u32(OutBuf *ob, uint32_t v);
+void ob_i32(OutBuf *ob, int32_t v);
+void ob_f64(OutBuf *ob, double v);
+
+/* ----------------------- Rutas ----------------------- */
+
+// {"eta":..,"latency":..,"hops":..,"contacts":[..]} con `decimals` fijos
+// (decimals < 0 = ob_double, ida y vuelta exacta)
+void ob_route_json(OutBuf *ob, const Route *R, double t0, int decimals);
+
+// Registro binario de resultado:
+//   u32 query | u32 n_routes | n_routes × (u32 hops | f64 eta | i32 contact_ids[hops])
+// n_routes = 0 si no hay ruta.
+void ob_result_bin(OutBuf *ob, uint32_t query, const Routes *RS);
+void ob_route_bin(OutBuf *ob, uint32_t query, const Route *R);
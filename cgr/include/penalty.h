@@ -0,0 +1,62 @@
+#pragma once
+#include <stdatomic.h>
+#include "contact.h"
+#include "link_est.h"
+
+/* Penalización aprendida por contacto como capa sobre el plan.
+ *
+ * La búsqueda suma lambda * pen[i] al setup_s del contacto de ÍNDICE i sin
+ * modificar el array de contactos, así que ni el plan se copia ni el índice
+ * de vecinos se reconstruye cuando cambian las penalizaciones. Los valores
+ * se actualizan in situ con stores atómicos: un hilo puede aprender mientras
+ * otros enrutan (cada lectura ve un valor completo, antiguo o nuevo).
+ *
+ * Se persiste por contact.id ("id,penalty_s"), de modo que el fichero
+ * sobrevive a reordenaciones del plan entre ejecuciones.
+ *
+ * Opcionalmente enlaza una LinkTable (link_est.h): cada contacto suma además
+ * el coste publicado por los informes de su enlace from → to.
+ */
+
+typedef struct CgrOverlay
+{
+    _Atomic double *pen;  // penalización por índice de contacto (s)
+    int n;                // tamaño de pen (= N del plan)
+    double lambda;        // peso: retardo extra = lambda * pen[i]
+    const LinkTable *links; // estimadores por enlace (NULL = ninguno)
+    int *link_slot;       // hueco en links de cada contacto (-1 = sin enlace)
+} CgrOverlay;
+
+CgrOverlay* overlay_new(int n, double lambda);
+void overlay_free(CgrOverlay *ov);
+
+// Retardo de establecimiento extra del contacto `ci` (= c) para `bytes` (0 sin overlay)
+static inline double overlay_setup(const CgrOverlay *ov, int ci, const Contact *c, double bytes) {
+    if (!ov || ci >= ov->n) return 0.0;
+    double x = ov->lambda * atomic_load_explicit(&ov->pen[ci], memory_order_relaxed);
+    if (ov->links && ov->link_slot[ci] >= 0) x += link_cost(ov->links, ov->link_slot[ci], bytes, c->rate_bps);
+    return x;
+}
+
+static inline double overlay_get(const CgrOverlay *ov, int ci) {
+    return atomic_load_explicit(&ov->pen[ci], memory_order_relaxed);
+}
+
+static inline void overlay_set(CgrOverlay *ov, int ci, double v) {
+    atomic_store_explicit(&ov->pen[ci], v, memory_order_relaxed);
+}
+
+// Asocia cada contacto de C (N = ov->n) a su enlace en T, creando los que
+// falten. Devuelve 0, o -1 si no hay memoria o T se llenó (esos contactos
+// quedan sin coste de enlace).
+int overlay_bind_links(CgrOverlay *ov, LinkTable *T, const Contact *C, int N);
+
+// pen[ci] = (1-alpha)*pen[ci] + alpha*sample (CAS: seguro con varios aprendices)
+double overlay_ewma(CgrOverlay *ov, int ci, double sample, double alpha);
+
+// Persistencia por contact.id. save escribe solo penalizaciones != 0.
+// load devuelve el número de entradas aplicadas o -1 si no se pudo abrir;
+// los ids que no están en C se ignoran. Ambas devuelven -1 si C repite algún
+// id (p. ej. un plan periodizado): la entrada no identificaría el contacto.
+int overlay_save(const CgrOverlay *ov, const Contact *C, int N, const char *path);
+int overlay_load(CgrOverlay *ov, const Contact *C, int N, const char *path);
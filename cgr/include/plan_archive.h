@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+#include "contact.h"
+
+/* Archivo columnar comprimido de planes de contacto (.cgrp)
+ *
+ *   cabecera | directorio de bloques | bloques
+ *
+ * Los contactos se ordenan por t_start y se agrupan en bloques de
+ * `block_size`. Cada bloque guarda sus 10 columnas por separado:
+ *   - id/from/to: delta + zigzag + varint
+ *   - dobles: entero escalado 10^k con delta/varint si es exacto,
+ *     o XOR con el valor previo recortando bytes nulos (sin pérdida)
+ * El directorio lleva min(t_start)/max(t_end) por bloque para que el
+ * cargador salte (sin leerlos) los bloques fuera del horizonte pedido.
+ */
+
+#define PLAN_ARCHIVE_BLOCK_DEFAULT 4096
+
+typedef struct
+{
+    uint32_t version;       // versión del formato (1 = sin p_fail)
+    int64_t n_contacts;     // contactos en el archivo
+    int     n_blocks;       // bloques en el archivo
+    double  t_min, t_max;   // rango temporal global
+    int     blocks_read;    // bloques decodificados en la última carga
+    int64_t bytes_read;     // bytes de bloque leídos en la última carga
+} PlanArchiveInfo;
+
+int plan_archive_write(const char *path, const Contact *C, int N, int block_size);
+
+// Carga los contactos que solapan [t_lo, t_hi]; si t_hi < t_lo carga todo.
+// Devuelve el número de contactos (en orden de t_start) o -1. `info` puede ser NULL.
+int plan_archive_load(const char *path, double t_lo, double t_hi, Contact **out_contacts,
+                      PlanArchiveInfo *info);
+
+int plan_archive_info(const char *path, PlanArchiveInfo *info);
+
+// Lectura secuencial bloque a bloque (memoria acotada a un bloque)
+typedef struct PlanArchiveReader PlanArchiveReader;
+PlanArchiveReader* plan_archive_open(const char *path, PlanArchiveInfo *info);
+// Decodifica el siguiente bloque en *buf (crece con realloc). Devuelve contactos, 0 al final o -1.
+int plan_archive_next_block(PlanArchiveReader *r, Contact **buf, int *cap);
+void plan_archive_rewind(PlanArchiveReader *r);
+void plan_archive_close(PlanArchiveReader *r);
@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include "contact.h"
+
+/* Plan en ventana deslizante: solo se mantienen en memoria los contactos
+ * que solapan [now, now + horizon].
+ *
+ * Los contactos llegan de una fuente ordenada por t_start (CSV, archivo
+ * .cgrp, array en memoria, páginas de una API...). Un hilo opcional de
+ * prefetch llena una cola acotada por delante de la ventana; cada
+ * plan_stream_advance() retira los contactos con t_end < now y admite los
+ * de la cola con t_start <= now + horizon. La memoria queda acotada por la
+ * ventana más la cola, independientemente de la longitud total del plan.
+ */
+
+// Fuente de contactos en orden de t_start
+typedef struct
+{
+    int  (*read)(void *ctx, Contact *out, int cap);  // >0 contactos, 0 fin, -1 error
+    int  (*rewind)(void *ctx);                       // opcional (necesario para periodizar)
+    void (*close)(void *ctx);                        // opcional
+    void *ctx;
+} PlanSource;
+
+// Fuentes incluidas. Devuelven una fuente con read == NULL si falla la apertura.
+PlanSource plan_source_csv(const char *path);
+PlanSource plan_source_archive(const char *path);
+// No copia C: el array debe vivir mientras viva la fuente (se ordena un índice aparte)
+PlanSource plan_source_array(const Contact *C, int N);
+
+typedef struct
+{
+    double horizon;      // segundos por delante de now que se mantienen en la ventana
+    double period;       // >0: al agotar la fuente se rebobina desplazando los tiempos
+    int    prefetch;     // 1 = hilo de lectura en segundo plano
+    int    queue_cap;    // contactos máximos en cola de prefetch (0 = 16384)
+    int    chunk;        // contactos por lectura de la fuente (0 = 1024)
+} PlanStreamCfg;
+
+typedef struct
+{
+    int64_t admitted;    // contactos que entraron en la ventana
+    int64_t retired;     // contactos retirados (incluye los ya vencidos al llegar)
+    int64_t read;        // contactos leídos de la fuente
+    int     window;      // contactos en la ventana tras el último advance
+    int     peak_window; // máximo histórico de la ventana
+    int     queued;      // contactos en cola tras el último advance
+    int     stalls;      // veces que advance esperó al hilo de prefetch
+    int     wraps;       // rebobinados de la fuente (periodización)
+} PlanStreamStats;
+
+typedef struct PlanStream PlanStream;
+
+// Toma posesión de la fuente (se cierra en plan_stream_close)
+PlanStream* plan_stream_open(PlanSource src, const PlanStreamCfg *cfg);
+
+// Desliza la ventana a [now, now + horizon]. `now` debe ser no decreciente.
+// Devuelve el número de contactos en la ventana o -1 si la fuente falló.
+int plan_stream_advance(PlanStream *ps, double now);
+
+// Contactos de la ventana en orden de t_start. Válido hasta el siguiente advance.
+const Contact* plan_stream_contacts(const PlanStream *ps, int *n);
+
+PlanStreamStats plan_stream_stats(PlanStream *ps);
+void plan_stream_close(PlanStream *ps);
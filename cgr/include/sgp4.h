@@ -0,0 +1,78 @@
+#pragma once
+
+/* Propagador SGP4 (modelo cercano a la Tierra, constantes WGS72) sobre TLE.
+ *
+ * Misma formulación que la referencia de Vallado (sgp4init + sgp4, modo
+ * mejorado): posiciones y velocidades en el marco TEME. Solo órbitas con
+ * periodo < 225 min (todo LEO y buena parte de MEO baja); las de espacio
+ * profundo (SDP4: resonancias luni-solares) se marcan y no se propagan.
+ * Los tiempos de la API son segundos Unix UTC.
+ */
+
+#define SGP4_RE_KM     6378.135      // radio ecuatorial WGS72 (km)
+#define SGP4_MU        398600.8      // km^3/s^2 (WGS72)
+#define SGP4_J2        0.001082616
+
+typedef enum
+{
+    SGP4_OK = 0,
+    SGP4_ERR_ECC,        // excentricidad media fuera de [0, 1)
+    SGP4_ERR_MOTION,     // movimiento medio <= 0
+    SGP4_ERR_SEMILATUS,  // semilatus rectum < 0
+    SGP4_ERR_DECAYED,    // radio < 1 radio terrestre (reentrada)
+    SGP4_ERR_DEEP_SPACE, // periodo >= 225 min: requiere SDP4 (no soportado)
+    SGP4_ERR_PARSE       // TLE mal formado / checksum
+} Sgp4Error;
+
+// Elementos de un TLE y coeficientes precalculados por sgp4_init
+typedef struct
+{
+    int catnum;             // número de catálogo NORAD
+    char name[25];          // línea 0 (puede quedar vacía)
+    double epoch_unix;      // época del TLE (s Unix UTC)
+    // Elementos medios (rad, rad/min)
+    double bstar, inclo, nodeo, ecco, argpo, mo, no_kozai;
+    // Derivados
+    double no_unkozai, ao, con41, x1mth2, x7thm1, cc1, cc4, cc5, d2, d3, d4,
+           delmo, eta, argpdot, omgcof, sinmao, t2cof, t3cof, t4cof, t5cof,
+           xlcof, aycof, xmcof, nodecf, nodedot, mdot;
+    int isimp;              // perigeo < 220 km: fórmulas truncadas
+    int error;              // Sgp4Error de la inicialización
+} Sgp4Sat;
+
+// Lee un TLE (line0 puede ser NULL) e inicializa s. Devuelve Sgp4Error.
+int sgp4_parse_tle(const char *line0, const char *line1, const char *line2, Sgp4Sat *s);
+
+// Inicializa los coeficientes a partir de los elementos ya rellenos
+int sgp4_init(Sgp4Sat *s);
+
+// Posición (km) y velocidad (km/s) TEME a tsince_min minutos de la época.
+// Devuelve Sgp4Error; r y v solo son válidos con SGP4_OK.
+int sgp4_propagate(const Sgp4Sat *s, double tsince_min, double r[3], double v[3]);
+
+// Igual con tiempo absoluto (s Unix UTC)
+static inline int sgp4_at(const Sgp4Sat *s, double t_unix, double r[3], double v[3]) {
+    return sgp4_propagate(s, (t_unix - s->epoch_unix) / 60.0, r, v);
+}
+
+// Elementos medios seculares (sin periódicos) a tsince_min minutos de la época
+typedef struct
+{
+    double a_km, ecc;         // semieje mayor (km) y excentricidad
+    double incl, node, argp;  // rad
+    double periodic_km;       // cota de |r osculador - r medio| por los periódicos
+} Sgp4Mean;
+
+int sgp4_mean_elements(const Sgp4Sat *s, double tsince_min, Sgp4Mean *m);
+
+// Tiempo sidéreo medio de Greenwich (rad, IAU-82): giro TEME -> ECEF en z
+double sgp4_gmst(double t_unix);
+
+/* Catálogo desde un fichero TLE (formato de 2 o 3 líneas, mezcla admitida;
+   líneas vacías y '#' ignoradas). *out se reserva con malloc; los TLE que no
+   se pueden leer se saltan y se cuentan en *bad (puede ser NULL). Devuelve
+   el número de satélites o -1 si el fichero no se puede abrir. Los de
+   espacio profundo se incluyen con error = SGP4_ERR_DEEP_SPACE. */
+int sgp4_load_catalog(const char *path, Sgp4Sat **out, int *bad);
+
+const char* sgp4_error_name(int err);
@@ -0,0 +1,53 @@
+#pragma once
+#include "sgp4.h"
+
+/* Propagación SGP4 por lotes: muchos satélites × muchos instantes.
+ *
+ * Los coeficientes de sgp4_init se guardan en columnas (SoA, una por
+ * coeficiente) y el mismo SGP4 de sgp4_propagate se evalúa para 4 satélites
+ * por iteración con AVX2 (seno, coseno y atan2 vectoriales de libmvec). La
+ * variante la elige cgr_simd_level(), como el núcleo de ETA; en CPUs sin
+ * AVX2 (o sin libmvec) cada satélite pasa por sgp4_propagate.
+ * La aritmética es la misma y en el mismo orden, pero las funciones
+ * vectoriales de libmvec y fmod/pow reescritos no redondean igual que libm:
+ * las posiciones difieren del escalar en unos ULP (< 1 µm en LEO).
+ */
+
+typedef struct
+{
+    int n;                  // satélites
+    int npad;               // n redondeado al ancho vectorial (columnas)
+    Sgp4Sat *sat;           // copia de los elementos (ruta escalar)
+    unsigned char *valid;   // [n] inicialización sin error
+    double *block;          // todas las columnas en una reserva
+    // Columnas [npad]: seculares, arrastre y periódicos (los términos que
+    // sgp4_propagate salta con isimp van a 0, así no hay ramas por satélite)
+    double *epoch, *mo, *mdot, *argpo, *argpdot, *nodeo, *nodedot, *nodecf;
+    double *cc1, *bcc4, *t2cof, *omgcof, *eta, *xmcof, *delmo, *d2, *d3, *d4;
+    double *bcc5, *sinmao, *t3cof, *t4cof, *t5cof, *no_unkozai, *a0, *ecco;
+    double *inclo, *sinip, *cosip, *aycof, *xlcof, *con41, *x1mth2, *x7thm1;
+} Sgp4Batch;
+
+// Copia n satélites inicializados (los que tienen error quedan inválidos).
+// 0 o -1 (sin memoria).
+int sgp4_batch_init(Sgp4Batch *B, const Sgp4Sat *S, int n);
+void sgp4_batch_free(Sgp4Batch *B);
+
+/* Todos los satélites en t (s Unix UTC): pos y vel [3n] (km, km/s, TEME;
+   vel puede ser NULL), ok[n] = 1 si la propagación es válida. Con
+   active != NULL solo se garantizan los satélites marcados (los bloques
+   vectoriales sin ninguno activo se saltan). Devuelve los válidos. */
+int sgp4_batch_at(const Sgp4Batch *B, double t_unix, const unsigned char *active,
+                  double *pos, double *vel, unsigned char *ok);
+
+/* nt instantes repartidos entre hilos: pos y vel [nt · n · 3] ordenados por
+   instante y satélite (vel puede ser NULL), ok [nt · n]. Devuelve 0 o -1. */
+int sgp4_batch_grid(const Sgp4Batch *B, const double *t_unix, int nt,
+                    double *pos, double *vel, unsigned char *ok, int threads);
+
+/* Interfaz plana para enlazar desde otros lenguajes (ctypes): crea el lote
+   desde las líneas 1 y 2 de n TLE (los ilegibles quedan inválidos) y lo
+   libera. NULL si no hay memoria. */
+Sgp4Batch* sgp4_batch_from_tle(const char *const *line1, const char *const *line2, int n);
+void sgp4_batch_destroy(Sgp4Batch *B);
+int sgp4_batch_valid(const Sgp4Batch *B, unsigned char *valid);
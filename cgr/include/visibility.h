@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include "sgp4_batch.h"
+
+/* Ventanas de visibilidad (línea de vista) para planes de contacto.
+ *
+ * Cada enlace tiene una función de visibilidad g(t), positiva cuando hay
+ * línea de vista: para estación–satélite la elevación sobre la máscara de
+ * la estación; para satélite–satélite la altura mínima de la línea de vista
+ * sobre la Tierra menos grazing_km (y, con alcance, alcance - distancia).
+ * g se muestrea cada step_s sobre las trayectorias del lote (sgp4_batch) y
+ * los cambios de signo entre muestras se refinan con búsqueda de raíz
+ * (regula falsi con SGP4 exacto) hasta tol_s: los bordes no dependen del
+ * paso. Un paso corto (máximo de g entre dos muestras negativas) se detecta
+ * con las derivadas en las muestras y se busca el máximo antes de descartar
+ * el intervalo. Del mismo modo, los extremos del alcance entre muestras
+ * (derivada con cambio de signo) se buscan con SGP4 exacto: min_km y max_km
+ * no dependen del paso. Los enlaces se reparten entre hilos.
+ */
+
+typedef struct
+{
+    char name[32];
+    double lat_deg, lon_deg;  // geodésicas (WGS84)
+    double alt_km;
+    double min_elev_deg;      // máscara de elevación
+} VisStation;
+
+typedef struct
+{
+    double t_begin, t_end;  // intervalo (s Unix UTC)
+    double step_s;          // muestreo grueso (<= 0 = 60 s)
+    double tol_s;           // precisión de los bordes (<= 0 = 1 ms)
+    int isl;                // 1 = ventanas entre todos los pares de satélites
+    double isl_range_km;    // alcance ISL (<= 0 = solo ocultación terrestre)
+    double grazing_km;      // altura mínima de la línea de vista ISL (atmósfera)
+    int threads;            // <= 0 = 1
+} VisConfig;
+
+#define VIS_CLIP_START 0x1  // visible ya en t_begin
+#define VIS_CLIP_END   0x2  // sigue visible en t_end
+
+typedef struct
+{
+    int station;            // índice de estación, -1 en ISL
+    int a, b;               // ISL: satélites a < b; estación: a = satélite, b = -1
+    double t_start, t_end;  // s Unix UTC
+    double min_km, max_km;  // alcance mínimo / máximo en la ventana
+    double owlt_s;          // max_km / c: cota del retardo de propagación
+    int clip;               // VIS_CLIP_*
+} VisWindow;
+
+typedef struct
+{
+    VisWindow *items;       // ordenadas por (t_start, station, a, b)
+    int count;
+    uint64_t links;         // enlaces evaluados
+    int steps;
+    uint64_t roots;         // bordes refinados
+    uint64_t peaks;         // máximos buscados entre muestras
+    double elapsed_s;
+} VisResult;
+
+// 0 o -1 (parámetros inválidos / sin memoria)
+int vis_windows(const Sgp4Batch *B, const VisStation *st, int nst, const VisConfig *cfg, VisResult *out);
+void vis_result_free(VisResult *r);
@@ -11,6 +11,7 @@
 
 #include "cgr.h"
 #include "nasa_api.h"
+#include "penalty.h"
 
 static volatile sig_atomic_t g_stop = 0;
 static void on_sigint(int s){ (void)s; g_stop = 1; }
@@ -29,19 +30,34 @@ typedef struct
     bool   learn_ewma;    // penalización suave por enlace
     double alpha;         // coeficiente EWMA [0..1]
     double lambda_;       // peso de penalización en segundos
+    const char *penalties;// fichero id,penalty_s (se carga al inicio y se guarda al salir)
+    const char *reports;  // informes por salto: from,to,planned_bps,achieved_bps,extra_delay_s,failed
 } Cfg;
 
-typedef struct
+/* Lee las líneas nuevas del fichero de informes (seguimiento tipo tail:
+   el FILE* queda abierto y cada ciclo continúa donde se quedó). */
+static int ingest_reports(FILE *f, LinkTable *T)
 {
-    double penalty_s;
-} EdgeState;
+    char line[256];
+    int n = 0;
+    clearerr(f);
+    while(fgets(line, sizeof(line), f)){
+        if(line[0]=='#' || line[0]=='\n') continue;
+        HopReport r = {0};
+        if(sscanf(line, "%d,%d,%lf,%lf,%lf,%d", &r.from, &r.to, &r.planned_bps,
+                  &r.achieved_bps, &r.extra_delay_s, &r.failed) != 6) continue;
+        if(link_report(T, &r) >= 0) n++;
+    }
+    return n;
+}
 
 static void usage(const char *p)
 {
     fprintf(stderr,
     "Uso (API SODA):\n"
     "  %s --dataset <id> [--app-token TOKEN] --src N --dst N --t0 s --bytes B [--k N]\n"
-    "     [--cycles M] [--tick s] [--consume] [--learn-ewma --alpha A --lambda L]\n\n"
+    "     [--cycles M] [--tick s] [--consume] [--learn-ewma --alpha A --lambda L]\n"
+    "     [--penalties FILE] [--reports FILE]\n\n"
     "Ejemplo:\n"
     "  %s --dataset abcd-1234 --app-token TU_TOKEN --src 100 --dst 200 --t0 0 --bytes 5e7 --k 3 --cycles 30 --tick 10 --consume --learn-ewma --alpha 0.2 --lambda 1.0\n",
     p,p);
@@ -55,7 +71,8 @@ int main(int argc, char **argv)
         .dataset_id=NULL, .app_token=NULL,
         .src=100, .dst=200, .t0=0.0, .bundle_bytes=5e7,
         .k_alt=3, .cycles=1, .tick_s=10.0,
-        .consume=false, .learn_ewma=false, .alpha=0.2, .lambda_=1.0
+        .consume=false, .learn_ewma=false, .alpha=0.2, .lambda_=1.0,
+        .penalties=NULL, .reports=NULL
     };
 
     for(int i=1;i<argc;i++){
@@ -73,6 +90,8 @@ int main(int argc, char **argv)
         else if(!strcmp(argv[i],"--learn-ewma")) cfg.learn_ewma = true;
         else if(!strcmp(argv[i],"--alpha") && i+1<argc) cfg.alpha = strtod(argv[++i],NULL);
         else if(!strcmp(argv[i],"--lambda") && i+1<argc) cfg.lambda_ = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--penalties") && i+1<argc) cfg.penalties = argv[++i];
+        else if(!strcmp(argv[i],"--reports") && i+1<argc) cfg.reports = argv[++i];
         else { fprintf(stderr,"Flag no reconocido: %s\n", argv[i]); usage(argv[0]); return 2; }
     }
     if(!cfg.dataset_id){ fprintf(stderr,"Error: --dataset es obligatorio\n"); usage(argv[0]); return 2; }
@@ -95,38 +114,46 @@ int main(int argc, char **argv)
     }
     printf("✓ API OK — contactos: %d\n\n", N);
 
-    EdgeState *E = (EdgeState*)calloc(N, sizeof(EdgeState));
+    // El plan no se copia por ciclo: las penalizaciones viven en un overlay que
+    // la búsqueda suma a setup_s, y el índice de vecinos se construye una vez
+    // (consumir capacidad solo toca residual_bytes).
+    NeighborIndex *NI = build_neighbor_index(C, N);
+    bool use_ov = cfg.learn_ewma || cfg.reports;
+    CgrOverlay *ov = use_ov ? overlay_new(N, cfg.learn_ewma ? cfg.lambda_ : 0.0) : NULL;
+    LinkTable *links = cfg.reports ? link_table_new(N, cfg.alpha, 0.95) : NULL;
+    if(!NI || (use_ov && !ov) || (cfg.reports && (!links || overlay_bind_links(ov, links, C, N) != 0))){
+        fprintf(stderr,"Sin memoria\n");
+        free_neighbor_index(NI); overlay_free(ov); link_table_free(links); free(C);
+        return 1;
+    }
+    FILE *rf = NULL;
+    if(cfg.reports && !(rf = fopen(cfg.reports, "r")))
+        fprintf(stderr,"Aviso: no se pudo abrir %s (sin informes)\n", cfg.reports);
+    if(cfg.learn_ewma && cfg.penalties){
+        int n = overlay_load(ov, C, N, cfg.penalties);
+        if(n >= 0) printf("✓ Penalizaciones: %d cargadas de %s\n\n", n, cfg.penalties);
+        else fprintf(stderr,"Aviso: no se cargó %s (fichero ilegible o ids de contacto repetidos)\n\n", cfg.penalties);
+    }
 
     double now = cfg.t0;
     for(int cycle=1; cycle<=cfg.cycles && !g_stop; cycle++){
         printf("── Ciclo %d | t=%.1f s ─────────────────────────────────\n", cycle, now);
-
-        Contact *W = (Contact*)malloc(sizeof(Contact)*N);
-        memcpy(W, C, sizeof(Contact)*N);
-        if(cfg.learn_ewma){
-            for(int i=0;i<N;i++)
-			{
-                W[i].setup_s += cfg.lambda_ * E[i].penalty_s;
-            }
+        if(rf){
+            int n = ingest_reports(rf, links);
+            if(n > 0) printf("  feedback: %d informes de salto\n", n);
         }
 
-        NeighborIndex *NI = build_neighbor_index(W, N);
-
-        CgrParams P = { .src_node=cfg.src, .dst_node=cfg.dst, .t0=now, .bundle_bytes=cfg.bundle_bytes, .expiry=0.0 };
-        Route best = cgr_best_route(W, N, &P, NI);
+        CgrParams P = { .src_node=cfg.src, .dst_node=cfg.dst, .t0=now, .bundle_bytes=cfg.bundle_bytes,
+                        .expiry=0.0, .overlay=ov };
+        Route best = cgr_best_route(C, N, &P, NI);
 
         if(best.found)
 		{
             double wait_s = 0.0;
-            if(best.hops>0){
-                int cid = best.contact_ids[0];
-                for(int i=0;i<N;i++){
-                    if(W[i].id==cid){
-                        double start_tx = fmax(now, W[i].t_start);
-                        wait_s = fmax(0.0, start_tx - now);
-                        break;
-                    }
-                }
+            int i0 = best.hops>0 ? best.contact_idxs[0] : -1;
+            if(i0 >= 0){
+                double start_tx = fmax(now, C[i0].t_start);
+                wait_s = fmax(0.0, start_tx - now);
             }
 
             printf("  Ruta óptima:\n");
@@ -137,7 +164,7 @@ int main(int argc, char **argv)
             printf("\n");
 
             if(cfg.k_alt>0){
-                Routes RS = cgr_k_yen(W, N, &P, NI, cfg.k_alt);
+                Routes RS = cgr_k_yen(C, N, &P, NI, cfg.k_alt);
                 printf("  Alternativas (K=%d):\n", RS.count);
                 for(int r=0;r<RS.count;r++){
                     printf("    #%d: ETA=%.3f s, hops=%d\n", r+1, RS.items[r].eta, RS.items[r].hops);
@@ -148,37 +175,25 @@ int main(int argc, char **argv)
             if(cfg.consume){
                 for(int i=0;i<best.hops;i++){
                     int cid = best.contact_ids[i];
-                    for(int j=0;j<N;j++){
-                        if(C[j].id==cid){
-                            double before = C[j].residual_bytes;
-                            if(C[j].residual_bytes > cfg.bundle_bytes)
-                                C[j].residual_bytes -= cfg.bundle_bytes;
-                            else
-                                C[j].residual_bytes = 0;
-                            printf("    consume: contacto %d  residual %.0f → %.0f\n",
-                                   cid, before, C[j].residual_bytes);
-                            break;
-                        }
-                    }
+                    int j = best.contact_idxs[i];
+                    double before = C[j].residual_bytes;
+                    if(C[j].residual_bytes > cfg.bundle_bytes)
+                        C[j].residual_bytes -= cfg.bundle_bytes;
+                    else
+                        C[j].residual_bytes = 0;
+                    printf("    consume: contacto %d  residual %.0f → %.0f\n",
+                           cid, before, C[j].residual_bytes);
                 }
             }
-            if(cfg.learn_ewma && best.hops>0){
-                int cid0 = best.contact_ids[0];
-                for(int i=0;i<N;i++){
-                    if(C[i].id==cid0){
-                        E[i].penalty_s = (1.0 - cfg.alpha)*E[i].penalty_s + cfg.alpha*wait_s;
-                        printf("    learn: contacto %d  penalty:= %.3f s\n", cid0, E[i].penalty_s);
-                        break;
-                    }
-                }
+            if(cfg.learn_ewma && i0 >= 0){
+                double pen = overlay_ewma(ov, i0, wait_s, cfg.alpha);
+                printf("    learn: contacto %d  penalty:= %.3f s\n", best.contact_ids[0], pen);
             }
         } else {
             printf("  ⚠️  No hay ruta disponible\n");
         }
 
         free_route(&best);
-        free_neighbor_index(NI);
-        free(W);
 
         now += cfg.tick_s;
         if(cycle < cfg.cycles) {
@@ -187,7 +202,16 @@ int main(int argc, char **argv)
         }
     }
 
-    free(E);
+    if(cfg.learn_ewma && cfg.penalties){
+        int n = overlay_save(ov, C, N, cfg.penalties);
+        if(n >= 0) printf("✓ Penalizaciones: %d guardadas en %s\n", n, cfg.penalties);
+        else fprintf(stderr,"No se pudo escribir %s (fichero o ids de contacto repetidos)\n", cfg.penalties);
+    }
+
+    if(rf) fclose(rf);
+    overlay_free(ov);
+    link_table_free(links);
+    free_neighbor_index(NI);
     free(C);
     printf("\n✓ Finalizado.\n");
     return 0;
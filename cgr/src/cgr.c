@@ -2,18 +2,22 @@
 #include <stdlib.h>
 #include <string.h>
 #include <float.h>
+#include <math.h>
 #include <stdio.h>
 #include <limits.h>
+#include <pthread.h>
 #include "cgr.h"
 #include "heap.h"
 #include "leo_metrics.h"
+#include "penalty.h"
+#include "eta_kernel.h"
 
 // ═══════════════════════════════════════════════════════════════════════════
 // Constantes y macros
 // ═══════════════════════════════════════════════════════════════════════════
 
-#define EPS_TIME  1e-12   // Tolerancia temporal (femtosegundos)
-#define EPS_BYTES 1e-9    // Tolerancia de capacidad (~1 byte)
+#define EPS_TIME  CGR_EPS_TIME    // Tolerancia temporal (femtosegundos)
+#define EPS_BYTES CGR_EPS_BYTES   // Tolerancia de capacidad (~1 byte)
 
 // Debug opcional (compilar con -DDEBUG_VERBOSE)
 #ifdef DEBUG_VERBOSE
@@ -28,10 +32,63 @@ static inline int max3(int a, int b, int c) {
 }
 
 // ═══════════════════════════════════════════════════════════════════════════
-// Construcción del índice by_from
+// Construcción del índice de vecinos (by_from / by_to, layout CSR)
 // ═══════════════════════════════════════════════════════════════════════════
 
+/* Merge sort bottom-up (estable) de un grupo de índices por t_end. */
+static void sort_bucket_by_t_end(int *idx, int n, int *tmp, const Contact *C) {
+    for (int width = 1; width < n; width *= 2) {
+        for (int lo = 0; lo < n; lo += 2 * width) {
+            int mid = lo + width < n ? lo + width : n;
+            int hi = lo + 2 * width < n ? lo + 2 * width : n;
+            int a = lo, b = mid, k = lo;
+            while (a < mid && b < hi) {
+                tmp[k++] = (C[idx[b]].t_end < C[idx[a]].t_end) ? idx[b++] : idx[a++];
+            }
+            while (a < mid) tmp[k++] = idx[a++];
+            while (b < hi) tmp[k++] = idx[b++];
+        }
+        memcpy(idx, tmp, sizeof(int) * n);
+    }
+}
+
+/* Convierte un histograma (cnt[v] = tamaño del grupo v) en vistas IndexList
+   sobre `pool`. Deja en cnt[v] el offset de escritura de cada grupo. */
+static void csr_assign_lists(IndexList *lists, int *cnt, int *pool, int node_cap) {
+    int off = 0;
+    for (int v = 0; v < node_cap; v++) {
+        int c = cnt[v];
+        lists[v].idxs = pool + off;
+        lists[v].count = c;
+        lists[v].cap = c;
+        cnt[v] = off;
+        off += c;
+    }
+}
+
+static int sort_by_to_lists(NeighborIndex *ni, const Contact *C, int N) {
+    int *tmp = (int*)malloc(sizeof(int) * (N > 0 ? N : 1));
+    if (!tmp) return -1;
+    for (int v = 0; v < ni->node_cap; v++) {
+        IndexList *L = &ni->by_to[v];
+        sort_bucket_by_t_end(L->idxs, L->count, tmp, C);
+    }
+    free(tmp);
+    return 0;
+}
+
+static void free_by_to(NeighborIndex *ni) {
+    free(ni->by_to);
+    free(ni->to_pool);
+    ni->by_to = NULL;
+    ni->to_pool = NULL;
+}
+
 NeighborIndex* build_neighbor_index(const Contact *C, int N) {
+    return build_neighbor_index_ex(C, N, 0);
+}
+
+NeighborIndex* build_neighbor_index_ex(const Contact *C, int N, int flags) {
     if (!C || N <= 0) return NULL;
     
     // Encontrar nodo máximo para dimensionar el array
@@ -43,41 +100,292 @@ NeighborIndex* build_neighbor_index(const Contact *C, int N) {
     NeighborIndex *ni = (NeighborIndex*)calloc(1, sizeof(NeighborIndex));
     if (!ni) return NULL;
     
+    int with_to = !(flags & NI_LAZY_BY_TO);
     ni->node_cap = maxNode + 1;
     ni->by_from = (IndexList*)calloc(ni->node_cap, sizeof(IndexList));
-    if (!ni->by_from) {
-        free(ni);
+    ni->from_pool = (int*)malloc(sizeof(int) * N);
+    if (with_to) {
+        ni->by_to = (IndexList*)calloc(ni->node_cap, sizeof(IndexList));
+        ni->to_pool = (int*)malloc(sizeof(int) * N);
+    }
+    int *cnt_from = (int*)calloc(ni->node_cap, sizeof(int));
+    int *cnt_to = (int*)calloc(ni->node_cap, sizeof(int));
+    if (!ni->by_from || !ni->from_pool || !cnt_from || !cnt_to ||
+        (with_to && (!ni->by_to || !ni->to_pool))) {
+        free(cnt_from);
+        free(cnt_to);
+        free_neighbor_index(ni);
         return NULL;
     }
 
-    // Agrupar contactos por nodo origen
+    // Counting sort en una sola pasada para ambos sentidos: histograma,
+    // prefijo y scatter (preserva el orden original dentro de cada grupo)
     for (int i = 0; i < N; i++) {
-        int from = C[i].from;
-        if (from < 0 || from >= ni->node_cap) continue;
-        
-        IndexList *L = &ni->by_from[from];
-        if (L->count >= L->cap) {
-            L->cap = (L->cap == 0 ? 8 : L->cap * 2);
-            int *new_idxs = (int*)realloc(L->idxs, sizeof(int) * L->cap);
-            if (!new_idxs) continue; // Skip en caso de fallo de memoria
-            L->idxs = new_idxs;
-        }
-        L->idxs[L->count++] = i;
+        if (C[i].from >= 0) cnt_from[C[i].from]++;
+        if (C[i].to >= 0) cnt_to[C[i].to]++;
+    }
+    csr_assign_lists(ni->by_from, cnt_from, ni->from_pool, ni->node_cap);
+    if (with_to) csr_assign_lists(ni->by_to, cnt_to, ni->to_pool, ni->node_cap);
+
+    for (int i = 0; i < N; i++) {
+        if (C[i].from >= 0) ni->from_pool[cnt_from[C[i].from]++] = i;
+        if (with_to && C[i].to >= 0) ni->to_pool[cnt_to[C[i].to]++] = i;
+    }
+    free(cnt_from);
+    free(cnt_to);
+
+    if (with_to && sort_by_to_lists(ni, C, N) != 0) {
+        free_neighbor_index(ni);
+        return NULL;
     }
     
-    DEBUG_PRINT("Índice construido: %d nodos, %d contactos\n", ni->node_cap, N);
+    DEBUG_PRINT("Índice construido: %d nodos, %d contactos, by_to=%s\n",
+                ni->node_cap, N, with_to ? "sí" : "perezoso");
     return ni;
 }
 
+/* Construcción paralela: counting sort con histograma por hilo.
+   El hilo t cubre el tramo [lo, hi) de C[]; su offset de escritura en el
+   grupo v es base[v] + Σ_{t'<t} cnt[t'][v], así que el resultado es
+   idéntico al de la versión secuencial (orden de C[] dentro de cada grupo). */
+
+typedef struct {
+    const Contact *C;
+    NeighborIndex *ni;
+    int lo, hi;              // tramo de contactos
+    int v_lo, v_hi;          // tramo de nodos (fase de ordenación)
+    int max_node;
+    int with_to;
+    int *cnt_from, *cnt_to;  // histograma local → offsets de escritura
+    int *tmp;
+} NiTask;
+
+static void* ni_task_max(void *arg) {
+    NiTask *t = (NiTask*)arg;
+    int m = 0;
+    for (int i = t->lo; i < t->hi; i++) m = max3(m, t->C[i].from, t->C[i].to);
+    t->max_node = m;
+    return NULL;
+}
+
+static void* ni_task_count(void *arg) {
+    NiTask *t = (NiTask*)arg;
+    for (int i = t->lo; i < t->hi; i++) {
+        if (t->C[i].from >= 0) t->cnt_from[t->C[i].from]++;
+        if (t->with_to && t->C[i].to >= 0) t->cnt_to[t->C[i].to]++;
+    }
+    return NULL;
+}
+
+static void* ni_task_scatter(void *arg) {
+    NiTask *t = (NiTask*)arg;
+    for (int i = t->lo; i < t->hi; i++) {
+        if (t->C[i].from >= 0) t->ni->from_pool[t->cnt_from[t->C[i].from]++] = i;
+        if (t->with_to && t->C[i].to >= 0) t->ni->to_pool[t->cnt_to[t->C[i].to]++] = i;
+    }
+    return NULL;
+}
+
+static void* ni_task_sort(void *arg) {
+    NiTask *t = (NiTask*)arg;
+    for (int v = t->v_lo; v < t->v_hi; v++) {
+        IndexList *L = &t->ni->by_to[v];
+        sort_bucket_by_t_end(L->idxs, L->count, t->tmp + (L->idxs - t->ni->to_pool), t->C);
+    }
+    return NULL;
+}
+
+static void ni_run_phase(NiTask *tasks, pthread_t *th, int threads, void *(*fn)(void*)) {
+    int spawned = 0;
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&th[t], NULL, fn, &tasks[t]) != 0) break;
+        spawned = t;
+    }
+    fn(&tasks[0]);
+    for (int t = spawned + 1; t < threads; t++) fn(&tasks[t]); // sin hilo: en serie
+    for (int t = 1; t <= spawned; t++) pthread_join(th[t], NULL);
+}
+
+static void ni_tasks_free(NiTask *tasks, pthread_t *th, int *tmp, int threads) {
+    if (tasks) {
+        for (int t = 0; t < threads; t++) {
+            free(tasks[t].cnt_from);
+            free(tasks[t].cnt_to);
+        }
+    }
+    free(tasks);
+    free(th);
+    free(tmp);
+}
+
+static NeighborIndex* ni_parallel_fail(NeighborIndex *ni, NiTask *tasks, pthread_t *th,
+                                       int *tmp, int threads) {
+    ni_tasks_free(tasks, th, tmp, threads);
+    free_neighbor_index(ni);
+    return NULL;
+}
+
+NeighborIndex* build_neighbor_index_parallel(const Contact *C, int N, int flags, int threads) {
+    if (!C || N <= 0) return NULL;
+    if (threads > N / 1024) threads = N / 1024;
+    if (threads <= 1) return build_neighbor_index_ex(C, N, flags);
+
+    NiTask *tasks = (NiTask*)calloc(threads, sizeof(NiTask));
+    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t) * threads);
+    NeighborIndex *ni = (NeighborIndex*)calloc(1, sizeof(NeighborIndex));
+    int *tmp = NULL;
+    if (!tasks || !th || !ni) return ni_parallel_fail(ni, tasks, th, tmp, threads);
+
+    int with_to = !(flags & NI_LAZY_BY_TO);
+    for (int t = 0; t < threads; t++) {
+        tasks[t].C = C;
+        tasks[t].ni = ni;
+        tasks[t].lo = (int)((long long)N * t / threads);
+        tasks[t].hi = (int)((long long)N * (t + 1) / threads);
+        tasks[t].with_to = with_to;
+    }
+
+    // Fase 0: nodo máximo
+    ni_run_phase(tasks, th, threads, ni_task_max);
+    int maxNode = 0;
+    for (int t = 0; t < threads; t++) if (tasks[t].max_node > maxNode) maxNode = tasks[t].max_node;
+    int V = maxNode + 1;
+
+    ni->node_cap = V;
+    ni->by_from = (IndexList*)calloc(V, sizeof(IndexList));
+    ni->from_pool = (int*)malloc(sizeof(int) * N);
+    if (!ni->by_from || !ni->from_pool) return ni_parallel_fail(ni, tasks, th, tmp, threads);
+    if (with_to) {
+        ni->by_to = (IndexList*)calloc(V, sizeof(IndexList));
+        ni->to_pool = (int*)malloc(sizeof(int) * N);
+        tmp = (int*)malloc(sizeof(int) * N);
+        if (!ni->by_to || !ni->to_pool || !tmp) return ni_parallel_fail(ni, tasks, th, tmp, threads);
+    }
+    for (int t = 0; t < threads; t++) {
+        tasks[t].cnt_from = (int*)calloc(V, sizeof(int));
+        tasks[t].cnt_to = with_to ? (int*)calloc(V, sizeof(int)) : NULL;
+        if (!tasks[t].cnt_from || (with_to && !tasks[t].cnt_to)) {
+            return ni_parallel_fail(ni, tasks, th, tmp, threads);
+        }
+    }
+
+    // Fase 1: histogramas por hilo
+    ni_run_phase(tasks, th, threads, ni_task_count);
+
+    // Prefijo global (nodo mayor, hilo menor) → offsets de escritura por hilo
+    int off_f = 0, off_t = 0;
+    for (int v = 0; v < V; v++) {
+        ni->by_from[v].idxs = ni->from_pool + off_f;
+        if (with_to) ni->by_to[v].idxs = ni->to_pool + off_t;
+        int base_f = off_f, base_t = off_t;
+        for (int t = 0; t < threads; t++) {
+            int cf = tasks[t].cnt_from[v];
+            tasks[t].cnt_from[v] = off_f;
+            off_f += cf;
+            if (with_to) {
+                int ct = tasks[t].cnt_to[v];
+                tasks[t].cnt_to[v] = off_t;
+                off_t += ct;
+            }
+        }
+        ni->by_from[v].count = ni->by_from[v].cap = off_f - base_f;
+        if (with_to) ni->by_to[v].count = ni->by_to[v].cap = off_t - base_t;
+    }
+
+    // Fase 2: scatter
+    ni_run_phase(tasks, th, threads, ni_task_scatter);
+
+    // Fase 3: ordenar by_to por t_end, repartiendo nodos por volumen de contactos
+    if (with_to) {
+        int v = 0;
+        for (int t = 0; t < threads; t++) {
+            long long target = (long long)off_t * (t + 1) / threads;
+            tasks[t].v_lo = v;
+            while (v < V && (t == threads - 1 ||
+                             (long long)(ni->by_to[v].idxs - ni->to_pool) < target)) v++;
+            tasks[t].v_hi = v;
+            tasks[t].tmp = tmp;
+        }
+        ni_run_phase(tasks, th, threads, ni_task_sort);
+    }
+
+    ni_tasks_free(tasks, th, tmp, threads);
+    DEBUG_PRINT("Índice paralelo: %d nodos, %d contactos, %d hilos\n", V, N, threads);
+    return ni;
+}
+
+int neighbor_index_ensure_by_to(NeighborIndex *ni, const Contact *C, int N) {
+    if (!ni || !C || N <= 0) return -1;
+    if (ni->by_to) return 0;
+
+    ni->by_to = (IndexList*)calloc(ni->node_cap, sizeof(IndexList));
+    ni->to_pool = (int*)malloc(sizeof(int) * N);
+    int *cnt = (int*)calloc(ni->node_cap, sizeof(int));
+    if (!ni->by_to || !ni->to_pool || !cnt) {
+        free(cnt);
+        free_by_to(ni);
+        return -1;
+    }
+
+    for (int i = 0; i < N; i++) {
+        if (C[i].to >= 0 && C[i].to < ni->node_cap) cnt[C[i].to]++;
+    }
+    csr_assign_lists(ni->by_to, cnt, ni->to_pool, ni->node_cap);
+    for (int i = 0; i < N; i++) {
+        int to = C[i].to;
+        if (to >= 0 && to < ni->node_cap) ni->to_pool[cnt[to]++] = i;
+    }
+    free(cnt);
+
+    if (sort_by_to_lists(ni, C, N) != 0) {
+        free_by_to(ni);
+        return -1;
+    }
+    return 0;
+}
+
 void free_neighbor_index(NeighborIndex* ni) {
     if (!ni) return;
-    if (ni->by_from) {
-        for (int i = 0; i < ni->node_cap; i++) {
-            free(ni->by_from[i].idxs);
+    free(ni->by_from);
+    free(ni->from_pool);
+    free(ni->soa);
+    free_by_to(ni);
+    free(ni);
+}
+
+int neighbor_index_attach_soa(NeighborIndex *ni, const Contact *C, int N) {
+    if (!ni || !C || N <= 0 || !ni->from_pool) return -1;
+
+    // 5 columnas de N, cada una alineada a 64 bytes
+    size_t col = ((size_t)N + 7) & ~(size_t)7;
+    double *soa = (double*)aligned_alloc(64, sizeof(double) * col * 5);
+    if (!soa) return -1;
+    double *ts = soa, *te = soa + col, *su = soa + 2 * col, *rt = soa + 3 * col, *ow = soa + 4 * col;
+
+    for (int v = 0; v < ni->node_cap; v++) {
+        const IndexList *L = &ni->by_from[v];
+        int off = (int)(L->idxs - ni->from_pool);
+        for (int k = 0; k < L->count; k++) {
+            const Contact *c = &C[L->idxs[k]];
+            ts[off + k] = c->t_start;
+            te[off + k] = c->t_end;
+            su[off + k] = c->setup_s;
+            rt[off + k] = (c->rate_bps > 1.0) ? c->rate_bps : 1.0;
+            ow[off + k] = c->owlt;
         }
-        free(ni->by_from);
     }
-    free(ni);
+    free(ni->soa);
+    ni->soa = soa;
+    ni->soa_n = (int)col;
+    ni->soa_plan = C;
+    return 0;
+}
+
+// Columnas de los contactos de una lista by_from
+static inline EtaSoA soa_view(const NeighborIndex *NI, const IndexList *L) {
+    const double *base = NI->soa + (L->idxs - NI->from_pool);
+    size_t col = (size_t)NI->soa_n;
+    return (EtaSoA){ base, base + col, base + 2 * col, base + 3 * col, base + 4 * col };
 }
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -93,6 +401,12 @@ static inline int is_banned_id(int id, const CgrFilters *F) {
     return 0;
 }
 
+static inline int is_banned(int ci, const Contact *C, const CgrFilters *F) {
+    if (!F) return 0;
+    if (F->banned_mask && F->banned_mask[ci]) return 1;
+    return is_banned_id(C[ci].id, F);
+}
+
 static inline int forced_id_at(const CgrFilters *F, int k) {
     if (!F || !F->forced_prefix_ids || F->forced_count <= 0) return -1;
     if (k < 0 || k >= F->forced_count) return -1;
@@ -144,70 +458,109 @@ static int compute_prefix_done(int ci, const Label *lab, const Contact *C, const
 // Cálculos de capacidad y ETA
 // ═══════════════════════════════════════════════════════════════════════════
 
-static double available_bytes_window(const Contact *c, double t_in) {
-    if (t_in > c->t_end + EPS_TIME) return 0.0;
-    
+/* `extra` es el retardo de establecimiento añadido por el overlay de
+   penalizaciones (0 sin overlay); se suma a c->setup_s en todo el modelo.
+
+   Evaluador único de un contacto: ETA al final del contacto llegando a su
+   nodo de entrada en t_in, o DBL_MAX con *why = primer motivo de rechazo
+   (CgrReject). Calcula inicio, ventana, capacidad y fin una sola vez y
+   combina las condiciones sin saltos (máscara de bits + ctz), así que el
+   coste no depende de qué contactos se rechazan. Las expresiones son las
+   mismas que en la versión de dos pasadas (viabilidad + ETA), operación a
+   operación: los resultados no cambian ni en el último bit. */
+static inline double contact_eval(const Contact *c, double t_in, double bundle_bytes,
+                                  double expiry_abs, double extra, int *why) {
+    double te = c->t_end;
+    double setup = c->setup_s + extra;
     double start_tx = (t_in < c->t_start) ? c->t_start : t_in;
-    double window = c->t_end - start_tx - c->setup_s;
-    if (window <= EPS_TIME) return 0.0;
-    
     double rate = (c->rate_bps > 1.0) ? c->rate_bps : 1.0;
-    return window * rate;
+    double window = te - start_tx - setup;
+    double cap = window * rate;
+    cap = (c->residual_bytes < cap) ? c->residual_bytes : cap;
+    double finish = start_tx + setup + bundle_bytes / rate;
+    double eta = finish + c->owlt;
+
+    unsigned m = (unsigned)(t_in > te + EPS_TIME)
+               | (unsigned)(window <= EPS_TIME) << 1
+               | (unsigned)(cap + EPS_BYTES < bundle_bytes) << 2
+               | (unsigned)(finish > te + EPS_TIME) << 3
+               | (unsigned)((expiry_abs > 0.0) & (eta > expiry_abs + EPS_TIME)) << 4;
+    *why = m ? __builtin_ctz(m) + 1 : CGR_REJ_NONE;
+    return m ? DBL_MAX : eta;
 }
 
-// ✅ MEJORA: Pre-check rápido de viabilidad sin calcular ETA completo
-static inline int contact_is_viable(const Contact *c, double t_arrival, double bundle_bytes) {
-    // Check temporal básico
-    if (t_arrival > c->t_end + EPS_TIME) return 0;
-    
-    double start_tx = (t_arrival < c->t_start) ? c->t_start : t_arrival;
-    double window = c->t_end - start_tx - c->setup_s;
-    if (window <= EPS_TIME) return 0;
-    
-    // Check de capacidad
-    double rate = (c->rate_bps > 1.0) ? c->rate_bps : 1.0;
-    double cap_window = window * rate;
-    double cap_actual = (c->residual_bytes < cap_window) ? c->residual_bytes : cap_window;
-    
-    if (cap_actual + EPS_BYTES < bundle_bytes) return 0;
-    
-    // Check que la transmisión cabe en la ventana
-    double tx_time = bundle_bytes / rate;
-    double finish = start_tx + c->setup_s + tx_time;
-    if (finish > c->t_end + EPS_TIME) return 0;
-    
-    return 1;
+// Igual sin motivo (DBL_MAX = no viable)
+static inline double contact_eta(const Contact *c, double t_in, double bundle_bytes,
+                                 double expiry_abs, double extra) {
+    int why;
+    return contact_eval(c, t_in, bundle_bytes, expiry_abs, extra, &why);
 }
 
-// ETA al final del contacto, dado t_in (tiempo de llegada al nodo de entrada del contacto)
-static double eta_contact(const Contact *c, double t_in, double bundle_bytes, double expiry_abs) {
-    if (t_in > c->t_end + EPS_TIME) return DBL_MAX;
-    
-    double avail = available_bytes_window(c, t_in);
-    double cap = (c->residual_bytes < avail) ? c->residual_bytes : avail;
-    
-    if (cap + EPS_BYTES < bundle_bytes) return DBL_MAX;
+/* Instante más tardío en que el bundle puede estar en c->from y aún usar c
+   para llegar a c->to antes de `deadline`. -DBL_MAX si no es posible.
+   Invierte contact_eta en aritmética exacta, pero el valor cae justo en el
+   borde de la ventana y el redondeo puede dejarlo unos ulp fuera: usar
+   ldt_contact_checked cuando el resultado tiene que ser transitable. */
+static double ldt_contact(const Contact *c, double deadline, double bundle_bytes, double extra) {
+    if (c->residual_bytes + EPS_BYTES < bundle_bytes) return -DBL_MAX;
 
-    double start_tx = (t_in < c->t_start) ? c->t_start : t_in;
     double rate = (c->rate_bps > 1.0) ? c->rate_bps : 1.0;
     double tx_time = bundle_bytes / rate;
-    double finish = start_tx + c->setup_s + tx_time;
-    
-    if (finish > c->t_end + EPS_TIME) return DBL_MAX;
+    double latest_finish = deadline - c->owlt;
+    if (latest_finish > c->t_end) latest_finish = c->t_end;
+
+    double setup = c->setup_s + extra;
+    double ldt = latest_finish - setup - tx_time;
+    if (ldt + EPS_TIME < c->t_start) return -DBL_MAX;
+    if (c->t_end - ldt - setup <= EPS_TIME) return -DBL_MAX;
+    return ldt;
+}
 
-    double eta = finish + c->owlt;
-    
-    // Check de expiración
-    if (expiry_abs > 0.0 && eta > expiry_abs + EPS_TIME) return DBL_MAX;
-    
-    return eta;
+/* ldt_contact garantizado transitable: justo en el límite, ventana·tasa
+   puede quedarse unos ulp por debajo del bundle (o finish pasar de t_end),
+   así que se comprueba el salto hacia delante y se retrocede lo necesario.
+   Como contact_eta es monótona en t_in, cualquier salida anterior también
+   llega antes de `deadline`. -DBL_MAX si no se encuentra un valor válido. */
+static double ldt_contact_checked(const Contact *c, double deadline, double bundle_bytes, double extra) {
+    double ldt = ldt_contact(c, deadline, bundle_bytes, extra);
+    double step = fabs(ldt) * DBL_EPSILON + EPS_TIME;
+    for (int k = 0; ldt != -DBL_MAX && k < 64; k++, step *= 2.0) {
+        double eta = contact_eta(c, ldt, bundle_bytes, 0.0, extra);
+        if (eta != DBL_MAX && eta <= deadline) return ldt;
+        ldt -= step;
+    }
+    return -DBL_MAX;
 }
 
-// ✅ NUEVA: Métrica compuesta que considera LEO (DESPUÉS de eta_contact) NOT USED
+/* Un paso (del último salto al primero) del intervalo de validez de una
+   ruta: *t pasa a ser la salida más tardía desde c->from que aún recorre
+   los saltos ya vistos y *bottleneck la menor residual. *t empieza en
+   DBL_MAX (o en el deadline absoluto). Salir más tarde nunca alarga la
+   latencia relativa (cada salto empieza en max(llegada, t_start)), así que
+   una expiración relativa al envío no acorta el intervalo. */
+static inline void route_validity_step(const Contact *C, int ci, const CgrParams *P,
+                                       double *t, double *bottleneck) {
+    const Contact *c = &C[ci];
+    if (*t != -DBL_MAX) {
+        double ex = overlay_setup(P->overlay, ci, c, P->bundle_bytes);
+        *t = ldt_contact_checked(c, *t, P->bundle_bytes, ex);
+    }
+    if (c->residual_bytes < *bottleneck) *bottleneck = c->residual_bytes;
+}
+
+// contact_ids y contact_idxs de una ruta de len saltos en una sola reserva
+static int route_alloc(Route *R, int len) {
+    R->contact_ids = (int*)malloc(sizeof(int) * 2 * (len > 0 ? len : 1));
+    if (!R->contact_ids) return -1;
+    R->contact_idxs = R->contact_ids + len;
+    return 0;
+}
+
+// ✅ NUEVA: Métrica compuesta que considera LEO (DESPUÉS de contact_eta) NOT USED
 
 // static double eta_contact_leo(const Contact *c, double t_in, double bundle_bytes, 
 //                               double expiry_abs, int prefer_isl) {
-//     double base_eta = eta_contact(c, t_in, bundle_bytes, expiry_abs);
+//     double base_eta = contact_eta(c, t_in, bundle_bytes, expiry_abs);
     
 //     if (base_eta == DBL_MAX || !prefer_isl) return base_eta;
     
@@ -235,9 +588,151 @@ Route cgr_best_route_filtered(const Contact *C, int N, const CgrParams *P,
                               const NeighborIndex *NI, const CgrFilters *F)
 {
     Route R = {.contact_ids = NULL, .hops = 0, .eta = DBL_MAX, .found = false};
+    if (!P || !NI || !C || N <= 0) return R;
+    CgrWorkspace *ws = cgr_workspace_new(N);
+    if (!ws) return R;
+    R = cgr_best_route_ws(C, N, P, NI, F, ws);
+    cgr_workspace_free(ws);
+    return R;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Workspace reutilizable para la búsqueda k=1
+// ═══════════════════════════════════════════════════════════════════════════
+
+/* Las labels se inicializan una sola vez; cada búsqueda apunta en `touched`
+   los contactos cuya label deja de estar a DBL_MAX y al terminar restaura
+   solo esos. Así el coste por consulta es proporcional a lo explorado y no
+   a N, y el heap conserva su capacidad entre consultas. */
+struct CgrWorkspace
+{
+    int n;
+    Label *lab;
+    int *touched;
+    int ntouched;
+    MinHeap *pq;
+    double *eta;            // salida de eta_bulk (una lista by_from)
+    int *sel;
+    CgrSearchStats st;
+};
+
+CgrWorkspace* cgr_workspace_new(int N) {
+    if (N <= 0) return NULL;
+    CgrWorkspace *ws = (CgrWorkspace*)calloc(1, sizeof(CgrWorkspace));
+    if (!ws) return NULL;
+    ws->n = N;
+    ws->lab = (Label*)malloc(sizeof(Label) * N);
+    ws->touched = (int*)malloc(sizeof(int) * N);
+    ws->pq = heap_new(64);
+    ws->eta = (double*)malloc(sizeof(double) * N);
+    ws->sel = (int*)malloc(sizeof(int) * N);
+    if (!ws->lab || !ws->touched || !ws->pq || !ws->eta || !ws->sel) {
+        cgr_workspace_free(ws);
+        return NULL;
+    }
+    for (int i = 0; i < N; i++) {
+        ws->lab[i].contact_idx = i;
+        ws->lab[i].eta = DBL_MAX;
+        ws->lab[i].prev_idx = -1;
+    }
+    return ws;
+}
+
+void cgr_workspace_free(CgrWorkspace *ws) {
+    if (!ws) return;
+    free(ws->lab);
+    free(ws->touched);
+    free(ws->eta);
+    free(ws->sel);
+    if (ws->pq) heap_free(ws->pq);
+    free(ws);
+}
+
+void cgr_workspace_stats(const CgrWorkspace *ws, CgrSearchStats *out) {
+    if (!out) return;
+    if (ws) *out = ws->st;
+    else memset(out, 0, sizeof(*out));
+}
+
+void cgr_workspace_stats_reset(CgrWorkspace *ws) {
+    if (ws) memset(&ws->st, 0, sizeof(ws->st));
+}
+
+void cgr_search_stats_add(CgrSearchStats *acc, const CgrSearchStats *s) {
+    acc->queries += s->queries;
+    acc->found += s->found;
+    acc->pops += s->pops;
+    acc->stale += s->stale;
+    acc->improved += s->improved;
+    acc->bulk_evals += s->bulk_evals;
+    acc->bulk_rejects += s->bulk_rejects;
+    for (int r = 0; r < CGR_REJ_COUNT; r++) acc->reject[r] += s->reject[r];
+}
+
+const char* cgr_reject_name(CgrReject r) {
+    static const char *names[CGR_REJ_COUNT] = {
+        "viable", "closed", "no_window", "capacity", "no_fit", "expired"
+    };
+    return (r >= 0 && r < CGR_REJ_COUNT) ? names[r] : "?";
+}
+
+static inline void ws_set_label(CgrWorkspace *ws, int ci, double eta, int prev) {
+    if (ws->lab[ci].eta == DBL_MAX) ws->touched[ws->ntouched++] = ci;
+    ws->lab[ci].eta = eta;
+    ws->lab[ci].prev_idx = prev;
+}
+
+static void ws_reset(CgrWorkspace *ws) {
+    for (int k = 0; k < ws->ntouched; k++) {
+        int ci = ws->touched[k];
+        ws->lab[ci].eta = DBL_MAX;
+        ws->lab[ci].prev_idx = -1;
+    }
+    ws->ntouched = 0;
+    ws->pq->size = 0;
+}
+
+/* Contadores de rechazo sin accesos indexados por `why` (que encadenarían
+   load/store sobre la misma posición): una comparación por motivo, que el
+   compilador mantiene en registros. */
+static inline void rej_add(uint32_t *rej, int why) {
+    for (int r = 0; r < CGR_REJ_COUNT; r++) rej[r] += (why == r);
+}
+
+static inline double eval_count(const Contact *c, double t_in, const CgrParams *P, double expiry_abs,
+                                const CgrOverlay *ov, int ci, uint32_t *rej) {
+    int why;
+    double eta = contact_eval(c, t_in, P->bundle_bytes, expiry_abs,
+                              overlay_setup(ov, ci, c, P->bundle_bytes), &why);
+    rej_add(rej, why);
+    return eta;
+}
+
+// Superviviente k de eta_bulk: solo falta la residual, que no está en la vista SoA
+static inline double bulk_eta(const CgrWorkspace *ws, const Contact *c, int k, double bytes,
+                              uint32_t *rej) {
+    int low = c->residual_bytes + EPS_BYTES < bytes;
+    rej_add(rej, low ? CGR_REJ_CAPACITY : CGR_REJ_NONE);
+    return low ? DBL_MAX : ws->eta[k];
+}
+
+// ETA de todos los contactos de L saliendo a t_in → ws->eta, viables en ws->sel
+static inline int bulk_candidates(const NeighborIndex *NI, const IndexList *L, double t_in,
+                                  const CgrParams *P, double expiry_abs, CgrWorkspace *ws) {
+    EtaSoA S = soa_view(NI, L);
+    int m = eta_bulk(&S, L->count, t_in, P->bundle_bytes, expiry_abs, ws->eta, ws->sel);
+    ws->st.bulk_evals += (uint64_t)L->count;
+    ws->st.bulk_rejects += (uint64_t)(L->count - m);
+    return m;
+}
+
+Route cgr_best_route_ws(const Contact *C, int N, const CgrParams *P, const NeighborIndex *NI,
+                        const CgrFilters *F, CgrWorkspace *ws)
+{
+    Route R = {.contact_ids = NULL, .hops = 0, .eta = DBL_MAX, .found = false};
     
     // Validación de entrada
-    if (!P || !NI || !C || N <= 0) {
+    if (!P || !NI || !C || N <= 0 || !ws || ws->n < N) {
         DEBUG_PRINT("ERROR: Parámetros inválidos\n");
         return R;
     }
@@ -255,23 +750,22 @@ Route cgr_best_route_filtered(const Contact *C, int N, const CgrParams *P,
     DEBUG_PRINT("Búsqueda %d→%d, bytes=%.0f, t0=%.3f\n", 
                 P->src_node, P->dst_node, P->bundle_bytes, P->t0);
 
-    // Inicializar labels (uno por contacto)
-    Label *lab = (Label*)malloc(sizeof(Label) * N);
-    if (!lab) return R;
-    
-    for (int i = 0; i < N; i++) {
-        lab[i].contact_idx = i;
-        lab[i].eta = DBL_MAX;
-        lab[i].prev_idx = -1;
-    }
-
-    MinHeap *pq = heap_new(64);
-    if (!pq) {
-        free(lab);
-        return R;
-    }
+    // Labels (una por contacto) y heap del workspace, limpios desde la consulta anterior
+    Label *lab = ws->lab;
+    MinHeap *pq = ws->pq;
+    CgrSearchStats *st = &ws->st;
+    st->queries++;
+    uint32_t rej[CGR_REJ_COUNT] = {0};   // local: se vuelca en st al terminar
     
     double expiry_abs = (P->expiry > 0.0) ? (P->t0 + P->expiry) : 0.0;
+    // Cota del llamante: se aplica como una expiración más estricta, así los
+    // contactos que la superan se descartan al evaluarlos y nunca entran al heap
+    if (F && F->eta_bound > 0.0 && (expiry_abs <= 0.0 || F->eta_bound < expiry_abs))
+        expiry_abs = F->eta_bound;
+    const CgrOverlay *ov = P->overlay;
+    // Vecinos en bloque con eta_bulk: solo sobre el plan de la vista SoA y sin
+    // overlay (el setup extra es por contacto); la residual se mira aparte
+    const int bulk = NI->soa && NI->soa_plan == C && !ov;
 
     // ─────────────────────────────────────────────────────────────────────
     // Semilla: inicializar desde el nodo origen
@@ -285,17 +779,17 @@ Route cgr_best_route_filtered(const Contact *C, int N, const CgrParams *P,
         for (int ci = 0; ci < N; ci++) {
             if (C[ci].id != first_id) continue;
             if (C[ci].from != P->src_node) continue;
-            if (is_banned_id(C[ci].id, F)) continue;
-            
-            // Pre-check rápido
-            if (!contact_is_viable(&C[ci], P->t0, P->bundle_bytes)) continue;
+            if (is_banned(ci, C, F)) continue;
             
-            double eta = eta_contact(&C[ci], P->t0, P->bundle_bytes, expiry_abs);
-            if (eta == DBL_MAX) continue;
+            double ex = overlay_setup(ov, ci, &C[ci], P->bundle_bytes);
+            int why;
+            double eta = contact_eval(&C[ci], P->t0, P->bundle_bytes, expiry_abs, ex, &why);
+            rej[why]++;
+            if (why) continue;
 
-            lab[ci].eta = eta;
-            lab[ci].prev_idx = -1;
+            ws_set_label(ws, ci, eta, -1);
             heap_push(pq, (Label){.contact_idx = ci, .eta = eta, .prev_idx = -1});
+            st->improved++;
             DEBUG_PRINT("Semilla: contacto %d (id=%d), eta=%.3f\n", ci, C[ci].id, eta);
             break; // Solo uno
         }
@@ -304,22 +798,21 @@ Route cgr_best_route_filtered(const Contact *C, int N, const CgrParams *P,
         if (P->src_node >= 0 && P->src_node < NI->node_cap) {
             IndexList L = NI->by_from[P->src_node];
             DEBUG_PRINT("Semilla: %d contactos desde nodo %d\n", L.count, P->src_node);
+            int m = bulk ? bulk_candidates(NI, &L, P->t0, P, expiry_abs, ws) : L.count;
             
-            for (int k = 0; k < L.count; k++) {
+            for (int j = 0; j < m; j++) {
+                int k = bulk ? ws->sel[j] : j;
                 int ci = L.idxs[k];
                 
-                if (F && is_banned_id(C[ci].id, F)) continue;
+                if (is_banned(ci, C, F)) continue;
                 
-                // Pre-check rápido
-                if (!contact_is_viable(&C[ci], P->t0, P->bundle_bytes)) continue;
+                double eta = bulk ? bulk_eta(ws, &C[ci], k, P->bundle_bytes, rej)
+                                  : eval_count(&C[ci], P->t0, P, expiry_abs, ov, ci, rej);
                 
-                double eta = eta_contact(&C[ci], P->t0, P->bundle_bytes, expiry_abs);
-                if (eta == DBL_MAX) continue;
-                
-                if (eta < lab[ci].eta) {
-                    lab[ci].eta = eta;
-                    lab[ci].prev_idx = -1;
+                if (eta < lab[ci].eta) {   // DBL_MAX (rechazado) nunca mejora
+                    ws_set_label(ws, ci, eta, -1);
                     heap_push(pq, (Label){.contact_idx = ci, .eta = eta, .prev_idx = -1});
+                    st->improved++;
                     DEBUG_PRINT("  Semilla: contacto %d (id=%d), eta=%.3f\n", ci, C[ci].id, eta);
                 }
             }
@@ -340,9 +833,13 @@ Route cgr_best_route_filtered(const Contact *C, int N, const CgrParams *P,
         double eta_here = cur.eta;
         
         expansions++;
+        st->pops++;
 
         // Label desactualizada (ya procesamos este contacto con mejor ETA)
-        if (eta_here > lab[ci].eta + EPS_TIME) continue;
+        if (eta_here > lab[ci].eta + EPS_TIME) {
+            st->stale++;
+            continue;
+        }
 
         // ¿Cuánto prefijo hemos cumplido en esta ruta?
         int prefix_done = compute_prefix_done(ci, lab, C, F);
@@ -373,33 +870,33 @@ Route cgr_best_route_filtered(const Contact *C, int N, const CgrParams *P,
             DEBUG_PRINT("  Requiere contacto forzado #%d: id=%d\n", prefix_done, need_forced_next);
         }
 
-        for (int kk = 0; kk < L.count; kk++) {
+        int m = bulk ? bulk_candidates(NI, &L, eta_here, P, expiry_abs, ws) : L.count;
+
+        for (int j = 0; j < m; j++) {
+            int kk = bulk ? ws->sel[j] : j;
             int nj = L.idxs[kk];
 
             // Filtros
             if (need_forced_next != -1 && C[nj].id != need_forced_next) continue;
-            if (F && is_banned_id(C[nj].id, F)) continue;
+            if (is_banned(nj, C, F)) continue;
             
-            // Pre-check rápido antes de calcular ETA completo
-            if (!contact_is_viable(&C[nj], eta_here, P->bundle_bytes)) continue;
-
-            double eta_n = eta_contact(&C[nj], eta_here, P->bundle_bytes, expiry_abs);
-            if (eta_n == DBL_MAX) continue;
+            double eta_n = bulk ? bulk_eta(ws, &C[nj], kk, P->bundle_bytes, rej)
+                                : eval_count(&C[nj], eta_here, P, expiry_abs, ov, nj, rej);
 
-            // Actualizar si es mejor
+            // Actualizar si es mejor (sin salto previo por rechazo: DBL_MAX nunca mejora)
             if (eta_n + EPS_TIME < lab[nj].eta) {
-                lab[nj].eta = eta_n;
-                lab[nj].prev_idx = ci;
+                ws_set_label(ws, nj, eta_n, ci);
                 heap_push(pq, (Label){.contact_idx = nj, .eta = eta_n, .prev_idx = ci});
+                st->improved++;
             }
         }
     }
 
-    heap_free(pq);
+    for (int r = 0; r < CGR_REJ_COUNT; r++) st->reject[r] += rej[r];
 
     if (best_end == -1) {
         DEBUG_PRINT("✗ No se encontró ruta (expansiones=%d)\n", expansions);
-        free(lab);
+        ws_reset(ws);
         return R; // No encontrada
     }
 
@@ -410,7 +907,7 @@ Route cgr_best_route_filtered(const Contact *C, int N, const CgrParams *P,
     int cap = 16, len = 0;
     int *rev = (int*)malloc(sizeof(int) * cap);
     if (!rev) {
-        free(lab);
+        ws_reset(ws);
         return R;
     }
     
@@ -421,7 +918,7 @@ Route cgr_best_route_filtered(const Contact *C, int N, const CgrParams *P,
             int *new_rev = (int*)realloc(rev, sizeof(int) * cap);
             if (!new_rev) {
                 free(rev);
-                free(lab);
+                ws_reset(ws);
                 return R;
             }
             rev = new_rev;
@@ -431,24 +928,28 @@ Route cgr_best_route_filtered(const Contact *C, int N, const CgrParams *P,
     }
     
     // Invertir para obtener orden correcto
-    R.contact_ids = (int*)malloc(sizeof(int) * len);
-    if (!R.contact_ids) {
+    if (route_alloc(&R, len) != 0) {
         free(rev);
-        free(lab);
+        ws_reset(ws);
         return R;
     }
     
     for (int i = 0; i < len; i++) {
+        R.contact_idxs[i] = rev[len - 1 - i];
         R.contact_ids[i] = C[rev[len - 1 - i]].id;
     }
     R.hops = len;
     R.eta = best_eta;
     R.found = true;
+    R.valid_until = DBL_MAX;
+    R.bottleneck_bytes = DBL_MAX;
+    for (int i = 0; i < len; i++) route_validity_step(C, rev[i], P, &R.valid_until, &R.bottleneck_bytes);
+    st->found++;
 
     DEBUG_PRINT("✓ Ruta reconstruida: %d saltos, eta=%.3f\n", len, best_eta);
 
     free(rev);
-    free(lab);
+    ws_reset(ws);
     return R;
 }
 
@@ -456,74 +957,306 @@ void free_route(Route *r) {
     if (!r) return;
     free(r->contact_ids);
     r->contact_ids = NULL;
+    r->contact_idxs = NULL;
     r->hops = 0;
     r->eta = 0;
     r->found = false;
+    r->valid_until = 0;
+    r->bottleneck_bytes = 0;
+}
+
+double cgr_route_eta(const Contact *C, int N, const Route *R, const CgrParams *P, double *bottleneck) {
+    if (bottleneck) *bottleneck = DBL_MAX;
+    if (!C || !R || !P || !R->found || (!R->contact_idxs && R->hops > 0)) return DBL_MAX;
+    double expiry_abs = (P->expiry > 0.0) ? (P->t0 + P->expiry) : 0.0;
+    double t = P->t0, low = DBL_MAX;
+    for (int h = 0; h < R->hops; h++) {
+        int ci = R->contact_idxs[h];
+        if (ci < 0 || ci >= N) return DBL_MAX;
+        const Contact *c = &C[ci];
+        t = contact_eta(c, t, P->bundle_bytes, expiry_abs,
+                        overlay_setup(P->overlay, ci, c, P->bundle_bytes));
+        if (t == DBL_MAX) return DBL_MAX;
+        if (c->residual_bytes < low) low = c->residual_bytes;
+    }
+    if (bottleneck) *bottleneck = low;
+    return t;
 }
 
 // ═══════════════════════════════════════════════════════════════════════════
-// K rutas por CONSUMO (modo práctico)
+// K rutas por CONSUMO (modo práctico) — búsqueda incremental
 // ═══════════════════════════════════════════════════════════════════════════
 
-static void consume_capacity(Contact *C, int N, const Route *route, const CgrParams *P) {
-    if (!route->found || route->hops <= 0) return;
+/* Entre iteraciones solo cambia el residual de los contactos de la ruta
+   consumida, y el ETA de un contacto depende del residual únicamente a
+   través de la viabilidad (residual >= bundle). Por eso tras consumir:
+     1. Los contactos que quedan por debajo del bundle se marcan inválidos,
+        junto con todo el subárbol de labels que desciende de ellos.
+     2. El resto de labels siguen siendo cotas alcanzables (los costes solo
+        suben), y las ya asentadas siguen siendo óptimas.
+     3. Cada label invalidada se re-siembra desde sus predecesores válidos
+        (by_to) y Dijkstra continúa desde esa frontera con el heap previo.
+   Cada iteración solo expande hasta que el tope del heap alcanza el mejor
+   ETA en destino, igual que la búsqueda k=1 con corte temprano. */
+
+static const IndexList* acquire_by_to(const NeighborIndex *NI, const Contact *C, int N,
+                                      NeighborIndex *tmp, int *owned) {
+    *owned = 0;
+    if (NI->by_to) return NI->by_to;
+    *tmp = *NI;
+    tmp->by_to = NULL;
+    tmp->to_pool = NULL;
+    if (neighbor_index_ensure_by_to(tmp, C, N) != 0) return NULL;
+    *owned = 1;
+    return tmp->by_to;
+}
 
-    DEBUG_PRINT("Consumiendo capacidad para ruta con %d saltos\n", route->hops);
+typedef struct
+{
+    Contact *C;              // copia de trabajo (con consumo)
+    Label *lab;
+    MinHeap *pq;
+    unsigned char *state;    // 0 = sin visitar, 1 = válida, 2 = inválida
+    int *touched;            // contactos con label finita (para no recorrer N)
+    int n_touched;
+    int *stack;
+    double bytes;
+    double expiry_abs;
+    int dst;
+    double best_dst;         // mejor ETA conocido en un contacto hacia dst
+    const CgrOverlay *ov;    // penalizaciones (P->overlay)
+} IncState;
+
+static inline void inc_set_label(IncState *S, int ci, double eta, int prev) {
+    if (S->lab[ci].eta == DBL_MAX) S->touched[S->n_touched++] = ci;
+    S->lab[ci].eta = eta;
+    S->lab[ci].prev_idx = prev;
+    if (S->C[ci].to == S->dst && eta < S->best_dst) S->best_dst = eta;
+    heap_push(S->pq, (Label){.contact_idx = ci, .eta = eta, .prev_idx = prev});
+}
 
-    for (int step = 0; step < route->hops; step++) {
-        int id = route->contact_ids[step];
-        for (int i = 0; i < N; i++) {
-            if (C[i].id == id) {
-                double bytes = P->bundle_bytes;
-                
-                if (C[i].residual_bytes >= bytes) {
-                    C[i].residual_bytes -= bytes;
-                } else {
-                    C[i].residual_bytes = 0.0;
-                }
-                
-                DEBUG_PRINT("  Contacto %d: %.0f → %.0f bytes\n", 
-                           id, C[i].residual_bytes + bytes, C[i].residual_bytes);
-                break;
-            }
+// Expande hasta que ninguna label pendiente pueda mejorar el mejor ETA en destino
+static void inc_drain(IncState *S, const NeighborIndex *NI) {
+    const Contact *C = S->C;
+    while (!heap_empty(S->pq) && S->pq->items[0].eta < S->best_dst) {
+        Label cur = heap_pop(S->pq);
+        int ci = cur.contact_idx;
+        // Entrada obsoleta (mejorada o invalidada después de encolarse)
+        if (cur.eta != S->lab[ci].eta || cur.prev_idx != S->lab[ci].prev_idx) continue;
+
+        int next_node = C[ci].to;
+        if (next_node < 0 || next_node >= NI->node_cap) continue;
+
+        IndexList L = NI->by_from[next_node];
+        for (int kk = 0; kk < L.count; kk++) {
+            int nj = L.idxs[kk];
+            double ex = overlay_setup(S->ov, nj, &C[nj], S->bytes);
+            double eta_n = contact_eta(&C[nj], cur.eta, S->bytes, S->expiry_abs, ex);
+            if (eta_n == DBL_MAX) continue;
+
+            if (eta_n + EPS_TIME < S->lab[nj].eta) inc_set_label(S, nj, eta_n, ci);
         }
     }
 }
 
+/* Propaga la invalidez (state=2) a las labels que descienden de un contacto
+   inválido, recorriendo solo las labels tocadas. */
+static void invalidate_subtrees(IncState *S) {
+    const Label *lab = S->lab;
+    unsigned char *state = S->state;
+    for (int t = 0; t < S->n_touched; t++) {
+        int i = S->touched[t];
+        if (state[i] || lab[i].eta == DBL_MAX) continue;
+
+        int sp = 0, walker = i;
+        while (walker != -1 && state[walker] == 0) {
+            S->stack[sp++] = walker;
+            walker = lab[walker].prev_idx;
+        }
+        unsigned char verdict = (walker == -1) ? 1 : state[walker];
+        while (sp > 0) state[S->stack[--sp]] = verdict;
+    }
+}
+
+static Route route_from_labels(const Contact *C, const CgrParams *P, const Label *lab, int best_end,
+                               int *path_idx) {
+    Route R = {.contact_ids = NULL, .hops = 0, .eta = DBL_MAX, .found = false};
+
+    int len = 0;
+    for (int cur = best_end; cur != -1; cur = lab[cur].prev_idx) len++;
+
+    if (route_alloc(&R, len) != 0) return R;
+
+    R.valid_until = DBL_MAX;
+    R.bottleneck_bytes = DBL_MAX;
+    int i = len - 1;
+    for (int cur = best_end; cur != -1; cur = lab[cur].prev_idx, i--) {
+        R.contact_ids[i] = C[cur].id;
+        R.contact_idxs[i] = cur;
+        path_idx[i] = cur;
+        route_validity_step(C, cur, P, &R.valid_until, &R.bottleneck_bytes);
+    }
+    R.hops = len;
+    R.eta = lab[best_end].eta;
+    R.found = true;
+    return R;
+}
+
 Routes cgr_k_routes(const Contact *C_in, int N, const CgrParams *P, const NeighborIndex *NI, int K) {
     Routes RS = {.items = NULL, .count = 0, .cap = 0};
     
-    if (K <= 0 || !C_in || !P || !NI) return RS;
+    if (K <= 0 || !C_in || !P || !NI || N <= 0) return RS;
+    if (P->src_node < 0 || P->src_node >= NI->node_cap) return RS;
+    if (P->dst_node < 0 || P->dst_node >= NI->node_cap) return RS;
+
+    DEBUG_PRINT("K rutas por consumo (incremental): K=%d\n", K);
+
+    NeighborIndex tmp_ni;
+    int own_by_to = 0;
+    const IndexList *by_to = acquire_by_to(NI, C_in, N, &tmp_ni, &own_by_to);
+
+    // Copia de trabajo (consumiremos capacidad) + estado de la búsqueda
+    IncState S;
+    memset(&S, 0, sizeof(S));
+    S.C = (Contact*)malloc(sizeof(Contact) * N);
+    S.lab = (Label*)malloc(sizeof(Label) * N);
+    S.state = (unsigned char*)calloc(N, 1);
+    S.touched = (int*)malloc(sizeof(int) * N);
+    S.stack = (int*)malloc(sizeof(int) * N);
+    S.pq = heap_new(64);
+    int *path = (int*)malloc(sizeof(int) * N);
+    RS.items = (Route*)calloc(K, sizeof(Route));
+    if (!by_to || !S.C || !S.lab || !S.state || !S.touched || !S.stack || !S.pq ||
+        !path || !RS.items) {
+        free(S.C); free(S.lab); free(S.state); free(S.touched); free(S.stack);
+        heap_free(S.pq); free(path); free(RS.items);
+        RS.items = NULL;
+        if (own_by_to) free_by_to(&tmp_ni);
+        return RS;
+    }
+    RS.cap = K;
+    memcpy(S.C, C_in, sizeof(Contact) * N);
+    Contact *C = S.C;
 
-    DEBUG_PRINT("K rutas por consumo: K=%d\n", K);
+    S.bytes = P->bundle_bytes;
+    S.expiry_abs = (P->expiry > 0.0) ? (P->t0 + P->expiry) : 0.0;
+    S.dst = P->dst_node;
+    S.best_dst = DBL_MAX;
+    S.ov = P->overlay;
 
-    // Copia de trabajo (consumiremos capacidad)
-    Contact *C = (Contact*)malloc(sizeof(Contact) * N);
-    if (!C) return RS;
-    
-    memcpy(C, C_in, sizeof(Contact) * N);
+    for (int i = 0; i < N; i++) {
+        S.lab[i].contact_idx = i;
+        S.lab[i].eta = DBL_MAX;
+        S.lab[i].prev_idx = -1;
+    }
 
-    RS.cap = K;
-    RS.items = (Route*)calloc(RS.cap, sizeof(Route));
-    if (!RS.items) {
-        free(C);
-        return RS;
+    // Búsqueda base
+    IndexList Ls = NI->by_from[P->src_node];
+    for (int k = 0; k < Ls.count; k++) {
+        int ci = Ls.idxs[k];
+        double ex = overlay_setup(S.ov, ci, &C[ci], S.bytes);
+        double eta = contact_eta(&C[ci], P->t0, S.bytes, S.expiry_abs, ex);
+        if (eta < S.lab[ci].eta) inc_set_label(&S, ci, eta, -1);
     }
+    inc_drain(&S, NI);
+
+    const IndexList *Ld = &by_to[P->dst_node];
 
     for (int k = 0; k < K; k++) {
         DEBUG_PRINT("Iteración K=%d/%d\n", k + 1, K);
-        
-        Route r = cgr_best_route(C, N, P, NI);
-        if (!r.found) {
+
+        int best_end = -1;
+        double best_eta = DBL_MAX;
+        for (int j = 0; j < Ld->count; j++) {
+            int ci = Ld->idxs[j];
+            if (S.lab[ci].eta < best_eta) {
+                best_eta = S.lab[ci].eta;
+                best_end = ci;
+            }
+        }
+        if (best_end == -1) {
             DEBUG_PRINT("No hay más rutas disponibles\n");
             break;
         }
-        
+
+        Route r = route_from_labels(C, P, S.lab, best_end, path);
+        if (!r.found) break;
         RS.items[RS.count++] = r;
-        consume_capacity(C, N, &r, P);
+
+        // Consumir capacidad y detectar contactos que dejan de ser viables
+        int dirty = 0;
+        for (int h = 0; h < r.hops; h++) {
+            Contact *c = &C[path[h]];
+            c->residual_bytes = (c->residual_bytes >= S.bytes) ? c->residual_bytes - S.bytes : 0.0;
+            if (c->residual_bytes + EPS_BYTES < S.bytes) {
+                S.state[path[h]] = 2;
+                dirty++;
+            }
+        }
+        if (dirty == 0) continue; // Labels intactas: la misma ruta sigue siendo óptima
+
+        invalidate_subtrees(&S);
+
+        // Resetear labels inválidas (compactando la lista de tocadas)
+        int w = 0, n_invalid = 0;
+        for (int t = 0; t < S.n_touched; t++) {
+            int i = S.touched[t];
+            if (S.state[i] == 2) {
+                S.lab[i].eta = DBL_MAX;
+                S.lab[i].prev_idx = -1;
+                path[n_invalid++] = i;      // path[] se reutiliza como lista de inválidas
+            } else {
+                S.touched[w++] = i;
+            }
+        }
+        S.n_touched = w;
+
+        S.best_dst = DBL_MAX;
+        for (int j = 0; j < Ld->count; j++) {
+            if (S.lab[Ld->idxs[j]].eta < S.best_dst) S.best_dst = S.lab[Ld->idxs[j]].eta;
+        }
+
+        // Re-sembrar la frontera: cada label inválida desde predecesores válidos
+        for (int t = 0; t < n_invalid; t++) {
+            int i = path[t];
+            const Contact *c = &C[i];
+            if (c->residual_bytes + EPS_BYTES < S.bytes) continue;
+
+            double ex = overlay_setup(S.ov, i, &C[i], S.bytes);
+            double best = DBL_MAX;
+            int best_prev = -1;
+            if (c->from == P->src_node) best = contact_eta(c, P->t0, S.bytes, S.expiry_abs, ex);
+            if (c->from >= 0 && c->from < NI->node_cap) {
+                const IndexList *Lp = &by_to[c->from];
+                for (int j = 0; j < Lp->count; j++) {
+                    int pj = Lp->idxs[j];
+                    if (S.state[pj] == 2 || S.lab[pj].eta == DBL_MAX) continue;
+                    double e = contact_eta(c, S.lab[pj].eta, S.bytes, S.expiry_abs, ex);
+                    if (e + EPS_TIME < best) {
+                        best = e;
+                        best_prev = pj;
+                    }
+                }
+            }
+            if (best != DBL_MAX) inc_set_label(&S, i, best, best_prev);
+        }
+
+        // Limpiar estado solo donde se escribió
+        for (int t = 0; t < S.n_touched; t++) S.state[S.touched[t]] = 0;
+        for (int t = 0; t < n_invalid; t++) S.state[path[t]] = 0;
+
+        DEBUG_PRINT("  %d contactos agotados, %d labels invalidadas\n", dirty, n_invalid);
+        inc_drain(&S, NI);
     }
 
-    free(C);
+    heap_free(S.pq);
+    free(path);
+    free(S.stack);
+    free(S.touched);
+    free(S.state);
+    free(S.lab);
+    free(S.C);
+    if (own_by_to) free_by_to(&tmp_ni);
     return RS;
 }
 
@@ -553,27 +1286,49 @@ static int route_already_exists(const Routes *rs, const Route *candidate) {
     return 0;
 }
 
+static int same_route(const Route *a, const Route *b) {
+    return a->hops == b->hops && !memcmp(a->contact_ids, b->contact_ids, sizeof(int) * a->hops);
+}
+
 Routes cgr_k_yen(const Contact *C, int N, const CgrParams *P, const NeighborIndex *NI, int K) {
+    return cgr_k_yen_ex(C, N, P, NI, K, 0);
+}
+
+Routes cgr_k_yen_ex(const Contact *C, int N, const CgrParams *P, const NeighborIndex *NI, int K, int flags) {
     Routes out = {.items = NULL, .count = 0, .cap = 0};
     
-    if (K <= 0 || !C || !P || !NI) return out;
+    if (K <= 0 || !C || !P || !NI || N <= 0) return out;
 
     DEBUG_PRINT("K rutas Yen-lite: K=%d\n", K);
 
+    // Un solo workspace para la ruta base y todas las búsquedas de desvío
+    CgrWorkspace *ws = cgr_workspace_new(N);
+    if (!ws) return out;
+
     out.cap = K;
     out.items = (Route*)calloc(K, sizeof(Route));
-    if (!out.items) return out;
+    if (!out.items) {
+        cgr_workspace_free(ws);
+        return out;
+    }
 
     // Ruta base (sin filtros)
-    Route base = cgr_best_route_filtered(C, N, P, NI, NULL);
+    Route base = cgr_best_route_ws(C, N, P, NI, NULL, ws);
     if (!base.found) {
         DEBUG_PRINT("No existe ruta base\n");
+        cgr_workspace_free(ws);
         return out;
     }
     
     out.items[out.count++] = base;
     DEBUG_PRINT("Ruta base: %d saltos, eta=%.3f\n", base.hops, base.eta);
 
+    const int bounded = !(flags & CGR_YEN_UNBOUNDED);
+    /* Segunda mejor alternativa de la ronda anterior: su búsqueda de desvío
+       (mismo prefijo, mismo contacto baneado) se repite en esta ronda y no es
+       la ruta recién añadida, así que la ganadora llega como mucho a esa ETA */
+    double carry = DBL_MAX;
+
     // ✅ FIX: Búsqueda exhaustiva de alternativas con deduplicación global
     int max_attempts = K * 20; // Límite de intentos
     int attempts = 0;
@@ -581,7 +1336,7 @@ Routes cgr_k_yen(const Contact *C, int N, const CgrParams *P, const NeighborInde
     while (out.count < K && attempts < max_attempts) {
         attempts++;
         
-        double best_eta = DBL_MAX;
+        double best_eta = DBL_MAX, second_eta = DBL_MAX;
         Route best = {.contact_ids = NULL, .hops = 0, .eta = DBL_MAX, .found = false};
 
         // Probar desvíos desde TODAS las rutas ya encontradas
@@ -602,7 +1357,13 @@ Routes cgr_k_yen(const Contact *C, int N, const CgrParams *P, const NeighborInde
                 F.banned_ids = &banned_one;
                 F.banned_count = 1;
 
-                Route cand = cgr_best_route_filtered(C, N, P, NI, &F);
+                // Cota inclusiva: un empate con la cota se sigue encontrando
+                if (bounded) {
+                    double b = (best_eta < carry) ? best_eta : carry;
+                    if (b < DBL_MAX) F.eta_bound = b;
+                }
+
+                Route cand = cgr_best_route_ws(C, N, P, NI, &F, ws);
                 if (!cand.found) continue;
 
                 // ✅ FIX: Verificar contra TODAS las rutas existentes
@@ -611,17 +1372,29 @@ Routes cgr_k_yen(const Contact *C, int N, const CgrParams *P, const NeighborInde
                     continue;
                 }
 
-                // Quedarnos con la mejor nueva alternativa
+                // Quedarnos con la mejor nueva alternativa (y la ETA de la segunda)
                 if (cand.eta < best_eta) {
-                    if (best.found) free_route(&best);
+                    if (best.found) {
+                        second_eta = best_eta;
+                        free_route(&best);
+                    }
                     best = cand;
                     best_eta = cand.eta;
                 } else {
+                    if (cand.eta < second_eta && !same_route(&cand, &best)) second_eta = cand.eta;
                     free_route(&cand);
                 }
             }
         }
 
+        // Con cota heredada una ronda vacía no es concluyente (un desempate
+        // distinto pudo devolver una ruta repetida): repetirla sin cota
+        if (!best.found && carry < DBL_MAX) {
+            carry = DBL_MAX;
+            attempts--;
+            continue;
+        }
+
         // Si no encontramos ninguna nueva, terminar
         if (!best.found) {
             DEBUG_PRINT("No hay más alternativas después de %d intentos\n", attempts);
@@ -629,10 +1402,12 @@ Routes cgr_k_yen(const Contact *C, int N, const CgrParams *P, const NeighborInde
         }
         
         out.items[out.count++] = best;
+        carry = second_eta;
         DEBUG_PRINT("✓ Ruta alternativa #%d: %d saltos, eta=%.3f\n", 
                    out.count, best.hops, best.eta);
     }
 
+    cgr_workspace_free(ws);
     return out;
 }
 
@@ -648,3 +1423,537 @@ void free_routes(Routes *rs) {
     rs->count = 0;
     rs->cap = 0;
 }
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Búsqueda inversa: salida más tardía (latest departure) con deadline
+// ═══════════════════════════════════════════════════════════════════════════
+
+Route cgr_latest_departure(const Contact *C, int N, const CgrParams *P,
+                           const NeighborIndex *NI, double deadline, double *out_ldt)
+{
+    Route R = {.contact_ids = NULL, .hops = 0, .eta = DBL_MAX, .found = false};
+    if (out_ldt) *out_ldt = -DBL_MAX;
+
+    if (!P || !NI || !C || N <= 0) return R;
+    if (P->src_node < 0 || P->src_node >= NI->node_cap) return R;
+    if (P->dst_node < 0 || P->dst_node >= NI->node_cap) return R;
+
+    // Sin deadline explícito: usar la expiración del bundle
+    if (deadline <= 0.0) {
+        if (P->expiry <= 0.0) return R;
+        deadline = P->t0 + P->expiry;
+    }
+
+    DEBUG_PRINT("Búsqueda inversa %d→%d, deadline=%.3f, bytes=%.0f\n",
+                P->src_node, P->dst_node, deadline, P->bundle_bytes);
+
+    // Índice inverso: si se construyó en modo perezoso, usar uno temporal
+    NeighborIndex tmp_ni;
+    int own_by_to = 0;
+    const IndexList *by_to = acquire_by_to(NI, C, N, &tmp_ni, &own_by_to);
+    if (!by_to) return R;
+    const CgrOverlay *ov = P->overlay;
+
+    // lab[i].eta = salida más tardía desde C[i].from; prev_idx = SIGUIENTE contacto
+    Label *lab = (Label*)malloc(sizeof(Label) * N);
+    MinHeap *pq = heap_new(64);
+    if (!lab || !pq) {
+        free(lab); heap_free(pq);
+        if (own_by_to) free_by_to(&tmp_ni);
+        return R;
+    }
+    for (int i = 0; i < N; i++) {
+        lab[i].contact_idx = i;
+        lab[i].eta = -DBL_MAX;
+        lab[i].prev_idx = -1;
+    }
+
+    /* by_to está ordenado por t_end y ldt <= t_end - setup - tx <= t_end
+       (setup y overlay no negativos): recorriendo cada lista desde el final,
+       el primer contacto con t_end < t0 cierra el barrido porque los que
+       quedan tampoco pueden salir después de t0. El orden descendente
+       además encola antes las salidas más tardías.
+       Semilla: contactos que llegan al destino. El heap es de mínimos,
+       así que se encola -ldt para extraer primero la salida más tardía. */
+    const IndexList *Ld = &by_to[P->dst_node];
+    for (int k = Ld->count - 1; k >= 0; k--) {
+        int ci = Ld->idxs[k];
+        if (C[ci].t_end + EPS_TIME < P->t0) break;
+        double ldt = ldt_contact_checked(&C[ci], deadline, P->bundle_bytes, overlay_setup(ov, ci, &C[ci], P->bundle_bytes));
+        if (ldt + EPS_TIME < P->t0) continue;
+        if (ldt > lab[ci].eta) {
+            lab[ci].eta = ldt;
+            heap_push(pq, (Label){.contact_idx = ci, .eta = -ldt, .prev_idx = -1});
+        }
+    }
+
+    int best_first = -1;
+    while (!heap_empty(pq)) {
+        Label cur = heap_pop(pq);
+        int ci = cur.contact_idx;
+        double ldt_here = -cur.eta;
+
+        if (ldt_here + EPS_TIME < lab[ci].eta) continue; // Label desactualizada
+
+        if (C[ci].from == P->src_node) {
+            best_first = ci;
+            break; // Máxima salida por orden del heap
+        }
+
+        int node = C[ci].from;
+        if (node < 0 || node >= NI->node_cap) continue;
+
+        const IndexList *Lp = &by_to[node];
+        for (int k = Lp->count - 1; k >= 0; k--) {
+            int pj = Lp->idxs[k];
+            if (C[pj].t_end + EPS_TIME < P->t0) break;
+            double ldt_p = ldt_contact_checked(&C[pj], ldt_here, P->bundle_bytes, overlay_setup(ov, pj, &C[pj], P->bundle_bytes));
+            if (ldt_p + EPS_TIME < P->t0) continue;
+
+            if (ldt_p > lab[pj].eta + EPS_TIME) {
+                lab[pj].eta = ldt_p;
+                lab[pj].prev_idx = ci;
+                heap_push(pq, (Label){.contact_idx = pj, .eta = -ldt_p, .prev_idx = ci});
+            }
+        }
+    }
+
+    heap_free(pq);
+    if (own_by_to) free_by_to(&tmp_ni);
+
+    if (best_first == -1) {
+        DEBUG_PRINT("✗ Sin salida que cumpla el deadline\n");
+        free(lab);
+        return R;
+    }
+
+    int len = 0;
+    for (int cur = best_first; cur != -1; cur = lab[cur].prev_idx) len++;
+
+    if (route_alloc(&R, len) != 0) {
+        free(lab);
+        return R;
+    }
+
+    // Ruta en orden natural (src → dst) y ETA real saliendo en el LDT
+    double t = lab[best_first].eta;
+    int h = 0;
+    R.bottleneck_bytes = DBL_MAX;
+    for (int cur = best_first; cur != -1; cur = lab[cur].prev_idx) {
+        R.contact_idxs[h] = cur;
+        R.contact_ids[h++] = C[cur].id;
+        t = contact_eta(&C[cur], t, P->bundle_bytes, 0.0, overlay_setup(ov, cur, &C[cur], P->bundle_bytes));
+        if (C[cur].residual_bytes < R.bottleneck_bytes) R.bottleneck_bytes = C[cur].residual_bytes;
+    }
+    // Cada salto se comprobó hacia delante; esto solo cubre lo imprevisto
+    if (t == DBL_MAX || t > deadline + EPS_TIME) {
+        DEBUG_PRINT("✗ La ruta no se puede recorrer desde el LDT\n");
+        free_route(&R);
+        R = (Route){.contact_ids = NULL, .hops = 0, .eta = DBL_MAX, .found = false};
+        free(lab);
+        return R;
+    }
+    R.hops = len;
+    R.eta = t;
+    R.found = true;
+    R.valid_until = lab[best_first].eta;   // el LDT ya es la cadena hacia atrás desde el deadline
+    if (out_ldt) *out_ldt = lab[best_first].eta;
+
+    DEBUG_PRINT("✓ LDT=%.3f, %d saltos, eta=%.3f\n", lab[best_first].eta, len, t);
+
+    free(lab);
+    return R;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Contactos probabilísticos: máxima entrega / mínima ETA esperada
+// ═══════════════════════════════════════════════════════════════════════════
+
+/* Búsqueda bicriterio (eta ↓, probabilidad ↑). Cada contacto guarda como
+   mucho max_labels labels no dominadas; una label se descarta si otra del
+   mismo contacto llega antes con al menos su probabilidad, y antes de
+   encolarse se poda si no puede mejorar la mejor solución en destino. Con
+   p_fail = 0 en todo el plan la primera label de cada contacto domina a las
+   demás y la búsqueda hace el mismo trabajo que la determinista. */
+
+#define EPS_PROB 1e-12
+
+typedef struct
+{
+    double eta;          // llegada al final del contacto
+    double p;            // probabilidad acumulada de éxito del camino
+    int ci;              // índice del contacto
+    int prev;            // label previa en el pool (-1 = raíz)
+    int alive;           // 0 si otra label del contacto la dominó
+} PLabel;
+
+typedef struct
+{
+    const Contact *C;
+    const CgrParams *P;
+    PLabel *pool;
+    int n, cap;
+    int *slots;          // N * m índices de labels vivas por contacto
+    int *cnt;            // labels vivas por contacto
+    int m;
+    MinHeap *pq;
+    CgrProbMode mode;
+    double deadline;     // absoluto (0 = sin límite)
+    double fail_cost;    // coste (relativo a t0) de un bundle perdido
+    int best;            // label en destino con mejor puntuación (-1 = ninguna)
+    double best_score;
+    double *ub;          // cota superior de probabilidad nodo → destino (NULL = 1)
+    int V;               // tamaño de ub (node_cap)
+} PSearch;
+
+static inline double prob_score(const PSearch *S, double eta, double p) {
+    if (S->mode == CGR_PROB_MAX_DELIVERY) return -p;
+    return p * (eta - S->P->t0) + (1.0 - p) * S->fail_cost;
+}
+
+/* Máxima probabilidad de llegar a dst desde cada nodo ignorando los tiempos
+   (Dijkstra inverso de producto máximo sobre by_to, solo con contactos que
+   solapan [t0, deadline]). Acota lo que puede ganar una label. */
+static double* prob_upper_bounds(const Contact *C, const NeighborIndex *NI, const IndexList *by_to,
+                                 int dst, double t0, double deadline) {
+    int V = NI->node_cap;
+    double *ub = (double*)calloc(V, sizeof(double));
+    MinHeap *pq = heap_new(64);
+    if (!ub || !pq) { free(ub); heap_free(pq); return NULL; }
+    ub[dst] = 1.0;
+    heap_push(pq, (Label){.contact_idx = dst, .eta = -1.0, .prev_idx = -1});
+    while (!heap_empty(pq)) {
+        Label top = heap_pop(pq);
+        int u = top.contact_idx;
+        if (-top.eta < ub[u]) continue;
+        const IndexList *L = &by_to[u];
+        for (int k = 0; k < L->count; k++) {
+            const Contact *c = &C[L->idxs[k]];
+            if (c->t_end < t0 || (deadline > 0.0 && c->t_start > deadline)) continue;
+            if (c->from < 0 || c->from >= V) continue;
+            double q = ub[u] * (1.0 - c->p_fail);
+            if (q > ub[c->from] + EPS_PROB) {
+                ub[c->from] = q;
+                heap_push(pq, (Label){.contact_idx = c->from, .eta = -q, .prev_idx = -1});
+            }
+        }
+    }
+    heap_free(pq);
+    return ub;
+}
+
+// ¿Puede una label (eta, p) en el contacto ci, o alguna extensión, mejorar la mejor solución?
+static int prob_can_improve(const PSearch *S, int ci, double eta, double p) {
+    if (S->best < 0) return 1;
+    int v = S->C[ci].to;
+    if (S->ub && v >= 0 && v < S->V) p *= S->ub[v];
+    const PLabel *b = &S->pool[S->best];
+    if (S->mode == CGR_PROB_MAX_DELIVERY) {
+        if (p > b->p + EPS_PROB) return 1;
+        return p >= b->p - EPS_PROB && eta + EPS_TIME < b->eta;
+    }
+    // La probabilidad solo baja y la eta solo sube: cota inferior de la puntuación
+    double rel = eta - S->P->t0;
+    double lb = (rel >= S->fail_cost) ? S->fail_cost : S->fail_cost - p * (S->fail_cost - rel);
+    return lb < S->best_score - EPS_TIME;
+}
+
+static int prob_add_label(PSearch *S, int ci, double eta, double p, int prev) {
+    if (!prob_can_improve(S, ci, eta, p)) return 0;
+
+    // Dominancia dentro del contacto
+    int *sl = S->slots + (size_t)ci * S->m;
+    for (int k = 0; k < S->cnt[ci]; k++) {
+        const PLabel *L = &S->pool[sl[k]];
+        if (L->eta <= eta + EPS_TIME && L->p >= p - EPS_PROB) return 0;
+    }
+    for (int k = 0; k < S->cnt[ci]; ) {
+        PLabel *L = &S->pool[sl[k]];
+        if (L->eta >= eta - EPS_TIME && L->p <= p + EPS_PROB) {
+            L->alive = 0;
+            sl[k] = sl[--S->cnt[ci]];
+        } else {
+            k++;
+        }
+    }
+    if (S->cnt[ci] >= S->m) return 0;
+
+    if (S->n >= S->cap) {
+        int ncap = S->cap * 2;
+        PLabel *np = (PLabel*)realloc(S->pool, sizeof(PLabel) * ncap);
+        if (!np) return -1;
+        S->pool = np;
+        S->cap = ncap;
+    }
+    int li = S->n++;
+    S->pool[li] = (PLabel){.eta = eta, .p = p, .ci = ci, .prev = prev, .alive = 1};
+    sl[S->cnt[ci]++] = li;
+
+    if (S->C[ci].to == S->P->dst_node) {
+        // Solución: no hace falta expandirla
+        double sc = prob_score(S, eta, p);
+        if (S->best < 0 || sc < S->best_score - EPS_PROB ||
+            (sc <= S->best_score + EPS_PROB && eta < S->pool[S->best].eta)) {
+            S->best = li;
+            S->best_score = sc;
+        }
+        return 1;
+    }
+    heap_push(S->pq, (Label){.contact_idx = li, .eta = eta, .prev_idx = prev});
+    return 1;
+}
+
+// -1 sin memoria para la label (la búsqueda queda incompleta)
+static int prob_try(PSearch *S, int ci, double t_in, double p_in, int prev) {
+    const Contact *c = &S->C[ci];
+    double bytes = S->P->bundle_bytes;
+    double ex = overlay_setup(S->P->overlay, ci, c, bytes);
+    double eta = contact_eta(c, t_in, bytes, S->deadline, ex);
+    if (eta == DBL_MAX) return 0;
+    return prob_add_label(S, ci, eta, p_in * (1.0 - c->p_fail), prev);
+}
+
+static Route prob_route_from(const PSearch *S, int li) {
+    Route R = {.contact_ids = NULL, .hops = 0, .eta = DBL_MAX, .found = false};
+    int len = 0;
+    for (int w = li; w != -1; w = S->pool[w].prev) len++;
+    if (route_alloc(&R, len) != 0) return R;
+    int h = len;
+    R.valid_until = (S->deadline > 0.0) ? S->deadline : DBL_MAX;
+    R.bottleneck_bytes = DBL_MAX;
+    for (int w = li; w != -1; w = S->pool[w].prev) {
+        R.contact_ids[--h] = S->C[S->pool[w].ci].id;
+        R.contact_idxs[h] = S->pool[w].ci;
+        route_validity_step(S->C, S->pool[w].ci, S->P, &R.valid_until, &R.bottleneck_bytes);
+    }
+    R.hops = len;
+    R.eta = S->pool[li].eta;
+    R.found = true;
+    return R;
+}
+
+static double prob_deadline(const CgrParams *P, const CgrProbCfg *cfg) {
+    if (cfg && cfg->deadline > 0.0) return cfg->deadline;
+    return (P->expiry > 0.0) ? P->t0 + P->expiry : 0.0;
+}
+
+Route cgr_prob_route(const Contact *C, int N, const CgrParams *P, const NeighborIndex *NI,
+                     const CgrProbCfg *cfg, double *out_p)
+{
+    Route R = {.contact_ids = NULL, .hops = 0, .eta = DBL_MAX, .found = false};
+    if (out_p) *out_p = 0.0;
+    if (!P || !NI || !C || N <= 0) return R;
+    if (P->src_node < 0 || P->src_node >= NI->node_cap) return R;
+    if (P->dst_node < 0 || P->dst_node >= NI->node_cap) return R;
+
+    PSearch S;
+    memset(&S, 0, sizeof(S));
+    S.C = C;
+    S.P = P;
+    S.m = (cfg && cfg->max_labels > 0) ? cfg->max_labels : 8;
+    S.mode = cfg ? cfg->mode : CGR_PROB_MAX_DELIVERY;
+    S.deadline = prob_deadline(P, cfg);
+    S.fail_cost = (cfg && cfg->fail_cost > 0.0) ? cfg->fail_cost
+                : (S.deadline > 0.0 ? S.deadline - P->t0 : 0.0);
+    // Sin deadline ni coste de fallo la ETA esperada no está acotada:
+    // minimizarla equivale a maximizar la entrega y desempatar por eta
+    if (S.mode == CGR_PROB_MIN_EXPECTED && S.fail_cost <= 0.0) S.mode = CGR_PROB_MAX_DELIVERY;
+    S.best = -1;
+    S.best_score = DBL_MAX;
+    S.cap = 1024;
+    S.pool = (PLabel*)malloc(sizeof(PLabel) * S.cap);
+    S.slots = (int*)malloc(sizeof(int) * (size_t)N * S.m);
+    S.cnt = (int*)calloc(N, sizeof(int));
+    S.pq = heap_new(64);
+    if (!S.pool || !S.slots || !S.cnt || !S.pq) {
+        free(S.pool); free(S.slots); free(S.cnt); heap_free(S.pq);
+        return R;
+    }
+
+    // Cotas de probabilidad: solo si hay contactos no fiables (si falla la
+    // reserva se busca sin ellas)
+    int any_fail = 0;
+    for (int i = 0; i < N && !any_fail; i++) any_fail = C[i].p_fail > 0.0;
+    NeighborIndex tmp_ni;
+    int own_by_to = 0;
+    const IndexList *by_to = any_fail ? acquire_by_to(NI, C, N, &tmp_ni, &own_by_to) : NULL;
+    if (by_to) {
+        S.ub = prob_upper_bounds(C, NI, by_to, P->dst_node, P->t0, S.deadline);
+        S.V = NI->node_cap;
+        if (own_by_to) free_by_to(&tmp_ni);
+    }
+    if (S.ub && S.ub[P->src_node] <= 0.0) {
+        // Destino inalcanzable incluso sin restricciones de tiempo
+        free(S.pool); free(S.slots); free(S.cnt); heap_free(S.pq); free(S.ub);
+        return R;
+    }
+
+    int oom = 0;
+    const IndexList *Ls = &NI->by_from[P->src_node];
+    for (int k = 0; k < Ls->count && !oom; k++) oom = prob_try(&S, Ls->idxs[k], P->t0, 1.0, -1) < 0;
+
+    while (!oom && !heap_empty(S.pq)) {
+        Label top = heap_pop(S.pq);
+        const PLabel L = S.pool[top.contact_idx];
+        if (!L.alive) continue;
+        // Cola por eta: ninguna label posterior puede llegar antes. Con
+        // MIN_EXPECTED la puntuación de cualquier label posterior es al menos
+        // min(eta - t0, fail_cost) (la misma cota que prob_can_improve con p
+        // libre): si fail_cost < eta - t0 una ruta poco fiable aún puede mejorar
+        if (S.best >= 0) {
+            if (S.mode == CGR_PROB_MAX_DELIVERY && S.pool[S.best].p >= 1.0 - EPS_PROB &&
+                L.eta >= S.pool[S.best].eta) break;
+            if (S.mode == CGR_PROB_MIN_EXPECTED &&
+                fmin(L.eta - P->t0, S.fail_cost) >= S.best_score - EPS_TIME) break;
+        }
+        if (!prob_can_improve(&S, L.ci, L.eta, L.p)) continue;
+
+        int node = C[L.ci].to;
+        if (node < 0 || node >= NI->node_cap) continue;
+        const IndexList *Ln = &NI->by_from[node];
+        for (int k = 0; k < Ln->count && !oom; k++)
+            oom = prob_try(&S, Ln->idxs[k], L.eta, L.p, top.contact_idx) < 0;
+    }
+
+    // Sin memoria la mejor label puede no ser la óptima: sin ruta
+    if (oom) {
+        DEBUG_PRINT("Ruta probabilística: sin memoria tras %d labels\n", S.n);
+    } else if (S.best >= 0) {
+        R = prob_route_from(&S, S.best);
+        if (out_p && R.found) *out_p = S.pool[S.best].p;
+    }
+    DEBUG_PRINT("Ruta probabilística: %d labels, p=%.4f\n", S.n, S.best >= 0 ? S.pool[S.best].p : 0.0);
+
+    free(S.pool); free(S.slots); free(S.cnt); heap_free(S.pq); free(S.ub);
+    return R;
+}
+
+/* ----------------------- Conjuntos de K rutas ----------------------- */
+
+/* P(al menos una ruta entrega) por inclusión-exclusión: las rutas que
+   comparten contactos no son independientes, y cada subconjunto cuenta
+   la unión de sus contactos una sola vez. */
+static double union_success(const Contact *C, const int *const *idx, const int *hops, int m, int *stamp) {
+    double total = 0.0;
+    for (int mask = 1; mask < (1 << m); mask++) {
+        double p = 1.0;
+        int bits = 0;
+        for (int r = 0; r < m; r++) {
+            if (!(mask & (1 << r))) continue;
+            bits++;
+            for (int h = 0; h < hops[r]; h++) {
+                int ci = idx[r][h];
+                if (stamp[ci] == mask) continue;
+                stamp[ci] = mask;
+                p *= 1.0 - C[ci].p_fail;
+            }
+        }
+        total += (bits & 1) ? p : -p;
+    }
+    // Reiniciar sellos de los contactos tocados
+    for (int r = 0; r < m; r++) for (int h = 0; h < hops[r]; h++) stamp[idx[r][h]] = 0;
+    return total;
+}
+
+// Índices de contacto de una ruta; NULL si no los tiene o alguno no está en [0, N)
+static const int* prob_route_indices(const Route *r, int N) {
+    if (!r->contact_idxs && r->hops > 0) return NULL;
+    for (int h = 0; h < r->hops; h++)
+        if (r->contact_idxs[h] < 0 || r->contact_idxs[h] >= N) return NULL;
+    return r->contact_idxs;
+}
+
+double cgr_routes_delivery_prob(const Contact *C, int N, const Routes *RS) {
+    if (!C || N <= 0 || !RS || RS->count <= 0) return 0.0;
+    int m = RS->count < CGR_PROB_K_MAX ? RS->count : CGR_PROB_K_MAX;
+    const int *idx[CGR_PROB_K_MAX] = {0};
+    int hops[CGR_PROB_K_MAX] = {0};
+    for (int r = 0; r < m; r++) {
+        idx[r] = prob_route_indices(&RS->items[r], N);
+        hops[r] = RS->items[r].hops;
+        if (!idx[r] && hops[r] > 0) return 0.0;
+    }
+    int *stamp = (int*)calloc(N, sizeof(int));
+    double p = stamp ? union_success(C, idx, hops, m, stamp) : 0.0;
+    free(stamp);
+    return p;
+}
+
+Routes cgr_prob_k_routes(const Contact *C, int N, const CgrParams *P, const NeighborIndex *NI,
+                         const CgrProbCfg *cfg, int K, double *out_p)
+{
+    Routes out = {.items = NULL, .count = 0, .cap = 0};
+    if (out_p) *out_p = 0.0;
+    if (K <= 0 || !C || !P || !NI || N <= 0) return out;
+    if (K > CGR_PROB_K_MAX) K = CGR_PROB_K_MAX;
+
+    // Candidatas: la más fiable + alternativas Yen que cumplen el deadline
+    double deadline = prob_deadline(P, cfg);
+    CgrParams Pd = *P;
+    if (deadline > 0.0) Pd.expiry = deadline - P->t0;
+    Routes cand = cgr_k_yen(C, N, &Pd, NI, 3 * K);
+    Route best = cgr_prob_route(C, N, P, NI, cfg, NULL);
+    if (best.found && !route_already_exists(&cand, &best)) {
+        if (cand.count >= cand.cap) {
+            Route *ni = (Route*)realloc(cand.items, sizeof(Route) * (cand.cap + 1));
+            if (ni) { cand.items = ni; cand.cap++; }
+        }
+        if (cand.count < cand.cap) cand.items[cand.count++] = best;
+        else free_route(&best);
+    } else {
+        free_route(&best);
+    }
+    if (cand.count == 0) { free_routes(&cand); return out; }
+
+    int *stamp = (int*)calloc(N, sizeof(int));
+    int *chosen = (int*)malloc(sizeof(int) * K);
+    const int **sel_idx = (const int**)malloc(sizeof(int*) * K);
+    int *sel_hops = (int*)malloc(sizeof(int) * K);
+    out.items = (Route*)calloc(K, sizeof(Route));
+    int ok = stamp && chosen && sel_idx && sel_hops && out.items;
+
+    // Selección voraz: la candidata que más sube P(alguna entrega); empate → menor eta
+    double p_set = 0.0;
+    int m = 0;
+    while (ok && m < K) {
+        int pick = -1;
+        double p_pick = p_set;
+        for (int c = 0; c < cand.count; c++) {
+            int used = 0;
+            for (int j = 0; j < m && !used; j++) used = (chosen[j] == c);
+            if (used) continue;
+            sel_idx[m] = cand.items[c].contact_idxs;
+            sel_hops[m] = cand.items[c].hops;
+            double p = union_success(C, sel_idx, sel_hops, m + 1, stamp);
+            if (p > p_pick + EPS_PROB ||
+                (pick >= 0 && p >= p_pick - EPS_PROB && cand.items[c].eta < cand.items[pick].eta)) {
+                pick = c;
+                p_pick = p;
+            }
+        }
+        if (pick < 0) break;
+        chosen[m] = pick;
+        sel_idx[m] = cand.items[pick].contact_idxs;
+        sel_hops[m] = cand.items[pick].hops;
+        m++;
+        p_set = p_pick;
+    }
+
+    if (ok) {
+        out.cap = K;
+        for (int j = 0; j < m; j++) {
+            out.items[out.count++] = cand.items[chosen[j]];
+            cand.items[chosen[j]].contact_ids = NULL;   // traspasada a out
+            cand.items[chosen[j]].contact_idxs = NULL;
+            cand.items[chosen[j]].hops = 0;
+        }
+        if (out_p) *out_p = p_set;
+    } else {
+        free(out.items);
+        out.items = NULL;
+    }
+
+    free(stamp); free(chosen); free(sel_idx); free(sel_hops);
+    free_routes(&cand);
+    return out;
+}
@@ -0,0 +1,1589 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <float.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include "cgr.h"
+#include "csv.h"
+#include "impact.h"
+#include "plan_archive.h"
+#include "plan_stream.h"
+#include "outbuf.h"
+#include "penalty.h"
+#include "link_est.h"
+#include "montecarlo.h"
+#include "eta_kernel.h"
+#include "ea_matrix.h"
+#include "sgp4_batch.h"
+#include "visibility.h"
+
+/* ===========================
+ * CGR benchmark suite
+ * ===========================
+ * Synthetic constellation plans (Walker-like planes + ground stations)
+ * and timing of the routing building blocks. Each section can be run
+ * alone with --only <name>. Sections also check their results against a
+ * reference; any failed check makes the run exit with status 1.
+ */
+
+typedef struct {
+    int    planes;        // orbital planes
+    int    per_plane;     // satellites per plane (planes*per_plane <= 99)
+    int    n_gs;          // ground stations (ids 100, 200, ...)
+    double horizon;       // plan length (s)
+    unsigned int seed;
+} BenchPlanCfg;
+
+static int g_failed = 0;   // failed checks in all sections
+
+// Records a correctness check; returns ok so it can pick the printed verdict
+static int check(int ok){
+    if(!ok) g_failed++;
+    return ok;
+}
+
+static double now_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double frand(double lo, double hi){
+    return lo + (hi - lo) * ((double)rand() / (double)RAND_MAX);
+}
+
+static int sat_id(const BenchPlanCfg *B, int plane, int k){
+    return 1 + plane * B->per_plane + (k % B->per_plane);
+}
+
+/* Synthetic plan:
+ * - intra-plane ISLs (both directions) in consecutive 600 s windows
+ * - inter-plane ISLs 300 s every 1200 s with random phase
+ * - GS passes (up + down) of 300..600 s once per ~95 min orbit
+ */
+static int bench_plan(const BenchPlanCfg *B, Contact **out){
+    srand(B->seed);
+    int M = 0, cap = 1024;
+    Contact *C = (Contact*)malloc(sizeof(Contact)*cap);
+    if(!C) return -1;
+
+    #define PUSH(_from,_to,_t0,_t1,_rate) do{                                      \
+        if(M>=cap){ cap*=2; C=(Contact*)realloc(C,sizeof(Contact)*cap); }          \
+        C[M].id = M;                                                               \
+        C[M].from = (_from);                                                       \
+        C[M].to   = (_to);                                                         \
+        C[M].t_start = (_t0);                                                      \
+        C[M].t_end   = (_t1);                                                      \
+        C[M].owlt    = frand(0.002, 0.015);                                        \
+        C[M].rate_bps= (_rate);                                                    \
+        C[M].setup_s = 0.1;                                                        \
+        C[M].residual_bytes = ((_t1) - (_t0)) * (_rate);                           \
+        C[M].p_fail  = 0.0;                                                        \
+        M++;                                                                       \
+    }while(0)
+
+    for(int p=0; p<B->planes; p++){
+        for(int k=0; k<B->per_plane; k++){
+            int a = sat_id(B, p, k), b = sat_id(B, p, k+1);
+            for(double t=0; t<B->horizon; t+=600.0){
+                double rate = frand(5e6, 1.2e7);
+                PUSH(a, b, t, t+600.0, rate);
+                PUSH(b, a, t, t+600.0, rate);
+            }
+            if(B->planes > 1){
+                int c = sat_id(B, (p+1) % B->planes, k);
+                double phase = frand(0, 1200.0);
+                for(double t=phase; t<B->horizon; t+=1200.0){
+                    double rate = frand(2e6, 8e6);
+                    PUSH(a, c, t, t+300.0, rate);
+                    PUSH(c, a, t, t+300.0, rate);
+                }
+            }
+        }
+    }
+
+    int nsats = B->planes * B->per_plane;
+    for(int g=0; g<B->n_gs; g++){
+        int gs = (g+1)*100;
+        for(int s=1; s<=nsats; s++){
+            if(rand() % 3) continue;        // not every satellite sees every GS
+            double phase = frand(0, 5700.0);
+            for(double t=phase; t<B->horizon; t+=5700.0){
+                double dur = frand(300.0, 600.0);
+                double rate = frand(1e6, 1e7);
+                PUSH(gs, s, t, t+dur, rate);
+                PUSH(s, gs, t, t+dur, rate);
+            }
+        }
+    }
+    #undef PUSH
+
+    *out = C;
+    return M;
+}
+
+/* ----------------------- Sección: impacto de fallos ----------------------- */
+
+typedef struct {
+    CgrParams P;
+} BenchBundle;
+
+static BenchBundle* bench_bundles(const BenchPlanCfg *B, int n, unsigned int seed){
+    BenchBundle *Q = (BenchBundle*)malloc(sizeof(BenchBundle)*n);
+    if(!Q) return NULL;
+    srand(seed);
+    for(int i=0;i<n;i++){
+        int s = 1 + rand() % B->n_gs, d;
+        do { d = 1 + rand() % B->n_gs; } while(d == s && B->n_gs > 1);
+        Q[i].P = (CgrParams){ .src_node=s*100, .dst_node=d*100,
+                              .t0=frand(0, B->horizon*0.5),
+                              .bundle_bytes=frand(1e6, 1e7), .expiry=0.0 };
+    }
+    return Q;
+}
+
+static void bench_impact(const BenchPlanCfg *B, int n_bundles){
+    Contact *C0 = NULL;
+    int N = bench_plan(B, &C0);
+    if(N <= 0){ fprintf(stderr, "bench_plan failed\n"); return; }
+    NeighborIndex *NI = build_neighbor_index(C0, N);
+    BenchBundle *Q = bench_bundles(B, n_bundles, B->seed + 1);
+
+    Contact *C = (Contact*)malloc(sizeof(Contact)*N);
+    memcpy(C, C0, sizeof(Contact)*N);
+
+    // Backlog comprometido
+    ImpactIndex *ix = impact_new(C, N);
+    int committed = 0;
+    for(int i=0;i<n_bundles;i++){
+        Route r = cgr_best_route(C, N, &Q[i].P, NI);
+        if(impact_commit(ix, C, i, &Q[i].P, &r) >= 0) committed++;
+        free_route(&r);
+    }
+
+    // Nodo más usado por el backlog = peor caso realista
+    int *use = (int*)calloc(NI->node_cap, sizeof(int));
+    for(int h=0; h<ix->count; h++){
+        const Route *R = &ix->routes[h].route;
+        for(int j=0;j<R->hops;j++){
+            int ci = R->contact_idxs[j];
+            if(C[ci].to < 100) use[C[ci].to]++;
+        }
+    }
+    int failed = 1;
+    for(int v=1; v<NI->node_cap; v++) if(use[v] > use[failed]) failed = v;
+    free(use);
+
+    // (a) Recálculo incremental
+    double t0 = now_s();
+    ImpactStats st = impact_reroute(ix, C, N, NI, NULL, 0, &failed, 1);
+    double t_inc = now_s() - t0;
+
+    // (b) Re-enrutado completo del backlog con el nodo vetado
+    unsigned char *mask = (unsigned char*)calloc(N, 1);
+    t0 = now_s();
+    memcpy(C, C0, sizeof(Contact)*N);
+    for(int i=0;i<N;i++) if(C[i].from == failed || C[i].to == failed) mask[i] = 1;
+    CgrFilters F; memset(&F, 0, sizeof(F)); F.banned_mask = mask;
+    int full_ok = 0;
+    for(int i=0;i<n_bundles;i++){
+        Route r = cgr_best_route_filtered(C, N, &Q[i].P, NI, &F);
+        if(r.found){
+            full_ok++;
+            for(int j=0;j<r.hops;j++){
+                Contact *c = &C[r.contact_idxs[j]];
+                c->residual_bytes = fmax(0.0, c->residual_bytes - Q[i].P.bundle_bytes);
+            }
+        }
+        free_route(&r);
+    }
+    double t_full = now_s() - t0;
+
+    printf("[impact] contacts=%d backlog=%d committed=%d failed_node=%d\n",
+           N, n_bundles, committed, failed);
+    printf("[impact]   banned=%d affected=%d rerouted=%d lost=%d\n",
+           st.banned_contacts, st.affected, st.rerouted, st.lost);
+    printf("[impact]   incremental: %9.3f ms\n", t_inc*1e3);
+    printf("[impact]   full       : %9.3f ms  (routes=%d)\n", t_full*1e3, full_ok);
+    printf("[impact]   speedup    : %9.1fx\n", t_inc > 0 ? t_full / t_inc : 0.0);
+
+    free(mask);
+    impact_free(ix);
+    free(Q);
+    free(C);
+    free_neighbor_index(NI);
+    free(C0);
+}
+
+/* ------------------- Sección: K rutas por consumo ------------------- */
+
+// Referencia: búsqueda completa tras cada consumo (algoritmo previo)
+static Routes k_routes_reference(const Contact *C_in, int N, const CgrParams *P,
+                                 const NeighborIndex *NI, int K){
+    Routes RS = { .items=(Route*)calloc(K, sizeof(Route)), .count=0, .cap=K };
+    Contact *C = (Contact*)malloc(sizeof(Contact)*N);
+    memcpy(C, C_in, sizeof(Contact)*N);
+    for(int k=0;k<K;k++){
+        Route r = cgr_best_route(C, N, P, NI);
+        if(!r.found) break;
+        RS.items[RS.count++] = r;
+        for(int j=0;j<r.hops;j++){
+            for(int i=0;i<N;i++){
+                if(C[i].id == r.contact_ids[j]){
+                    C[i].residual_bytes = fmax(0.0, C[i].residual_bytes - P->bundle_bytes);
+                    break;
+                }
+            }
+        }
+    }
+    free(C);
+    return RS;
+}
+
+static void bench_kroutes(const BenchPlanCfg *B, int K, int queries){
+    Contact *C = NULL;
+    int N = bench_plan(B, &C);
+    if(N <= 0){ fprintf(stderr, "bench_plan failed\n"); return; }
+    NeighborIndex *NI = build_neighbor_index(C, N);
+    BenchBundle *Q = bench_bundles(B, queries, B->seed + 2);
+
+    double t_ref = 0, t_inc = 0;
+    int routes_ref = 0, routes_inc = 0, mismatches = 0;
+    for(int q=0;q<queries;q++){
+        // Bundles grandes para agotar contactos y forzar invalidaciones
+        CgrParams P = Q[q].P;
+        P.bundle_bytes *= 40.0;
+
+        double t0 = now_s();
+        Routes A = k_routes_reference(C, N, &P, NI, K);
+        t_ref += now_s() - t0;
+
+        t0 = now_s();
+        Routes Bk = cgr_k_routes(C, N, &P, NI, K);
+        t_inc += now_s() - t0;
+
+        routes_ref += A.count;
+        routes_inc += Bk.count;
+        // Comparar hasta que un empate de ETA elija contactos distintos
+        // (a partir de ahí el consumo diverge legítimamente)
+        for(int r=0;r<A.count && r<Bk.count;r++){
+            const Route *a = &A.items[r], *b = &Bk.items[r];
+            if(fabs(a->eta - b->eta) > 1e-6){ mismatches++; break; }
+            if(a->hops != b->hops || memcmp(a->contact_ids, b->contact_ids, sizeof(int)*a->hops)) break;
+            if(r+1 == A.count && A.count != Bk.count) mismatches++;
+        }
+        free_routes(&A);
+        free_routes(&Bk);
+    }
+
+    printf("[kroutes] contacts=%d K=%d queries=%d\n", N, K, queries);
+    printf("[kroutes]   reference  : %9.3f ms  (routes=%d)\n", t_ref*1e3, routes_ref);
+    printf("[kroutes]   incremental: %9.3f ms  (routes=%d)\n", t_inc*1e3, routes_inc);
+    check(mismatches == 0);
+    printf("[kroutes]   speedup    : %9.1fx   eta mismatches=%d\n",
+           t_inc > 0 ? t_ref / t_inc : 0.0, mismatches);
+
+    // Yen sin consumo: búsquedas de desvío con y sin cota de ETA
+    int Ky = 10;
+    double t_unb = 0, t_bnd = 0;
+    int routes_unb = 0, same_sets = 0;
+    for(int q=0;q<queries;q++){
+        double t0 = now_s();
+        Routes A = cgr_k_yen_ex(C, N, &Q[q].P, NI, Ky, CGR_YEN_UNBOUNDED);
+        t_unb += now_s() - t0;
+        t0 = now_s();
+        Routes Bk = cgr_k_yen_ex(C, N, &Q[q].P, NI, Ky, 0);
+        t_bnd += now_s() - t0;
+
+        routes_unb += A.count;
+        int same = A.count == Bk.count;
+        for(int r=0;same && r<A.count;r++)
+            same = A.items[r].hops == Bk.items[r].hops &&
+                   !memcmp(A.items[r].contact_ids, Bk.items[r].contact_ids, sizeof(int)*A.items[r].hops);
+        same_sets += same;
+        free_routes(&A);
+        free_routes(&Bk);
+    }
+    printf("[kroutes]   yen K=%-4d : unbounded %9.3f ms  bounded %9.3f ms  (%.1fx, routes=%d, identical sets %d/%d)\n",
+           Ky, t_unb*1e3, t_bnd*1e3, t_bnd > 0 ? t_unb / t_bnd : 0.0, routes_unb, same_sets, queries);
+
+    free(Q);
+    free_neighbor_index(NI);
+    free(C);
+}
+
+/* ------------------ Sección: carga del plan + índice ------------------ */
+
+static int write_plan_csv(const char *path, const Contact *C, int N){
+    FILE *f = fopen(path, "w");
+    if(!f) return -1;
+    fprintf(f, "# id,from,to,t_start,t_end,owlt_s,rate_bps,setup_s,residual_bytes[,p_success]\n");
+    for(int i=0;i<N;i++){
+        fprintf(f, "%d,%d,%d,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g",
+                C[i].id, C[i].from, C[i].to, C[i].t_start, C[i].t_end,
+                C[i].owlt, C[i].rate_bps, C[i].setup_s, C[i].residual_bytes);
+        if(C[i].p_fail != 0.0) fprintf(f, ",%.17g", 1.0 - C[i].p_fail);
+        fputc('\n', f);
+    }
+    return fclose(f);
+}
+
+static int same_contacts(const Contact *a, const Contact *b, int N){
+    for(int i=0;i<N;i++){
+        if(a[i].id != b[i].id || a[i].from != b[i].from || a[i].to != b[i].to ||
+           a[i].t_start != b[i].t_start || a[i].t_end != b[i].t_end || a[i].owlt != b[i].owlt ||
+           a[i].rate_bps != b[i].rate_bps || a[i].setup_s != b[i].setup_s ||
+           a[i].residual_bytes != b[i].residual_bytes || a[i].p_fail != b[i].p_fail) return 0;
+    }
+    return 1;
+}
+
+static int same_index(const NeighborIndex *a, const NeighborIndex *b){
+    if(a->node_cap != b->node_cap) return 0;
+    for(int v=0; v<a->node_cap; v++){
+        if(a->by_from[v].count != b->by_from[v].count || a->by_to[v].count != b->by_to[v].count) return 0;
+        if(memcmp(a->by_from[v].idxs, b->by_from[v].idxs, sizeof(int)*a->by_from[v].count)) return 0;
+        if(memcmp(a->by_to[v].idxs, b->by_to[v].idxs, sizeof(int)*a->by_to[v].count)) return 0;
+    }
+    return 1;
+}
+
+static void bench_load(const BenchPlanCfg *B, double days){
+    BenchPlanCfg L = *B;
+    L.horizon = days * 86400.0;
+    Contact *C0 = NULL;
+    int N0 = bench_plan(&L, &C0);
+    if(N0 <= 0){ fprintf(stderr, "bench_plan failed\n"); return; }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/cgr_bench_plan_%ld.csv", (long)getpid());
+    if(write_plan_csv(path, C0, N0) != 0){ fprintf(stderr, "cannot write %s\n", path); free(C0); return; }
+
+    // Referencia secuencial
+    double t0 = now_s();
+    Contact *Cs = NULL;
+    int Ns = load_contacts_csv(path, &Cs);
+    double t_load = now_s() - t0;
+    t0 = now_s();
+    NeighborIndex *NIs = build_neighbor_index(Cs, Ns);
+    double t_build = now_s() - t0;
+
+    printf("[load] contacts=%d (%.1f days)\n", Ns, days);
+    printf("[load]   serial      : load %8.1f ms  build %7.1f ms  total %8.1f ms\n",
+           t_load*1e3, t_build*1e3, (t_load+t_build)*1e3);
+
+    const int sweep[] = {1, 2, 4, 8};
+    for(size_t k=0; k<sizeof(sweep)/sizeof(sweep[0]); k++){
+        int T = sweep[k];
+        Contact *Cp = NULL;
+        t0 = now_s();
+        int Np = load_contacts_csv_parallel(path, T, &Cp);
+        double tl = now_s() - t0;
+        t0 = now_s();
+        NeighborIndex *NIp = build_neighbor_index_parallel(Cp, Np, 0, T);
+        double tb = now_s() - t0;
+
+        int same = (Np == Ns) && same_contacts(Cp, Cs, Ns) && NIp && same_index(NIs, NIp);
+        printf("[load]   threads=%-2d  : load %8.1f ms  build %7.1f ms  total %8.1f ms  %s\n",
+               T, tl*1e3, tb*1e3, (tl+tb)*1e3, check(same) ? "identical" : "MISMATCH");
+        free_neighbor_index(NIp);
+        free(Cp);
+    }
+
+    remove(path);
+    free_neighbor_index(NIs);
+    free(Cs);
+    free(C0);
+}
+
+/* ----------------------- Sección: archivo columnar ----------------------- */
+
+static long file_size(const char *path){
+    FILE *f = fopen(path, "rb");
+    if(!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fclose(f);
+    return n;
+}
+
+static void bench_archive(const BenchPlanCfg *B, double days){
+    BenchPlanCfg L = *B;
+    L.horizon = days * 86400.0;
+    Contact *C0 = NULL;
+    int N0 = bench_plan(&L, &C0);
+    if(N0 <= 0){ fprintf(stderr, "bench_plan failed\n"); return; }
+
+    char csv[64], arc[64];
+    snprintf(csv, sizeof(csv), "/tmp/cgr_bench_plan_%ld.csv", (long)getpid());
+    snprintf(arc, sizeof(arc), "/tmp/cgr_bench_plan_%ld.cgrp", (long)getpid());
+    double t0 = now_s();
+    int werr = write_plan_csv(csv, C0, N0) != 0;
+    double t_wcsv = now_s() - t0;
+    t0 = now_s();
+    werr |= plan_archive_write(arc, C0, N0, PLAN_ARCHIVE_BLOCK_DEFAULT) != 0;
+    double t_warc = now_s() - t0;
+    if(werr){ fprintf(stderr, "cannot write bench plans\n"); remove(csv); remove(arc); free(C0); return; }
+
+    long sz_csv = file_size(csv), sz_arc = file_size(arc);
+    printf("[archive] contacts=%d (%.1f days)\n", N0, days);
+    printf("[archive]   size   : csv %8.2f MB  archive %7.2f MB  (%.1fx, %.1f B/contact)\n",
+           sz_csv/1e6, sz_arc/1e6, (double)sz_csv/(double)sz_arc, (double)sz_arc/N0);
+    printf("[archive]   write  : csv %8.1f ms  archive %7.1f ms\n", t_wcsv*1e3, t_warc*1e3);
+
+    t0 = now_s();
+    Contact *Cc = NULL;
+    int Nc = load_contacts_csv(csv, &Cc);
+    double t_csv = now_s() - t0;
+
+    PlanArchiveInfo info;
+    t0 = now_s();
+    Contact *Ca = NULL;
+    int Na = plan_archive_load(arc, 0.0, -1.0, &Ca, &info);
+    double t_all = now_s() - t0;
+    int total_blocks = info.n_blocks;
+
+    // Mismo multiconjunto de contactos: el archivo está en orden de t_start, comparar por id
+    int same = (Na == Nc && Na == N0);
+    if(same){
+        Contact *ref = (Contact*)malloc(sizeof(Contact)*N0);
+        for(int i=0; ref && i<N0; i++) ref[C0[i].id] = C0[i];
+        for(int i=0; ref && i<Na && same; i++) same = same_contacts(&Ca[i], &ref[Ca[i].id], 1);
+        if(!ref) same = 0;
+        free(ref);
+    }
+    printf("[archive]   full   : csv %8.1f ms  archive %7.1f ms  (%.1fx)  %s\n",
+           t_csv*1e3, t_all*1e3, t_csv/t_all, check(same) ? "identical" : "MISMATCH");
+
+    // Rebanada de un día a mitad del plan
+    double lo = floor(days*0.5) * 86400.0, hi = lo + 86400.0;
+    t0 = now_s();
+    Contact *Cd = NULL;
+    int Nd = plan_archive_load(arc, lo, hi, &Cd, &info);
+    double t_day = now_s() - t0;
+    int expect = 0;
+    for(int i=0;i<N0;i++) if(C0[i].t_end >= lo && C0[i].t_start <= hi) expect++;
+    printf("[archive]   1-day  : %d contacts in %.1f ms  blocks %d/%d  read %.2f MB  %s\n",
+           Nd, t_day*1e3, info.blocks_read, total_blocks, info.bytes_read/1e6,
+           check(Nd == expect) ? "ok" : "MISMATCH");
+
+    remove(csv);
+    remove(arc);
+    free(Cd);
+    free(Ca);
+    free(Cc);
+    free(C0);
+}
+
+/* ----------------------- Sección: plan en ventana ----------------------- */
+
+// Recorre `days` de plan desde un .cgrp con una ventana de `H` segundos,
+// construyendo el índice en cada tick como haría cgr_live.
+static void bench_stream(const BenchPlanCfg *B, double days, double H, double tick){
+    BenchPlanCfg L = *B;
+    L.horizon = days * 86400.0;
+    Contact *C0 = NULL;
+    int N0 = bench_plan(&L, &C0);
+    if(N0 <= 0){ fprintf(stderr, "bench_plan failed\n"); return; }
+
+    char arc[64];
+    snprintf(arc, sizeof(arc), "/tmp/cgr_bench_stream_%ld.cgrp", (long)getpid());
+    if(plan_archive_write(arc, C0, N0, PLAN_ARCHIVE_BLOCK_DEFAULT) != 0){
+        fprintf(stderr, "cannot write %s\n", arc); free(C0); return;
+    }
+    printf("[stream] contacts=%d (%.1f days), window %.0f s, tick %.0f s\n", N0, days, H, tick);
+
+    for(int prefetch=0; prefetch<=1; prefetch++){
+        PlanStreamCfg sc = { .horizon=H, .period=0.0, .prefetch=prefetch, .queue_cap=0, .chunk=0 };
+        PlanStream *PS = plan_stream_open(plan_source_archive(arc), &sc);
+        if(!PS){ fprintf(stderr, "cannot open stream\n"); break; }
+
+        int ticks = 0, checks = 0, bad = 0;
+        double t_check = 0.0, t0 = now_s();
+        for(double now=0.0; now<L.horizon; now+=tick, ticks++){
+            int n = plan_stream_advance(PS, now);
+            const Contact *W = plan_stream_contacts(PS, &n);
+            NeighborIndex *NI = build_neighbor_index(W, n);
+            free_neighbor_index(NI);
+            if(ticks % 24 == 0){   // comprobar contra el plan completo (fuera del tiempo medido)
+                double tc = now_s();
+                int expect = 0;
+                for(int i=0;i<N0;i++) if(C0[i].t_end >= now && C0[i].t_start <= now + H) expect++;
+                checks++;
+                if(expect != n) bad++;
+                t_check += now_s() - tc;
+            }
+        }
+        double dt = now_s() - t0 - t_check;
+        PlanStreamStats st = plan_stream_stats(PS);
+        printf("[stream]   %-9s: %d ticks in %7.1f ms (%.3f ms/tick)  peak window %d (%.1f%% of plan)  "
+               "stalls %d  checks %d/%d %s\n",
+               prefetch ? "prefetch" : "sync", ticks, dt*1e3, dt*1e3/ticks,
+               st.peak_window, 100.0*st.peak_window/N0, st.stalls, checks-bad, checks,
+               check(!bad) ? "ok" : "MISMATCH");
+        plan_stream_close(PS);
+    }
+
+    remove(arc);
+    free(C0);
+}
+
+/* ----------------------- Sección: salida JSON ----------------------- */
+
+static void stdio_route_json(FILE *f, const Route *R, double t0){
+    fprintf(f, "{\"eta\":%.6f,\"latency\":%.6f,\"hops\":%d,\"contacts\":[", R->eta, R->eta - t0, R->hops);
+    for(int i=0;i<R->hops;i++) fprintf(f, "%s%d", (i? ",":""), R->contact_ids[i]);
+    fprintf(f, "]}\n");
+}
+
+// Formatea `total` rutas (reutilizando las de `n_bundles` consultas) a /dev/null
+static void bench_output(const BenchPlanCfg *B, int n_bundles, int total){
+    Contact *C = NULL;
+    int N = bench_plan(B, &C);
+    NeighborIndex *NI = build_neighbor_index(C, N);
+    BenchBundle *Q = bench_bundles(B, n_bundles, 7);
+    Route *R = (Route*)calloc(n_bundles, sizeof(Route));
+    int found = 0;
+    for(int i=0;i<n_bundles;i++){
+        R[i] = cgr_best_route(C, N, &Q[i].P, NI);
+        if(R[i].found) found++;
+    }
+    if(!found){ fprintf(stderr, "no routes to format\n"); total = 0; }
+
+    FILE *f = fopen("/dev/null", "w");
+    int fd = open("/dev/null", O_WRONLY);
+    double t0 = now_s();
+    for(int k=0, i=0; k<total; i=(i+1)%n_bundles){
+        if(!R[i].found) continue;
+        stdio_route_json(f, &R[i], Q[i].P.t0);
+        k++;
+    }
+    fflush(f);
+    double t_stdio = now_s() - t0;
+
+    // NDJSON con volcado cada 1 MiB y con un único write al final
+    double t_ob[2];
+    size_t bytes = 0;
+    int writes[2];
+    for(int mode=0; mode<2; mode++){
+        OutBuf ob;
+        ob_init(&ob, fd, mode == 0 ? (1u << 20) : 0);
+        writes[mode] = 0;
+        t0 = now_s();
+        for(int k=0, i=0; k<total; i=(i+1)%n_bundles){
+            if(!R[i].found) continue;
+            ob_route_json(&ob, &R[i], Q[i].P.t0, 6);
+            ob_putc(&ob, '\n');
+            size_t before = ob.len;
+            ob_end_record(&ob);
+            if(ob.len < before) writes[mode]++;
+            k++;
+        }
+        bytes = ob.len;
+        if(ob.len) writes[mode]++;
+        ob_flush(&ob);
+        t_ob[mode] = now_s() - t0;
+        ob_free(&ob);
+    }
+
+    printf("[output] %d route records (compact JSON, %%.6f)\n", total);
+    printf("[output]   stdio fprintf   : %8.1f ms  (%.0f ns/route)\n", t_stdio*1e3, t_stdio*1e9/total);
+    printf("[output]   outbuf 1MiB     : %8.1f ms  (%.0f ns/route, %.1fx)  writes=%d\n",
+           t_ob[0]*1e3, t_ob[0]*1e9/total, t_stdio/t_ob[0], writes[0]);
+    printf("[output]   outbuf one batch: %8.1f ms  (%.0f ns/route, %.1fx)  writes=%d  %.1f MB\n",
+           t_ob[1]*1e3, t_ob[1]*1e9/total, t_stdio/t_ob[1], writes[1], bytes/1e6);
+
+    fclose(f);
+    close(fd);
+    for(int i=0;i<n_bundles;i++) free_route(&R[i]);
+    free(R);
+    free(Q);
+    free_neighbor_index(NI);
+    free(C);
+}
+
+/* ----------------------- Section: penalty overlay ----------------------- */
+
+// One learning cycle the old api_main way (copy the plan, bake the penalties
+// into setup_s, rebuild the index) against the overlay over a fixed index.
+static void bench_overlay(const BenchPlanCfg *B, int cycles){
+    Contact *C = NULL;
+    int N = bench_plan(B, &C);
+    BenchBundle *Q = bench_bundles(B, cycles, 11);
+    CgrOverlay *ov = overlay_new(N, 1.0);
+    srand(B->seed + 5);
+    for(int i=0;i<N;i++) if(rand() % 4 == 0) overlay_set(ov, i, frand(0.0, 30.0));
+
+    double t0 = now_s();
+    NeighborIndex *NI = build_neighbor_index(C, N);
+    double t_build = now_s() - t0;
+
+    double t_copy = 0.0, t_ov = 0.0;
+    int mismatches = 0, found = 0;
+    for(int c=0;c<cycles;c++){
+        t0 = now_s();
+        Contact *W = (Contact*)malloc(sizeof(Contact)*N);
+        memcpy(W, C, sizeof(Contact)*N);
+        for(int i=0;i<N;i++) W[i].setup_s += ov->lambda * overlay_get(ov, i);
+        NeighborIndex *NIw = build_neighbor_index(W, N);
+        Route a = cgr_best_route(W, N, &Q[c].P, NIw);
+        free_neighbor_index(NIw);
+        free(W);
+        t_copy += now_s() - t0;
+
+        CgrParams P = Q[c].P;
+        P.overlay = ov;
+        t0 = now_s();
+        Route b = cgr_best_route(C, N, &P, NI);
+        t_ov += now_s() - t0;
+
+        if(a.found != b.found || (a.found && (a.eta != b.eta || a.hops != b.hops))) mismatches++;
+        if(b.found && b.hops > 0){
+            found++;
+            overlay_ewma(ov, b.contact_idxs[0], frand(0.0, 60.0), 0.2);
+        }
+        free_route(&a);
+        free_route(&b);
+    }
+
+    printf("[overlay] %d contacts, %d learning cycles (%d routed)\n", N, cycles, found);
+    printf("[overlay]   copy + rebuild : %8.3f ms/cycle\n", t_copy*1e3/cycles);
+    printf("[overlay]   overlay        : %8.3f ms/cycle  (%.1fx, one-off index %.3f ms)\n",
+           t_ov*1e3/cycles, t_copy/t_ov, t_build*1e3);
+    printf("[overlay]   routes identical: %s\n\n", check(!mismatches) ? "yes" : "NO");
+
+    free_neighbor_index(NI);
+    overlay_free(ov);
+    free(Q);
+    free(C);
+}
+
+/* ----------------------- Section: link feedback ----------------------- */
+
+typedef struct {
+    LinkTable *T;
+    const Contact *C;
+    int N, n_reports;
+    unsigned int seed;
+} ReportArg;
+
+static void* report_worker(void *p){
+    ReportArg *a = (ReportArg*)p;
+    unsigned int s = a->seed;
+    for(int i=0;i<a->n_reports;i++){
+        s = s * 1103515245u + 12345u;
+        const Contact *c = &a->C[(s >> 8) % (unsigned)a->N];
+        HopReport r = { .from=c->from, .to=c->to, .planned_bps=c->rate_bps,
+                        .achieved_bps=c->rate_bps * (0.5 + (s & 0xff) / 512.0),
+                        .extra_delay_s=(s >> 24) * 0.01, .failed=(s & 0x3f) == 0 };
+        link_report(a->T, &r);
+    }
+    return NULL;
+}
+
+typedef struct {
+    const Contact *C;
+    int N;
+    const NeighborIndex *NI;
+    const BenchBundle *Q;
+    int nq;
+    const CgrOverlay *ov;
+    atomic_int *stop;
+    int routed;
+} RouteArg;
+
+static void* route_worker(void *p){
+    RouteArg *a = (RouteArg*)p;
+    for(int i=0; !atomic_load_explicit(a->stop, memory_order_relaxed); i=(i+1)%a->nq){
+        CgrParams P = a->Q[i].P;
+        P.overlay = a->ov;
+        Route R = cgr_best_route(a->C, a->N, &P, a->NI);
+        free_route(&R);
+        a->routed++;
+    }
+    return NULL;
+}
+
+// Hop reports into the link table: ingest rate alone, with a routing thread
+// reading the estimates concurrently, and the effect on the chosen route.
+static void bench_feedback(const BenchPlanCfg *B, int reporters, int n_reports){
+    Contact *C = NULL;
+    int N = bench_plan(B, &C);
+    NeighborIndex *NI = build_neighbor_index(C, N);
+    BenchBundle *Q = bench_bundles(B, 200, 13);
+    LinkTable *T = link_table_new(N, 0.2, 0.95);
+    CgrOverlay *ov = overlay_new(N, 0.0);
+    overlay_bind_links(ov, T, C, N);
+
+    pthread_t th[16], rt;
+    ReportArg ra[16];
+    if(reporters > 16) reporters = 16;
+    double t_alone = 0.0, t_mixed = 0.0;
+    int routed = 0;
+    for(int mode=0; mode<2; mode++){
+        atomic_int stop = 0;
+        RouteArg ga = { .C=C, .N=N, .NI=NI, .Q=Q, .nq=200, .ov=ov, .stop=&stop, .routed=0 };
+        if(mode == 1) pthread_create(&rt, NULL, route_worker, &ga);
+        double t0 = now_s();
+        for(int i=0;i<reporters;i++){
+            ra[i] = (ReportArg){ .T=T, .C=C, .N=N, .n_reports=n_reports, .seed=B->seed*31u + i + mode*97u };
+            pthread_create(&th[i], NULL, report_worker, &ra[i]);
+        }
+        for(int i=0;i<reporters;i++) pthread_join(th[i], NULL);
+        double dt = now_s() - t0;
+        if(mode == 1){ atomic_store(&stop, 1); pthread_join(rt, NULL); routed = ga.routed; t_mixed = dt; }
+        else t_alone = dt;
+    }
+    double total = (double)reporters * n_reports;
+
+    // Degradar el primer salto de una ruta y comprobar que se evita
+    int changed = -1;
+    for(int q=0; q<200 && changed < 0; q++){
+        CgrParams P = Q[q].P;
+        P.overlay = ov;
+        Route before = cgr_best_route(C, N, &P, NI);
+        if(!before.found || before.hops < 1){ free_route(&before); continue; }
+        const Contact *c0 = NULL;
+        for(int i=0;i<N && !c0;i++) if(C[i].id == before.contact_ids[0]) c0 = &C[i];
+        for(int k=0;k<LINK_WINDOW;k++){
+            HopReport r = { .from=c0->from, .to=c0->to, .planned_bps=c0->rate_bps,
+                            .achieved_bps=c0->rate_bps * 0.1, .extra_delay_s=600.0, .failed=0 };
+            link_report(T, &r);
+        }
+        Route after = cgr_best_route(C, N, &P, NI);
+        changed = !after.found || after.contact_ids[0] != before.contact_ids[0];
+        free_route(&before);
+        free_route(&after);
+    }
+
+    printf("[feedback] %d contacts, %u links, %d reporter threads x %d reports\n",
+           N, (unsigned)atomic_load(&T->used), reporters, n_reports);
+    printf("[feedback]   reports alone    : %8.1f ms  (%.1f M reports/s)\n", t_alone*1e3, total/t_alone/1e6);
+    printf("[feedback]   with routing     : %8.1f ms  (%.1f M reports/s, %d routes meanwhile)\n",
+           t_mixed*1e3, total/t_mixed/1e6, routed);
+    printf("[feedback]   degraded hop avoided: %s\n\n", changed == 1 ? "yes" : changed == 0 ? "NO" : "n/a");
+
+    overlay_free(ov);
+    link_table_free(T);
+    free(Q);
+    free_neighbor_index(NI);
+    free(C);
+}
+
+/* ----------------------- Section: probabilistic contacts ----------------------- */
+
+static void bench_prob(const BenchPlanCfg *B, int n_bundles, int K){
+    Contact *C = NULL;
+    int N = bench_plan(B, &C);
+    NeighborIndex *NI = build_neighbor_index(C, N);
+    BenchBundle *Q = bench_bundles(B, n_bundles, 17);
+    Route *R = (Route*)calloc(n_bundles, sizeof(Route));
+    CgrProbCfg maxp = { .mode=CGR_PROB_MAX_DELIVERY };
+    CgrProbCfg expd = { .mode=CGR_PROB_MIN_EXPECTED };
+
+    // Deterministic plan: the probabilistic search must match cgr_best_route
+    double t0 = now_s();
+    for(int i=0;i<n_bundles;i++) R[i] = cgr_best_route(C, N, &Q[i].P, NI);
+    double t_det = now_s() - t0;
+    int same = 0;
+    t0 = now_s();
+    for(int i=0;i<n_bundles;i++){
+        Route r = cgr_prob_route(C, N, &Q[i].P, NI, &maxp, NULL);
+        if(r.found == R[i].found && (!r.found || (r.eta == R[i].eta && r.hops == R[i].hops))) same++;
+        free_route(&r);
+    }
+    double t_p0 = now_s() - t0;
+
+    // Ground passes fail with weather (p up to 0.3), ISLs rarely (p up to 0.02);
+    // bundles must be delivered within 1 h
+    for(int i=0;i<n_bundles;i++) Q[i].P.expiry = 3600.0;
+    srand(B->seed + 9);
+    for(int i=0;i<N;i++){
+        int gs = C[i].from >= 100 || C[i].to >= 100;
+        C[i].p_fail = gs ? frand(0.0, 0.3) : frand(0.0, 0.02);
+    }
+    for(int i=0;i<n_bundles;i++){ free_route(&R[i]); R[i] = cgr_best_route(C, N, &Q[i].P, NI); }
+
+    double p_det = 0.0, p_max = 0.0, eta_det = 0.0, eta_max = 0.0;
+    double t_pm = 0.0, t_pe = 0.0;
+    int found = 0;
+    for(int i=0;i<n_bundles;i++){
+        if(!R[i].found) continue;
+        Routes one = { .items=&R[i], .count=1, .cap=1 };
+        double p;
+        t0 = now_s();
+        Route r = cgr_prob_route(C, N, &Q[i].P, NI, &maxp, &p);
+        t_pm += now_s() - t0;
+        t0 = now_s();
+        Route e = cgr_prob_route(C, N, &Q[i].P, NI, &expd, NULL);
+        t_pe += now_s() - t0;
+        if(r.found){
+            found++;
+            p_det += cgr_routes_delivery_prob(C, N, &one);
+            p_max += p;
+            eta_det += R[i].eta - Q[i].P.t0;
+            eta_max += r.eta - Q[i].P.t0;
+        }
+        free_route(&r);
+        free_route(&e);
+    }
+
+    // K-route sets: Yen by ETA vs greedy by combined reliability
+    int nk = n_bundles < 50 ? n_bundles : 50;
+    double pk_yen = 0.0, pk_rel = 0.0, t_yen = 0.0, t_rel = 0.0;
+    for(int i=0;i<nk;i++){
+        t0 = now_s();
+        Routes Y = cgr_k_yen(C, N, &Q[i].P, NI, K);
+        t_yen += now_s() - t0;
+        double p;
+        t0 = now_s();
+        Routes S = cgr_prob_k_routes(C, N, &Q[i].P, NI, &maxp, K, &p);
+        t_rel += now_s() - t0;
+        pk_yen += cgr_routes_delivery_prob(C, N, &Y);
+        pk_rel += p;
+        free_routes(&Y);
+        free_routes(&S);
+    }
+
+    check(same == n_bundles);
+    printf("[prob] %d contacts, %d bundles\n", N, n_bundles);
+    printf("[prob]   p_fail=0  : best_route %6.1f us/q, prob_route %6.1f us/q (%.2fx)  identical %d/%d\n",
+           t_det*1e6/n_bundles, t_p0*1e6/n_bundles, t_p0/t_det, same, n_bundles);
+    if(found){
+        printf("[prob]   random p  : max-delivery %6.1f us/q, min-expected %6.1f us/q\n",
+               t_pm*1e6/found, t_pe*1e6/found);
+        printf("[prob]   delivery  : earliest route p=%.3f (latency %.0f s)  most reliable p=%.3f (latency %.0f s)\n",
+               p_det/found, eta_det/found, p_max/found, eta_max/found);
+    }
+    printf("[prob]   K=%d sets  : yen p=%.3f (%.1f ms/q)  reliability-greedy p=%.3f (%.1f ms/q)\n\n",
+           K, pk_yen/nk, t_yen*1e3/nk, pk_rel/nk, t_rel*1e3/nk);
+
+    for(int i=0;i<n_bundles;i++) free_route(&R[i]);
+    free(R);
+    free(Q);
+    free_neighbor_index(NI);
+    free(C);
+}
+
+/* Monte Carlo robustness: reusable workspaces, copy-on-write trials and
+   thread scaling (results must not depend on the thread count) */
+static void bench_mc(const BenchPlanCfg *B, int n_queries, int trials){
+    Contact *C = NULL;
+    int N = bench_plan(B, &C);
+    NeighborIndex *NI = build_neighbor_index(C, N);
+    BenchBundle *BB = bench_bundles(B, n_queries, 23);
+    CgrParams *Q = (CgrParams*)malloc(sizeof(CgrParams)*n_queries);
+    for(int i=0;i<n_queries;i++) Q[i] = BB[i].P;
+
+    // Per-query cost: fresh O(N) labels vs a reused workspace
+    CgrWorkspace *ws = cgr_workspace_new(N);
+    int same = 0;
+    double t0 = now_s();
+    for(int i=0;i<n_queries;i++){ Route r = cgr_best_route(C, N, &Q[i], NI); free_route(&r); }
+    double t_fresh = now_s() - t0;
+    t0 = now_s();
+    for(int i=0;i<n_queries;i++){ Route r = cgr_best_route_ws(C, N, &Q[i], NI, NULL, ws); free_route(&r); }
+    double t_ws = now_s() - t0;
+    for(int i=0;i<n_queries;i++){
+        Route a = cgr_best_route(C, N, &Q[i], NI), b = cgr_best_route_ws(C, N, &Q[i], NI, NULL, ws);
+        if(a.found == b.found && (!a.found || (a.eta == b.eta && a.hops == b.hops))) same++;
+        free_route(&a); free_route(&b);
+    }
+    cgr_workspace_free(ws);
+
+    // Baseline trial: copy the whole plan and perturb every contact's dice
+    McConfig cfg = { .trials = trials, .threads = 1, .seed = 7,
+                     .pert = { .p_drop = 0.02, .p_jitter = 0.05, .jitter_s = 20.0,
+                               .p_rate = 0.05, .rate_lo = 0.5, .rate_hi = 1.0 } };
+    Contact *copy = (Contact*)malloc(sizeof(Contact)*N);
+    int nb = trials < 50 ? trials : 50;
+    t0 = now_s();
+    for(int t=0;t<nb;t++){
+        memcpy(copy, C, sizeof(Contact)*N);
+        for(int i=0;i<N;i++){
+            if(frand(0,1) < cfg.pert.p_jitter) copy[i].t_start += frand(-20.0, 20.0);
+            if(frand(0,1) < cfg.pert.p_rate) copy[i].rate_bps *= frand(0.5, 1.0);
+        }
+    }
+    double t_copy = (now_s() - t0) / nb;
+    free(copy);
+
+    printf("[mc] %d contacts, %d queries, %d trials (%ld online cpus)\n",
+           N, n_queries, trials, sysconf(_SC_NPROCESSORS_ONLN));
+    check(same == n_queries);
+    printf("[mc]   search    : fresh %6.1f us/q, workspace %6.1f us/q (%.2fx)  identical %d/%d\n",
+           t_fresh*1e6/n_queries, t_ws*1e6/n_queries, t_fresh/t_ws, same, n_queries);
+
+    McResult R1;
+    int threads[] = {1, 2, 4};
+    double base = 0.0;
+    for(int k=0;k<3;k++){
+        McResult R;
+        cfg.threads = threads[k];
+        if(mc_run(C, N, NI, Q, n_queries, &cfg, &R) != 0){ printf("[mc]   mc_run failed\n"); break; }
+        if(k == 0){
+            R1 = R;
+            base = R.elapsed_s;
+            McSummary s;
+            mc_summary(&R, -1, &s);
+            printf("[mc]   trial     : %.1f contacts perturbed (copy-on-write); full copy + per-contact dice would cost %.1f us\n",
+                   (double)R.perturbed/trials, t_copy*1e6);
+            printf("[mc]   outcome   : delivery %.1f%%, latency p50 %.0f s p99 %.0f s\n",
+                   100.0*s.delivery, s.p50, s.p99);
+        }
+        int same_res = !memcmp(R.latency, R1.latency, sizeof(float)*(size_t)trials*n_queries);
+        printf("[mc]   threads=%d : %7.1f trials/s  speedup %.2fx  %s\n", threads[k],
+               trials / R.elapsed_s, base / R.elapsed_s, check(same_res) ? "same results" : "RESULTS DIFFER");
+        if(k) mc_result_free(&R);
+    }
+    mc_result_free(&R1);
+    printf("\n");
+
+    free(Q);
+    free(BB);
+    free_neighbor_index(NI);
+    free(C);
+}
+
+/* Fused SoA ETA kernel: per-level kernel throughput on the largest
+   outgoing list, and end-to-end k=1 searches with and without the SoA view */
+static int same_route(const Route *a, const Route *b){
+    if(a->found != b->found) return 0;
+    if(!a->found) return 1;
+    if(a->eta != b->eta || a->hops != b->hops) return 0;
+    return !memcmp(a->contact_ids, b->contact_ids, sizeof(int)*a->hops);
+}
+
+static void bench_eta(const BenchPlanCfg *B, int n_queries, int kernel_reps){
+    Contact *C = NULL;
+    int N = bench_plan(B, &C);
+    NeighborIndex *NI = build_neighbor_index(C, N);
+    BenchBundle *Q = bench_bundles(B, n_queries, 31);
+    CgrWorkspace *ws = cgr_workspace_new(N);
+    Route *ref = (Route*)calloc(n_queries, sizeof(Route));
+
+    double t0 = now_s();
+    for(int i=0;i<n_queries;i++) ref[i] = cgr_best_route_ws(C, N, &Q[i].P, NI, NULL, ws);
+    double t_aos = now_s() - t0;
+
+    t0 = now_s();
+    neighbor_index_attach_soa(NI, C, N);
+    double t_attach = now_s() - t0;
+
+    int big = 0;
+    for(int v=1;v<NI->node_cap;v++) if(NI->by_from[v].count > NI->by_from[big].count) big = v;
+    const IndexList *L = &NI->by_from[big];
+    const double *base = NI->soa + (L->idxs - NI->from_pool);
+    size_t col = (size_t)NI->soa_n;
+    EtaSoA S = { base, base + col, base + 2*col, base + 3*col, base + 4*col };
+    double *eta = (double*)malloc(sizeof(double)*L->count), *eta0 = (double*)malloc(sizeof(double)*L->count);
+    int *sel = (int*)malloc(sizeof(int)*L->count);
+
+    printf("[eta] %d contacts, %d queries; largest outgoing list: node %d with %d contacts; cpu best: %s\n",
+           N, n_queries, big, L->count, cgr_simd_name(cgr_simd_detect()));
+    printf("[eta]   search AoS (per-contact checks) %6.1f us/q; SoA view built in %.2f ms\n",
+           t_aos*1e6/n_queries, t_attach*1e3);
+
+    CgrSimdLevel best = cgr_simd_detect();
+    double k_scalar = 0.0;
+    for(int lv=CGR_SIMD_SCALAR; lv<=(int)best; lv++){
+        cgr_simd_force((CgrSimdLevel)lv);
+        int m = 0, same_k = 1;
+        t0 = now_s();
+        for(int r=0;r<kernel_reps;r++){
+            double t_in = B->horizon * r / kernel_reps;
+            m += eta_bulk(&S, L->count, t_in, 1e6, 0.0, eta, sel);
+        }
+        double tk = now_s() - t0;
+        for(int r=0;r<8;r++){
+            double t_in = B->horizon * r / 8;
+            cgr_simd_force(CGR_SIMD_SCALAR);
+            eta_bulk(&S, L->count, t_in, 5e6, t_in + 3600.0, eta0, sel);
+            cgr_simd_force((CgrSimdLevel)lv);
+            eta_bulk(&S, L->count, t_in, 5e6, t_in + 3600.0, eta, sel);
+            if(memcmp(eta, eta0, sizeof(double)*L->count)) same_k = 0;
+        }
+        if(lv == CGR_SIMD_SCALAR) k_scalar = tk;
+
+        int same = 0;
+        t0 = now_s();
+        for(int i=0;i<n_queries;i++){
+            Route r = cgr_best_route_ws(C, N, &Q[i].P, NI, NULL, ws);
+            same += same_route(&r, &ref[i]);
+            free_route(&r);
+        }
+        double ts = now_s() - t0;
+        check(same == n_queries);
+        printf("[eta]   %-6s : kernel %5.2f ns/contact (%.2fx, %d viable/call, %s)  search %6.1f us/q (%.2fx)  identical %d/%d\n",
+               cgr_simd_name((CgrSimdLevel)lv), tk*1e9/((double)kernel_reps*L->count), k_scalar/tk,
+               m/kernel_reps, check(same_k) ? "bit-exact" : "MISMATCH", ts*1e6/n_queries, t_aos/ts, same, n_queries);
+    }
+    cgr_simd_force(best);
+    printf("\n");
+
+    for(int i=0;i<n_queries;i++) free_route(&ref[i]);
+    free(ref);
+    free(eta); free(eta0); free(sel);
+    cgr_workspace_free(ws);
+    free(Q);
+    free_neighbor_index(NI);
+    free(C);
+}
+
+/* Relaxation throughput of the k=1 search on the per-contact path (no SoA
+   view), with the reject breakdown collected by the workspace */
+static void bench_eval(const BenchPlanCfg *B, int n_queries){
+    Contact *C = NULL;
+    int N = bench_plan(B, &C);
+    NeighborIndex *NI = build_neighbor_index(C, N);
+    BenchBundle *Q = bench_bundles(B, n_queries, 37);
+    CgrWorkspace *ws = cgr_workspace_new(N);
+
+    // Half the queries with a 30 min expiry so every reject reason shows up
+    for(int i=0;i<n_queries;i+=2) Q[i].P.expiry = 1800.0;
+    double t0 = now_s();
+    int found = 0;
+    for(int i=0;i<n_queries;i++){
+        Route r = cgr_best_route_ws(C, N, &Q[i].P, NI, NULL, ws);
+        found += r.found;
+        free_route(&r);
+    }
+    double t = now_s() - t0;
+
+    CgrSearchStats st;
+    cgr_workspace_stats(ws, &st);
+    uint64_t evals = 0;
+    for(int r=0;r<CGR_REJ_COUNT;r++) evals += st.reject[r];
+    printf("[eval] %d contacts, %d queries (%d found): %.1f us/q\n", N, n_queries, found, t*1e6/n_queries);
+    printf("[eval]   %.0f contact evaluations/q, %.1f M evaluations/s; %.0f pops/q (%.1f%% stale), %.0f label updates/q\n",
+           (double)evals/n_queries, evals/t/1e6, (double)st.pops/n_queries,
+           st.pops ? 100.0*st.stale/st.pops : 0.0, (double)st.improved/n_queries);
+    printf("[eval]  ");
+    for(int r=0;r<CGR_REJ_COUNT;r++)
+        printf(" %s %.1f%%", cgr_reject_name((CgrReject)r), evals ? 100.0*st.reject[r]/evals : 0.0);
+    printf("\n\n");
+
+    cgr_workspace_free(ws);
+    free(Q);
+    free_neighbor_index(NI);
+    free(C);
+}
+
+/* All-pairs earliest-arrival matrices: per-node search with row reuse vs
+   one cgr_best_route per (departure, src, dst), spot-checked cell by cell */
+static void bench_allpairs(const BenchPlanCfg *B, int steps, int samples){
+    Contact *C = NULL;
+    int N = bench_plan(B, &C);
+    NeighborIndex *NI = build_neighbor_index(C, N);
+    CgrWorkspace *ws = cgr_workspace_new(N);
+    EaConfig cfg = { .t_begin = 0.0, .step_s = 60.0, .steps = steps, .bundle_bytes = 1e6, .threads = 1 };
+    EaMatrix m;
+    if(ea_compute(C, N, &cfg, &m) != 0){ fprintf(stderr, "ea_compute failed\n"); return; }
+    int n = m.n_nodes;
+    double cells = (double)steps * n * n;
+
+    // Sampled cells against the contact-level search
+    srand(B->seed + 11);
+    int agree = 0;
+    double t0 = now_s();
+    for(int i=0;i<samples;i++){
+        int k = rand() % steps, s = rand() % n, d = rand() % n;
+        CgrParams P = { .src_node = m.node_ids[s], .dst_node = m.node_ids[d],
+                        .t0 = cfg.t_begin + k * cfg.step_s, .bundle_bytes = cfg.bundle_bytes };
+        Route r = cgr_best_route_ws(C, N, &P, NI, NULL, ws);
+        float v = ea_at(&m, k, s, d);
+        if(s == d) agree += (v == 0.0f);
+        else if(!r.found) agree += isnan(v);
+        else agree += !isnan(v) && fabs((r.eta - P.t0) - v) <= 1e-3 * fmax(1.0, v);
+        free_route(&r);
+    }
+    double t_pair = (now_s() - t0) / samples;
+
+    const char *path = "/tmp/cgr_bench_allpairs.cgea";
+    EaMatrix back;
+    int round = ea_matrix_write(path, &m) == 0 && ea_matrix_read(path, &back) == 0;
+    if(round){
+        round = back.n_nodes == n && back.steps == steps &&
+                !memcmp(back.latency, m.latency, sizeof(float) * (size_t)cells);
+        ea_matrix_free(&back);
+    }
+    unlink(path);
+
+    printf("[allpairs] %d contacts, %d nodes x %d departures (60 s), %.0f cells\n", N, n, steps, cells);
+    printf("[allpairs]   matrix     : %8.3f s (%.0f cells/s); %llu searches, %llu rows reused (%.1f%%)\n",
+           m.elapsed_s, cells / m.elapsed_s, (unsigned long long)m.searches, (unsigned long long)m.reused,
+           100.0 * m.reused / (double)(m.searches + m.reused));
+    printf("[allpairs]   per pair   : %8.1f us/cell -> %.1f s estimated (%.0fx)\n",
+           t_pair * 1e6, t_pair * cells, t_pair * cells / m.elapsed_s);
+    check(agree == samples);
+    printf("[allpairs]   spot check : %d/%d cells agree with cgr_best_route; .cgea round trip %s\n\n",
+           agree, samples, check(round) ? "ok" : "FAILED");
+
+    ea_matrix_free(&m);
+    cgr_workspace_free(ws);
+    free_neighbor_index(NI);
+    free(C);
+}
+
+/* Bit-parallel reachability within a window for all sources at once, checked
+   against the all-pairs earliest-arrival matrix (latency <= window) */
+static void bench_reach(const BenchPlanCfg *B, int steps){
+    Contact *C = NULL;
+    int N = bench_plan(B, &C);
+    EaConfig ec = { .t_begin = 0.0, .step_s = 300.0, .steps = steps, .bundle_bytes = 1e6, .threads = 1 };
+    EaMatrix m;
+    if(ea_compute(C, N, &ec, &m) != 0){ fprintf(stderr, "ea_compute failed\n"); free(C); return; }
+    int n = m.n_nodes;
+    printf("[reach] %d contacts, %d nodes, %d departures (300 s apart), %d-bit source sets\n",
+           N, n, steps, EA_REACH_BITS);
+
+    const double windows[] = { 60.0, 300.0, 1800.0 };
+    for(int wi=0;wi<3;wi++){
+        EaReachConfig rc = { .t_begin = ec.t_begin, .step_s = ec.step_s, .steps = steps,
+                             .window = windows[wi], .bundle_bytes = ec.bundle_bytes, .threads = 1 };
+        EaReach r;
+        if(ea_reach_compute(C, N, &rc, &r) != 0){ fprintf(stderr, "ea_reach_compute failed\n"); break; }
+        long cells = 0, agree = 0, reach = 0;
+        for(int k=0;k<steps;k++)
+            for(int s=0;s<n;s++)
+                for(int d=0;d<n;d++){
+                    float v = ea_at(&m, k, s, d);
+                    int a = !isnan(v) && v <= windows[wi], b = ea_reach_test(&r, k, s, d);
+                    cells++;
+                    agree += a == b;
+                    reach += b;
+                }
+        check(agree == cells);
+        printf("[reach]   within %4.0f s : %6.3f ms/departure vs matrix %6.3f ms (%.1fx); %5.1f%% reachable, %.0f events/departure, %ld/%ld agree\n",
+               windows[wi], r.elapsed_s*1e3/steps, m.elapsed_s*1e3/steps, m.elapsed_s/r.elapsed_s,
+               100.0*reach/cells, (double)r.events/steps, agree, cells);
+        ea_reach_free(&r);
+    }
+    printf("\n");
+
+    ea_matrix_free(&m);
+    free(C);
+}
+
+/* Route validity intervals (Route.valid_until / bottleneck_bytes) against
+   re-evaluating the route with cgr_route_eta: same ETA at t0, still
+   feasible when leaving at valid_until, no longer 1 ms later, and the
+   bottleneck is the lowest hop residual. Also the cost of that
+   re-evaluation against routing again. */
+static void bench_validity(const BenchPlanCfg *B, int n_queries){
+    Contact *C = NULL;
+    int N = bench_plan(B, &C);
+    NeighborIndex *NI = build_neighbor_index(C, N);
+    BenchBundle *Q = bench_bundles(B, n_queries, 41);
+    Route *R = (Route*)calloc(n_queries, sizeof(Route));
+
+    double t0 = now_s();
+    for(int i=0;i<n_queries;i++) R[i] = cgr_best_route(C, N, &Q[i].P, NI);
+    double t_route = now_s() - t0;
+
+    int found = 0, same_eta = 0, at_end = 0, after_end = 0, bottleneck = 0, bounded = 0;
+    double t_eval = 0.0;
+    for(int i=0;i<n_queries;i++){
+        if(!R[i].found) continue;
+        found++;
+        CgrParams P = Q[i].P;
+        double low;
+        t0 = now_s();
+        double eta = cgr_route_eta(C, N, &R[i], &P, &low);
+        t_eval += now_s() - t0;
+        same_eta += eta == R[i].eta;
+        bottleneck += low == R[i].bottleneck_bytes;
+        if(R[i].valid_until == DBL_MAX) continue;
+        bounded++;
+        P.t0 = R[i].valid_until;
+        at_end += R[i].valid_until >= Q[i].P.t0 && cgr_route_eta(C, N, &R[i], &P, NULL) != DBL_MAX;
+        P.t0 = R[i].valid_until + 1e-3;
+        after_end += cgr_route_eta(C, N, &R[i], &P, NULL) == DBL_MAX;
+    }
+
+    int ok = same_eta == found && bottleneck == found && at_end == bounded && after_end == bounded;
+    printf("[validity] %d contacts, %d queries (%d found, %d with a finite interval)\n", N, n_queries, found, bounded);
+    printf("[validity]   eta at t0 %d/%d, bottleneck %d/%d, feasible at valid_until %d/%d, infeasible 1 ms later %d/%d  %s\n",
+           same_eta, found, bottleneck, found, at_end, bounded, after_end, bounded, check(ok) ? "ok" : "MISMATCH");
+    if(found)
+        printf("[validity]   re-evaluate %.2f us/route vs re-route %.1f us/q (%.0fx)\n\n",
+               t_eval*1e6/found, t_route*1e6/n_queries, t_eval > 0.0 ? (t_route/n_queries) / (t_eval/found) : 0.0);
+
+    for(int i=0;i<n_queries;i++) free_route(&R[i]);
+    free(R);
+    free(Q);
+    free_neighbor_index(NI);
+    free(C);
+}
+
+/* Latest departure (cgr_latest_departure) against forward routing: with a
+   deadline between the earliest arrival and a few hours later, the route
+   must reach dst by the deadline leaving at the LDT (its own eta and
+   cgr_route_eta), and cgr_best_route leaving 1 us later must not. */
+static void bench_ldt(const BenchPlanCfg *B, int n_queries){
+    Contact *C = NULL;
+    int N = bench_plan(B, &C);
+    NeighborIndex *NI = build_neighbor_index(C, N);
+    BenchBundle *Q = bench_bundles(B, n_queries, 53);
+
+    int asked = 0, found = 0, feasible = 0, latest = 0;
+    double t_fwd = 0.0, t_ldt = 0.0;
+    for(int i=0;i<n_queries;i++){
+        CgrParams P = Q[i].P;
+        double t0 = now_s();
+        Route F = cgr_best_route(C, N, &P, NI);
+        t_fwd += now_s() - t0;
+        if(!F.found){ free_route(&F); continue; }
+        asked++;
+        double deadline = F.eta + frand(0.0, 4*3600.0);
+        free_route(&F);
+
+        double ldt;
+        t0 = now_s();
+        Route R = cgr_latest_departure(C, N, &P, NI, deadline, &ldt);
+        t_ldt += now_s() - t0;
+        if(!R.found){ free_route(&R); continue; }
+        found++;
+
+        CgrParams Pl = P;
+        Pl.t0 = ldt;
+        double eta = cgr_route_eta(C, N, &R, &Pl, NULL);
+        feasible += R.eta <= deadline && eta <= deadline;
+        Pl.t0 = ldt + 1e-6;
+        Route L = cgr_best_route(C, N, &Pl, NI);
+        latest += !L.found || L.eta > deadline;
+        free_route(&L);
+        free_route(&R);
+    }
+
+    int ok = found == asked && feasible == found && latest == found;
+    printf("[ldt]      %d contacts, %d queries with a route (%d LDT found)\n", N, asked, found);
+    printf("[ldt]      arrives by the deadline from the LDT %d/%d, no route 1 us later %d/%d  %s\n",
+           feasible, found, latest, found, check(ok) ? "ok" : "MISMATCH");
+    if(asked)
+        printf("[ldt]      backward %.1f us/q vs forward %.1f us/q\n\n", t_ldt*1e6/asked, t_fwd*1e6/n_queries);
+
+    free(Q);
+    free_neighbor_index(NI);
+    free(C);
+}
+
+/* ---------------------------- SGP4 ---------------------------- */
+// Vallado, "Revisiting Spacetrack Report #3" (AIAA 2006-6753), SGP4-VER.TLE:
+// TEME r (km) and v (km/s) printed to 1e-8 km and 1e-9 km/s
+
+typedef struct { const char *l1, *l2; double tsince, r[3], v[3]; } Sgp4Ref;
+
+static const Sgp4Ref SGP4_REF[] = {
+    { "1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753",
+      "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667", 0.0,
+      { 7022.46529266, -1400.08296755, 0.03995155 }, { 1.893841015, 6.405893759, 4.534807250 } },
+    { "1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753",
+      "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667", 360.0,
+      { -7154.03120202, -3783.17682504, -3536.19412294 }, { 4.741887409, -4.151817765, -2.093935425 } },
+    { "1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753",
+      "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667", 720.0,
+      { -7134.59340119, 6531.68641334, 3260.27186483 }, { -4.113793027, -2.911922039, -2.557327851 } },
+    { "1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753",
+      "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667", 1080.0,
+      { 5568.53901181, 4492.06992591, 3863.87641983 }, { -4.209106476, 5.159719888, 2.744852980 } },
+    { "1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753",
+      "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667", 1440.0,
+      { -938.55923943, -6268.18748831, -4294.02924751 }, { 7.536105209, -0.427127707, 0.989878080 } },
+    { "1 06251U 62025E   06176.82412014  .00008885  00000-0  12808-3 0  3985",
+      "2 06251  58.0579  54.0425 0030035 139.1568 221.1854 15.56387291  6774", 0.0,
+      { 3988.31022699, 5498.96657235, 0.90055879 }, { -3.290032738, 2.357652820, 6.496623475 } },
+    { "1 28057U 03049A   06177.78615833  .00000060  00000-0  35940-4 0  1836",
+      "2 28057  98.4283 247.6961 0000884  88.1964 271.9322 14.35478080140550", 0.0,
+      { -2715.28237486, -6619.26436889, -0.01341443 }, { -1.008587273, 0.422782003, 7.385272942 } },
+};
+
+// n satellites from the 28057 reference TLE spread in plane and phase (LEO, ~800 km)
+static Sgp4Sat* synth_catalog(unsigned int seed, int n){
+    const Sgp4Ref *R = &SGP4_REF[sizeof(SGP4_REF)/sizeof(SGP4_REF[0]) - 1];
+    Sgp4Sat base, *S = (Sgp4Sat*)malloc(sizeof(Sgp4Sat)*(n > 0 ? n : 1));
+    if(!S || sgp4_parse_tle(NULL, R->l1, R->l2, &base) != SGP4_OK){ free(S); return NULL; }
+    srand(seed);
+    for(int i=0;i<n;i++){
+        S[i] = base;
+        S[i].mo = frand(0.0, 6.283185307179586);
+        S[i].nodeo = frand(0.0, 6.283185307179586);
+        S[i].inclo = frand(0.5, 1.75);
+        sgp4_init(&S[i]);
+    }
+    return S;
+}
+
+static void bench_sgp4(const BenchPlanCfg *B, int n_sats, int steps){
+    // 1) Reference vectors
+    int n_ref = (int)(sizeof(SGP4_REF)/sizeof(SGP4_REF[0])), ref_ok = 0;
+    double ref_dr = 0.0, ref_dv = 0.0;
+    for(int i=0;i<n_ref;i++){
+        Sgp4Sat s;
+        double r[3], v[3];
+        if(sgp4_parse_tle(NULL, SGP4_REF[i].l1, SGP4_REF[i].l2, &s) != SGP4_OK ||
+           sgp4_propagate(&s, SGP4_REF[i].tsince, r, v) != SGP4_OK) continue;
+        double dr = 0.0, dv = 0.0;
+        for(int k=0;k<3;k++){
+            dr = fmax(dr, fabs(r[k] - SGP4_REF[i].r[k]));
+            dv = fmax(dv, fabs(v[k] - SGP4_REF[i].v[k]));
+        }
+        ref_dr = fmax(ref_dr, dr);
+        ref_dv = fmax(ref_dv, dv);
+        ref_ok += dr < 1e-5 && dv < 1e-8;
+    }
+    printf("[sgp4] Vallado vectors %d/%d within 1e-5 km / 1e-8 km/s (max |dr| %.1e km, |dv| %.1e km/s)  %s\n",
+           ref_ok, n_ref, ref_dr, ref_dv, check(ref_ok == n_ref) ? "ok" : "MISMATCH");
+
+    // 2) Batch vs scalar on a synthetic LEO catalog
+    Sgp4Sat *S = synth_catalog(B->seed + 13, n_sats);
+    double *pos = (double*)malloc(sizeof(double)*3*n_sats);
+    double *ref = (double*)malloc(sizeof(double)*3*n_sats);
+    unsigned char *ok = (unsigned char*)malloc(n_sats);
+    unsigned char *ref_valid = (unsigned char*)malloc(n_sats);
+    Sgp4Batch Bt;
+    if(!S || !pos || !ref || !ok || !ref_valid){
+        fprintf(stderr, "[sgp4] setup failed\n");
+        check(0);
+        free(S); free(pos); free(ref); free(ok); free(ref_valid);
+        return;
+    }
+    if(sgp4_batch_init(&Bt, S, n_sats) != 0){
+        fprintf(stderr, "[sgp4] batch: out of memory\n");
+        check(0);
+        free(S); free(pos); free(ref); free(ok); free(ref_valid);
+        return;
+    }
+
+    double t_scalar = 0.0, t_batch = 0.0, max_dr = 0.0;
+    int bad = 0;
+    for(int k=0;k<steps;k++){
+        double t = S[0].epoch_unix + k * 60.0, v[3];
+        double t1 = now_s();
+        for(int i=0;i<n_sats;i++)
+            ref_valid[i] = sgp4_at(&S[i], t, &ref[3*i], v) == SGP4_OK;
+        double t2 = now_s();
+        sgp4_batch_at(&Bt, t, NULL, pos, NULL, ok);
+        t_batch += now_s() - t2;
+        t_scalar += t2 - t1;
+        for(int i=0;i<n_sats;i++){
+            if(ok[i] != ref_valid[i]){ bad++; continue; }
+            if(!ok[i]) continue;
+            double dx = pos[3*i] - ref[3*i], dy = pos[3*i+1] - ref[3*i+1], dz = pos[3*i+2] - ref[3*i+2];
+            max_dr = fmax(max_dr, sqrt(dx*dx + dy*dy + dz*dz));
+        }
+    }
+    long evals = (long)n_sats * steps;
+    printf("[sgp4] %d sats x %d steps: scalar %.1f ns/sat, batch %.1f ns/sat (%.2fx, simd level %d)\n",
+           n_sats, steps, t_scalar*1e9/evals, t_batch*1e9/evals,
+           t_batch > 0.0 ? t_scalar/t_batch : 0.0, cgr_simd_level());
+    printf("[sgp4]   batch vs scalar: max |dr| %.2e km, validity mismatches %d  %s\n\n",
+           max_dr, bad, check(bad == 0 && max_dr < 1e-6) ? "ok" : "MISMATCH");
+
+    sgp4_batch_free(&Bt);
+    free(S); free(pos); free(ref); free(ok); free(ref_valid);
+}
+
+/* ---------------------------- Visibility ---------------------------- */
+// Brute-force reference for vis_windows: the same line-of-sight tests
+// sampled every dt, no root finding. Windows are runs of visible samples.
+
+static double vis_ref_g(const double *ra, const double *rb, const double *up, double mask,
+                        const VisConfig *cfg, double *range){
+    double d[3] = { rb[0]-ra[0], rb[1]-ra[1], rb[2]-ra[2] };
+    double dd = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+    *range = sqrt(dd);
+    if(up) return asin((d[0]*up[0] + d[1]*up[1] + d[2]*up[2]) / *range) - mask;
+    double s = fmin(1.0, fmax(0.0, -(ra[0]*d[0] + ra[1]*d[1] + ra[2]*d[2]) / dd));
+    double p[3] = { ra[0]+s*d[0], ra[1]+s*d[1], ra[2]+s*d[2] };
+    double g = sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]) - SGP4_RE_KM - cfg->grazing_km;
+    return cfg->isl_range_km > 0.0 ? fmin(g, cfg->isl_range_km - *range) : g;
+}
+
+static int vis_reference(const Sgp4Sat *S, int n, const VisStation *st, int nst, const VisConfig *cfg,
+                         double dt, VisWindow **out){
+    int nl = nst*n + (cfg->isl ? n*(n-1)/2 : 0), cnt = 0, cap = 1024;
+    VisWindow *W = (VisWindow*)malloc(sizeof(VisWindow)*cap);
+    VisWindow *open = (VisWindow*)malloc(sizeof(VisWindow)*nl);
+    double *r = (double*)malloc(sizeof(double)*3*n), *gs = (double*)malloc(sizeof(double)*6*(nst > 0 ? nst : 1));
+    if(!W || !open || !r || !gs){ free(W); free(open); free(r); free(gs); return -1; }
+    for(int l=0;l<nl;l++) open[l].t_start = NAN;
+    int steps = (int)llround((cfg->t_end - cfg->t_begin) / dt);
+    for(int k=0;k<=steps;k++){
+        double t = cfg->t_begin + k*dt, v[3], th = sgp4_gmst(t);
+        for(int i=0;i<n;i++) sgp4_at(&S[i], t, &r[3*i], v);
+        for(int s=0;s<nst;s++){
+            double lat = st[s].lat_deg * 3.14159265358979323846 / 180.0;
+            double lon = st[s].lon_deg * 3.14159265358979323846 / 180.0 + th;
+            double nr = 6378.137 / sqrt(1.0 - 6.69437999014e-3 * sin(lat)*sin(lat));
+            gs[6*s]   = (nr + st[s].alt_km) * cos(lat) * cos(lon);
+            gs[6*s+1] = (nr + st[s].alt_km) * cos(lat) * sin(lon);
+            gs[6*s+2] = (nr * (1.0 - 6.69437999014e-3) + st[s].alt_km) * sin(lat);
+            gs[6*s+3] = cos(lat)*cos(lon); gs[6*s+4] = cos(lat)*sin(lon); gs[6*s+5] = sin(lat);
+        }
+        for(int l=0,s=0,a=0,b=0;l<nl;l++){
+            if(l < nst*n){ s = l / n; a = l % n; b = -1; }
+            else if(l == nst*n){ s = -1; a = 0; b = 1; }
+            else if(++b == n){ a++; b = a+1; }
+            double range, g = s >= 0 ? vis_ref_g(&gs[6*s], &r[3*a], &gs[6*s+3], st[s].min_elev_deg * 3.14159265358979323846 / 180.0, cfg, &range)
+                                     : vis_ref_g(&r[3*a], &r[3*b], NULL, 0.0, cfg, &range);
+            VisWindow *o = &open[l];
+            if(g > 0.0){
+                if(isnan(o->t_start)) *o = (VisWindow){ .station = s, .a = a, .b = b, .t_start = t, .min_km = range, .max_km = range };
+                o->t_end = t;
+                o->min_km = fmin(o->min_km, range);
+                o->max_km = fmax(o->max_km, range);
+            }
+            if(!isnan(o->t_start) && (g <= 0.0 || k == steps)){
+                if(cnt == cap){
+                    VisWindow *nw = (VisWindow*)realloc(W, sizeof(VisWindow)*(cap *= 2));
+                    if(!nw){ free(W); free(open); free(r); free(gs); return -1; }
+                    W = nw;
+                }
+                W[cnt++] = *o;
+                o->t_start = NAN;
+            }
+        }
+    }
+    free(open); free(r); free(gs);
+    *out = W;
+    return cnt;
+}
+
+static void bench_vis(const BenchPlanCfg *B, int n_sats, double hours, double dt){
+    static const VisStation st[] = {
+        { "MAD", 40.43, -4.25, 0.8, 10.0 }, { "GDS", 35.43, -116.89, 1.0, 10.0 },
+        { "CAN", -35.40, 148.98, 0.7, 10.0 }, { "SVB", 78.23, 15.41, 0.5, 5.0 },
+    };
+    int nst = (int)(sizeof(st)/sizeof(st[0]));
+    Sgp4Sat *S = synth_catalog(B->seed + 17, n_sats);
+    Sgp4Batch Bt;
+    if(!S || sgp4_batch_init(&Bt, S, n_sats) != 0){
+        fprintf(stderr, "[vis] setup failed\n");
+        check(0);
+        free(S);
+        return;
+    }
+    VisConfig cfg = { .t_begin = S[0].epoch_unix, .t_end = S[0].epoch_unix + hours*3600.0, .step_s = 60.0,
+                      .tol_s = 1e-3, .isl = 1, .isl_range_km = 4000.0, .grazing_km = 80.0, .threads = 1 };
+    VisResult R;
+    VisWindow *ref = NULL;
+    double t1 = now_s();
+    int rc = vis_windows(&Bt, st, nst, &cfg, &R);
+    double t_vis = now_s() - t1;
+    t1 = now_s();
+    int nref = rc == 0 ? vis_reference(S, n_sats, st, nst, &cfg, dt, &ref) : -1;
+    double t_ref = now_s() - t1;
+    if(rc != 0 || nref < 0){
+        fprintf(stderr, "[vis] out of memory\n");
+        check(0);
+        if(rc == 0) vis_result_free(&R);
+        sgp4_batch_free(&Bt);
+        free(S);
+        return;
+    }
+
+    /* Reference run [first, last] visible sample: the window starts in
+       (first - dt, first] and ends in [last, last + dt). Runs shorter than
+       2 samples and windows shorter than 2·dt may be missed by either side. */
+    double tol = cfg.tol_s + 1e-6, under_max = 0.0, over_min = 0.0, slack_max = 0.0;
+    int missing = 0, extra = 0, range_bad = 0;
+    for(int i=0;i<nref;i++){
+        const VisWindow *w = &ref[i];
+        int found = 0;
+        for(int k=0;k<R.count && !found;k++){
+            const VisWindow *v = &R.items[k];
+            if(v->station != w->station || v->a != w->a || v->b != w->b) continue;
+            if(v->t_start < w->t_start - dt - tol || v->t_start > w->t_start + tol) continue;
+            if(v->t_end < w->t_end - tol || v->t_end > w->t_end + dt + tol) continue;
+            found = 1;
+            under_max = fmax(under_max, w->max_km - v->max_km);
+            over_min = fmax(over_min, v->min_km - w->min_km);
+            slack_max = fmax(slack_max, v->max_km - w->max_km);
+            range_bad += w->max_km > v->max_km + 1e-6 || w->min_km < v->min_km - 1e-6 ||
+                         fabs(v->owlt_s * 299792.458 - v->max_km) > 1e-6;
+        }
+        missing += !found && w->t_end - w->t_start >= dt;
+    }
+    for(int k=0;k<R.count;k++){
+        const VisWindow *v = &R.items[k];
+        if(v->t_end - v->t_start < 2*dt) continue;
+        int found = 0;
+        for(int i=0;i<nref && !found;i++)
+            found = ref[i].station == v->station && ref[i].a == v->a && ref[i].b == v->b &&
+                    ref[i].t_start < v->t_end && ref[i].t_end > v->t_start;
+        extra += !found;
+    }
+
+    printf("[vis] %d sats, %d stations, ISL <= %.0f km, %.0f h: %d windows (%llu peaks, %llu roots) in %.1f ms; brute force %.0f s step: %d windows in %.1f ms\n",
+           n_sats, nst, cfg.isl_range_km, hours, R.count, (unsigned long long)R.peaks, (unsigned long long)R.roots,
+           t_vis*1e3, dt, nref, t_ref*1e3);
+    printf("[vis]   missing %d, extra %d, range bounds violated %d (max under %.2e km, min over %.2e km; max slack %.3f km)  %s\n\n",
+           missing, extra, range_bad, under_max, over_min, slack_max,
+           check(!missing && !extra && !range_bad) ? "ok" : "MISMATCH");
+
+    free(ref);
+    vis_result_free(&R);
+    sgp4_batch_free(&Bt);
+    free(S);
+}
+
+/* ------------------------------------------------------------------- */
+
+static void usage(const char *p){
+    fprintf(stderr,
+    "Usage:\n"
+    "  %s [--only impact|kroutes|load|archive|stream|output|overlay|feedback|prob|mc|eta|eval|allpairs|reach|validity|ldt|sgp4|vis] [--planes N] [--per-plane N] [--gs N]\n"
+    "     [--horizon s] [--bundles N] [--seed S]\n", p);
+}
+
+int main(int argc, char **argv){
+    BenchPlanCfg B = { .planes=8, .per_plane=10, .n_gs=6, .horizon=21600.0, .seed=42 };
+    const char *only = NULL;
+    int n_bundles = 1000;
+
+    for(int i=1;i<argc;i++){
+        if(!strcmp(argv[i],"--only") && i+1<argc) only = argv[++i];
+        else if(!strcmp(argv[i],"--planes") && i+1<argc) B.planes = (int)strtol(argv[++i],NULL,10);
+        else if(!strcmp(argv[i],"--per-plane") && i+1<argc) B.per_plane = (int)strtol(argv[++i],NULL,10);
+        else if(!strcmp(argv[i],"--gs") && i+1<argc) B.n_gs = (int)strtol(argv[++i],NULL,10);
+        else if(!strcmp(argv[i],"--horizon") && i+1<argc) B.horizon = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--bundles") && i+1<argc) n_bundles = (int)strtol(argv[++i],NULL,10);
+        else if(!strcmp(argv[i],"--seed") && i+1<argc) B.seed = (unsigned int)strtoul(argv[++i],NULL,10);
+        else { usage(argv[0]); return 2; }
+    }
+    if(B.planes < 1 || B.per_plane < 2 || B.planes*B.per_plane > 99 || B.n_gs < 2 || B.n_gs > 9){
+        fprintf(stderr, "Error: need planes*per_plane <= 99, per_plane >= 2, 2 <= gs <= 9\n");
+        return 2;
+    }
+
+    printf("CGR bench — %d planes x %d sats, %d GS, horizon %.0f s, seed %u\n\n",
+           B.planes, B.per_plane, B.n_gs, B.horizon, B.seed);
+
+    if(!only || !strcmp(only, "impact")) bench_impact(&B, n_bundles);
+    if(!only || !strcmp(only, "kroutes")) bench_kroutes(&B, 50, 20);
+    if(!only || !strcmp(only, "load")) bench_load(&B, 7.0);
+    if(!only || !strcmp(only, "archive")) bench_archive(&B, 30.0);
+    if(!only || !strcmp(only, "stream")) bench_stream(&B, 30.0, 6*3600.0, 600.0);
+    if(!only || !strcmp(only, "output")) bench_output(&B, 500, 1000000);
+    if(!only || !strcmp(only, "overlay")) bench_overlay(&B, 200);
+    if(!only || !strcmp(only, "feedback")) bench_feedback(&B, 4, 500000);
+    if(!only || !strcmp(only, "prob")) bench_prob(&B, 500, 3);
+    if(!only || !strcmp(only, "mc")) bench_mc(&B, 50, 400);
+    if(!only || !strcmp(only, "eta")) bench_eta(&B, 500, 20000);
+    if(!only || !strcmp(only, "eval")) bench_eval(&B, 500);
+    if(!only || !strcmp(only, "allpairs")) bench_allpairs(&B, 240, 2000);
+    if(!only || !strcmp(only, "reach")) bench_reach(&B, 48);
+    if(!only || !strcmp(only, "validity")) bench_validity(&B, 1000);
+    if(!only || !strcmp(only, "ldt")) bench_ldt(&B, 1000);
+    if(!only || !strcmp(only, "sgp4")) bench_sgp4(&B, 2000, 200);
+    if(!only || !strcmp(only, "vis")) bench_vis(&B, 40, 6.0, 1.0);
+    if(g_failed) fprintf(stderr, "%d check(s) FAILED\n", g_failed);
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "sgp4.h"
+#include "conjunction.h"
+
+/* ===========================
+ * CGR conjunction screening
+ * ===========================
+ * Screens a whole TLE catalog for close approaches (SGP4, uniform grid per
+ * time step, TCA refinement; see conjunction.h). With --isl-range the same
+ * engine emits the windows in which satellite pairs are within range as a
+ * contact plan CSV for the router (node id = position in the TLE file).
+ */
+
+#define C_KM_S 299792.458
+
+static void usage(const char *p){
+    fprintf(stderr,
+    "Usage:\n"
+    "  %s --tle <file> [--threshold km] [--days D | --hours H] [--start unix_s]\n"
+    "     [--step s] [--threads N] [--no-prefilter] [--out conj.csv]\n"
+    "  %s --tle <file> --isl-range km --plan <contacts.csv> [--rate bps] [--setup s]\n"
+    "     [--days D | --hours H] [--start unix_s] [--step s] [--threads N]\n\n"
+    "Defaults: 5 km threshold, 7 days from the newest TLE epoch, 20 s steps.\n"
+    "Deep-space objects (period >= 225 min) are not propagated and are reported.\n"
+    "Pairs whose perigee/apogee bands or orbital planes keep them apart are\n"
+    "discarded before propagation (--no-prefilter screens every object).\n"
+    "Plan times are seconds from --start; the node/catalog mapping is written\n"
+    "as comments at the top of the plan.\n",
+    p, p);
+}
+
+static void utc_string(double t, char *buf, size_t n){
+    time_t s = (time_t)floor(t);
+    struct tm tm;
+    gmtime_r(&s, &tm);
+    size_t k = strftime(buf, n, "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(buf + k, n - k, ".%03dZ", (int)((t - floor(t)) * 1000.0));
+}
+
+// Names go into CSV fields: no commas
+static const char* csv_name(const Sgp4Sat *s, char *buf){
+    snprintf(buf, 25, "%s", s->name);
+    for(char *p=buf;*p;p++) if(*p == ',') *p = ' ';
+    return buf;
+}
+
+static int write_conjunctions(FILE *f, const Sgp4Sat *S, const ConjResult *R, double thr){
+    char ta[40], na[25], nb[25];
+    fprintf(f, "# %d conjunctions under %.3f km\n", R->count, thr);
+    fprintf(f, "catnum_a,catnum_b,name_a,name_b,tca_unix,tca_utc,miss_km,vrel_kms\n");
+    for(int k=0;k<R->count;k++){
+        const Conjunction *c = &R->items[k];
+        utc_string(c->tca, ta, sizeof(ta));
+        fprintf(f, "%d,%d,%s,%s,%.3f,%s,%.4f,%.4f\n", S[c->a].catnum, S[c->b].catnum,
+                csv_name(&S[c->a], na), csv_name(&S[c->b], nb), c->tca, ta, c->miss_km, c->vrel_kms);
+    }
+    return ferror(f) ? -1 : 0;
+}
+
+// Both directions of every window; residual = what the link can carry in it
+static int write_plan(FILE *f, const Sgp4Sat *S, int n, const ProxResult *R, double t0,
+                      double rate, double setup){
+    char ts[40], nm[25];
+    utc_string(t0, ts, sizeof(ts));
+    fprintf(f, "# ISL contact plan from TLE proximity, t = 0 at %s (unix %.3f)\n", ts, t0);
+    fprintf(f, "# node,catnum,name\n");
+    for(int i=0;i<n;i++) fprintf(f, "#   %d,%d,%s\n", i, S[i].catnum, csv_name(&S[i], nm));
+    fprintf(f, "# id,from,to,t_start,t_end,owlt_s,rate_bps,setup_s,residual_bytes\n");
+    int id = 0;
+    for(int k=0;k<R->count;k++){
+        const ProxWindow *w = &R->items[k];
+        double dur = w->t_end - w->t_start;
+        if(dur <= setup) continue;
+        double owlt = 0.5 * (w->min_km + w->max_km) / C_KM_S;
+        double resid = (dur - setup) * rate / 8.0;
+        for(int dir=0;dir<2;dir++){
+            fprintf(f, "%d,%d,%d,%.3f,%.3f,%.6f,%.1f,%.3f,%.0f\n", id++,
+                    dir ? w->b : w->a, dir ? w->a : w->b,
+                    w->t_start - t0, w->t_end - t0, owlt, rate, setup, resid);
+        }
+    }
+    return ferror(f) ? -1 : 0;
+}
+
+int main(int argc, char **argv){
+    const char *tle = NULL, *out_path = NULL, *plan_path = NULL;
+    ConjConfig cfg = { .t_begin = NAN, .step_s = 20.0, .threshold_km = 5.0, .vrel_max_kms = 0.0, .threads = 1 };
+    double span = 7.0 * 86400.0, isl = 0.0, rate = 1e7, setup = 0.1;
+
+    for(int i=1;i<argc;i++){
+        if(!strcmp(argv[i],"--tle") && i+1<argc) tle = argv[++i];
+        else if(!strcmp(argv[i],"--out") && i+1<argc) out_path = argv[++i];
+        else if(!strcmp(argv[i],"--plan") && i+1<argc) plan_path = argv[++i];
+        else if(!strcmp(argv[i],"--threshold") && i+1<argc) cfg.threshold_km = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--days") && i+1<argc) span = strtod(argv[++i],NULL) * 86400.0;
+        else if(!strcmp(argv[i],"--hours") && i+1<argc) span = strtod(argv[++i],NULL) * 3600.0;
+        else if(!strcmp(argv[i],"--start") && i+1<argc) cfg.t_begin = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--step") && i+1<argc) cfg.step_s = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--threads") && i+1<argc) cfg.threads = (int)strtol(argv[++i],NULL,10);
+        else if(!strcmp(argv[i],"--isl-range") && i+1<argc) isl = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--rate") && i+1<argc) rate = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--setup") && i+1<argc) setup = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--no-prefilter")) cfg.no_prefilter = 1;
+        else { usage(argv[0]); return 2; }
+    }
+    if(!tle || (isl > 0.0 && !plan_path)){ usage(argv[0]); return 2; }
+    if(!(cfg.step_s > 0.0) || !(cfg.threshold_km > 0.0) || !(span > 0.0) || cfg.threads < 1 || !(rate > 0.0)){
+        fprintf(stderr, "Error: --step, --threshold, --days/--hours, --rate and --threads must be positive\n");
+        return 2;
+    }
+
+    Sgp4Sat *S = NULL;
+    int bad = 0;
+    int n = sgp4_load_catalog(tle, &S, &bad);
+    if(n <= 0){ fprintf(stderr, "Error: no TLEs in %s\n", tle); free(S); return 1; }
+    if(isnan(cfg.t_begin)){
+        double newest = -1e300;
+        for(int i=0;i<n;i++) if(S[i].epoch_unix > newest) newest = S[i].epoch_unix;
+        cfg.t_begin = floor(newest / 60.0) * 60.0;
+    }
+    cfg.t_end = cfg.t_begin + span;
+
+    int deep = 0, other = 0;
+    for(int i=0;i<n;i++){
+        if(S[i].error == SGP4_ERR_DEEP_SPACE) deep++;
+        else if(S[i].error) other++;
+    }
+    char t0s[40];
+    utc_string(cfg.t_begin, t0s, sizeof(t0s));
+    fprintf(stderr, "Catalog      : %d objects from %s (%d deep-space skipped, %d invalid elements, %d unreadable TLEs)\n",
+            n, tle, deep, other, bad);
+    fprintf(stderr, "Window       : %s + %.1f h, step %.1f s, %d thread%s\n",
+            t0s, span / 3600.0, cfg.step_s, cfg.threads, cfg.threads == 1 ? "" : "s");
+
+    int rc = 0;
+    if(isl > 0.0){
+        cfg.threshold_km = isl;
+        ProxResult R;
+        if(conj_proximity(S, n, &cfg, &R) != 0){ fprintf(stderr, "Error: proximity screening failed\n"); free(S); return 1; }
+        FILE *f = fopen(plan_path, "w");
+        if(!f || write_plan(f, S, n, &R, cfg.t_begin, rate, setup) != 0){
+            fprintf(stderr, "Error: cannot write %s\n", plan_path);
+            rc = 1;
+        }
+        if(f) fclose(f);
+        fprintf(stderr, "ISL windows  : %d pair windows within %.0f km (%d steps) in %.3f s -> %s\n",
+                R.count, isl, R.steps, R.elapsed_s, plan_path);
+        prox_result_free(&R);
+        free(S);
+        return rc;
+    }
+
+    ConjResult R;
+    if(conj_screen(S, n, &cfg, &R) != 0){ fprintf(stderr, "Error: screening failed\n"); free(S); return 1; }
+    if(!cfg.no_prefilter && R.pairs_total > 0){
+        double tot = (double)R.pairs_total;
+        fprintf(stderr, "Prefilter    : %llu pairs -> %llu with overlapping perigee/apogee bands (%.2f%%)"
+                " -> %llu after plane geometry (%.3f%%, first %.1f h epoch of %d) in %.3f s\n",
+                (unsigned long long)R.pairs_total, (unsigned long long)R.pairs_band, 100.0 * R.pairs_band / tot,
+                (unsigned long long)R.pairs_plane, 100.0 * R.pairs_plane / tot, R.epoch_s / 3600.0,
+                R.epochs, R.prefilter_s);
+        fprintf(stderr, "Propagation  : %.1f%% of object-steps (objects with no possible partner skipped)\n",
+                100.0 * R.active_frac);
+    }
+    fprintf(stderr, "Screening    : %d steps in %.3f s (%.2f ms/step), screen volume %.1f km\n",
+            R.steps, R.elapsed_s, R.elapsed_s * 1e3 / R.steps, R.screen_km);
+    fprintf(stderr, "Candidates   : %llu pair-steps in volume, %llu refined, %d conjunctions under %.3f km\n",
+            (unsigned long long)R.candidates, (unsigned long long)R.refined, R.count, cfg.threshold_km);
+
+    FILE *f = out_path ? fopen(out_path, "w") : stdout;
+    if(!f || write_conjunctions(f, S, &R, cfg.threshold_km) != 0){
+        fprintf(stderr, "Error: cannot write %s\n", out_path ? out_path : "stdout");
+        rc = 1;
+    }
+    if(f && f != stdout) fclose(f);
+    conj_result_free(&R);
+    free(S);
+    return rc;
+}
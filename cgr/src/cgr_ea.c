@@ -0,0 +1,199 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include "cgr.h"
+#include "csv.h"
+#include "ea_matrix.h"
+#include "plan_archive.h"
+
+/* ===========================
+ * CGR all-pairs earliest arrival
+ * ===========================
+ * Offline analytics for capacity planning: earliest-arrival latency from
+ * every node to every node for departures t_begin, t_begin + step, ...
+ * over the whole plan, written as a .cgea matrix (see ea_matrix.h).
+ * --reach answers "which sources reach each node within W seconds" for all
+ * sources at once with the bit-parallel scan.
+ */
+
+static void usage(const char *p){
+    fprintf(stderr,
+    "Usage:\n"
+    "  %s --plan <csv|cgrp> [--out matrix.cgea] [--bytes B]\n"
+    "     [--t-begin s] [--step s] [--steps N | --span s] [--threads N]\n"
+    "  %s --read matrix.cgea [--src N --dst N]\n"
+    "  %s --plan <csv|cgrp> --reach W [--dst N] [--t-begin s] [--step s --steps N] [--bytes B] [--threads N]\n\n"
+    "Defaults: departures every 60 s for one day from the plan start, 1000-byte bundle.\n"
+    "--read prints the summary of a stored matrix, or one src->dst latency profile.\n"
+    "--reach prints, per destination, how many sources arrive within W seconds\n"
+    "(averaged over the departures; one departure unless --steps), or with --dst\n"
+    "the reaching sources for each departure.\n",
+    p, p, p);
+}
+
+static int load_plan(const char *path, Contact **out){
+    size_t n = strlen(path);
+    if(n > 5 && !strcmp(path + n - 5, ".cgrp")) return plan_archive_load(path, 0.0, -1.0, out, NULL);
+    return load_contacts_csv(path, out);
+}
+
+static void print_summary(const EaMatrix *m){
+    size_t pairs = 0, reach = 0;
+    double sum = 0.0, worst = 0.0;
+    int n = m->n_nodes;
+    for(int k=0;k<m->steps;k++)
+        for(int s=0;s<n;s++)
+            for(int d=0;d<n;d++){
+                if(s == d) continue;
+                float v = ea_at(m, k, s, d);
+                pairs++;
+                if(isnan(v)) continue;
+                reach++;
+                sum += v;
+                if(v > worst) worst = v;
+            }
+    printf("Matrix       : %d nodes x %d departures (t %.0f .. %.0f s, step %.0f s), bundle %.0f B\n",
+           n, m->steps, m->t_begin, m->t_begin + (m->steps - 1) * m->step_s, m->step_s, m->bundle_bytes);
+    printf("Reachability : %.1f%% of (departure, src, dst)", pairs ? 100.0 * reach / pairs : 0.0);
+    if(reach) printf("; latency mean %.1f s, max %.1f s", sum / reach, worst);
+    printf("\n");
+}
+
+static int run_reach(const Contact *C, int N, const EaConfig *cfg, double window, int dst){
+    EaReachConfig rc = { .t_begin = cfg->t_begin, .step_s = cfg->step_s, .steps = cfg->steps,
+                         .window = window, .bundle_bytes = cfg->bundle_bytes, .threads = cfg->threads };
+    EaReach r;
+    if(ea_reach_compute(C, N, &rc, &r) != 0){
+        fprintf(stderr, "Error: out of memory or plan without nodes\n");
+        return 1;
+    }
+    int n = r.n_nodes, d = -1;
+    if(dst >= 0 && (d = ea_reach_node_index(&r, dst)) < 0){
+        fprintf(stderr, "Error: node %d not in plan\n", dst);
+        ea_reach_free(&r);
+        return 1;
+    }
+    if(d >= 0){
+        for(int k=0;k<r.steps;k++){
+            printf("t0 %.3f: %d sources reach %d within %.0f s:", r.t_begin + k * r.step_s,
+                   ea_reach_count(&r, k, d), dst, window);
+            for(int s=0;s<n;s++) if(ea_reach_test(&r, k, s, d)) printf(" %d", r.node_ids[s]);
+            printf("\n");
+        }
+    } else {
+        printf("# node,sources_within_%.0fs (mean over %d departure(s), of %d)\n", window, r.steps, n);
+        for(int v=0;v<n;v++){
+            double sum = 0.0;
+            for(int k=0;k<r.steps;k++) sum += ea_reach_count(&r, k, v);
+            printf("%d,%.2f\n", r.node_ids[v], sum / r.steps);
+        }
+    }
+    fprintf(stderr, "Reach        : %d departure(s) in %.3f s (%.3f ms each), %llu propagation events\n",
+            r.steps, r.elapsed_s, r.elapsed_s * 1e3 / r.steps, (unsigned long long)r.events);
+    ea_reach_free(&r);
+    return 0;
+}
+
+static int print_profile(const EaMatrix *m, int src, int dst){
+    int s = ea_node_index(m, src), d = ea_node_index(m, dst);
+    if(s < 0 || d < 0){
+        fprintf(stderr, "Error: node %d not in matrix\n", s < 0 ? src : dst);
+        return 1;
+    }
+    printf("# t_depart,latency_s (empty = unreachable)  %d->%d\n", src, dst);
+    for(int k=0;k<m->steps;k++){
+        float v = ea_at(m, k, s, d);
+        if(isnan(v)) printf("%.3f,\n", m->t_begin + k * m->step_s);
+        else         printf("%.3f,%.3f\n", m->t_begin + k * m->step_s, v);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv){
+    const char *plan_path = NULL, *out_path = NULL, *read_path = NULL;
+    EaConfig cfg = { .t_begin = NAN, .step_s = 60.0, .steps = 0, .bundle_bytes = 1000.0, .threads = 1 };
+    double span = 86400.0, reach = -1.0;
+    int src = -1, dst = -1;
+
+    for(int i=1;i<argc;i++){
+        if(!strcmp(argv[i],"--plan") && i+1<argc) plan_path = argv[++i];
+        else if(!strcmp(argv[i],"--out") && i+1<argc) out_path = argv[++i];
+        else if(!strcmp(argv[i],"--read") && i+1<argc) read_path = argv[++i];
+        else if(!strcmp(argv[i],"--bytes") && i+1<argc) cfg.bundle_bytes = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--t-begin") && i+1<argc) cfg.t_begin = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--step") && i+1<argc) cfg.step_s = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--steps") && i+1<argc) cfg.steps = (int)strtol(argv[++i],NULL,10);
+        else if(!strcmp(argv[i],"--span") && i+1<argc) span = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--threads") && i+1<argc) cfg.threads = (int)strtol(argv[++i],NULL,10);
+        else if(!strcmp(argv[i],"--reach") && i+1<argc) reach = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--src") && i+1<argc) src = (int)strtol(argv[++i],NULL,10);
+        else if(!strcmp(argv[i],"--dst") && i+1<argc) dst = (int)strtol(argv[++i],NULL,10);
+        else { usage(argv[0]); return 2; }
+    }
+
+    if(read_path){
+        EaMatrix m;
+        if(ea_matrix_read(read_path, &m) != 0){ fprintf(stderr, "Error: cannot read %s\n", read_path); return 1; }
+        int rc = 0;
+        if(src >= 0 && dst >= 0) rc = print_profile(&m, src, dst);
+        else print_summary(&m);
+        ea_matrix_free(&m);
+        return rc;
+    }
+    if(!plan_path){ usage(argv[0]); return 2; }
+    if(!(cfg.step_s > 0.0) || !(cfg.bundle_bytes > 0.0) || cfg.threads < 1 || cfg.steps < 0 || !(span > 0.0)){
+        fprintf(stderr, "Error: --step, --span, --bytes and --threads must be positive\n");
+        return 2;
+    }
+
+    Contact *C = NULL;
+    int N = load_plan(plan_path, &C);
+    if(N <= 0){ fprintf(stderr, "Error: could not load plan %s\n", plan_path); return 1; }
+
+    if(isnan(cfg.t_begin)){
+        double t_min = DBL_MAX;
+        for(int i=0;i<N;i++) if(C[i].t_start < t_min) t_min = C[i].t_start;
+        cfg.t_begin = floor(t_min);
+    }
+    if(reach >= 0.0){
+        if(cfg.steps == 0) cfg.steps = 1;
+        int rc = run_reach(C, N, &cfg, reach, dst);
+        free(C);
+        return rc;
+    }
+    if(cfg.steps == 0) cfg.steps = (int)ceil(span / cfg.step_s);
+
+    EaMatrix m;
+    if(ea_compute(C, N, &cfg, &m) != 0){
+        fprintf(stderr, "Error: out of memory or plan without nodes\n");
+        free(C);
+        return 1;
+    }
+    free(C);
+
+    uint64_t total = m.searches + m.reused;
+    printf("CGR all-pairs earliest arrival — plan %s (%d contacts), %d thread%s\n",
+           plan_path, N, cfg.threads, cfg.threads == 1 ? "" : "s");
+    printf("Compute      : %.3f s; %llu node searches + %llu rows reused (%.1f%%), %.1f contacts/departure, %.0f cells/s\n",
+           m.elapsed_s, (unsigned long long)m.searches, (unsigned long long)m.reused,
+           total ? 100.0 * m.reused / total : 0.0, total ? (double)m.evals / total : 0.0,
+           (double)m.steps * m.n_nodes * m.n_nodes / m.elapsed_s);
+    print_summary(&m);
+
+    int rc = 0;
+    if(out_path){
+        if(ea_matrix_write(out_path, &m) != 0){
+            fprintf(stderr, "Error: cannot write %s\n", out_path);
+            rc = 1;
+        } else {
+            printf("Written      : %s (%.1f MB)\n", out_path,
+                   (48.0 + 4.0 * m.n_nodes + 4.0 * m.steps * m.n_nodes * m.n_nodes) / 1e6);
+        }
+    }
+    ea_matrix_free(&m);
+    return rc;
+}
@@ -7,10 +7,15 @@
 #include <time.h>
 #include <unistd.h>
 #include <math.h>
+#include <float.h>
 
 #include "cgr.h"
 #include "csv.h"
+#include "eta_kernel.h"
 #include "nasa_api.h"
+#include "outbuf.h"
+#include "plan_archive.h"
+#include "plan_stream.h"
 
 static volatile sig_atomic_t g_stop = 0;
 static void on_sigint(int s){ (void)s; g_stop = 1; }
@@ -32,6 +37,9 @@ typedef struct {
     // Synthetic generator control
     int    synth_n;       // number of intermediate satellites
     unsigned int seed;    // random seed (0 = time(NULL))
+    // Streaming plan window
+    double stream_h;      // >0: keep only contacts in [now, now+H] (bounded memory)
+    bool   no_cache;      // re-route every tick even while the last routes are valid
 } LiveCfg;
 
 static void banner(void){
@@ -45,7 +53,12 @@ static void usage(const char *p){
     "Usage:\n"
     "  %s [<nasa-dataset-id>] [--source local|api|synth] [--contacts <csv>]\n"
     "     [--src N --dst N] [--bytes B] [--tick s] [--period s] [--auto-period]\n"
-    "     [--k N] [--app-token <token>] [--synth-n N] [--seed S] [--help]\n\n"
+    "     [--k N] [--app-token <token>] [--synth-n N] [--seed S] [--stream H] [--no-cache] [--help]\n\n"
+    "  --contacts also accepts a columnar archive (.cgrp, see cgr_pack).\n"
+    "  --stream H keeps a sliding window of H seconds fed by a prefetch thread\n"
+    "  instead of the whole plan (local files are never fully loaded).\n"
+    "  Routes are reused across ticks until their validity interval ends or the\n"
+    "  residual capacity of a hop changes; --no-cache re-routes every tick.\n\n"
     "Examples:\n"
     "  %s --source local --contacts data/contacts_realistic.csv\n"
     "  %s abcd-1234 --source api --app-token YOUR_TOKEN --tick 10 --k 3\n"
@@ -58,14 +71,53 @@ static void sleep_ms(int ms){
     nanosleep(&ts, NULL);
 }
 
-static void print_progress(double now, double period){
-    if(period <= 0){ printf("\n"); return; }
+// Left-justify what was written since `from` to `width` columns (like %-Nd)
+static void ob_pad(OutBuf *ob, size_t from, int width){
+    for(size_t n = ob->len - from; n < (size_t)width; n++) ob_putc(ob, ' ');
+}
+
+static void print_progress(OutBuf *ob, double now, double period){
+    if(period <= 0){ ob_putc(ob, '\n'); return; }
     double f = fmod(now, period) / period;
     int width = 30;
     int filled = (int)(f * width);
-    printf("   Orbit: [");
-    for(int i=0;i<width;i++) putchar(i<filled? '#':'.');
-    printf("]  φ=%.1f%%\n", f*100.0);
+    ob_puts(ob, "   Orbit: [");
+    for(int i=0;i<width;i++) ob_putc(ob, i<filled? '#':'.');
+    ob_puts(ob, "]  φ="); ob_fixed(ob, f*100.0, 1); ob_puts(ob, "%\n");
+}
+
+static bool is_archive_path(const char *path){
+    size_t n = strlen(path);
+    return n > 5 && !strcmp(path + n - 5, ".cgrp");
+}
+
+static int load_plan_file(const char *path, Contact **out){
+    if(is_archive_path(path)) return plan_archive_load(path, 0.0, -1.0, out, NULL);
+    return load_contacts_csv(path, out);
+}
+
+// Time span of a plan file without loading it whole
+static bool plan_file_span(const char *path, double *tmin, double *tmax){
+    if(is_archive_path(path)){
+        PlanArchiveInfo info;
+        if(plan_archive_info(path, &info) != 0) return false;
+        *tmin = info.t_min; *tmax = info.t_max;
+        return info.n_contacts > 0;
+    }
+    CsvReader *r = csv_reader_open(path);
+    if(!r) return false;
+    Contact buf[1024];
+    int n, total = 0;
+    *tmin = 1e300; *tmax = -1e300;
+    while((n = csv_reader_next(r, buf, 1024)) > 0){
+        for(int i=0;i<n;i++){
+            if(buf[i].t_start < *tmin) *tmin = buf[i].t_start;
+            if(buf[i].t_end   > *tmax) *tmax = buf[i].t_end;
+        }
+        total += n;
+    }
+    csv_reader_close(r);
+    return total > 0;
 }
 
 // Duplicate contact windows around t0 for orbital periodicity
@@ -91,6 +143,25 @@ static Contact* periodize_contacts(const Contact *base, int N, double t0, double
     return C;
 }
 
+/* Cached routes still usable at P->t0: refresh their ETAs in place.
+ * They are evaluated with the library's contact model on Cr, the plan they
+ * were computed on (their contact_idxs point into it): here the plan only
+ * changes by periodization shifts and the stream window, which never alter
+ * a contact, so Cr stays exact until the validity intervals end. cgr_live
+ * never consumes capacity either, so residuals (and the bottleneck) are
+ * fixed: only validity and the refreshed ETA decide reuse. */
+static bool routes_reusable(Route *best, Routes *alts, const Contact *Cr, int Nr, const CgrParams *P){
+    if(!Cr || !best->found || P->t0 > best->valid_until) return false;
+    for(int r=-1;r<alts->count;r++){
+        Route *R = r < 0 ? best : &alts->items[r];
+        if(P->t0 > R->valid_until) return false;
+        double eta = cgr_route_eta(Cr, Nr, R, P, NULL);
+        if(eta == DBL_MAX) return false;
+        R->eta = eta;
+    }
+    return true;
+}
+
 /* ===========================
  * Realistic Synthetic Generator
  * ===========================
@@ -129,6 +200,7 @@ static int synth_generate(Contact **out, int *src, int *dst, double *period_out,
         C[M].rate_bps= (_rate);                                                    \
         C[M].setup_s = (setup);                                                    \
         C[M].residual_bytes = (_resid);                                            \
+        C[M].p_fail  = 0.0;                                                        \
         M++;                                                                        \
     }while(0)
 
@@ -194,7 +266,9 @@ int main(int argc, char **argv){
         .dataset_id = NULL,
         .app_token  = NULL,
         .synth_n = 12,
-        .seed = 0
+        .seed = 0,
+        .stream_h = 0.0,
+        .no_cache = false
     };
 
     // First non-flag argument = dataset-id (if using API mode)
@@ -219,6 +293,8 @@ int main(int argc, char **argv){
         else if(!strcmp(argv[i],"--app-token") && i+1<argc) L.app_token = argv[++i];
         else if(!strcmp(argv[i],"--synth-n") && i+1<argc) L.synth_n = (int)strtol(argv[++i],NULL,10);
         else if(!strcmp(argv[i],"--seed") && i+1<argc) { L.seed = (unsigned int)strtoul(argv[++i],NULL,10); }
+        else if(!strcmp(argv[i],"--stream") && i+1<argc) L.stream_h = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--no-cache")) L.no_cache = true;
         else {
             fprintf(stderr, "Unrecognized parameter: %s\n", argv[i]);
             usage(argv[0]);
@@ -257,7 +333,7 @@ int main(int argc, char **argv){
         if(n > 0){ N0 = n; }
         else {
             printf("[API] No data available; falling back to local: %s\n", L.contacts_path);
-            N0 = load_contacts_csv(L.contacts_path, &C0);
+            N0 = load_plan_file(L.contacts_path, &C0);
             if(N0 <= 0){ fprintf(stderr,"Error: could not load contacts.\n"); return 1; }
         }
     }
@@ -269,8 +345,11 @@ int main(int argc, char **argv){
         if(L.period<=0.0){ L.period=Pgen; }
         printf("✓ Generated %d synthetic contacts (period=%.1f s)\n\n", N0, L.period);
     }
+    else if(L.stream_h > 0.0){ // SRC_LOCAL, streamed: the file is read window by window
+        printf("✓ Streaming contacts from %s (window %.0f s)\n\n", L.contacts_path, L.stream_h);
+    }
     else { // SRC_LOCAL
-        N0 = load_contacts_csv(L.contacts_path, &C0);
+        N0 = load_plan_file(L.contacts_path, &C0);
         if(N0 <= 0){ fprintf(stderr,"Error: could not load contacts.\n"); return 1; }
         printf("✓ Loaded %d contacts\n\n", N0);
     }
@@ -278,9 +357,14 @@ int main(int argc, char **argv){
     // AUTO-PERIOD if applicable
     if(L.auto_period && L.period <= 0.0){
         double tmin = 1e300, tmax = -1e300;
-        for(int i=0;i<N0;i++){
-            if(C0[i].t_start < tmin) tmin = C0[i].t_start;
-            if(C0[i].t_end   > tmax) tmax = C0[i].t_end;
+        if(C0){
+            for(int i=0;i<N0;i++){
+                if(C0[i].t_start < tmin) tmin = C0[i].t_start;
+                if(C0[i].t_end   > tmax) tmax = C0[i].t_end;
+            }
+        } else if(!plan_file_span(L.contacts_path, &tmin, &tmax)){
+            fprintf(stderr,"Error: could not read contacts from %s.\n", L.contacts_path);
+            return 1;
         }
         double span = (tmax > tmin) ? (tmax - tmin) : 0.0;
         if(span > 0.0){
@@ -289,88 +373,150 @@ int main(int argc, char **argv){
         }
     }
 
+    // ====== Streaming window (optional) ======
+    PlanStream *PS = NULL;
+    if(L.stream_h > 0.0){
+        PlanSource src = C0 ? plan_source_array(C0, N0)
+                       : is_archive_path(L.contacts_path) ? plan_source_archive(L.contacts_path)
+                       : plan_source_csv(L.contacts_path);
+        PlanStreamCfg sc = { .horizon=L.stream_h, .period=L.period, .prefetch=1, .queue_cap=0, .chunk=0 };
+        PS = plan_stream_open(src, &sc);
+        if(!PS){ fprintf(stderr,"Error: could not open contact stream.\n"); free(C0); return 1; }
+    }
+
     // ====== Real-time simulation loop ======
     printf("🚀 Starting real-time simulation loop (Ctrl+C to stop)...\n\n");
+    fflush(stdout);   // from here on each tick goes out through ob in one write
+    OutBuf ob;
+    ob_init(&ob, STDOUT_FILENO, 0);
     double sim_time = 0.0;
-    int cycle = 0;
+    int cycle = 0, routed = 0;
+    Route best = {0};
+    Routes RS = {0};
+    Contact *Cr = NULL;   // plan the cached routes were computed on
+    int Nr = 0;
 
     while(!g_stop){
         cycle++;
-        printf("╔════════════════════════════════════════════════════════╗\n");
-        printf("║  CYCLE #%-4d | Simulation time: %.1f s              \n", cycle, sim_time);
-        printf("╠════════════════════════════════════════════════════════╣\n");
+        size_t at;
+        ob_puts(&ob, "╔════════════════════════════════════════════════════════╗\n");
+        ob_puts(&ob, "║  CYCLE #"); at = ob.len; ob_int(&ob, cycle); ob_pad(&ob, at, 4);
+        ob_puts(&ob, " | Simulation time: "); ob_fixed(&ob, sim_time, 1); ob_puts(&ob, " s              \n");
+        ob_puts(&ob, "╠════════════════════════════════════════════════════════╣\n");
 
         int Nc = 0;
-        Contact *C = periodize_contacts(C0, N0, sim_time, L.period, &Nc);
-        NeighborIndex *NI = build_neighbor_index(C, Nc);
-
+        Contact *Cp = NULL;
+        const Contact *C;
+        if(PS){
+            if(plan_stream_advance(PS, sim_time) < 0){
+                ob_flush(&ob);
+                fprintf(stderr,"Error: contact stream failed.\n");
+                break;
+            }
+            C = plan_stream_contacts(PS, &Nc);
+        } else {
+            Cp = periodize_contacts(C0, N0, sim_time, L.period, &Nc);
+            C = Cp;
+        }
         int active = 0;
         for(int i=0;i<Nc;i++){
             if(sim_time >= C[i].t_start && sim_time < C[i].t_end) active++;
         }
-        printf("║  Active contacts:   %-4d                               \n", active);
-        printf("║  Data source:       %-30s  \n",
-               (L.source==SRC_API?"NASA API (SODA)":(L.source==SRC_SYNTH?"SYNTHETIC":"LOCAL CSV")));
-        printf("║  Errors:            0                                  \n");
-        printf("╚════════════════════════════════════════════════════════╝\n\n");
+        ob_puts(&ob, "║  Active contacts:   "); at = ob.len; ob_int(&ob, active); ob_pad(&ob, at, 4);
+        ob_puts(&ob, "                               \n");
+        ob_puts(&ob, "║  Data source:       "); at = ob.len;
+        ob_puts(&ob, L.source==SRC_API?"NASA API (SODA)":(L.source==SRC_SYNTH?"SYNTHETIC":"LOCAL CSV"));
+        ob_pad(&ob, at, 30); ob_puts(&ob, "  \n");
+        if(PS){
+            PlanStreamStats st = plan_stream_stats(PS);
+            ob_puts(&ob, "║  Window:            "); ob_int(&ob, st.window);
+            ob_puts(&ob, " contacts (peak "); ob_int(&ob, st.peak_window);
+            ob_puts(&ob, ", queued "); ob_int(&ob, st.queued); ob_puts(&ob, ")\n");
+        }
+        ob_puts(&ob, "║  Errors:            0                                  \n");
+        ob_puts(&ob, "╚════════════════════════════════════════════════════════╝\n\n");
 
-        // Compute optimal route
+        // Compute optimal route (or keep the previous one while it stays valid)
         CgrParams P = { .src_node=L.src, .dst_node=L.dst, .t0=sim_time, .bundle_bytes=L.bundle_bytes, .expiry=0.0 };
-        Route best = cgr_best_route(C, Nc, &P, NI);
+        bool cached = !L.no_cache && routes_reusable(&best, &RS, Cr, Nr, &P);
+        if(!cached){
+            free_route(&best);
+            free_routes(&RS);
+            NeighborIndex *NI = build_neighbor_index(C, Nc);
+            best = cgr_best_route(C, Nc, &P, NI);
+            if(L.k_alt > 0 && best.found) RS = cgr_k_yen(C, Nc, &P, NI, L.k_alt);
+            free_neighbor_index(NI);
+            routed++;
+            // Keep this tick's plan for the cache (a periodized plan is ours already)
+            free(Cr);
+            Cr = NULL;
+            if(!L.no_cache && best.found){
+                if(Cp){ Cr = Cp; Cp = NULL; }
+                else if((Cr = (Contact*)malloc(sizeof(Contact)*(Nc > 0 ? Nc : 1)))) memcpy(Cr, C, sizeof(Contact)*Nc);
+            }
+            Nr = Cr ? Nc : 0;
+        }
 
         if(best.found){
             // Calculate wait time for first hop
+            const Contact *Cb = cached ? Cr : C;
             double wait_s = 0.0;
             if(best.hops>0){
-                int first_id = best.contact_ids[0];
-                for(int i=0;i<Nc;i++){
-                    if(C[i].id == first_id){
-                        double start_tx = fmax(sim_time, C[i].t_start);
-                        wait_s = fmax(0.0, start_tx - sim_time);
-                        break;
-                    }
-                }
+                double start_tx = fmax(sim_time, Cb[best.contact_idxs[0]].t_start);
+                wait_s = fmax(0.0, start_tx - sim_time);
+            }
+            if(cached){
+                ob_puts(&ob, "🛰️  ROUTE (cached, valid until "); ob_fixed(&ob, best.valid_until, 3); ob_puts(&ob, " s):\n");
+            } else {
+                ob_puts(&ob, "🛰️  OPTIMAL ROUTE FOUND:\n");
             }
-            printf("🛰️  OPTIMAL ROUTE FOUND:\n");
-            printf("   • ETA:      %.3f s\n", best.eta);
-            printf("   • Latency:  %.3f s (includes initial wait: %.3f s)\n", best.eta - sim_time, wait_s);
-            printf("   • Hops:     %d\n", best.hops);
-            printf("   • Path:     ");
-            for(int i=0;i<best.hops;i++){ if(i) printf(" → "); printf("%d", best.contact_ids[i]); }
-            printf("\n\n");
+            ob_puts(&ob, "   • ETA:      "); ob_fixed(&ob, best.eta, 3); ob_puts(&ob, " s\n");
+            ob_puts(&ob, "   • Latency:  "); ob_fixed(&ob, best.eta - sim_time, 3);
+            ob_puts(&ob, " s (includes initial wait: "); ob_fixed(&ob, wait_s, 3); ob_puts(&ob, " s)\n");
+            ob_puts(&ob, "   • Hops:     "); ob_int(&ob, best.hops); ob_putc(&ob, '\n');
+            ob_puts(&ob, "   • Valid:    departures until "); ob_fixed(&ob, best.valid_until, 3);
+            ob_puts(&ob, " s, bottleneck "); ob_fixed(&ob, best.bottleneck_bytes, 0); ob_puts(&ob, " bytes\n");
+            ob_puts(&ob, "   • Path:     ");
+            for(int i=0;i<best.hops;i++){ if(i) ob_puts(&ob, " → "); ob_int(&ob, best.contact_ids[i]); }
+            ob_puts(&ob, "\n\n");
         } else {
-            printf("⚠️  NO ROUTE AVAILABLE\n\n");
+            ob_puts(&ob, "⚠️  NO ROUTE AVAILABLE\n\n");
         }
 
         // Alternative routes (Yen-lite)
         if(L.k_alt > 0 && best.found){
-            Routes RS = cgr_k_yen(C, Nc, &P, NI, L.k_alt);
-            printf("📊 Alternative routes (K=%d):\n", L.k_alt);
-            if(RS.count==0) printf("   (none)\n");
+            ob_puts(&ob, "📊 Alternative routes (K="); ob_int(&ob, L.k_alt); ob_puts(&ob, "):\n");
+            if(RS.count==0) ob_puts(&ob, "   (none)\n");
             for(int r=0;r<RS.count;r++){
                 const Route *R = &RS.items[r];
                 double overhead = ((R->eta - best.eta) / best.eta) * 100.0;
-                printf("   #%d: ETA=%.3f s, %d hops (+%.1f%% overhead)\n", 
-                       r+1, R->eta, R->hops, overhead);
+                ob_puts(&ob, "   #"); ob_int(&ob, r+1);
+                ob_puts(&ob, ": ETA="); ob_fixed(&ob, R->eta, 3);
+                ob_puts(&ob, " s, "); ob_int(&ob, R->hops);
+                ob_puts(&ob, " hops (+"); ob_fixed(&ob, overhead, 1); ob_puts(&ob, "% overhead)\n");
             }
-            printf("\n");
-            free_routes(&RS);
+            ob_putc(&ob, '\n');
         }
 
-        print_progress(sim_time, L.period);
+        print_progress(&ob, sim_time, L.period);
 
-        free_route(&best);
-        free_neighbor_index(NI);
-        free(C);
+        free(Cp);
 
-        printf("⏳ Next cycle in 1 second...\n\n");
+        ob_puts(&ob, "⏳ Next cycle in 1 second...\n\n");
+        ob_flush(&ob);
         sleep_ms(1000);
         sim_time += L.tick;
     }
 
+    ob_flush(&ob);
+    ob_free(&ob);
     printf("\n[SIGNAL] Stopping simulation...\n\n");
     printf("[CLEANUP] Freeing resources...\n");
+    free_route(&best);
+    free_routes(&RS);
+    free(Cr);
+    plan_stream_close(PS);
     free(C0);
-    printf("✓ Simulation completed after %d cycles\n", cycle);
+    printf("✓ Simulation completed after %d cycles (%d routed, %d from cache)\n", cycle, routed, cycle - routed);
     return 0;
 }
@@ -0,0 +1,229 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "cgr.h"
+#include "csv.h"
+#include "montecarlo.h"
+#include "outbuf.h"
+#include "plan_archive.h"
+
+/* ===========================
+ * CGR Monte Carlo robustness
+ * ===========================
+ * Routes a query set over thousands of randomly perturbed copies of a
+ * contact plan (dropped contacts, jittered windows, scaled rates) and
+ * reports how delivery ratio and latency degrade against the nominal plan.
+ *
+ * Query format (CSV, '#' comments):  src,dst,t0,size_bytes[,expiry]
+ */
+
+#define SHOW_QUERIES 20
+
+static void usage(const char *p){
+    fprintf(stderr,
+    "Usage:\n"
+    "  %s --plan <csv|cgrp> (--queries <file> | --src N --dst N --t0 s --bytes B [--expiry s])\n"
+    "     [--trials N] [--threads N] [--seed S] [--out per_query.ndjson]\n"
+    "     [--p-drop p] [--p-jitter p --jitter s] [--p-rate p --rate-range lo:hi]\n\n"
+    "Perturbations are sampled independently per contact and per trial:\n"
+    "  --p-drop    probability of removing a contact (default 0.05)\n"
+    "  --p-jitter  probability of shifting t_start/t_end, each by U(-jitter, +jitter) (default 0.2, 30 s)\n"
+    "  --p-rate    probability of scaling rate_bps by U(lo, hi) (default 0.2, 0.5:1.0)\n"
+    "Query lines: src,dst,t0,size_bytes[,expiry]\n",
+    p);
+}
+
+static int load_plan(const char *path, Contact **out){
+    size_t n = strlen(path);
+    if(n > 5 && !strcmp(path + n - 5, ".cgrp")) return plan_archive_load(path, 0.0, -1.0, out, NULL);
+    return load_contacts_csv(path, out);
+}
+
+static int load_queries(const char *path, CgrParams **out){
+    FILE *f = fopen(path, "r");
+    if(!f) return -1;
+    int cap = 256, n = 0, line = 0;
+    CgrParams *Q = (CgrParams*)malloc(sizeof(CgrParams)*cap);
+    char buf[512];
+    while(Q && fgets(buf, sizeof(buf), f)){
+        line++;
+        char *p = buf;
+        while(isspace((unsigned char)*p)) p++;
+        if(*p=='#' || *p==0) continue;
+        CgrParams q = {0};
+        int k = sscanf(p, " %d , %d , %lf , %lf , %lf", &q.src_node, &q.dst_node, &q.t0, &q.bundle_bytes, &q.expiry);
+        if(k < 4 || q.src_node < 0 || q.dst_node < 0 || q.bundle_bytes <= 0.0){
+            fprintf(stderr, "warning: bad query line %d (skipped)\n", line);
+            continue;
+        }
+        if(k < 5) q.expiry = 0.0;
+        if(n >= cap){
+            cap *= 2;
+            CgrParams *nq = (CgrParams*)realloc(Q, sizeof(CgrParams)*cap);
+            if(!nq){ free(Q); Q = NULL; break; }
+            Q = nq;
+        }
+        Q[n++] = q;
+    }
+    fclose(f);
+    if(!Q) return -1;
+    *out = Q;
+    return n;
+}
+
+static void print_summary(const char *label, const McSummary *s, double base){
+    printf("%-14s delivery %5.1f%%", label, 100.0*s->delivery);
+    if(!isnan(base)) printf("  nominal %9.3f s", base);
+    else             printf("  nominal  no route  ");
+    if(s->n) printf("  latency p50 %9.3f  p90 %9.3f  p99 %9.3f  max %9.3f s", s->p50, s->p90, s->p99, s->max);
+    printf("\n");
+}
+
+static int write_ndjson(const char *path, const McResult *R, const CgrParams *Q){
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) return -1;
+    OutBuf ob;
+    ob_init(&ob, fd, 1u << 20);
+    for(int q=0;q<R->nq;q++){
+        McSummary s;
+        if(mc_summary(R, q, &s) != 0) break;
+        ob_puts(&ob, "{\"query\":");      ob_int(&ob, q);
+        ob_puts(&ob, ",\"src\":");        ob_int(&ob, Q[q].src_node);
+        ob_puts(&ob, ",\"dst\":");        ob_int(&ob, Q[q].dst_node);
+        ob_puts(&ob, ",\"t0\":");         ob_double(&ob, Q[q].t0);
+        ob_puts(&ob, ",\"nominal\":");
+        if(isnan(R->base_latency[q])) ob_puts(&ob, "null"); else ob_fixed(&ob, R->base_latency[q], 6);
+        ob_puts(&ob, ",\"delivery\":");   ob_fixed(&ob, s.delivery, 6);
+        if(s.n){
+            ob_puts(&ob, ",\"mean\":");   ob_fixed(&ob, s.mean, 6);
+            ob_puts(&ob, ",\"p50\":");    ob_fixed(&ob, s.p50, 6);
+            ob_puts(&ob, ",\"p90\":");    ob_fixed(&ob, s.p90, 6);
+            ob_puts(&ob, ",\"p99\":");    ob_fixed(&ob, s.p99, 6);
+            ob_puts(&ob, ",\"max\":");    ob_fixed(&ob, s.max, 6);
+        }
+        ob_puts(&ob, "}\n");
+        ob_end_record(&ob);
+    }
+    int rc = ob_flush(&ob);
+    if(ob.err) rc = -1;
+    ob_free(&ob);
+    close(fd);
+    return rc;
+}
+
+static int parse_range(const char *s, double *lo, double *hi){
+    char *e;
+    *lo = strtod(s, &e);
+    if(e == s || *e != ':') return -1;
+    s = e + 1;
+    *hi = strtod(s, &e);
+    if(e == s || *hi < *lo || *lo < 0.0) return -1;
+    return 0;
+}
+
+int main(int argc, char **argv){
+    const char *plan_path = NULL, *queries_path = NULL, *out_path = NULL;
+    CgrParams single = { .src_node = -1, .dst_node = -1 };
+    McConfig cfg = { .trials = 1000, .threads = 1, .seed = 42,
+                     .pert = { .p_drop = 0.05, .p_jitter = 0.2, .jitter_s = 30.0,
+                               .p_rate = 0.2, .rate_lo = 0.5, .rate_hi = 1.0 } };
+
+    for(int i=1;i<argc;i++){
+        if(!strcmp(argv[i],"--plan") && i+1<argc) plan_path = argv[++i];
+        else if(!strcmp(argv[i],"--queries") && i+1<argc) queries_path = argv[++i];
+        else if(!strcmp(argv[i],"--out") && i+1<argc) out_path = argv[++i];
+        else if(!strcmp(argv[i],"--src") && i+1<argc) single.src_node = (int)strtol(argv[++i],NULL,10);
+        else if(!strcmp(argv[i],"--dst") && i+1<argc) single.dst_node = (int)strtol(argv[++i],NULL,10);
+        else if(!strcmp(argv[i],"--t0") && i+1<argc) single.t0 = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--bytes") && i+1<argc) single.bundle_bytes = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--expiry") && i+1<argc) single.expiry = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--trials") && i+1<argc) cfg.trials = (int)strtol(argv[++i],NULL,10);
+        else if(!strcmp(argv[i],"--threads") && i+1<argc) cfg.threads = (int)strtol(argv[++i],NULL,10);
+        else if(!strcmp(argv[i],"--seed") && i+1<argc) cfg.seed = strtoull(argv[++i],NULL,10);
+        else if(!strcmp(argv[i],"--p-drop") && i+1<argc) cfg.pert.p_drop = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--p-jitter") && i+1<argc) cfg.pert.p_jitter = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--jitter") && i+1<argc) cfg.pert.jitter_s = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--p-rate") && i+1<argc) cfg.pert.p_rate = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--rate-range") && i+1<argc){
+            if(parse_range(argv[++i], &cfg.pert.rate_lo, &cfg.pert.rate_hi) != 0){
+                fprintf(stderr, "Error: --rate-range expects lo:hi with 0 <= lo <= hi\n");
+                return 2;
+            }
+        }
+        else { usage(argv[0]); return 2; }
+    }
+    if(!plan_path || (!queries_path && (single.src_node < 0 || single.dst_node < 0 || single.bundle_bytes <= 0.0))){
+        usage(argv[0]);
+        return 2;
+    }
+    if(cfg.trials < 1 || cfg.threads < 1){
+        fprintf(stderr, "Error: --trials and --threads must be >= 1\n");
+        return 2;
+    }
+
+    Contact *C = NULL;
+    int N = load_plan(plan_path, &C);
+    if(N <= 0){ fprintf(stderr, "Error: could not load plan %s\n", plan_path); return 1; }
+
+    CgrParams *Q = NULL;
+    int nq;
+    if(queries_path){
+        nq = load_queries(queries_path, &Q);
+        if(nq <= 0){ fprintf(stderr, "Error: no queries in %s\n", queries_path); free(C); return 1; }
+    } else {
+        Q = (CgrParams*)malloc(sizeof(CgrParams));
+        if(!Q){ fprintf(stderr, "Error: out of memory\n"); free(C); return 1; }
+        Q[0] = single;
+        nq = 1;
+    }
+
+    NeighborIndex *NI = build_neighbor_index_ex(C, N, NI_LAZY_BY_TO);
+    McResult R;
+    if(!NI || mc_run(C, N, NI, Q, nq, &cfg, &R) != 0){
+        fprintf(stderr, "Error: out of memory\n");
+        free_neighbor_index(NI); free(Q); free(C);
+        return 1;
+    }
+
+    printf("CGR Monte Carlo — plan %s (%d contacts), %d queries x %d trials, %d thread%s\n",
+           plan_path, N, nq, cfg.trials, cfg.threads, cfg.threads == 1 ? "" : "s");
+    printf("Perturbation : drop %.3f  jitter %.3f (±%.1f s)  rate %.3f (x%.2f..%.2f)\n",
+           cfg.pert.p_drop, cfg.pert.p_jitter, cfg.pert.jitter_s, cfg.pert.p_rate,
+           cfg.pert.rate_lo, cfg.pert.rate_hi);
+    printf("Throughput   : %.0f trials/s, %.0f routes/s (wall %.3f s); %.1f contacts perturbed per trial\n\n",
+           cfg.trials / R.elapsed_s, (double)cfg.trials * nq / R.elapsed_s, R.elapsed_s,
+           (double)R.perturbed / cfg.trials);
+
+    McSummary s;
+    int nominal = 0;
+    for(int q=0;q<nq;q++) nominal += !isnan(R.base_latency[q]);
+    mc_summary(&R, -1, &s);
+    printf("All queries    delivery %5.1f%%  (nominal plan %d/%d)", 100.0*s.delivery, nominal, nq);
+    if(s.n) printf("  latency mean %.3f  p50 %.3f  p90 %.3f  p99 %.3f  max %.3f s", s.mean, s.p50, s.p90, s.p99, s.max);
+    printf("\n");
+    for(int q=0;q<nq && q<SHOW_QUERIES;q++){
+        char label[48];
+        snprintf(label, sizeof(label), "%d->%d @%.0f", Q[q].src_node, Q[q].dst_node, Q[q].t0);
+        mc_summary(&R, q, &s);
+        print_summary(label, &s, R.base_latency[q]);
+    }
+    if(nq > SHOW_QUERIES) printf("... (%d more; use --out for all)\n", nq - SHOW_QUERIES);
+
+    int rc = 0;
+    if(out_path && write_ndjson(out_path, &R, Q) != 0){
+        fprintf(stderr, "Error: cannot write %s\n", out_path);
+        rc = 1;
+    }
+
+    mc_result_free(&R);
+    free_neighbor_index(NI);
+    free(Q);
+    free(C);
+    return rc;
+}
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "csv.h"
+#include "plan_archive.h"
+
+/* ===========================
+ * cgr_pack: CSV ⇄ archivo columnar (.cgrp)
+ * ===========================
+ *   cgr_pack plan.csv plan.cgrp [--block N]
+ *   cgr_pack --info plan.cgrp
+ *   cgr_pack --slice plan.cgrp t_lo t_hi out.csv
+ */
+
+static int write_csv(const char *path, const Contact *C, int N){
+    FILE *f = fopen(path, "w");
+    if(!f) return -1;
+    fprintf(f, "# id,from,to,t_start,t_end,owlt_s,rate_bps,setup_s,residual_bytes[,p_success]\n");
+    for(int i=0;i<N;i++){
+        fprintf(f, "%d,%d,%d,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g",
+                C[i].id, C[i].from, C[i].to, C[i].t_start, C[i].t_end,
+                C[i].owlt, C[i].rate_bps, C[i].setup_s, C[i].residual_bytes);
+        if(C[i].p_fail != 0.0) fprintf(f, ",%.17g", 1.0 - C[i].p_fail);
+        fputc('\n', f);
+    }
+    return fclose(f);
+}
+
+static void usage(const char *p){
+    fprintf(stderr,
+    "Uso:\n"
+    "  %s <in.csv> <out.cgrp> [--block N]\n"
+    "  %s --info <plan.cgrp>\n"
+    "  %s --slice <plan.cgrp> <t_lo> <t_hi> <out.csv>\n", p, p, p);
+}
+
+int main(int argc, char **argv){
+    if(argc >= 3 && !strcmp(argv[1], "--info")){
+        PlanArchiveInfo info;
+        if(plan_archive_info(argv[2], &info) != 0){ fprintf(stderr, "Error: no se pudo leer %s\n", argv[2]); return 1; }
+        printf("contacts=%lld blocks=%d t=[%.3f, %.3f]\n",
+               (long long)info.n_contacts, info.n_blocks, info.t_min, info.t_max);
+        return 0;
+    }
+
+    if(argc >= 6 && !strcmp(argv[1], "--slice")){
+        PlanArchiveInfo info;
+        Contact *C = NULL;
+        int N = plan_archive_load(argv[2], strtod(argv[3], NULL), strtod(argv[4], NULL), &C, &info);
+        if(N < 0){ fprintf(stderr, "Error: no se pudo leer %s\n", argv[2]); return 1; }
+        int rc = write_csv(argv[5], C, N);
+        fprintf(stderr, "%d contactos (%d/%d bloques, %lld bytes)\n",
+                N, info.blocks_read, info.n_blocks, (long long)info.bytes_read);
+        free(C);
+        return rc == 0 ? 0 : 1;
+    }
+
+    if(argc != 3 && !(argc == 5 && !strcmp(argv[3], "--block"))){ usage(argv[0]); return 2; }
+    int block = (argc == 5) ? (int)strtol(argv[4], NULL, 10) : PLAN_ARCHIVE_BLOCK_DEFAULT;
+
+    Contact *C = NULL;
+    int N = load_contacts_csv(argv[1], &C);
+    if(N <= 0){ fprintf(stderr, "Error: no se pudieron cargar contactos de %s\n", argv[1]); return 1; }
+    if(plan_archive_write(argv[2], C, N, block) != 0){
+        fprintf(stderr, "Error: no se pudo escribir %s\n", argv[2]);
+        free(C);
+        return 1;
+    }
+    fprintf(stderr, "%d contactos → %s\n", N, argv[2]);
+    free(C);
+    return 0;
+}
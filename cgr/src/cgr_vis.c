@@ -0,0 +1,196 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "sgp4.h"
+#include "sgp4_batch.h"
+#include "visibility.h"
+
+/* ===========================
+ * CGR line-of-sight contact plans
+ * ===========================
+ * Generates the contact plan of a TLE constellation: ground station passes
+ * (elevation above each station's mask) and, with --isl, satellite pairs
+ * with an unobstructed line of sight. Window edges come from root finding
+ * on the exact SGP4 trajectories (see visibility.h), not from the sampling
+ * step; owlt is the longest range in the window over c.
+ * Node ids follow the router convention: ground stations 100, 200, ...
+ * and satellites 1, 2, ... in TLE order (skipping multiples of 100).
+ */
+
+#define MAX_STATIONS 9
+
+static void usage(const char *p){
+    fprintf(stderr,
+    "Usage:\n"
+    "  %s --tle <file> --plan <contacts.csv> [--stations <gs.csv>] [--isl] [--isl-range km]\n"
+    "     [--grazing km] [--min-elev deg] [--days D | --hours H] [--start unix_s]\n"
+    "     [--step s] [--tol s] [--rate bps] [--gs-rate bps] [--setup s] [--threads N]\n\n"
+    "Stations file: name,lat_deg,lon_deg,alt_m[,min_elev_deg] per line ('#' comments),\n"
+    "at most %d stations. --isl adds every satellite pair whose line of sight clears\n"
+    "the Earth by --grazing km (default 80); --isl-range also limits the distance.\n"
+    "Defaults: 1 day from the newest TLE epoch, 60 s sampling, 1 ms edges, 10 deg mask,\n"
+    "10 Mbps ISL / 50 Mbps ground links, 0.1 s setup. Plan times are seconds from\n"
+    "--start; the node mapping is written as comments at the top of the plan.\n",
+    p, MAX_STATIONS);
+}
+
+static void utc_string(double t, char *buf, size_t n){
+    time_t s = (time_t)floor(t);
+    struct tm tm;
+    gmtime_r(&s, &tm);
+    size_t k = strftime(buf, n, "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(buf + k, n - k, ".%03dZ", (int)((t - floor(t)) * 1000.0));
+}
+
+static int load_stations(const char *path, double min_elev, VisStation *st){
+    FILE *f = fopen(path, "r");
+    if(!f) return -1;
+    char line[256];
+    int n = 0;
+    while(fgets(line, sizeof(line), f)){
+        char *p = line;
+        while(*p == ' ' || *p == '\t') p++;
+        if(*p == '#' || *p == '\n' || *p == '\r' || !*p) continue;
+        if(n == MAX_STATIONS){ n = -2; break; }
+        VisStation *s = &st[n];
+        char *tok = strtok(p, ",");
+        char *f1 = strtok(NULL, ","), *f2 = strtok(NULL, ","), *f3 = strtok(NULL, ","), *f4 = strtok(NULL, ",\r\n");
+        if(!tok || !f1 || !f2 || !f3){ n = -3; break; }
+        snprintf(s->name, sizeof(s->name), "%s", tok);
+        s->lat_deg = strtod(f1, NULL);
+        s->lon_deg = strtod(f2, NULL);
+        s->alt_km = strtod(f3, NULL) / 1000.0;
+        s->min_elev_deg = f4 ? strtod(f4, NULL) : min_elev;
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+static int write_plan(FILE *f, const Sgp4Sat *S, int n, const VisStation *st, int nst, const VisResult *R,
+                      double t0, double isl_rate, double gs_rate, double setup){
+    char ts[40];
+    utc_string(t0, ts, sizeof(ts));
+    int *node = (int*)malloc(sizeof(int) * (n > 0 ? n : 1));
+    if(!node) return -1;
+    for(int i=0, id=0;i<n;i++){
+        id++;
+        if(id % 100 == 0 && id < 1000) id++;
+        node[i] = id;
+    }
+    fprintf(f, "# Line-of-sight contact plan from TLE, t = 0 at %s (unix %.3f)\n", ts, t0);
+    fprintf(f, "# node,kind,catnum/lat,name/lon\n");
+    for(int s=0;s<nst;s++) fprintf(f, "#   %d,gs,%.5f,%.5f %s\n", 100 * (s + 1), st[s].lat_deg, st[s].lon_deg, st[s].name);
+    for(int i=0;i<n;i++) if(S[i].error == SGP4_OK) fprintf(f, "#   %d,sat,%d,%s\n", node[i], S[i].catnum, S[i].name);
+    fprintf(f, "# id,from,to,t_start,t_end,owlt_s,rate_bps,setup_s,residual_bytes\n");
+    int id = 0;
+    for(int k=0;k<R->count;k++){
+        const VisWindow *w = &R->items[k];
+        double dur = w->t_end - w->t_start;
+        if(dur <= setup) continue;
+        int a = w->station >= 0 ? 100 * (w->station + 1) : node[w->a];
+        int b = w->station >= 0 ? node[w->a] : node[w->b];
+        double rate = w->station >= 0 ? gs_rate : isl_rate;
+        double resid = (dur - setup) * rate / 8.0;
+        for(int dir=0;dir<2;dir++){
+            fprintf(f, "%d,%d,%d,%.3f,%.3f,%.6f,%.1f,%.3f,%.0f\n", id++,
+                    dir ? b : a, dir ? a : b, w->t_start - t0, w->t_end - t0, w->owlt_s, rate, setup, resid);
+        }
+    }
+    free(node);
+    return ferror(f) ? -1 : 0;
+}
+
+int main(int argc, char **argv){
+    const char *tle = NULL, *plan_path = NULL, *gs_path = NULL;
+    VisConfig cfg = { .t_begin = NAN, .step_s = 60.0, .tol_s = 1e-3, .grazing_km = 80.0, .threads = 1 };
+    double span = 86400.0, min_elev = 10.0, isl_rate = 1e7, gs_rate = 5e7, setup = 0.1;
+
+    for(int i=1;i<argc;i++){
+        if(!strcmp(argv[i],"--tle") && i+1<argc) tle = argv[++i];
+        else if(!strcmp(argv[i],"--plan") && i+1<argc) plan_path = argv[++i];
+        else if(!strcmp(argv[i],"--stations") && i+1<argc) gs_path = argv[++i];
+        else if(!strcmp(argv[i],"--isl")) cfg.isl = 1;
+        else if(!strcmp(argv[i],"--isl-range") && i+1<argc){ cfg.isl = 1; cfg.isl_range_km = strtod(argv[++i],NULL); }
+        else if(!strcmp(argv[i],"--grazing") && i+1<argc) cfg.grazing_km = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--min-elev") && i+1<argc) min_elev = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--days") && i+1<argc) span = strtod(argv[++i],NULL) * 86400.0;
+        else if(!strcmp(argv[i],"--hours") && i+1<argc) span = strtod(argv[++i],NULL) * 3600.0;
+        else if(!strcmp(argv[i],"--start") && i+1<argc) cfg.t_begin = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--step") && i+1<argc) cfg.step_s = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--tol") && i+1<argc) cfg.tol_s = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--rate") && i+1<argc) isl_rate = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--gs-rate") && i+1<argc) gs_rate = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--setup") && i+1<argc) setup = strtod(argv[++i],NULL);
+        else if(!strcmp(argv[i],"--threads") && i+1<argc) cfg.threads = (int)strtol(argv[++i],NULL,10);
+        else { usage(argv[0]); return 2; }
+    }
+    if(!tle || !plan_path || (!gs_path && !cfg.isl)){ usage(argv[0]); return 2; }
+    if(!(cfg.step_s > 0.0) || !(cfg.tol_s > 0.0) || !(span > 0.0) || cfg.threads < 1 ||
+       !(isl_rate > 0.0) || !(gs_rate > 0.0)){
+        fprintf(stderr, "Error: --step, --tol, --days/--hours, --rate, --gs-rate and --threads must be positive\n");
+        return 2;
+    }
+
+    VisStation st[MAX_STATIONS];
+    int nst = 0;
+    if(gs_path){
+        nst = load_stations(gs_path, min_elev, st);
+        if(nst == -1){ fprintf(stderr, "Error: cannot open %s\n", gs_path); return 1; }
+        if(nst == -2){ fprintf(stderr, "Error: at most %d ground stations (ids 100..900)\n", MAX_STATIONS); return 1; }
+        if(nst < 0){ fprintf(stderr, "Error: %s: expected name,lat_deg,lon_deg,alt_m[,min_elev_deg]\n", gs_path); return 1; }
+    }
+
+    Sgp4Sat *S = NULL;
+    int bad = 0;
+    int n = sgp4_load_catalog(tle, &S, &bad);
+    if(n <= 0){ fprintf(stderr, "Error: no TLEs in %s\n", tle); free(S); return 1; }
+    if(isnan(cfg.t_begin)){
+        double newest = -1e300;
+        for(int i=0;i<n;i++) if(S[i].epoch_unix > newest) newest = S[i].epoch_unix;
+        cfg.t_begin = floor(newest / 60.0) * 60.0;
+    }
+    cfg.t_end = cfg.t_begin + span;
+
+    Sgp4Batch B;
+    if(sgp4_batch_init(&B, S, n) != 0){ fprintf(stderr, "Error: out of memory\n"); free(S); return 1; }
+    int skipped = 0;
+    for(int i=0;i<n;i++) skipped += S[i].error != SGP4_OK;
+    char t0s[40];
+    utc_string(cfg.t_begin, t0s, sizeof(t0s));
+    fprintf(stderr, "Catalog      : %d satellites from %s (%d not propagated: deep space/invalid, %d unreadable TLEs)\n",
+            n - skipped, tle, skipped, bad);
+    fprintf(stderr, "Window       : %s + %.1f h, sampling %.1f s, edges to %.3g s, %d thread%s\n",
+            t0s, span / 3600.0, cfg.step_s, cfg.tol_s, cfg.threads, cfg.threads == 1 ? "" : "s");
+
+    VisResult R;
+    if(vis_windows(&B, st, nst, &cfg, &R) != 0){
+        fprintf(stderr, "Error: visibility computation failed\n");
+        sgp4_batch_free(&B);
+        free(S);
+        return 1;
+    }
+    int ngs = 0;
+    for(int k=0;k<R.count;k++) ngs += R.items[k].station >= 0;
+    fprintf(stderr, "Visibility   : %llu links, %d GS passes + %d ISL windows, %llu edges refined, "
+            "%llu between-sample extrema checked, %.3f s\n",
+            (unsigned long long)R.links, ngs, R.count - ngs, (unsigned long long)R.roots,
+            (unsigned long long)R.peaks, R.elapsed_s);
+
+    int rc = 0;
+    FILE *f = fopen(plan_path, "w");
+    if(!f || write_plan(f, S, n, st, nst, &R, cfg.t_begin, isl_rate, gs_rate, setup) != 0){
+        fprintf(stderr, "Error: cannot write %s\n", plan_path);
+        rc = 1;
+    }
+    if(f) fclose(f);
+    if(!rc) fprintf(stderr, "Plan         : %s\n", plan_path);
+    vis_result_free(&R);
+    sgp4_batch_free(&B);
+    free(S);
+    return rc;
+}
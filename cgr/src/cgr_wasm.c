@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "cgr.h"
+#include "csv.h"
+#include "cgr_wasm.h"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Estado del módulo: un plan y el resultado de la última consulta
+// ═══════════════════════════════════════════════════════════════════════════
+
+static struct
+{
+    Contact *C;
+    int N;
+    NeighborIndex *NI;       // NULL hasta cgrw_plan_commit (y con el plan vacío)
+    CgrWorkspace *ws;        // NULL hasta cgrw_plan_commit
+
+    int *ids, ids_cap;       // ids de contacto de todas las rutas, concatenados
+    int *off;                // count + 1 offsets en ids
+    double *eta;
+    int count, routes_cap;
+} W;
+
+static const int layout[CGRW_L_COUNT] = {
+    [CGRW_L_SIZE]     = (int)sizeof(Contact),
+    [CGRW_L_ID]       = (int)offsetof(Contact, id),
+    [CGRW_L_FROM]     = (int)offsetof(Contact, from),
+    [CGRW_L_TO]       = (int)offsetof(Contact, to),
+    [CGRW_L_T_START]  = (int)offsetof(Contact, t_start),
+    [CGRW_L_T_END]    = (int)offsetof(Contact, t_end),
+    [CGRW_L_OWLT]     = (int)offsetof(Contact, owlt),
+    [CGRW_L_RATE]     = (int)offsetof(Contact, rate_bps),
+    [CGRW_L_SETUP]    = (int)offsetof(Contact, setup_s),
+    [CGRW_L_RESIDUAL] = (int)offsetof(Contact, residual_bytes),
+    [CGRW_L_P_FAIL]   = (int)offsetof(Contact, p_fail),
+};
+
+const int* cgrw_layout(void) {
+    return layout;
+}
+
+static void plan_release_index(void) {
+    cgr_workspace_free(W.ws);
+    free_neighbor_index(W.NI);
+    W.ws = NULL;
+    W.NI = NULL;
+}
+
+void cgrw_plan_free(void) {
+    plan_release_index();
+    free(W.C);
+    W.C = NULL;
+    W.N = 0;
+    W.count = 0;
+}
+
+Contact* cgrw_plan_alloc(int n) {
+    cgrw_plan_free();
+    if (n < 0) return NULL;
+    W.C = (Contact*)calloc(n > 0 ? n : 1, sizeof(Contact));
+    if (!W.C) return NULL;
+    W.N = n;
+    return W.C;
+}
+
+int cgrw_plan_load_csv(char *text, int len) {
+    cgrw_plan_free();
+    if (len < 0) return -1;
+    Contact *C = NULL;
+    int n = load_contacts_csv_text(text, (size_t)len, &C);
+    if (n < 0) return -1;
+    W.C = C;
+    W.N = n;
+    return cgrw_plan_commit() == 0 ? n : -1;
+}
+
+Contact* cgrw_plan_ptr(void) {
+    return W.C;
+}
+
+int cgrw_plan_count(void) {
+    return W.N;
+}
+
+int cgrw_plan_commit(void) {
+    plan_release_index();
+    W.count = 0;
+    if (!W.C) return -1;
+    // build_neighbor_index rechaza N = 0: el plan vacío queda sin índice y
+    // sus consultas terminan sin ruta
+    W.ws = cgr_workspace_new(W.N > 0 ? W.N : 1);
+    if (W.N > 0) W.NI = build_neighbor_index(W.C, W.N);
+    if (!W.ws || (W.N > 0 && (!W.NI || neighbor_index_attach_soa(W.NI, W.C, W.N) != 0))) {
+        plan_release_index();
+        return -1;
+    }
+    return 0;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Consultas
+// ═══════════════════════════════════════════════════════════════════════════
+
+static int result_reserve(int routes, int ids) {
+    if (routes + 1 > W.routes_cap) {
+        int cap = W.routes_cap ? W.routes_cap : 8;
+        while (cap < routes + 1) cap *= 2;
+        int *no = (int*)realloc(W.off, sizeof(int) * cap);
+        if (no) W.off = no;
+        double *ne = (double*)realloc(W.eta, sizeof(double) * cap);
+        if (ne) W.eta = ne;
+        if (!no || !ne) return -1;
+        W.routes_cap = cap;
+    }
+    if (ids > W.ids_cap) {
+        int cap = W.ids_cap ? W.ids_cap : 64;
+        while (cap < ids) cap *= 2;
+        int *ni = (int*)realloc(W.ids, sizeof(int) * cap);
+        if (!ni) return -1;
+        W.ids = ni;
+        W.ids_cap = cap;
+    }
+    return 0;
+}
+
+// Copia las rutas encontradas de rs[0..n) al buffer de resultados
+static int result_store(const Route *rs, int n) {
+    int total = 0, count = 0;
+    for (int r = 0; r < n; r++) if (rs[r].found) { total += rs[r].hops; count++; }
+    W.count = 0;
+    if (result_reserve(count, total) != 0) return -1;
+    int w = 0;
+    W.off[0] = 0;
+    for (int r = 0; r < n; r++) {
+        if (!rs[r].found) continue;
+        memcpy(W.ids + W.off[w], rs[r].contact_ids, sizeof(int) * rs[r].hops);
+        W.eta[w] = rs[r].eta;
+        W.off[w + 1] = W.off[w] + rs[r].hops;
+        w++;
+    }
+    W.count = count;
+    return count;
+}
+
+static int query_params(CgrParams *P, int src, int dst, double t0, double bytes, double expiry) {
+    W.count = 0;
+    if (!W.ws || src < 0 || dst < 0) return -1;
+    memset(P, 0, sizeof(*P));
+    P->src_node = src;
+    P->dst_node = dst;
+    P->t0 = t0;
+    P->bundle_bytes = bytes;
+    P->expiry = expiry;
+    return 0;
+}
+
+int cgrw_route(int src, int dst, double t0, double bytes, double expiry) {
+    CgrParams P;
+    if (query_params(&P, src, dst, t0, bytes, expiry) != 0) return -1;
+    if (!W.NI) return 0;
+    Route r = cgr_best_route_ws(W.C, W.N, &P, W.NI, NULL, W.ws);
+    int rc = result_store(&r, 1);
+    free_route(&r);
+    return rc;
+}
+
+int cgrw_k_routes(int src, int dst, double t0, double bytes, double expiry, int K, int yen) {
+    CgrParams P;
+    if (K <= 0 || query_params(&P, src, dst, t0, bytes, expiry) != 0) return -1;
+    if (!W.NI) return 0;
+    Routes RS = yen ? cgr_k_yen(W.C, W.N, &P, W.NI, K) : cgr_k_routes(W.C, W.N, &P, W.NI, K);
+    int rc = result_store(RS.items, RS.count);
+    free_routes(&RS);
+    return rc;
+}
+
+int cgrw_result_count(void) {
+    return W.count;
+}
+
+const int* cgrw_result_ids(void) {
+    return W.ids;
+}
+
+const int* cgrw_result_offsets(void) {
+    return W.off;
+}
+
+const double* cgrw_result_etas(void) {
+    return W.eta;
+}
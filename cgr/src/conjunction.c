@@ -0,0 +1,763 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "conjunction.h"
+#include "sgp4_batch.h"
+
+#define CONJ_PI            3.14159265358979323846
+#define CONJ_DEFAULT_STEP  20.0
+#define CONJ_BLOCK_STEPS   32     // pasos por unidad de trabajo de un hilo
+#define CONJ_LIN_MARGIN_KM 2.0    // holgura del filtro lineal (curvatura en step/2)
+#define CONJ_TCA_TOL_S     1e-4
+#define CONJ_EPOCH_S       21600.0 // validez de la geometría de planos del prefiltro
+#define CONJ_PLANE_MIN_SIN 0.02   // planos casi coplanarios: sin filtro de planos
+#define CONJ_PLANE_MAX_DN  0.25   // giro admisible de la línea de nodos en una época (rad)
+
+static double conj_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline double dot3(const double *a, const double *b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline void cross3(const double *a, const double *b, double *c) {
+    c[0] = a[1] * b[2] - a[2] * b[1];
+    c[1] = a[2] * b[0] - a[0] * b[2];
+    c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Rejilla uniforme por instante: hash de celdas con listas encadenadas
+// ═══════════════════════════════════════════════════════════════════════════
+
+typedef struct
+{
+    int n;
+    double *pos, *vel;      // [3n]
+    unsigned char *ok;      // propagación válida en este instante
+    int *cell;              // [3n] coordenadas de celda
+    int *head;              // [hmask + 1] primer objeto de cada cubeta
+    int *next;              // [n]
+    unsigned hmask;
+} Grid;
+
+static int grid_init(Grid *G, int n) {
+    memset(G, 0, sizeof(*G));
+    unsigned h = 1;
+    while (h < 2u * (unsigned)n) h <<= 1;
+    G->n = n;
+    G->hmask = h - 1;
+    G->pos = (double*)malloc(sizeof(double) * 3 * n);
+    G->vel = (double*)malloc(sizeof(double) * 3 * n);
+    G->ok = (unsigned char*)malloc(n);
+    G->cell = (int*)malloc(sizeof(int) * 3 * n);
+    G->head = (int*)malloc(sizeof(int) * h);
+    G->next = (int*)malloc(sizeof(int) * n);
+    return (G->pos && G->vel && G->ok && G->cell && G->head && G->next) ? 0 : -1;
+}
+
+static void grid_free(Grid *G) {
+    free(G->pos); free(G->vel); free(G->ok);
+    free(G->cell); free(G->head); free(G->next);
+}
+
+static inline unsigned cell_hash(const Grid *G, int x, int y, int z) {
+    return ((unsigned)x * 73856093u ^ (unsigned)y * 19349663u ^ (unsigned)z * 83492791u) & G->hmask;
+}
+
+/* Propaga el catálogo a t (por lotes, ver sgp4_batch.h) y lo reparte en
+   celdas de lado `side`. Con active != NULL solo los objetos marcados (los
+   demás no tienen ningún par posible en esta época según el prefiltro). */
+static void grid_build(Grid *G, const Sgp4Batch *B, const unsigned char *active, double t, double side) {
+    memset(G->head, -1, sizeof(int) * (G->hmask + 1));
+    double inv = 1.0 / side;
+    sgp4_batch_at(B, t, active, G->pos, G->vel, G->ok);
+    for (int i = 0; i < G->n; i++) {
+        if (!G->ok[i]) continue;
+        double *r = G->pos + 3 * i;
+        int *c = G->cell + 3 * i;
+        c[0] = (int)floor(r[0] * inv);
+        c[1] = (int)floor(r[1] * inv);
+        c[2] = (int)floor(r[2] * inv);
+        unsigned h = cell_hash(G, c[0], c[1], c[2]);
+        G->next[i] = G->head[h];
+        G->head[h] = i;
+    }
+}
+
+typedef void (*PairFn)(void *ctx, const Grid *G, int i, int j, const double d[3], double d2);
+
+/* Pares (i < j) a distancia < sqrt(r2) mirando las 27 celdas vecinas. Se
+   comprueba la celda exacta de j: dos celdas que comparten cubeta no deben
+   producir el mismo par dos veces. Devuelve los pares visitados. */
+static uint64_t grid_pairs(const Grid *G, double r2, PairFn fn, void *ctx) {
+    uint64_t pairs = 0;
+    for (int i = 0; i < G->n; i++) {
+        if (!G->ok[i]) continue;
+        const int *c = G->cell + 3 * i;
+        const double *ri = G->pos + 3 * i;
+        for (int dx = -1; dx <= 1; dx++)
+            for (int dy = -1; dy <= 1; dy++)
+                for (int dz = -1; dz <= 1; dz++) {
+                    int x = c[0] + dx, y = c[1] + dy, z = c[2] + dz;
+                    for (int j = G->head[cell_hash(G, x, y, z)]; j != -1; j = G->next[j]) {
+                        if (j <= i) continue;
+                        const int *cj = G->cell + 3 * j;
+                        if (cj[0] != x || cj[1] != y || cj[2] != z) continue;
+                        const double *rj = G->pos + 3 * j;
+                        double d[3] = { rj[0] - ri[0], rj[1] - ri[1], rj[2] - ri[2] };
+                        double d2 = dot3(d, d);
+                        if (d2 >= r2) continue;
+                        pairs++;
+                        fn(ctx, G, i, j, d, d2);
+                    }
+                }
+    }
+    return pairs;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Reparto de bloques de pasos entre hilos
+// ═══════════════════════════════════════════════════════════════════════════
+
+typedef struct
+{
+    const Sgp4Sat *S;
+    int n;
+    Sgp4Batch batch;        // mismo catálogo en columnas para grid_build
+    const ConjConfig *cfg;
+    double step, screen_km;
+    int steps, blocks;
+    const unsigned char *active; // [epochs · n] del prefiltro o NULL
+    double epoch_s;
+    int epochs;
+    atomic_int next_block;
+    atomic_int err;
+    pthread_mutex_t mu;
+    void *out;              // ConjResult* o ProxResult* (según el worker)
+} ConjShared;
+
+static int count_steps(const ConjConfig *cfg, double step) {
+    return (int)floor((cfg->t_end - cfg->t_begin) / step + 1e-9) + 1;
+}
+
+static int run_workers(ConjShared *Sh, void *(*worker)(void*), int threads) {
+    atomic_init(&Sh->next_block, 0);
+    atomic_init(&Sh->err, 0);
+    pthread_mutex_init(&Sh->mu, NULL);
+    if (threads < 1) threads = 1;
+    if (threads > Sh->blocks) threads = Sh->blocks;
+    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t) * threads);
+    int started = 1;
+    for (int t = 1; th && t < threads; t++) {
+        if (pthread_create(&th[t], NULL, worker, Sh) != 0) break;
+        started++;
+    }
+    worker(Sh);
+    for (int t = 1; t < started; t++) pthread_join(th[t], NULL);
+    free(th);
+    pthread_mutex_destroy(&Sh->mu);
+    return atomic_load(&Sh->err) ? -1 : 0;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Prefiltro: bandas perigeo/apogeo y geometría de planos
+// ═══════════════════════════════════════════════════════════════════════════
+
+/* Dos objetos solo pueden acercarse a menos de threshold si sus bandas
+   radiales [perigeo, apogeo] (ensanchadas con los periódicos de SGP4) se
+   solapan en threshold: con las bandas ordenadas por su borde inferior los
+   pares que se solapan salen de un barrido, sin mirar los n² pares.
+   Sobre esos pares, el filtro de planos: dos órbitas en planos distintos
+   solo se cruzan cerca de su línea de nodos mutua; si en los dos nodos los
+   radios de ambas difieren (con la deriva J2 de la época como incertidumbre)
+   más que threshold, nunca se acercan. Como nodo y perigeo precesan, este
+   filtro vale por épocas de CONJ_EPOCH_S; el resultado es, por época, qué
+   objetos tienen algún par posible. Los demás no se propagan. */
+
+typedef struct
+{
+    double lo, hi;          // banda radial (km), ensanchada threshold/2 por lado
+    int idx;
+} Band;
+
+typedef struct
+{
+    double h[3], P[3], Q[3]; // normal, dirección del perigeo y a 90° (unitarios)
+    double p, e;            // semilatus rectum (km) y excentricidad en la época
+    double r_lo;            // radio mínimo posible en la época
+    double slope;           // cota de |dr/dν| (km/rad)
+    double dnu;             // deriva del perigeo en el plano (rad)
+    double dh;              // giro posible de la normal (rad)
+    double dr;              // incertidumbre radial: periódicos + arrastre
+    int ok;
+} PlaneGeom;
+
+typedef struct
+{
+    const Band *band;       // ordenadas por lo
+    int nb;
+    double pad_km;
+    double epoch_s;
+    int epochs;
+    unsigned char *active;  // [epochs · n]
+    uint64_t pairs_plane;   // pares que pasan bandas y planos en la primera época
+} Prefilter;
+
+static int cmp_band(const void *x, const void *y) {
+    const Band *a = (const Band*)x, *b = (const Band*)y;
+    if (a->lo != b->lo) return a->lo < b->lo ? -1 : 1;
+    return (a->idx > b->idx) - (a->idx < b->idx);
+}
+
+static double angle_diff(double a, double b) {
+    double d = fmod(fabs(a - b), 2.0 * CONJ_PI);
+    return d > CONJ_PI ? 2.0 * CONJ_PI - d : d;
+}
+
+// Geometría de i en [ta, tb] (s Unix) a partir de los elementos medios
+static void plane_geom(const Sgp4Sat *s, double ta, double tb, PlaneGeom *g) {
+    Sgp4Mean m0, m, m1;
+    double tm = 0.5 * (ta + tb);
+    g->ok = sgp4_mean_elements(s, (ta - s->epoch_unix) / 60.0, &m0) == SGP4_OK
+         && sgp4_mean_elements(s, (tm - s->epoch_unix) / 60.0, &m) == SGP4_OK
+         && sgp4_mean_elements(s, (tb - s->epoch_unix) / 60.0, &m1) == SGP4_OK;
+    if (!g->ok) return;
+    double so = sin(m.node), co = cos(m.node), si = sin(m.incl), ci = cos(m.incl);
+    double sw = sin(m.argp), cw = cos(m.argp);
+    g->h[0] = so * si;  g->h[1] = -co * si;  g->h[2] = ci;
+    g->P[0] = co * cw - so * sw * ci;  g->P[1] = so * cw + co * sw * ci;  g->P[2] = sw * si;
+    g->Q[0] = -co * sw - so * cw * ci; g->Q[1] = -so * sw + co * cw * ci; g->Q[2] = cw * si;
+    g->e = m.ecc;
+    g->p = m.a_km * (1.0 - m.ecc * m.ecc);
+    double pk = fmax(fmax(m0.periodic_km, m.periodic_km), m1.periodic_km);
+    g->r_lo = fmin(m0.a_km * (1.0 - m0.ecc), m1.a_km * (1.0 - m1.ecc)) - pk;
+    double e_hi = fmin(m.ecc + pk / m.a_km, 0.99);
+    g->slope = m.a_km * e_hi * (1.0 + e_hi) / (1.0 - e_hi);
+    double dnode = fmax(angle_diff(m0.node, m.node), angle_diff(m1.node, m.node));
+    g->dnu = fmax(angle_diff(m0.argp, m.argp), angle_diff(m1.argp, m.argp)) + dnode;
+    g->dh = dnode * fabs(si);
+    g->dr = pk + fabs(m0.a_km - m1.a_km) * (1.0 + m.ecc) + m.a_km * fabs(m0.ecc - m1.ecc);
+}
+
+/* 1 si g y o no pueden acercarse a menos de pad en la época. En cada nodo
+   mutuo la diferencia de radios Δ, menos la incertidumbre, acota la
+   distancia: a un ángulo φ del nodo el radio cambia como mucho slope·φ y
+   el punto sale del otro plano R·sin(i_rel)·(2/π)·φ, así que la distancia
+   es >= Δ·k con k = R·s'/(slope_g + slope_o + R·s'), s' = (2/π)·sin(i_rel).
+   Puntos cerca de nodos opuestos distan >= 0.89·R·sin(i_rel). */
+static int planes_separated(const PlaneGeom *g, const PlaneGeom *o, double pad) {
+    if (!g->ok || !o->ok) return 0;
+    double c[3];
+    cross3(g->h, o->h, c);
+    double sn = sqrt(dot3(c, c));
+    double dh = g->dh + o->dh;
+    double s_lo = sn - dh;
+    if (s_lo < CONJ_PLANE_MIN_SIN) return 0;
+    double dn = dh / s_lo;
+    if (dn > CONJ_PLANE_MAX_DN) return 0;
+    double R = fmin(g->r_lo, o->r_lo);
+    if (0.89 * R * s_lo <= pad) return 0;
+
+    double inv = 1.0 / sn;
+    double n[3] = { c[0] * inv, c[1] * inv, c[2] * inv };
+    double cg = dot3(n, g->P) * g->e, co = dot3(n, o->P) * o->e;
+    double unc = g->slope * (g->dnu + dn) + o->slope * (o->dnu + dn) + g->dr + o->dr;
+    double rs = R * s_lo * (2.0 / CONJ_PI);
+    double k = rs / (g->slope + o->slope + rs);
+    for (int side = 1; side >= -1; side -= 2) {
+        double rg = g->p / (1.0 + side * cg), ro = o->p / (1.0 + side * co);
+        double d = (fabs(rg - ro) - unc) * k;
+        if (d <= pad) return 0;
+    }
+    return 1;
+}
+
+static void* prefilter_worker(void *arg) {
+    ConjShared *Sh = (ConjShared*)arg;
+    Prefilter *F = (Prefilter*)Sh->out;
+    PlaneGeom *geo = (PlaneGeom*)malloc(sizeof(PlaneGeom) * Sh->n);
+    if (!geo) {
+        atomic_store(&Sh->err, 1);
+        return NULL;
+    }
+    int e;
+    while (!atomic_load(&Sh->err) && (e = atomic_fetch_add(&Sh->next_block, 1)) < F->epochs) {
+        // La muestra que posee un TCA puede caer un paso fuera de su época
+        double ta = Sh->cfg->t_begin + e * F->epoch_s - Sh->step;
+        double tb = fmin(Sh->cfg->t_begin + (e + 1) * F->epoch_s, Sh->cfg->t_end) + Sh->step;
+        for (int k = 0; k < F->nb; k++) plane_geom(&Sh->S[F->band[k].idx], ta, tb, &geo[k]);
+        // La primera época cuenta todos los pares; en las demás solo importa
+        // la máscara y el par se salta si ya tiene los dos extremos activos
+        unsigned char *act = F->active + (size_t)e * Sh->n;
+        uint64_t surv = 0;
+        for (int a = 0; a < F->nb; a++) {
+            int ia = F->band[a].idx;
+            for (int b = a + 1; b < F->nb && F->band[b].lo <= F->band[a].hi; b++) {
+                int ib = F->band[b].idx;
+                if (e > 0 && act[ia] && act[ib]) continue;
+                if (planes_separated(&geo[a], &geo[b], F->pad_km)) continue;
+                surv++;
+                act[ia] = 1;
+                act[ib] = 1;
+            }
+        }
+        if (e == 0) F->pairs_plane = surv;
+    }
+    free(geo);
+    return NULL;
+}
+
+/* Bandas de todo el intervalo, barrido de solapes y filtro de planos por
+   épocas. Rellena las estadísticas de out y deja en Sh->active la máscara
+   por época (a liberar por el llamador). */
+static int prefilter_run(ConjShared *Sh, ConjResult *out) {
+    const ConjConfig *cfg = Sh->cfg;
+    int n = Sh->n;
+    double t0 = conj_now();
+    Band *band = (Band*)malloc(sizeof(Band) * n);
+    if (!band) return -1;
+    int nb = 0;
+    for (int i = 0; i < n; i++) {
+        const Sgp4Sat *s = &Sh->S[i];
+        Sgp4Mean m0, m1;
+        if (s->error != SGP4_OK
+            || sgp4_mean_elements(s, (cfg->t_begin - Sh->step - s->epoch_unix) / 60.0, &m0) != SGP4_OK
+            || sgp4_mean_elements(s, (cfg->t_end + Sh->step - s->epoch_unix) / 60.0, &m1) != SGP4_OK)
+            continue;
+        double pk = fmax(m0.periodic_km, m1.periodic_km) + 0.5 * cfg->threshold_km;
+        band[nb].lo = fmin(m0.a_km * (1.0 - m0.ecc), m1.a_km * (1.0 - m1.ecc)) - pk;
+        band[nb].hi = fmax(m0.a_km * (1.0 + m0.ecc), m1.a_km * (1.0 + m1.ecc)) + pk;
+        band[nb].idx = i;
+        nb++;
+    }
+    qsort(band, nb, sizeof(Band), cmp_band);
+
+    // Pares con bandas solapadas: por cada banda, las que empiezan antes de su fin
+    uint64_t overlaps = 0;
+    for (int a = 0; a < nb; a++) {
+        int lo = a + 1, hi = nb;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (band[mid].lo <= band[a].hi) lo = mid + 1; else hi = mid;
+        }
+        overlaps += (uint64_t)(lo - a - 1);
+    }
+
+    Prefilter F = { .band = band, .nb = nb, .pad_km = cfg->threshold_km, .epoch_s = CONJ_EPOCH_S };
+    F.epochs = (int)ceil((cfg->t_end - cfg->t_begin) / F.epoch_s);
+    if (F.epochs < 1) F.epochs = 1;
+    F.active = (unsigned char*)calloc((size_t)F.epochs * n, 1);
+    int rc = -1;
+    if (F.active) {
+        ConjShared P = *Sh;
+        P.blocks = F.epochs;
+        P.out = &F;
+        rc = run_workers(&P, prefilter_worker, cfg->threads);
+    }
+    if (rc == 0) {
+        double act = 0.0;
+        for (int e = 0; e < F.epochs; e++) {
+            // Pasos de la época e
+            int k0 = (int)ceil(e * F.epoch_s / Sh->step - 1e-9);
+            int k1 = e + 1 < F.epochs ? (int)ceil((e + 1) * F.epoch_s / Sh->step - 1e-9) : Sh->steps;
+            if (k1 > Sh->steps) k1 = Sh->steps;
+            int cnt = 0;
+            for (int i = 0; i < n; i++) cnt += F.active[(size_t)e * n + i];
+            act += (double)cnt * (k1 > k0 ? k1 - k0 : 0);
+        }
+        out->pairs_total = (uint64_t)nb * (nb - 1) / 2;
+        out->pairs_band = overlaps;
+        out->pairs_plane = F.pairs_plane;
+        out->epochs = F.epochs;
+        out->epoch_s = fmin(F.epoch_s, cfg->t_end - cfg->t_begin);
+        out->active_frac = nb > 0 ? act / ((double)nb * Sh->steps) : 0.0;
+        Sh->active = F.active;
+        Sh->epoch_s = F.epoch_s;
+        Sh->epochs = F.epochs;
+    } else {
+        free(F.active);
+    }
+    free(band);
+    out->prefilter_s = conj_now() - t0;
+    return rc;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Conjunciones
+// ═══════════════════════════════════════════════════════════════════════════
+
+typedef struct
+{
+    const ConjShared *Sh;
+    double t_k;
+    Conjunction *ev;
+    int count, cap;
+    uint64_t refined;
+    int oom;
+} ConjLocal;
+
+/* Newton sobre f(t) = d·w (velocidad radial relativa) con la derivada
+   aproximada |w|² (aceleración relativa despreciable a corta distancia). */
+static int refine_tca(const Sgp4Sat *A, const Sgp4Sat *B, double t, double max_dt, Conjunction *c) {
+    double ra[3], va[3], rb[3], vb[3], d[3], w[3];
+    for (int it = 0; it < 8; it++) {
+        if (sgp4_at(A, t, ra, va) != SGP4_OK || sgp4_at(B, t, rb, vb) != SGP4_OK) return 0;
+        for (int k = 0; k < 3; k++) { d[k] = rb[k] - ra[k]; w[k] = vb[k] - va[k]; }
+        double ww = dot3(w, w);
+        if (ww < 1e-18) break;
+        double dt = -dot3(d, w) / ww;
+        if (dt > max_dt) dt = max_dt;
+        if (dt < -max_dt) dt = -max_dt;
+        if (fabs(dt) < CONJ_TCA_TOL_S) break;
+        t += dt;
+    }
+    c->tca = t;
+    c->miss_km = sqrt(dot3(d, d));
+    c->vrel_kms = sqrt(dot3(w, w));
+    return 1;
+}
+
+static void conj_visit(void *ctx, const Grid *G, int i, int j, const double d[3], double d2) {
+    (void)d2;
+    ConjLocal *L = (ConjLocal*)ctx;
+    const ConjShared *Sh = L->Sh;
+    const double *vi = G->vel + 3 * i, *vj = G->vel + 3 * j;
+    double w[3] = { vj[0] - vi[0], vj[1] - vi[1], vj[2] - vi[2] };
+    double ww = dot3(w, w);
+    if (ww < 1e-18) return;                    // mismo estado (TLE duplicado)
+
+    // Solo la muestra más cercana al TCA lineal lo refina
+    double tau = -dot3(d, w) / ww, half = 0.5 * Sh->step;
+    if (tau <= -half || tau > half) return;
+    double m[3] = { d[0] + tau * w[0], d[1] + tau * w[1], d[2] + tau * w[2] };
+    double lim = Sh->cfg->threshold_km + CONJ_LIN_MARGIN_KM;
+    if (dot3(m, m) > lim * lim) return;
+
+    Conjunction c = { .a = i, .b = j };
+    L->refined++;
+    if (!refine_tca(&Sh->S[i], &Sh->S[j], L->t_k + tau, Sh->step, &c)) return;
+    if (c.miss_km > Sh->cfg->threshold_km) return;
+    if (c.tca < Sh->cfg->t_begin || c.tca > Sh->cfg->t_end) return;
+    if (L->count == L->cap) {
+        int nc = L->cap ? 2 * L->cap : 64;
+        Conjunction *ne = (Conjunction*)realloc(L->ev, sizeof(Conjunction) * nc);
+        if (!ne) { L->oom = 1; return; }
+        L->ev = ne;
+        L->cap = nc;
+    }
+    L->ev[L->count++] = c;
+}
+
+static void* conj_worker(void *arg) {
+    ConjShared *Sh = (ConjShared*)arg;
+    ConjResult *out = (ConjResult*)Sh->out;
+    ConjLocal L = { .Sh = Sh };
+    Grid G;
+    uint64_t cand = 0;
+    if (grid_init(&G, Sh->n) != 0) {
+        atomic_store(&Sh->err, 1);
+        grid_free(&G);
+        return NULL;
+    }
+    double r2 = Sh->screen_km * Sh->screen_km;
+    int b;
+    while (!atomic_load(&Sh->err) && (b = atomic_fetch_add(&Sh->next_block, 1)) < Sh->blocks) {
+        int k1 = (b + 1) * CONJ_BLOCK_STEPS;
+        if (k1 > Sh->steps) k1 = Sh->steps;
+        for (int k = b * CONJ_BLOCK_STEPS; k < k1; k++) {
+            L.t_k = Sh->cfg->t_begin + k * Sh->step;
+            const unsigned char *act = NULL;
+            if (Sh->active) {
+                int e = (int)((k * Sh->step) / Sh->epoch_s);
+                if (e >= Sh->epochs) e = Sh->epochs - 1;
+                act = Sh->active + (size_t)e * Sh->n;
+            }
+            grid_build(&G, &Sh->batch, act, L.t_k, Sh->screen_km);
+            cand += grid_pairs(&G, r2, conj_visit, &L);
+        }
+        if (L.oom) atomic_store(&Sh->err, 1);
+    }
+    grid_free(&G);
+
+    pthread_mutex_lock(&Sh->mu);
+    out->candidates += cand;
+    out->refined += L.refined;
+    if (L.count) {
+        Conjunction *ne = (Conjunction*)realloc(out->items, sizeof(Conjunction) * (out->count + L.count));
+        if (ne) {
+            memcpy(ne + out->count, L.ev, sizeof(Conjunction) * L.count);
+            out->items = ne;
+            out->count += L.count;
+        } else {
+            atomic_store(&Sh->err, 1);
+        }
+    }
+    pthread_mutex_unlock(&Sh->mu);
+    free(L.ev);
+    return NULL;
+}
+
+static int cmp_pair_tca(const void *x, const void *y) {
+    const Conjunction *a = (const Conjunction*)x, *b = (const Conjunction*)y;
+    if (a->a != b->a) return a->a < b->a ? -1 : 1;
+    if (a->b != b->b) return a->b < b->b ? -1 : 1;
+    return (a->tca > b->tca) - (a->tca < b->tca);
+}
+
+static int cmp_tca(const void *x, const void *y) {
+    const Conjunction *a = (const Conjunction*)x, *b = (const Conjunction*)y;
+    if (a->tca != b->tca) return a->tca < b->tca ? -1 : 1;
+    if (a->a != b->a) return a->a < b->a ? -1 : 1;
+    return (a->b > b->b) - (a->b < b->b);
+}
+
+// Cota de velocidad relativa: 2·máx |v| en t (5% de margen por excentricidad)
+static double catalog_vrel_max(const Sgp4Sat *S, int n, double t) {
+    double vmax = 0.0, r[3], v[3];
+    for (int i = 0; i < n; i++) {
+        if (sgp4_at(&S[i], t, r, v) != SGP4_OK) continue;
+        double s = sqrt(dot3(v, v));
+        if (s > vmax) vmax = s;
+    }
+    return 2.1 * vmax;
+}
+
+static int screen_setup(const Sgp4Sat *S, int n, const ConjConfig *cfg, ConjShared *Sh,
+                        int *objects, int *skipped) {
+    if (!S || n <= 0 || !cfg || !(cfg->t_end >= cfg->t_begin) || !(cfg->threshold_km > 0.0)) return -1;
+    memset(Sh, 0, sizeof(*Sh));
+    Sh->S = S;
+    Sh->n = n;
+    Sh->cfg = cfg;
+    Sh->step = cfg->step_s > 0.0 ? cfg->step_s : CONJ_DEFAULT_STEP;
+    Sh->steps = count_steps(cfg, Sh->step);
+    Sh->blocks = (Sh->steps + CONJ_BLOCK_STEPS - 1) / CONJ_BLOCK_STEPS;
+    int bad = 0;
+    for (int i = 0; i < n; i++) bad += S[i].error != SGP4_OK;
+    if (objects) *objects = n - bad;
+    if (skipped) *skipped = bad;
+    return sgp4_batch_init(&Sh->batch, S, n);
+}
+
+int conj_screen(const Sgp4Sat *S, int n, const ConjConfig *cfg, ConjResult *out) {
+    if (!out) return -1;
+    memset(out, 0, sizeof(*out));
+    ConjShared Sh;
+    if (screen_setup(S, n, cfg, &Sh, &out->objects, &out->skipped) != 0) return -1;
+
+    double t0 = conj_now();
+    double vrel = cfg->vrel_max_kms > 0.0 ? cfg->vrel_max_kms : catalog_vrel_max(S, n, cfg->t_begin);
+    Sh.screen_km = cfg->threshold_km + 0.5 * vrel * Sh.step;
+    out->steps = Sh.steps;
+    out->screen_km = Sh.screen_km;
+    if (!cfg->no_prefilter && prefilter_run(&Sh, out) != 0) {
+        sgp4_batch_free(&Sh.batch);
+        return -1;
+    }
+    Sh.out = out;
+    int rc = run_workers(&Sh, conj_worker, cfg->threads);
+    free((void*)Sh.active);
+    sgp4_batch_free(&Sh.batch);
+    if (rc != 0) {
+        conj_result_free(out);
+        return -1;
+    }
+
+    // Un encuentro cerca del borde de dos muestras puede refinarse dos veces
+    qsort(out->items, out->count, sizeof(Conjunction), cmp_pair_tca);
+    int m = 0;
+    for (int k = 0; k < out->count; k++) {
+        Conjunction *c = &out->items[k];
+        if (m > 0) {
+            Conjunction *p = &out->items[m - 1];
+            if (p->a == c->a && p->b == c->b && c->tca - p->tca < Sh.step) {
+                if (c->miss_km < p->miss_km) *p = *c;
+                continue;
+            }
+        }
+        out->items[m++] = *c;
+    }
+    out->count = m;
+    qsort(out->items, out->count, sizeof(Conjunction), cmp_tca);
+    out->elapsed_s = conj_now() - t0;
+    return 0;
+}
+
+void conj_result_free(ConjResult *r) {
+    if (!r) return;
+    free(r->items);
+    r->items = NULL;
+    r->count = 0;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Ventanas de proximidad (ISL)
+// ═══════════════════════════════════════════════════════════════════════════
+
+typedef struct
+{
+    ProxWindow *w;
+    int count, cap;
+} WinVec;
+
+static int winvec_push(WinVec *V, const ProxWindow *x) {
+    if (V->count == V->cap) {
+        int nc = V->cap ? 2 * V->cap : 64;
+        ProxWindow *nw = (ProxWindow*)realloc(V->w, sizeof(ProxWindow) * nc);
+        if (!nw) return -1;
+        V->w = nw;
+        V->cap = nc;
+    }
+    V->w[V->count++] = *x;
+    return 0;
+}
+
+static int cmp_win(const void *x, const void *y) {
+    const ProxWindow *a = (const ProxWindow*)x, *b = (const ProxWindow*)y;
+    if (a->a != b->a) return a->a < b->a ? -1 : 1;
+    if (a->b != b->b) return a->b < b->b ? -1 : 1;
+    return (a->t_start > b->t_start) - (a->t_start < b->t_start);
+}
+
+typedef struct
+{
+    double t_k;
+    WinVec now;             // pares dentro en este instante (t_start = t_end = t_k)
+    int oom;
+} ProxLocal;
+
+static void prox_visit(void *ctx, const Grid *G, int i, int j, const double d[3], double d2) {
+    (void)G; (void)d;
+    ProxLocal *L = (ProxLocal*)ctx;
+    double km = sqrt(d2);
+    ProxWindow w = { .a = i, .b = j, .t_start = L->t_k, .t_end = L->t_k, .min_km = km, .max_km = km };
+    if (winvec_push(&L->now, &w) != 0) L->oom = 1;
+}
+
+/* Cruza las ventanas abiertas (ordenadas por par) con los pares de este
+   instante: las que siguen se alargan, las que faltan se cierran en `done`. */
+static int prox_advance(WinVec *open, WinVec *now, WinVec *next, WinVec *done) {
+    qsort(now->w, now->count, sizeof(ProxWindow), cmp_win);
+    next->count = 0;
+    int a = 0, b = 0;
+    while (a < open->count || b < now->count) {
+        int c = (a == open->count) ? 1 : (b == now->count) ? -1
+              : (open->w[a].a != now->w[b].a) ? (open->w[a].a < now->w[b].a ? -1 : 1)
+              : (open->w[a].b != now->w[b].b) ? (open->w[a].b < now->w[b].b ? -1 : 1) : 0;
+        if (c < 0) {
+            if (winvec_push(done, &open->w[a++]) != 0) return -1;
+        } else if (c > 0) {
+            if (winvec_push(next, &now->w[b++]) != 0) return -1;
+        } else {
+            ProxWindow w = open->w[a++];
+            const ProxWindow *x = &now->w[b++];
+            w.t_end = x->t_end;
+            if (x->min_km < w.min_km) w.min_km = x->min_km;
+            if (x->max_km > w.max_km) w.max_km = x->max_km;
+            if (winvec_push(next, &w) != 0) return -1;
+        }
+    }
+    WinVec tmp = *open;
+    *open = *next;
+    *next = tmp;
+    now->count = 0;
+    return 0;
+}
+
+static void* prox_worker(void *arg) {
+    ConjShared *Sh = (ConjShared*)arg;
+    ProxResult *out = (ProxResult*)Sh->out;
+    ProxLocal L = { 0 };
+    WinVec open = { 0 }, next = { 0 }, done = { 0 };
+    Grid G;
+    if (grid_init(&G, Sh->n) != 0) {
+        atomic_store(&Sh->err, 1);
+        grid_free(&G);
+        return NULL;
+    }
+    double r2 = Sh->screen_km * Sh->screen_km;
+    int b, fail = 0;
+    while (!fail && !atomic_load(&Sh->err) && (b = atomic_fetch_add(&Sh->next_block, 1)) < Sh->blocks) {
+        int k1 = (b + 1) * CONJ_BLOCK_STEPS;
+        if (k1 > Sh->steps) k1 = Sh->steps;
+        for (int k = b * CONJ_BLOCK_STEPS; k < k1 && !fail; k++) {
+            L.t_k = Sh->cfg->t_begin + k * Sh->step;
+            grid_build(&G, &Sh->batch, NULL, L.t_k, Sh->screen_km);
+            grid_pairs(&G, r2, prox_visit, &L);
+            fail = L.oom || prox_advance(&open, &L.now, &next, &done) != 0;
+        }
+        // Fin de bloque: se cierra todo; la fusión final une los tramos contiguos
+        for (int k = 0; !fail && k < open.count; k++) fail = winvec_push(&done, &open.w[k]) != 0;
+        open.count = 0;
+    }
+    grid_free(&G);
+
+    pthread_mutex_lock(&Sh->mu);
+    if (!fail && done.count) {
+        ProxWindow *nw = (ProxWindow*)realloc(out->items, sizeof(ProxWindow) * (out->count + done.count));
+        if (nw) {
+            memcpy(nw + out->count, done.w, sizeof(ProxWindow) * done.count);
+            out->items = nw;
+            out->count += done.count;
+        } else {
+            fail = 1;
+        }
+    }
+    pthread_mutex_unlock(&Sh->mu);
+    if (fail) atomic_store(&Sh->err, 1);
+    free(L.now.w); free(open.w); free(next.w); free(done.w);
+    return NULL;
+}
+
+int conj_proximity(const Sgp4Sat *S, int n, const ConjConfig *cfg, ProxResult *out) {
+    if (!out) return -1;
+    memset(out, 0, sizeof(*out));
+    ConjShared Sh;
+    if (screen_setup(S, n, cfg, &Sh, NULL, NULL) != 0) return -1;
+
+    double t0 = conj_now();
+    Sh.screen_km = cfg->threshold_km;
+    Sh.out = out;
+    out->steps = Sh.steps;
+    int rc = run_workers(&Sh, prox_worker, cfg->threads);
+    sgp4_batch_free(&Sh.batch);
+    if (rc != 0) {
+        prox_result_free(out);
+        return -1;
+    }
+
+    // Une los tramos cortados en los bordes de bloque (separados un paso)
+    qsort(out->items, out->count, sizeof(ProxWindow), cmp_win);
+    int m = 0;
+    for (int k = 0; k < out->count; k++) {
+        const ProxWindow *w = &out->items[k];
+        if (m > 0) {
+            ProxWindow *p = &out->items[m - 1];
+            if (p->a == w->a && p->b == w->b && w->t_start - p->t_end <= 1.5 * Sh.step) {
+                if (w->t_end > p->t_end) p->t_end = w->t_end;
+                if (w->min_km < p->min_km) p->min_km = w->min_km;
+                if (w->max_km > p->max_km) p->max_km = w->max_km;
+                continue;
+            }
+        }
+        out->items[m++] = *w;
+    }
+    out->count = m;
+    out->elapsed_s = conj_now() - t0;
+    return 0;
+}
+
+void prox_result_free(ProxResult *r) {
+    if (!r) return;
+    free(r->items);
+    r->items = NULL;
+    r->count = 0;
+}
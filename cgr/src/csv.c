@@ -1,8 +1,9 @@
-
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <pthread.h>
 #include "csv.h"
 
 static char* trim(char *s){
@@ -13,12 +14,30 @@ static char* trim(char *s){
     return s;
 }
 
+/* Columna opcional p_success tras residual_bytes → *p_fail (0 si falta).
+   -1 si la columna está pero no es un número de [0, 1] seguido de fin de
+   línea: la fila es corrupta, no un contacto fiable. */
+static int parse_p_success(const char *p, double *p_fail){
+    *p_fail = 0.0;
+    while(isspace((unsigned char)*p)) p++;
+    if(!*p) return 0;
+    if(*p++ != ',') return -1;
+    char *e;
+    double ps = strtod(p, &e);
+    if(e == p || !(ps >= 0.0 && ps <= 1.0)) return -1;
+    while(isspace((unsigned char)*e)) e++;
+    if(*e) return -1;
+    *p_fail = 1.0 - ps;
+    return 0;
+}
+
 int load_contacts_csv(const char *path, Contact **out_contacts){
     FILE *f = fopen(path, "r");
     if(!f) return -1;
 
     int cap = 128, n = 0;
     Contact *arr = (Contact*)malloc(sizeof(Contact)*cap);
+    if(!arr){ fclose(f); return -1; }
     char line[1024];
 
     while(fgets(line, sizeof(line), f)){
@@ -26,14 +45,18 @@ int load_contacts_csv(const char *path, Contact **out_contacts){
         if(*p=='#' || *p==0) continue;
 
         Contact c;
-        // id,from,to,t_start,t_end,owlt_s,rate_bps,setup_s,residual_bytes
-        int ok = sscanf(p, " %d , %d , %d , %lf , %lf , %lf , %lf , %lf , %lf ",
-            &c.id, &c.from, &c.to, &c.t_start, &c.t_end, &c.owlt, &c.rate_bps, &c.setup_s, &c.residual_bytes);
-        if(ok != 9) continue; // ignora líneas corruptas
+        int used = 0;
+        // id,from,to,t_start,t_end,owlt_s,rate_bps,setup_s,residual_bytes[,p_success]
+        int ok = sscanf(p, " %d , %d , %d , %lf , %lf , %lf , %lf , %lf , %lf %n",
+            &c.id, &c.from, &c.to, &c.t_start, &c.t_end, &c.owlt, &c.rate_bps, &c.setup_s, &c.residual_bytes,
+            &used);
+        if(ok != 9 || parse_p_success(p + used, &c.p_fail) != 0) continue; // ignora líneas corruptas
 
         if(n >= cap){
             cap *= 2;
-            arr = (Contact*)realloc(arr, sizeof(Contact)*cap);
+            Contact *na = (Contact*)realloc(arr, sizeof(Contact)*cap);
+            if(!na){ free(arr); fclose(f); return -1; }
+            arr = na;
         }
         arr[n++] = c;
     }
@@ -43,3 +66,186 @@ int load_contacts_csv(const char *path, Contact **out_contacts){
     return n;
 }
 
+/* ----------------------- Carga paralela por bloques ----------------------- */
+
+// Misma gramática que el sscanf de arriba, sin copiar la línea
+static int parse_contact_line(const char *p, Contact *c){
+    char *e;
+    long iv[3];
+    double dv[6];
+    for(int k=0;k<3;k++){
+        iv[k] = strtol(p, &e, 10);
+        if(e == p) return 0;
+        p = e;
+        while(*p==' ' || *p=='\t') p++;
+        if(*p++ != ',') return 0;
+    }
+    for(int k=0;k<6;k++){
+        dv[k] = strtod(p, &e);
+        if(e == p) return 0;
+        p = e;
+        if(k < 5){
+            while(*p==' ' || *p=='\t') p++;
+            if(*p++ != ',') return 0;
+        }
+    }
+    if(parse_p_success(p, &c->p_fail) != 0) return 0;
+    c->id = (int)iv[0]; c->from = (int)iv[1]; c->to = (int)iv[2];
+    c->t_start = dv[0]; c->t_end = dv[1]; c->owlt = dv[2];
+    c->rate_bps = dv[3]; c->setup_s = dv[4]; c->residual_bytes = dv[5];
+    return 1;
+}
+
+typedef struct {
+    char *begin, *end;   // bloque [begin, end) alineado a fin de línea
+    Contact *arr;        // contactos parciales del hilo
+    int n, cap;
+    int failed;          // sin memoria: el bloque está incompleto
+} CsvChunk;
+
+static void* parse_chunk(void *arg){
+    CsvChunk *ch = (CsvChunk*)arg;
+    ch->cap = 256; ch->n = 0;
+    ch->arr = (Contact*)malloc(sizeof(Contact)*ch->cap);
+    if(!ch->arr){ ch->failed = 1; return NULL; }
+
+    char *p = ch->begin;
+    while(p < ch->end){
+        char *nl = memchr(p, '\n', (size_t)(ch->end - p));
+        char *eol = nl ? nl : ch->end;
+        *eol = 0;                         // delimitar la línea para strtod
+        while(p < eol && isspace((unsigned char)*p)) p++;
+        Contact c;
+        if(p < eol && *p != '#' && parse_contact_line(p, &c)){
+            if(ch->n >= ch->cap){
+                ch->cap *= 2;
+                Contact *na = (Contact*)realloc(ch->arr, sizeof(Contact)*ch->cap);
+                if(!na){ ch->failed = 1; return NULL; }
+                ch->arr = na;
+            }
+            ch->arr[ch->n++] = c;
+        }
+        p = eol + 1;
+    }
+    return NULL;
+}
+
+int load_contacts_csv_parallel(const char *path, int threads, Contact **out_contacts){
+    if(threads <= 1) return load_contacts_csv(path, out_contacts);
+
+    FILE *f = fopen(path, "rb");
+    if(!f) return -1;
+    if(fseek(f, 0, SEEK_END) != 0){ fclose(f); return -1; }
+    long sz = ftell(f);
+    if(sz < 0 || fseek(f, 0, SEEK_SET) != 0){ fclose(f); return -1; }
+
+    char *buf = (char*)malloc((size_t)sz + 1);
+    if(!buf){ fclose(f); return -1; }
+    size_t got = fread(buf, 1, (size_t)sz, f);
+    fclose(f);
+    buf[got] = 0;
+
+    if((long)got < (long)threads * 4096) threads = 1 + (int)(got / 4096);
+    CsvChunk *ch = (CsvChunk*)calloc(threads, sizeof(CsvChunk));
+    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*threads);
+    if(!ch || !th){ free(buf); free(ch); free(th); return -1; }
+
+    // Cortes en límites de línea
+    char *cur = buf, *end = buf + got;
+    for(int t=0;t<threads;t++){
+        char *cut = (t == threads-1) ? end : buf + (got * (size_t)(t+1)) / threads;
+        if(cut < cur) cut = cur;
+        while(cut < end && *cut != '\n') cut++;
+        ch[t].begin = cur;
+        ch[t].end = cut;
+        cur = (cut < end) ? cut + 1 : end;
+    }
+
+    int spawned = 0;
+    for(int t=1;t<threads;t++){
+        if(pthread_create(&th[t], NULL, parse_chunk, &ch[t]) != 0) break;
+        spawned = t;
+    }
+    parse_chunk(&ch[0]);
+    for(int t=spawned+1;t<threads;t++) parse_chunk(&ch[t]);  // sin hilo: en serie
+    for(int t=1;t<=spawned;t++) pthread_join(th[t], NULL);
+
+    // Concatenar en orden de fichero
+    int n = 0, ok = 1;
+    for(int t=0;t<threads;t++){
+        if(ch[t].failed) ok = 0;
+        n += ch[t].n;
+    }
+    Contact *arr = ok ? (Contact*)malloc(sizeof(Contact)*(n > 0 ? n : 1)) : NULL;
+    if(arr){
+        int w = 0;
+        for(int t=0;t<threads;t++){
+            memcpy(arr + w, ch[t].arr, sizeof(Contact)*ch[t].n);
+            w += ch[t].n;
+        }
+    }
+    for(int t=0;t<threads;t++) free(ch[t].arr);
+    free(ch);
+    free(th);
+    free(buf);
+
+    if(!arr) return -1;
+    *out_contacts = arr;
+    return n;
+}
+
+int load_contacts_csv_text(char *text, size_t len, Contact **out_contacts){
+    if(!text && len) return -1;
+    // Sin '\n' final la última línea se cortaría fuera del texto: se copia
+    char *buf = NULL;
+    if(len && text[len-1] != '\n'){
+        buf = (char*)malloc(len + 1);
+        if(!buf) return -1;
+        memcpy(buf, text, len);
+        buf[len++] = '\n';
+        text = buf;
+    }
+    CsvChunk ch = { .begin = text, .end = text + len };
+    parse_chunk(&ch);
+    free(buf);
+    if(ch.failed){ free(ch.arr); return -1; }
+    *out_contacts = ch.arr;
+    return ch.n;
+}
+
+/* ----------------------- Lectura incremental ----------------------- */
+
+struct CsvReader {
+    FILE *f;
+    char line[1024];
+};
+
+CsvReader* csv_reader_open(const char *path){
+    CsvReader *r = (CsvReader*)calloc(1, sizeof(CsvReader));
+    if(!r) return NULL;
+    r->f = fopen(path, "r");
+    if(!r->f){ free(r); return NULL; }
+    return r;
+}
+
+int csv_reader_next(CsvReader *r, Contact *out, int cap){
+    if(!r || !out) return -1;
+    int n = 0;
+    while(n < cap && fgets(r->line, sizeof(r->line), r->f)){
+        char *p = trim(r->line);
+        if(*p=='#' || *p==0) continue;
+        if(parse_contact_line(p, &out[n])) n++;
+    }
+    return n;
+}
+
+int csv_reader_rewind(CsvReader *r){
+    if(!r) return -1;
+    return fseek(r->f, 0, SEEK_SET);
+}
+
+void csv_reader_close(CsvReader *r){
+    if(!r) return;
+    fclose(r->f);
+    free(r);
+}
@@ -0,0 +1,787 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "ea_matrix.h"
+#include "eta_kernel.h"
+#include "heap.h"
+
+#define EA_MAGIC        "CGEA"
+#define EA_VERSION      1u
+#define EA_HEADER_BYTES 48
+
+static double ea_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Estructura expandida en el tiempo: salidas de cada nodo agrupadas por
+// vecino y, dentro de cada enlace (u, v), ordenadas por t_end
+// ═══════════════════════════════════════════════════════════════════════════
+
+typedef struct
+{
+    int n;              // nodos compactos
+    int M;              // contactos útiles (from != to, ids >= 0)
+    int G;              // enlaces (u, v) distintos
+    int *node_off;      // CSR [n + 1] de enlaces por nodo de salida
+    int *link_off;      // CSR [G + 1] de contactos por enlace
+    int *link_to;       // [G] nodo compacto de llegada
+    double *col;        // t_start | t_end | setup | rate | owlt, M posiciones cada una
+    double *sufmin;     // [M] mínimo t_start desde k hasta el final de su enlace
+    double *residual;   // [M]
+} EaGraph;
+
+typedef struct
+{
+    const Contact *C;
+    int idx;
+} EaSortItem;
+
+static int cmp_from_tend(const void *a, const void *b) {
+    const Contact *x = ((const EaSortItem*)a)->C, *y = ((const EaSortItem*)b)->C;
+    if (x->from != y->from) return (x->from > y->from) - (x->from < y->from);
+    if (x->to != y->to) return (x->to > y->to) - (x->to < y->to);
+    if (x->t_end != y->t_end) return (x->t_end > y->t_end) - (x->t_end < y->t_end);
+    return (((const EaSortItem*)a)->idx > ((const EaSortItem*)b)->idx) -
+           (((const EaSortItem*)a)->idx < ((const EaSortItem*)b)->idx);
+}
+
+static void graph_free(EaGraph *g) {
+    free(g->node_off);
+    free(g->link_off);
+    free(g->link_to);
+    free(g->col);
+    free(g->sufmin);
+    free(g->residual);
+    memset(g, 0, sizeof(*g));
+}
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static int find_node(const int *ids, int n, int node_id) {
+    int lo = 0, hi = n - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (ids[mid] == node_id) return mid;
+        if (ids[mid] < node_id) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+/* Nodos presentes en el plan → ids crecientes sin repetir en *ids (ordenar y
+   compactar: no depende del mayor id) y, por contacto i, la posición de su
+   from y su to en (*ends)[2i], (*ends)[2i + 1] (-1 si el id es negativo) */
+static int collect_nodes(const Contact *C, int N, int **ids, int **ends) {
+    int *id = (int*)malloc(sizeof(int) * 2 * (size_t)N);
+    int *e = (int*)malloc(sizeof(int) * 2 * (size_t)N);
+    if (!id || !e) { free(id); free(e); return -1; }
+    int n = 0;
+    for (int i = 0; i < N; i++) {
+        if (C[i].from < 0 || C[i].to < 0) continue;
+        id[n++] = C[i].from;
+        id[n++] = C[i].to;
+    }
+    if (n == 0) { free(id); free(e); return -1; }
+    qsort(id, n, sizeof(int), cmp_int);
+    int u = 1;
+    for (int k = 1; k < n; k++) if (id[k] != id[u - 1]) id[u++] = id[k];
+    int *shrunk = (int*)realloc(id, sizeof(int) * u);
+    if (shrunk) id = shrunk;
+    for (int i = 0; i < N; i++) {
+        e[2 * i]     = C[i].from < 0 ? -1 : find_node(id, u, C[i].from);
+        e[2 * i + 1] = C[i].to < 0 ? -1 : find_node(id, u, C[i].to);
+    }
+    *ids = id;
+    *ends = e;
+    return u;
+}
+
+static int graph_build(EaGraph *g, const Contact *C, int N, const int *ends, int n) {
+    memset(g, 0, sizeof(*g));
+    EaSortItem *S = (EaSortItem*)malloc(sizeof(EaSortItem) * N);
+    if (!S) return -1;
+    int M = 0;
+    for (int i = 0; i < N; i++) {
+        if (C[i].from < 0 || C[i].to < 0 || C[i].from == C[i].to) continue;
+        S[M].C = &C[i];
+        S[M].idx = i;
+        M++;
+    }
+    qsort(S, M, sizeof(EaSortItem), cmp_from_tend);
+
+    int G = 0;
+    for (int k = 0; k < M; k++)
+        if (k == 0 || S[k].C->from != S[k - 1].C->from || S[k].C->to != S[k - 1].C->to) G++;
+
+    g->n = n;
+    g->M = M;
+    g->G = G;
+    int m1 = M > 0 ? M : 1;
+    g->node_off = (int*)calloc(n + 1, sizeof(int));
+    g->link_off = (int*)malloc(sizeof(int) * (G + 1));
+    g->link_to = (int*)malloc(sizeof(int) * (G > 0 ? G : 1));
+    g->col = (double*)malloc(sizeof(double) * 5 * m1);
+    g->sufmin = (double*)malloc(sizeof(double) * m1);
+    g->residual = (double*)malloc(sizeof(double) * m1);
+    if (!g->node_off || !g->link_off || !g->link_to || !g->col || !g->sufmin || !g->residual) {
+        free(S);
+        graph_free(g);
+        return -1;
+    }
+    int l = -1;
+    for (int k = 0; k < M; k++) {
+        const Contact *c = S[k].C;
+        if (k == 0 || c->from != S[k - 1].C->from || c->to != S[k - 1].C->to) {
+            l++;
+            g->link_off[l] = k;
+            g->link_to[l] = ends[2 * S[k].idx + 1];
+            g->node_off[ends[2 * S[k].idx] + 1]++;
+        }
+        g->col[k]         = c->t_start;
+        g->col[M + k]     = c->t_end;
+        g->col[2 * M + k] = c->setup_s;
+        g->col[3 * M + k] = (c->rate_bps > 1.0) ? c->rate_bps : 1.0;
+        g->col[4 * M + k] = c->owlt;
+        g->residual[k] = c->residual_bytes;
+    }
+    g->link_off[G] = M;
+    for (int v = 0; v < n; v++) g->node_off[v + 1] += g->node_off[v];
+    for (l = 0; l < G; l++) {
+        int a = g->link_off[l], b = g->link_off[l + 1];
+        double mn = DBL_MAX;
+        for (int k = b - 1; k >= a; k--) {
+            if (g->col[k] < mn) mn = g->col[k];
+            g->sufmin[k] = mn;
+        }
+    }
+    free(S);
+    return 0;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Búsqueda por nodo (un hilo)
+// ═══════════════════════════════════════════════════════════════════════════
+
+typedef struct
+{
+    double *lab;        // llegada más temprana por nodo en la búsqueda actual
+    double *prev_seed;  // llegadas del primer salto en el paso anterior
+    double *eta;        // fila de llegadas vigente
+    MinHeap *pq;
+    uint64_t searches, reused, evals;
+} EaWorker;
+
+static void worker_free(EaWorker *w) {
+    free(w->lab);
+    free(w->prev_seed);
+    free(w->eta);
+    heap_free(w->pq);
+}
+
+static int worker_init(EaWorker *w, const EaGraph *g) {
+    memset(w, 0, sizeof(*w));
+    w->lab = (double*)malloc(sizeof(double) * g->n);
+    w->prev_seed = (double*)malloc(sizeof(double) * g->n);
+    w->eta = (double*)malloc(sizeof(double) * g->n);
+    w->pq = heap_new(g->n);
+    if (!w->lab || !w->prev_seed || !w->eta || !w->pq || !w->pq->items) {
+        worker_free(w);
+        return -1;
+    }
+    return 0;
+}
+
+// Primera posición de [a, b) con x[k] >= key (x no decreciente)
+static inline int lower_bound(const double *x, int a, int b, double key) {
+    while (a < b) {
+        int mid = a + (b - a) / 2;
+        if (x[mid] < key) a = mid + 1;
+        else b = mid;
+    }
+    return a;
+}
+
+/* Relaja las salidas de u alcanzado en t_in; empuja las mejoras si push.
+   En cada enlace solo se evalúa la franja útil: desde el primer contacto aún
+   abierto (mismo criterio que CGR_REJ_CLOSED) hasta el primero a partir del
+   cual todos empiezan después de la llegada ya conocida a v (un contacto no
+   entrega antes de su t_start, así que no puede mejorarla). La franja suele
+   tener uno o dos contactos: se evalúan uno a uno sin pasar por eta_bulk. */
+static void relax(EaWorker *w, const EaGraph *g, int u, double t_in, double bytes, int push) {
+    const int M = g->M;
+    const double *tend = g->col + M;
+    const EtaSoA S = { g->col, g->col + M, g->col + 2 * M, g->col + 3 * M, g->col + 4 * M };
+    for (int l = g->node_off[u]; l < g->node_off[u + 1]; l++) {
+        int v = g->link_to[l];
+        int a0 = g->link_off[l], b = g->link_off[l + 1];
+        if (g->sufmin[a0] >= w->lab[v]) continue;
+        b = lower_bound(g->sufmin, a0, b, w->lab[v]);
+        // Cerrado: t_in > t_end + EPS. La búsqueda binaria usa t_end < t_in - EPS,
+        // que puede diferir en el último bit; se ajusta con la condición exacta
+        int a = lower_bound(tend, a0, b, t_in - CGR_EPS_TIME);
+        while (a > a0 && !(t_in > tend[a - 1] + CGR_EPS_TIME)) a--;
+        w->evals += (uint64_t)(b > a ? b - a : 0);
+        for (int k = a; k < b; k++) {
+            double e = eta_soa_one(&S, k, t_in, bytes, 0.0);
+            if (e < w->lab[v] && g->residual[k] + CGR_EPS_BYTES >= bytes) {
+                w->lab[v] = e;
+                if (push) heap_push(w->pq, (Label){.contact_idx = v, .eta = e, .prev_idx = u});
+            }
+        }
+    }
+}
+
+/* Llegadas desde s saliendo en t → w->eta. Primero solo el primer salto: si
+   coincide con el del paso anterior, el resto del Dijkstra sería idéntico y
+   w->eta (el resultado anterior) sigue valiendo. */
+static void search_from(EaWorker *w, const EaGraph *g, int s, double t, double bytes, int have_prev) {
+    int n = g->n;
+    for (int v = 0; v < n; v++) w->lab[v] = DBL_MAX;
+    w->lab[s] = t;
+    relax(w, g, s, t, bytes, 0);
+
+    if (have_prev) {
+        int same = 1;
+        for (int v = 0; v < n && same; v++) same = (v == s) || w->lab[v] == w->prev_seed[v];
+        if (same) {
+            w->eta[s] = t;
+            w->reused++;
+            return;
+        }
+    }
+    memcpy(w->prev_seed, w->lab, sizeof(double) * n);
+    w->searches++;
+
+    w->pq->size = 0;
+    for (int v = 0; v < n; v++)
+        if (v != s && w->lab[v] < DBL_MAX)
+            heap_push(w->pq, (Label){.contact_idx = v, .eta = w->lab[v], .prev_idx = s});
+    while (!heap_empty(w->pq)) {
+        Label cur = heap_pop(w->pq);
+        if (cur.eta > w->lab[cur.contact_idx]) continue;   // obsoleta
+        relax(w, g, cur.contact_idx, cur.eta, bytes, 1);
+    }
+    memcpy(w->eta, w->lab, sizeof(double) * n);
+}
+
+typedef struct
+{
+    const EaGraph *g;
+    const EaConfig *cfg;
+    EaMatrix *out;
+    _Atomic int next_src;
+    _Atomic int err;
+    pthread_mutex_t mu;
+} EaShared;
+
+static void* ea_worker(void *arg) {
+    EaShared *S = (EaShared*)arg;
+    const EaGraph *g = S->g;
+    EaMatrix *m = S->out;
+    int n = g->n;
+    EaWorker w;
+    if (worker_init(&w, g) != 0) {
+        atomic_store(&S->err, 1);
+        return NULL;
+    }
+    for (;;) {
+        int s = atomic_fetch_add_explicit(&S->next_src, 1, memory_order_relaxed);
+        if (s >= n || atomic_load_explicit(&S->err, memory_order_relaxed)) break;
+        for (int k = 0; k < m->steps; k++) {
+            double t = m->t_begin + k * m->step_s;
+            search_from(&w, g, s, t, m->bundle_bytes, k > 0);
+            float *row = m->latency + ((size_t)k * n + s) * n;
+            for (int v = 0; v < n; v++)
+                row[v] = (w.eta[v] < DBL_MAX) ? (float)(w.eta[v] - t) : NAN;
+            row[s] = 0.0f;
+        }
+    }
+    pthread_mutex_lock(&S->mu);
+    m->searches += w.searches;
+    m->reused += w.reused;
+    m->evals += w.evals;
+    pthread_mutex_unlock(&S->mu);
+    worker_free(&w);
+    return NULL;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// API
+// ═══════════════════════════════════════════════════════════════════════════
+
+int ea_node_index(const EaMatrix *m, int node_id) {
+    return find_node(m->node_ids, m->n_nodes, node_id);
+}
+
+int ea_compute(const Contact *C, int N, const EaConfig *cfg, EaMatrix *out) {
+    if (!C || N <= 0 || !cfg || cfg->steps <= 0 || !(cfg->step_s > 0.0) || !out) return -1;
+    memset(out, 0, sizeof(*out));
+
+    int *ends = NULL;
+    int n = collect_nodes(C, N, &out->node_ids, &ends);
+    if (n <= 0) return -1;
+    out->n_nodes = n;
+    out->steps = cfg->steps;
+    out->t_begin = cfg->t_begin;
+    out->step_s = cfg->step_s;
+    out->bundle_bytes = cfg->bundle_bytes;
+
+    EaGraph g;
+    int rc = graph_build(&g, C, N, ends, n);
+    free(ends);
+    out->latency = (float*)malloc(sizeof(float) * (size_t)cfg->steps * n * n);
+    if (rc != 0 || !out->latency) {
+        if (rc == 0) graph_free(&g);
+        ea_matrix_free(out);
+        return -1;
+    }
+
+    EaShared S = { .g = &g, .cfg = cfg, .out = out };
+    atomic_init(&S.next_src, 0);
+    atomic_init(&S.err, 0);
+    pthread_mutex_init(&S.mu, NULL);
+
+    int threads = cfg->threads < 1 ? 1 : cfg->threads;
+    if (threads > n) threads = n;
+    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t) * threads);
+    int started = 1;
+    double t0 = ea_now();
+    for (int t = 1; th && t < threads; t++) {
+        if (pthread_create(&th[t], NULL, ea_worker, &S) != 0) break;
+        started++;
+    }
+    ea_worker(&S);
+    for (int t = 1; t < started; t++) pthread_join(th[t], NULL);
+    out->elapsed_s = ea_now() - t0;
+    free(th);
+    pthread_mutex_destroy(&S.mu);
+    graph_free(&g);
+
+    if (atomic_load(&S.err)) {
+        ea_matrix_free(out);
+        return -1;
+    }
+    return 0;
+}
+
+void ea_matrix_free(EaMatrix *m) {
+    if (!m) return;
+    free(m->node_ids);
+    free(m->latency);
+    memset(m, 0, sizeof(*m));
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Alcanzabilidad bit-paralela
+// ═══════════════════════════════════════════════════════════════════════════
+
+#define RB_WORDS (EA_REACH_BITS / 64)
+
+// Vector GCC/Clang: |, & y ~ se compilan a instrucciones SIMD del ancho disponible
+typedef uint64_t ReachBits __attribute__((vector_size(EA_REACH_BITS / 8)));
+
+// Por puntero: pasar el vector por valor cambia la ABI según -mavx
+static inline int rb_any(const ReachBits *b) {
+    uint64_t acc = 0;
+    for (int w = 0; w < RB_WORDS; w++) acc |= (*b)[w];
+    return acc != 0;
+}
+
+// Contactos útiles ordenados por t_start, en columnas
+typedef struct
+{
+    int n, M;
+    double *col;        // t_start | t_end | setup | rate | owlt
+    double *residual;
+    int *from, *to;     // nodos compactos
+    int *node_off;      // CSR [n + 1]: hueco de contactos abiertos por nodo
+    double max_len;     // t_end - t_start más largo
+} ReachGraph;
+
+static int cmp_tstart(const void *a, const void *b) {
+    const Contact *x = ((const EaSortItem*)a)->C, *y = ((const EaSortItem*)b)->C;
+    if (x->t_start != y->t_start) return (x->t_start > y->t_start) - (x->t_start < y->t_start);
+    return (((const EaSortItem*)a)->idx > ((const EaSortItem*)b)->idx) -
+           (((const EaSortItem*)a)->idx < ((const EaSortItem*)b)->idx);
+}
+
+static void rgraph_free(ReachGraph *g) {
+    free(g->col);
+    free(g->residual);
+    free(g->from);
+    free(g->to);
+    free(g->node_off);
+    memset(g, 0, sizeof(*g));
+}
+
+static int rgraph_build(ReachGraph *g, const Contact *C, int N, const int *ends, int n) {
+    memset(g, 0, sizeof(*g));
+    EaSortItem *S = (EaSortItem*)malloc(sizeof(EaSortItem) * N);
+    if (!S) return -1;
+    int M = 0;
+    for (int i = 0; i < N; i++) {
+        if (C[i].from < 0 || C[i].to < 0 || C[i].from == C[i].to) continue;
+        S[M].C = &C[i];
+        S[M].idx = i;
+        M++;
+    }
+    qsort(S, M, sizeof(EaSortItem), cmp_tstart);
+
+    int m1 = M > 0 ? M : 1;
+    g->n = n;
+    g->M = M;
+    g->col = (double*)malloc(sizeof(double) * 5 * m1);
+    g->residual = (double*)malloc(sizeof(double) * m1);
+    g->from = (int*)malloc(sizeof(int) * m1);
+    g->to = (int*)malloc(sizeof(int) * m1);
+    g->node_off = (int*)calloc(n + 1, sizeof(int));
+    if (!g->col || !g->residual || !g->from || !g->to || !g->node_off) {
+        free(S);
+        rgraph_free(g);
+        return -1;
+    }
+    for (int k = 0; k < M; k++) {
+        const Contact *c = S[k].C;
+        g->col[k]         = c->t_start;
+        g->col[M + k]     = c->t_end;
+        g->col[2 * M + k] = c->setup_s;
+        g->col[3 * M + k] = (c->rate_bps > 1.0) ? c->rate_bps : 1.0;
+        g->col[4 * M + k] = c->owlt;
+        g->residual[k] = c->residual_bytes;
+        g->from[k] = ends[2 * S[k].idx];
+        g->to[k] = ends[2 * S[k].idx + 1];
+        g->node_off[g->from[k] + 1]++;
+        if (c->t_end - c->t_start > g->max_len) g->max_len = c->t_end - c->t_start;
+    }
+    for (int v = 0; v < n; v++) g->node_off[v + 1] += g->node_off[v];
+    free(S);
+    return 0;
+}
+
+typedef struct
+{
+    ReachBits *reach;   // [n] orígenes que ya alcanzaron cada nodo
+    int *open;          // contactos abiertos de cada nodo, en su hueco de node_off
+    int *n_open;        // [n]
+    ReachBits *pool;    // bits en vuelo de cada llegada pendiente
+    int *free_slots;
+    int pool_cap, n_free, pool_used;
+    MinHeap *pq;        // llegadas: contact_idx = nodo, prev_idx = hueco del pool
+    uint64_t events;
+} ReachWorker;
+
+static void rworker_free(ReachWorker *w) {
+    free(w->reach);
+    free(w->open);
+    free(w->n_open);
+    free(w->pool);
+    free(w->free_slots);
+    heap_free(w->pq);
+}
+
+static int rworker_init(ReachWorker *w, const ReachGraph *g) {
+    memset(w, 0, sizeof(*w));
+    // aligned_alloc: el vector exige alineación a su tamaño
+    w->reach = (ReachBits*)aligned_alloc(sizeof(ReachBits), sizeof(ReachBits) * g->n);
+    w->open = (int*)malloc(sizeof(int) * (g->M > 0 ? g->M : 1));
+    w->n_open = (int*)malloc(sizeof(int) * g->n);
+    w->pool_cap = 256;
+    w->pool = (ReachBits*)aligned_alloc(sizeof(ReachBits), sizeof(ReachBits) * w->pool_cap);
+    w->free_slots = (int*)malloc(sizeof(int) * w->pool_cap);
+    w->pq = heap_new(w->pool_cap);
+    if (!w->reach || !w->open || !w->n_open || !w->pool || !w->free_slots || !w->pq || !w->pq->items) {
+        rworker_free(w);
+        return -1;
+    }
+    return 0;
+}
+
+static int pool_get(ReachWorker *w) {
+    if (w->n_free > 0) return w->free_slots[--w->n_free];
+    if (w->pool_used == w->pool_cap) {
+        int ncap = w->pool_cap * 2;
+        ReachBits *np = (ReachBits*)aligned_alloc(sizeof(ReachBits), sizeof(ReachBits) * ncap);
+        int *nf = (int*)malloc(sizeof(int) * ncap);
+        if (!np || !nf) { free(np); free(nf); return -1; }
+        memcpy(np, w->pool, sizeof(ReachBits) * w->pool_used);
+        free(w->pool);
+        free(w->free_slots);
+        w->pool = np;
+        w->free_slots = nf;
+        w->pool_cap = ncap;
+    }
+    return w->pool_used++;
+}
+
+// Programa la llegada de bits a v en t (solo los que v aún no tiene)
+static int schedule(ReachWorker *w, int v, double t, const ReachBits *bits) {
+    ReachBits nb = *bits & ~w->reach[v];
+    if (!rb_any(&nb)) return 0;
+    int slot = pool_get(w);
+    if (slot < 0) return -1;
+    w->pool[slot] = nb;
+    heap_push(w->pq, (Label){.contact_idx = v, .eta = t, .prev_idx = slot});
+    return 0;
+}
+
+/* Una pasada: orígenes [base, base + EA_REACH_BITS) salen en t0. Los bits del
+   resultado quedan en w->reach. */
+static int reach_pass(ReachWorker *w, const ReachGraph *g, int base, double t0, double deadline,
+                      double bytes) {
+    const int M = g->M, n = g->n;
+    const EtaSoA S = { g->col, g->col + M, g->col + 2 * M, g->col + 3 * M, g->col + 4 * M };
+    const ReachBits zero = {0};
+    for (int v = 0; v < n; v++) {
+        w->reach[v] = zero;
+        w->n_open[v] = 0;
+    }
+    w->pq->size = 0;
+    w->n_free = 0;
+    w->pool_used = 0;
+
+    // Primer contacto que puede seguir abierto en t0
+    int k = lower_bound(g->col, 0, M, t0 - g->max_len - 1.0);
+    for (int s = base; s < n && s < base + EA_REACH_BITS; s++) {
+        ReachBits b = zero;
+        b[(s - base) >> 6] = 1ull << ((s - base) & 63);
+        if (schedule(w, s, t0, &b) != 0) return -1;
+    }
+
+    for (;;) {
+        double t_arr = heap_empty(w->pq) ? DBL_MAX : w->pq->items[0].eta;
+        double t_st = (k < M) ? g->col[k] : DBL_MAX;
+        if (t_arr == DBL_MAX && (t_st > deadline || t_st == DBL_MAX)) break;
+
+        if (t_arr <= t_st) {
+            // Llegada (a igual tiempo, antes que los inicios: espera su salida)
+            Label ev = heap_pop(w->pq);
+            int v = ev.contact_idx;
+            ReachBits nb = w->pool[ev.prev_idx] & ~w->reach[v];
+            w->free_slots[w->n_free++] = ev.prev_idx;
+            if (!rb_any(&nb)) continue;
+            w->reach[v] |= nb;
+            w->events++;
+
+            int *open = w->open + g->node_off[v];
+            for (int j = 0; j < w->n_open[v]; ) {
+                int c = open[j];
+                double e = eta_soa_one(&S, c, ev.eta, bytes, 0.0);
+                if (e == DBL_MAX) {
+                    // Inviable ya para esta llegada, y para cualquier otra posterior
+                    open[j] = open[--w->n_open[v]];
+                    continue;
+                }
+                if (e <= deadline && schedule(w, g->to[c], e, &nb) != 0) return -1;
+                j++;
+            }
+        } else {
+            // Inicio del contacto k: salen juntos los orígenes que esperan en su nodo
+            int c = k++, u = g->from[c];
+            if (g->residual[c] + CGR_EPS_BYTES < bytes) continue;
+            double t_in = (t0 > g->col[c]) ? t0 : g->col[c];
+            double e = eta_soa_one(&S, c, t_in, bytes, 0.0);
+            if (e == DBL_MAX) continue;                       // nunca servirá
+            if (e <= deadline && schedule(w, g->to[c], e, &w->reach[u]) != 0) return -1;
+            w->open[g->node_off[u] + w->n_open[u]++] = c;
+        }
+    }
+    return 0;
+}
+
+typedef struct
+{
+    const ReachGraph *g;
+    const EaReachConfig *cfg;
+    EaReach *out;
+    int batches, passes;    // pasadas = salidas x lotes de orígenes
+    _Atomic int next_pass;
+    _Atomic int err;
+    pthread_mutex_t mu;
+} ReachShared;
+
+static void* reach_worker(void *arg) {
+    ReachShared *S = (ReachShared*)arg;
+    const ReachGraph *g = S->g;
+    EaReach *r = S->out;
+    ReachWorker w;
+    if (rworker_init(&w, g) != 0) {
+        atomic_store(&S->err, 1);
+        return NULL;
+    }
+    for (;;) {
+        int p = atomic_fetch_add_explicit(&S->next_pass, 1, memory_order_relaxed);
+        if (p >= S->passes || atomic_load_explicit(&S->err, memory_order_relaxed)) break;
+        int step = p / S->batches, base = (p % S->batches) * EA_REACH_BITS;
+        double t0 = r->t_begin + step * r->step_s;
+        if (reach_pass(&w, g, base, t0, t0 + r->window, r->bundle_bytes) != 0) {
+            atomic_store(&S->err, 1);
+            break;
+        }
+        // Palabras [base/64, base/64 + RB_WORDS) de cada fila: exclusivas de esta pasada
+        uint64_t *rows = r->bits + (size_t)step * g->n * r->words;
+        for (int v = 0; v < g->n; v++)
+            for (int q = 0; q < RB_WORDS && base / 64 + q < r->words; q++)
+                rows[(size_t)v * r->words + base / 64 + q] = w.reach[v][q];
+    }
+    pthread_mutex_lock(&S->mu);
+    r->events += w.events;
+    pthread_mutex_unlock(&S->mu);
+    rworker_free(&w);
+    return NULL;
+}
+
+int ea_reach_compute(const Contact *C, int N, const EaReachConfig *cfg, EaReach *out) {
+    if (!C || N <= 0 || !cfg || !(cfg->window >= 0.0) || (cfg->steps > 1 && !(cfg->step_s > 0.0)) || !out)
+        return -1;
+    memset(out, 0, sizeof(*out));
+
+    int *ends = NULL;
+    int n = collect_nodes(C, N, &out->node_ids, &ends);
+    if (n <= 0) return -1;
+    out->n_nodes = n;
+    out->words = (n + 63) / 64;
+    out->steps = cfg->steps > 0 ? cfg->steps : 1;
+    out->t_begin = cfg->t_begin;
+    out->step_s = cfg->step_s;
+    out->window = cfg->window;
+    out->bundle_bytes = cfg->bundle_bytes;
+
+    ReachGraph g;
+    int rc = rgraph_build(&g, C, N, ends, n);
+    free(ends);
+    out->bits = (uint64_t*)calloc((size_t)out->steps * n * out->words, sizeof(uint64_t));
+    if (rc != 0 || !out->bits) {
+        if (rc == 0) rgraph_free(&g);
+        ea_reach_free(out);
+        return -1;
+    }
+
+    ReachShared S = { .g = &g, .cfg = cfg, .out = out, .batches = (n + EA_REACH_BITS - 1) / EA_REACH_BITS };
+    S.passes = S.batches * out->steps;
+    atomic_init(&S.next_pass, 0);
+    atomic_init(&S.err, 0);
+    pthread_mutex_init(&S.mu, NULL);
+
+    int threads = cfg->threads < 1 ? 1 : cfg->threads;
+    if (threads > S.passes) threads = S.passes;
+    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t) * threads);
+    int started = 1;
+    double t0 = ea_now();
+    for (int t = 1; th && t < threads; t++) {
+        if (pthread_create(&th[t], NULL, reach_worker, &S) != 0) break;
+        started++;
+    }
+    reach_worker(&S);
+    for (int t = 1; t < started; t++) pthread_join(th[t], NULL);
+    out->elapsed_s = ea_now() - t0;
+    free(th);
+    pthread_mutex_destroy(&S.mu);
+    rgraph_free(&g);
+
+    if (atomic_load(&S.err)) {
+        ea_reach_free(out);
+        return -1;
+    }
+    return 0;
+}
+
+void ea_reach_free(EaReach *r) {
+    if (!r) return;
+    free(r->node_ids);
+    free(r->bits);
+    memset(r, 0, sizeof(*r));
+}
+
+int ea_reach_node_index(const EaReach *r, int node_id) {
+    return find_node(r->node_ids, r->n_nodes, node_id);
+}
+
+int ea_reach_count(const EaReach *r, int step, int dst) {
+    const uint64_t *row = r->bits + ((size_t)step * r->n_nodes + dst) * r->words;
+    int c = 0;
+    for (int q = 0; q < r->words; q++) c += __builtin_popcountll(row[q]);
+    return c;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Formato .cgea
+// ═══════════════════════════════════════════════════════════════════════════
+
+static void put_u32(uint8_t *p, uint32_t v) { memcpy(p, &v, 4); }
+static void put_f64(uint8_t *p, double v)   { memcpy(p, &v, 8); }
+static uint32_t get_u32(const uint8_t *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static double   get_f64(const uint8_t *p) { double v; memcpy(&v, p, 8); return v; }
+
+int ea_matrix_write(const char *path, const EaMatrix *m) {
+    if (!path || !m || !m->latency || m->n_nodes <= 0) return -1;
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+
+    uint8_t hdr[EA_HEADER_BYTES] = {0};
+    memcpy(hdr, EA_MAGIC, 4);
+    put_u32(hdr + 4, EA_VERSION);
+    put_u32(hdr + 8, (uint32_t)m->n_nodes);
+    put_u32(hdr + 12, (uint32_t)m->steps);
+    put_f64(hdr + 16, m->t_begin);
+    put_f64(hdr + 24, m->step_s);
+    put_f64(hdr + 32, m->bundle_bytes);
+
+    size_t cells = (size_t)m->steps * m->n_nodes * m->n_nodes;
+    int ok = fwrite(hdr, 1, EA_HEADER_BYTES, f) == EA_HEADER_BYTES &&
+             fwrite(m->node_ids, sizeof(int32_t), m->n_nodes, f) == (size_t)m->n_nodes &&
+             fwrite(m->latency, sizeof(float), cells, f) == cells;
+    ok = (fclose(f) == 0) && ok;
+    return ok ? 0 : -1;
+}
+
+int ea_matrix_read(const char *path, EaMatrix *m) {
+    if (!path || !m) return -1;
+    memset(m, 0, sizeof(*m));
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    uint8_t hdr[EA_HEADER_BYTES];
+    if (fread(hdr, 1, EA_HEADER_BYTES, f) != EA_HEADER_BYTES || memcmp(hdr, EA_MAGIC, 4) != 0 ||
+        get_u32(hdr + 4) != EA_VERSION) {
+        fclose(f);
+        return -1;
+    }
+    m->n_nodes = (int)get_u32(hdr + 8);
+    m->steps = (int)get_u32(hdr + 12);
+    m->t_begin = get_f64(hdr + 16);
+    m->step_s = get_f64(hdr + 24);
+    m->bundle_bytes = get_f64(hdr + 32);
+    // steps·n²·4 bytes tiene que caber en size_t
+    uint64_t n2 = (uint64_t)(uint32_t)m->n_nodes * (uint32_t)m->n_nodes;
+    if (m->n_nodes <= 0 || m->steps <= 0 || n2 > SIZE_MAX / sizeof(float) / (uint64_t)m->steps) {
+        fclose(f);
+        memset(m, 0, sizeof(*m));
+        return -1;
+    }
+
+    size_t cells = (size_t)m->steps * (size_t)n2;
+    m->node_ids = (int*)malloc(sizeof(int) * m->n_nodes);
+    m->latency = (float*)malloc(sizeof(float) * cells);
+    int ok = m->node_ids && m->latency &&
+             fread(m->node_ids, sizeof(int32_t), m->n_nodes, f) == (size_t)m->n_nodes &&
+             fread(m->latency, sizeof(float), cells, f) == cells;
+    fclose(f);
+    // ea_node_index busca en node_ids por bisección: crecientes y sin repetir
+    for (int v = 1; ok && v < m->n_nodes; v++) ok = m->node_ids[v - 1] < m->node_ids[v];
+    if (!ok) {
+        ea_matrix_free(m);
+        return -1;
+    }
+    return 0;
+}
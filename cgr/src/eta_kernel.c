@@ -0,0 +1,178 @@
+#include <float.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "eta_kernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ETA_X86 1
+#include <immintrin.h>
+#endif
+
+typedef int (*EtaBulkFn)(const EtaSoA*, int, double, double, double, double*, int*);
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Escalar (eta_soa_one de eta_kernel.h)
+// ═══════════════════════════════════════════════════════════════════════════
+
+static int eta_bulk_scalar(const EtaSoA *S, int n, double t_in, double bytes, double expiry_abs,
+                           double *eta, int *sel) {
+    int m = 0;
+    for (int k = 0; k < n; k++) {
+        eta[k] = eta_soa_one(S, k, t_in, bytes, expiry_abs);
+        if (eta[k] != DBL_MAX) sel[m++] = k;
+    }
+    return m;
+}
+
+#ifdef ETA_X86
+
+// ═══════════════════════════════════════════════════════════════════════════
+// AVX2: 4 contactos por iteración, cola escalar
+// ═══════════════════════════════════════════════════════════════════════════
+
+__attribute__((target("avx2")))
+static int eta_bulk_avx2(const EtaSoA *S, int n, double t_in, double bytes, double expiry_abs,
+                         double *eta, int *sel) {
+    const __m256d vt = _mm256_set1_pd(t_in), vb = _mm256_set1_pd(bytes);
+    const __m256d veps = _mm256_set1_pd(CGR_EPS_TIME), vepsb = _mm256_set1_pd(CGR_EPS_BYTES);
+    const __m256d vmax = _mm256_set1_pd(DBL_MAX);
+    const int has_exp = expiry_abs > 0.0;
+    const __m256d vexp = _mm256_set1_pd(expiry_abs + CGR_EPS_TIME);
+    int m = 0, k = 0;
+
+    for (; k + 4 <= n; k += 4) {
+        __m256d te = _mm256_loadu_pd(S->t_end + k);
+        __m256d ts = _mm256_loadu_pd(S->t_start + k);
+        __m256d su = _mm256_loadu_pd(S->setup + k);
+        __m256d rt = _mm256_loadu_pd(S->rate + k);
+        __m256d te_eps = _mm256_add_pd(te, veps);
+
+        __m256d ok = _mm256_cmp_pd(vt, te_eps, _CMP_LE_OQ);
+        __m256d start = _mm256_max_pd(ts, vt);                       // t_in < ts ? ts : t_in
+        __m256d window = _mm256_sub_pd(_mm256_sub_pd(te, start), su);
+        ok = _mm256_and_pd(ok, _mm256_cmp_pd(window, veps, _CMP_GT_OQ));
+        __m256d capw = _mm256_add_pd(_mm256_mul_pd(window, rt), vepsb);
+        ok = _mm256_and_pd(ok, _mm256_cmp_pd(capw, vb, _CMP_GE_OQ));
+        __m256d finish = _mm256_add_pd(_mm256_add_pd(start, su), _mm256_div_pd(vb, rt));
+        ok = _mm256_and_pd(ok, _mm256_cmp_pd(finish, te_eps, _CMP_LE_OQ));
+        __m256d e = _mm256_add_pd(finish, _mm256_loadu_pd(S->owlt + k));
+        if (has_exp) ok = _mm256_and_pd(ok, _mm256_cmp_pd(e, vexp, _CMP_LE_OQ));
+
+        _mm256_storeu_pd(eta + k, _mm256_blendv_pd(vmax, e, ok));
+        unsigned bits = (unsigned)_mm256_movemask_pd(ok);
+        while (bits) {
+            sel[m++] = k + __builtin_ctz(bits);
+            bits &= bits - 1;
+        }
+    }
+    for (; k < n; k++) {
+        eta[k] = eta_soa_one(S, k, t_in, bytes, expiry_abs);
+        if (eta[k] != DBL_MAX) sel[m++] = k;
+    }
+    return m;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// AVX-512: 8 contactos por iteración, cola con cargas enmascaradas
+// ═══════════════════════════════════════════════════════════════════════════
+
+__attribute__((target("avx512f")))
+static int eta_bulk_avx512(const EtaSoA *S, int n, double t_in, double bytes, double expiry_abs,
+                           double *eta, int *sel) {
+    const __m512d vt = _mm512_set1_pd(t_in), vb = _mm512_set1_pd(bytes);
+    const __m512d veps = _mm512_set1_pd(CGR_EPS_TIME), vepsb = _mm512_set1_pd(CGR_EPS_BYTES);
+    const __m512d vmax = _mm512_set1_pd(DBL_MAX), vone = _mm512_set1_pd(1.0);
+    const int has_exp = expiry_abs > 0.0;
+    const __m512d vexp = _mm512_set1_pd(expiry_abs + CGR_EPS_TIME);
+    int m = 0;
+
+    for (int k = 0; k < n; k += 8) {
+        __mmask8 lanes = (n - k >= 8) ? (__mmask8)0xFF : (__mmask8)((1u << (n - k)) - 1);
+        __m512d te = _mm512_maskz_loadu_pd(lanes, S->t_end + k);
+        __m512d ts = _mm512_maskz_loadu_pd(lanes, S->t_start + k);
+        __m512d su = _mm512_maskz_loadu_pd(lanes, S->setup + k);
+        __m512d rt = _mm512_mask_loadu_pd(vone, lanes, S->rate + k);   // sin divisiones por 0 en la cola
+        __m512d te_eps = _mm512_add_pd(te, veps);
+
+        __mmask8 ok = _mm512_mask_cmp_pd_mask(lanes, vt, te_eps, _CMP_LE_OQ);
+        __m512d start = _mm512_max_pd(ts, vt);
+        __m512d window = _mm512_sub_pd(_mm512_sub_pd(te, start), su);
+        ok = _mm512_mask_cmp_pd_mask(ok, window, veps, _CMP_GT_OQ);
+        __m512d capw = _mm512_add_pd(_mm512_mul_pd(window, rt), vepsb);
+        ok = _mm512_mask_cmp_pd_mask(ok, capw, vb, _CMP_GE_OQ);
+        __m512d finish = _mm512_add_pd(_mm512_add_pd(start, su), _mm512_div_pd(vb, rt));
+        ok = _mm512_mask_cmp_pd_mask(ok, finish, te_eps, _CMP_LE_OQ);
+        __m512d e = _mm512_add_pd(finish, _mm512_maskz_loadu_pd(lanes, S->owlt + k));
+        if (has_exp) ok = _mm512_mask_cmp_pd_mask(ok, e, vexp, _CMP_LE_OQ);
+
+        _mm512_mask_storeu_pd(eta + k, lanes, _mm512_mask_blend_pd(ok, vmax, e));
+        unsigned bits = ok;
+        while (bits) {
+            sel[m++] = k + __builtin_ctz(bits);
+            bits &= bits - 1;
+        }
+    }
+    return m;
+}
+
+#endif // ETA_X86
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Dispatch
+// ═══════════════════════════════════════════════════════════════════════════
+
+static _Atomic(EtaBulkFn) eta_impl;
+static _Atomic int eta_level;
+static pthread_once_t eta_once = PTHREAD_ONCE_INIT;
+
+CgrSimdLevel cgr_simd_detect(void) {
+#ifdef ETA_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return CGR_SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return CGR_SIMD_AVX2;
+#endif
+    return CGR_SIMD_SCALAR;
+}
+
+static void eta_set(CgrSimdLevel level) {
+    EtaBulkFn fn = eta_bulk_scalar;
+#ifdef ETA_X86
+    if (level == CGR_SIMD_AVX512) fn = eta_bulk_avx512;
+    else if (level == CGR_SIMD_AVX2) fn = eta_bulk_avx2;
+#endif
+    atomic_store(&eta_level, (int)level);
+    atomic_store(&eta_impl, fn);
+}
+
+static void eta_init(void) {
+    eta_set(cgr_simd_detect());
+}
+
+CgrSimdLevel cgr_simd_level(void) {
+    pthread_once(&eta_once, eta_init);
+    return (CgrSimdLevel)atomic_load(&eta_level);
+}
+
+CgrSimdLevel cgr_simd_force(CgrSimdLevel level) {
+    pthread_once(&eta_once, eta_init);
+    CgrSimdLevel best = cgr_simd_detect();
+    if (level > best) level = best;
+    if (level < CGR_SIMD_SCALAR) level = CGR_SIMD_SCALAR;
+    eta_set(level);
+    return level;
+}
+
+const char* cgr_simd_name(CgrSimdLevel level) {
+    switch (level) {
+        case CGR_SIMD_AVX512: return "avx512";
+        case CGR_SIMD_AVX2:   return "avx2";
+        default:              return "scalar";
+    }
+}
+
+int eta_bulk(const EtaSoA *S, int n, double t_in, double bytes, double expiry_abs,
+             double *eta, int *sel) {
+    pthread_once(&eta_once, eta_init);
+    EtaBulkFn fn = atomic_load_explicit(&eta_impl, memory_order_relaxed);
+    return fn(S, n, t_in, bytes, expiry_abs, eta, sel);
+}
@@ -0,0 +1,364 @@
+#include <stdlib.h>
+#include <string.h>
+#include "impact.h"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Mapa id → índice
+// ═══════════════════════════════════════════════════════════════════════════
+
+typedef struct { int id; int idx; } IdPair;
+
+static int cmp_id_pair(const void *a, const void *b) {
+    const IdPair *x = (const IdPair*)a, *y = (const IdPair*)b;
+    if (x->id != y->id) return (x->id < y->id) ? -1 : 1;
+    return (x->idx < y->idx) ? -1 : (x->idx > y->idx);
+}
+
+int impact_contact_index(const ImpactIndex *ix, int contact_id) {
+    if (!ix) return -1;
+    int lo = 0, hi = ix->n_contacts - 1, found = -1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (ix->id_keys[mid] < contact_id) lo = mid + 1;
+        else {
+            if (ix->id_keys[mid] == contact_id) found = mid;
+            hi = mid - 1;
+        }
+    }
+    return found < 0 ? -1 : ix->id_vals[found];
+}
+
+ImpactIndex* impact_new(const Contact *C, int N) {
+    if (!C || N <= 0) return NULL;
+
+    ImpactIndex *ix = (ImpactIndex*)calloc(1, sizeof(ImpactIndex));
+    if (!ix) return NULL;
+
+    ix->n_contacts = N;
+    ix->by_contact = (IndexList*)calloc(N, sizeof(IndexList));
+    ix->id_keys = (int*)malloc(sizeof(int) * N);
+    ix->id_vals = (int*)malloc(sizeof(int) * N);
+    IdPair *pairs = (IdPair*)malloc(sizeof(IdPair) * N);
+    if (!ix->by_contact || !ix->id_keys || !ix->id_vals || !pairs) {
+        free(pairs);
+        impact_free(ix);
+        return NULL;
+    }
+
+    for (int i = 0; i < N; i++) {
+        pairs[i].id = C[i].id;
+        pairs[i].idx = i;
+    }
+    qsort(pairs, N, sizeof(IdPair), cmp_id_pair);
+    for (int i = 0; i < N; i++) {
+        ix->id_keys[i] = pairs[i].id;
+        ix->id_vals[i] = pairs[i].idx;
+    }
+    free(pairs);
+    return ix;
+}
+
+void impact_free(ImpactIndex *ix) {
+    if (!ix) return;
+    for (int h = 0; h < ix->count; h++) {
+        free_route(&ix->routes[h].route);
+        free(ix->routes[h].taken);
+    }
+    free(ix->routes);
+    if (ix->by_contact) {
+        for (int i = 0; i < ix->n_contacts; i++) {
+            free(ix->by_contact[i].idxs);
+        }
+        free(ix->by_contact);
+    }
+    free(ix->id_keys);
+    free(ix->id_vals);
+    free(ix);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Registro de rutas
+// ═══════════════════════════════════════════════════════════════════════════
+
+static int list_push(IndexList *L, int v) {
+    if (L->count >= L->cap) {
+        int ncap = (L->cap == 0 ? 4 : L->cap * 2);
+        int *n = (int*)realloc(L->idxs, sizeof(int) * ncap);
+        if (!n) return -1;
+        L->idxs = n;
+        L->cap = ncap;
+    }
+    L->idxs[L->count++] = v;
+    return 0;
+}
+
+static void list_remove(IndexList *L, int v) {
+    for (int i = 0; i < L->count; i++) {
+        if (L->idxs[i] == v) {
+            L->idxs[i] = L->idxs[--L->count];
+            return;
+        }
+    }
+}
+
+static int copy_route(Route *dst, const Route *src) {
+    *dst = *src;
+    dst->contact_ids = NULL;
+    dst->contact_idxs = NULL;
+    int n = src->hops > 0 ? src->hops : 0;
+    dst->contact_ids = (int*)malloc(sizeof(int) * 2 * (n > 0 ? n : 1));
+    if (!dst->contact_ids) return -1;
+    dst->contact_idxs = dst->contact_ids + n;
+    memcpy(dst->contact_ids, src->contact_ids, sizeof(int) * n);
+    memcpy(dst->contact_idxs, src->contact_idxs, sizeof(int) * n);
+    return 0;
+}
+
+// Índices de la ruta válidos para este plan
+static bool route_indexable(const ImpactIndex *ix, const Route *R) {
+    if (R->hops > 0 && !R->contact_idxs) return false;
+    for (int i = 0; i < R->hops; i++) {
+        if (R->contact_idxs[i] < 0 || R->contact_idxs[i] >= ix->n_contacts) return false;
+    }
+    return true;
+}
+
+static int link_route(ImpactIndex *ix, int h) {
+    const Route *R = &ix->routes[h].route;
+    for (int i = 0; i < R->hops; i++) {
+        if (list_push(&ix->by_contact[R->contact_idxs[i]], h) != 0) {
+            while (--i >= 0) list_remove(&ix->by_contact[R->contact_idxs[i]], h);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void unlink_route(ImpactIndex *ix, int h) {
+    const Route *R = &ix->routes[h].route;
+    for (int i = 0; i < R->hops; i++) {
+        list_remove(&ix->by_contact[R->contact_idxs[i]], h);
+    }
+}
+
+int impact_track(ImpactIndex *ix, int bundle_id, const CgrParams *P, const Route *R) {
+    if (!ix || !P || !R || !R->found || !route_indexable(ix, R)) return -1;
+
+    if (ix->count >= ix->cap) {
+        int ncap = (ix->cap == 0 ? 64 : ix->cap * 2);
+        TrackedRoute *n = (TrackedRoute*)realloc(ix->routes, sizeof(TrackedRoute) * ncap);
+        if (!n) return -1;
+        ix->routes = n;
+        ix->cap = ncap;
+    }
+
+    int h = ix->count;
+    TrackedRoute *T = &ix->routes[h];
+    memset(T, 0, sizeof(*T));
+    if (copy_route(&T->route, R) != 0) return -1;
+    if (link_route(ix, h) != 0) {
+        free_route(&T->route);
+        return -1;
+    }
+    T->bundle_id = bundle_id;
+    T->params = *P;
+    T->active = true;
+    ix->count++;
+    return h;
+}
+
+void impact_track_routes(ImpactIndex *ix, int bundle_id, const CgrParams *P, const Routes *RS) {
+    if (!RS) return;
+    for (int r = 0; r < RS->count; r++) {
+        impact_track(ix, bundle_id, P, &RS->items[r]);
+    }
+}
+
+// Descuenta bytes en cada salto (sin bajar de 0) y anota lo descontado
+static int take_capacity(TrackedRoute *T, Contact *C, double bytes) {
+    const Route *R = &T->route;
+    T->taken = (double*)malloc(sizeof(double) * (R->hops > 0 ? R->hops : 1));
+    if (!T->taken) return -1;
+    for (int i = 0; i < R->hops; i++) {
+        Contact *c = &C[R->contact_idxs[i]];
+        double v = c->residual_bytes - bytes;
+        v = (v > 0.0) ? v : 0.0;
+        T->taken[i] = c->residual_bytes - v;
+        c->residual_bytes = v;
+    }
+    T->committed = true;
+    return 0;
+}
+
+// Devuelve exactamente lo que take_capacity descontó
+static void release_capacity(TrackedRoute *T, Contact *C) {
+    if (!T->committed) return;
+    const Route *R = &T->route;
+    for (int i = 0; i < R->hops; i++) {
+        C[R->contact_idxs[i]].residual_bytes += T->taken[i];
+    }
+    free(T->taken);
+    T->taken = NULL;
+    T->committed = false;
+}
+
+void impact_untrack(ImpactIndex *ix, Contact *C, int handle) {
+    if (!ix || handle < 0 || handle >= ix->count) return;
+    TrackedRoute *T = &ix->routes[handle];
+    if (!T->active) return;
+    if (T->committed) {
+        if (!C) return;   // sin el plan no se puede devolver la capacidad
+        release_capacity(T, C);
+    }
+    unlink_route(ix, handle);
+    free_route(&T->route);
+    T->active = false;
+}
+
+int impact_commit(ImpactIndex *ix, Contact *C, int bundle_id, const CgrParams *P, const Route *R) {
+    if (!ix || !C) return -1;
+    int h = impact_track(ix, bundle_id, P, R);
+    if (h < 0) return -1;
+    if (take_capacity(&ix->routes[h], C, P->bundle_bytes) != 0) {
+        impact_untrack(ix, C, h);
+        return -1;
+    }
+    return h;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Análisis de impacto y recálculo incremental
+// ═══════════════════════════════════════════════════════════════════════════
+
+static int mark_banned(const ImpactIndex *ix, const Contact *C, const NeighborIndex *NI,
+                       const int *failed_ids, int n_failed_ids,
+                       const int *failed_nodes, int n_failed_nodes,
+                       unsigned char *mask) {
+    int N = ix->n_contacts, banned = 0;
+
+    for (int k = 0; k < n_failed_ids; k++) {
+        // Todas las copias con ese id (planes periodizados repiten ids)
+        int lo = 0, hi = N;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (ix->id_keys[mid] < failed_ids[k]) lo = mid + 1; else hi = mid;
+        }
+        for (int j = lo; j < N && ix->id_keys[j] == failed_ids[k]; j++) {
+            if (!mask[ix->id_vals[j]]) { mask[ix->id_vals[j]] = 1; banned++; }
+        }
+    }
+
+    for (int k = 0; k < n_failed_nodes; k++) {
+        int v = failed_nodes[k];
+        if (NI && v >= 0 && v < NI->node_cap && NI->by_to) {
+            const IndexList *Lf = &NI->by_from[v], *Lt = &NI->by_to[v];
+            for (int j = 0; j < Lf->count; j++) {
+                if (!mask[Lf->idxs[j]]) { mask[Lf->idxs[j]] = 1; banned++; }
+            }
+            for (int j = 0; j < Lt->count; j++) {
+                if (!mask[Lt->idxs[j]]) { mask[Lt->idxs[j]] = 1; banned++; }
+            }
+        } else {
+            // Sin by_to: barrido completo
+            for (int i = 0; i < N; i++) {
+                if ((C[i].from == v || C[i].to == v) && !mask[i]) { mask[i] = 1; banned++; }
+            }
+        }
+    }
+    return banned;
+}
+
+static int collect_affected(const ImpactIndex *ix, const unsigned char *mask,
+                            unsigned char *seen, int *out, int cap) {
+    int total = 0;
+    for (int i = 0; i < ix->n_contacts; i++) {
+        if (!mask[i]) continue;
+        const IndexList *L = &ix->by_contact[i];
+        for (int j = 0; j < L->count; j++) {
+            int h = L->idxs[j];
+            if (seen[h]) continue;
+            seen[h] = 1;
+            total++;
+        }
+    }
+    // Handles en orden ascendente (orden de registro = prioridad)
+    int w = 0;
+    for (int h = 0; h < ix->count && w < cap; h++) {
+        if (seen[h]) out[w++] = h;
+    }
+    return total;
+}
+
+int impact_affected(const ImpactIndex *ix, const Contact *C, const NeighborIndex *NI,
+                    const int *failed_ids, int n_failed_ids,
+                    const int *failed_nodes, int n_failed_nodes,
+                    int *out_handles, int cap)
+{
+    if (!ix || !C) return 0;
+    unsigned char *mask = (unsigned char*)calloc(ix->n_contacts, 1);
+    unsigned char *seen = (unsigned char*)calloc(ix->count > 0 ? ix->count : 1, 1);
+    if (!mask || !seen) {
+        free(mask); free(seen);
+        return 0;
+    }
+    mark_banned(ix, C, NI, failed_ids, n_failed_ids, failed_nodes, n_failed_nodes, mask);
+    int total = collect_affected(ix, mask, seen, out_handles, out_handles ? cap : 0);
+    free(mask);
+    free(seen);
+    return total;
+}
+
+ImpactStats impact_reroute(ImpactIndex *ix, Contact *C, int N, const NeighborIndex *NI,
+                           const int *failed_ids, int n_failed_ids,
+                           const int *failed_nodes, int n_failed_nodes)
+{
+    ImpactStats st = {0, 0, 0, 0};
+    if (!ix || !C || N != ix->n_contacts) return st;
+
+    unsigned char *mask = (unsigned char*)calloc(N, 1);
+    unsigned char *seen = (unsigned char*)calloc(ix->count > 0 ? ix->count : 1, 1);
+    int *hs = (int*)malloc(sizeof(int) * (ix->count > 0 ? ix->count : 1));
+    if (!mask || !seen || !hs) {
+        free(mask); free(seen); free(hs);
+        return st;
+    }
+
+    st.banned_contacts = mark_banned(ix, C, NI, failed_ids, n_failed_ids,
+                                     failed_nodes, n_failed_nodes, mask);
+    st.affected = collect_affected(ix, mask, seen, hs, ix->count);
+
+    // 1) Liberar la capacidad de las rutas comprometidas afectadas
+    for (int k = 0; k < st.affected; k++) {
+        TrackedRoute *T = &ix->routes[hs[k]];
+        seen[hs[k]] = T->committed ? 2 : 1;   // 2 = volver a consumir tras recalcular
+        release_capacity(T, C);
+        unlink_route(ix, hs[k]);
+        free_route(&T->route);
+    }
+
+    // 2) Recalcular solo esas rutas con los contactos caídos vetados
+    CgrFilters F;
+    memset(&F, 0, sizeof(F));
+    F.banned_mask = mask;
+
+    for (int k = 0; k < st.affected; k++) {
+        int h = hs[k];
+        TrackedRoute *T = &ix->routes[h];
+        Route r = cgr_best_route_filtered(C, N, &T->params, NI, &F);
+        T->route = r;
+        if (!r.found || link_route(ix, h) != 0) {
+            free_route(&T->route);
+            T->active = false;
+            st.lost++;
+            continue;
+        }
+        // Sin memoria para anotar el consumo la ruta queda seguida pero sin comprometer
+        if (seen[h] == 2) take_capacity(T, C, T->params.bundle_bytes);
+        st.rerouted++;
+    }
+
+    free(mask);
+    free(seen);
+    free(hs);
+    return st;
+}
@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <string.h>
+#include "link_est.h"
+
+#define EFF_MIN 0.05   // eficiencia mínima: acota la ralentización a 19x
+
+static inline uint64_t link_key(int from, int to) {
+    return (((uint64_t)(uint32_t)from << 32) | (uint32_t)to) + 1;
+}
+
+static inline uint32_t key_hash(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    return (uint32_t)k;
+}
+
+LinkTable* link_table_new(int links, double alpha, double quantile) {
+    if (links < 1) links = 1;
+    uint32_t cap = 16;
+    while (cap < (uint32_t)links * 2 && cap < (1u << 30)) cap <<= 1;
+
+    LinkTable *T = (LinkTable*)calloc(1, sizeof(LinkTable));
+    if (!T) return NULL;
+    T->slots = (LinkEst*)calloc(cap, sizeof(LinkEst));
+    if (!T->slots) { free(T); return NULL; }
+    // calloc deja todos los atómicos a 0; la razón de tasa parte de nominal
+    for (uint32_t i = 0; i < cap; i++) atomic_init(&T->slots[i].rate_ratio, 1.0);
+    T->mask = cap - 1;
+    T->alpha = (alpha > 0.0 && alpha <= 1.0) ? alpha : 0.2;
+    T->quantile = quantile > 1.0 ? 1.0 : quantile;
+    return T;
+}
+
+void link_table_free(LinkTable *T) {
+    if (!T) return;
+    free(T->slots);
+    free(T);
+}
+
+int link_find(const LinkTable *T, int from, int to) {
+    uint64_t k = link_key(from, to);
+    for (uint32_t i = key_hash(k) & T->mask, probes = 0; probes <= T->mask; i = (i + 1) & T->mask, probes++) {
+        uint64_t cur = atomic_load_explicit(&T->slots[i].key, memory_order_acquire);
+        if (cur == k) return (int)i;
+        if (cur == 0) return -1;
+    }
+    return -1;
+}
+
+int link_slot(LinkTable *T, int from, int to) {
+    uint64_t k = link_key(from, to);
+    for (uint32_t i = key_hash(k) & T->mask, probes = 0; probes <= T->mask; i = (i + 1) & T->mask, probes++) {
+        uint64_t cur = atomic_load_explicit(&T->slots[i].key, memory_order_acquire);
+        if (cur == k) return (int)i;
+        if (cur != 0) continue;
+        // Hueco libre: reclamarlo (si otro hilo gana, cur pasa a su clave)
+        if (atomic_compare_exchange_strong_explicit(&T->slots[i].key, &cur, k,
+                                                    memory_order_acq_rel, memory_order_acquire)) {
+            atomic_fetch_add_explicit(&T->used, 1, memory_order_relaxed);
+            return (int)i;
+        }
+        if (cur == k) return (int)i;
+    }
+    return -1;
+}
+
+static void ewma_update(_Atomic double *v, double sample, double alpha) {
+    double old = atomic_load_explicit(v, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(v, &old, (1.0 - alpha) * old + alpha * sample,
+                                                  memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+// Percentil q de la ventana (copia local + ordenación por inserción)
+static double window_quantile(const LinkEst *e, double q) {
+    uint32_t n = atomic_load_explicit(&e->wpos, memory_order_relaxed);
+    int m = n < LINK_WINDOW ? (int)n : LINK_WINDOW;
+    if (m == 0) return 0.0;
+
+    float w[LINK_WINDOW];
+    for (int i = 0; i < m; i++) {
+        float x = atomic_load_explicit(&e->win[i], memory_order_relaxed);
+        int j = i;
+        while (j > 0 && w[j - 1] > x) { w[j] = w[j - 1]; j--; }
+        w[j] = x;
+    }
+    int r = (int)(q * (m - 1) + 0.5);
+    return w[r < 0 ? 0 : r];
+}
+
+int link_report(LinkTable *T, const HopReport *r) {
+    if (!T || !r) return -1;
+    int s = link_slot(T, r->from, r->to);
+    if (s < 0) {
+        atomic_fetch_add_explicit(&T->dropped, 1, memory_order_relaxed);
+        return -1;
+    }
+    LinkEst *e = &T->slots[s];
+    double a = T->alpha;
+
+    ewma_update(&e->fail, r->failed ? 1.0 : 0.0, a);
+    if (r->failed) {
+        atomic_fetch_add_explicit(&e->n_fail, 1, memory_order_relaxed);
+    } else {
+        if (r->planned_bps > 0.0 && r->achieved_bps > 0.0)
+            ewma_update(&e->rate_ratio, r->achieved_bps / r->planned_bps, a);
+        double d = r->extra_delay_s > 0.0 ? r->extra_delay_s : 0.0;
+        ewma_update(&e->delay_s, d, a);
+        uint32_t p = atomic_fetch_add_explicit(&e->wpos, 1, memory_order_relaxed);
+        atomic_store_explicit(&e->win[p % LINK_WINDOW], (float)d, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&e->n, 1, memory_order_relaxed);
+
+    // Publicar el coste derivado. Con reintentos geométricos el tiempo de
+    // transmisión esperado es tx / (razón · (1 - p_fallo)).
+    double cd = (T->quantile < 0.0) ? atomic_load_explicit(&e->delay_s, memory_order_relaxed)
+                                    : window_quantile(e, T->quantile);
+    double eff = atomic_load_explicit(&e->rate_ratio, memory_order_relaxed)
+               * (1.0 - atomic_load_explicit(&e->fail, memory_order_relaxed));
+    if (eff > 1.0) eff = 1.0;
+    if (eff < EFF_MIN) eff = EFF_MIN;
+    atomic_store_explicit(&e->cost_delay, cd, memory_order_relaxed);
+    atomic_store_explicit(&e->cost_slow, 1.0 / eff - 1.0, memory_order_relaxed);
+    return s;
+}
+
+int link_stats(const LinkTable *T, int from, int to, LinkStats *out) {
+    int s = T ? link_find(T, from, to) : -1;
+    if (s < 0 || !out) return -1;
+    const LinkEst *e = &T->slots[s];
+    memset(out, 0, sizeof(*out));
+    out->n = atomic_load_explicit(&e->n, memory_order_relaxed);
+    out->n_fail = atomic_load_explicit(&e->n_fail, memory_order_relaxed);
+    out->rate_ratio = atomic_load_explicit(&e->rate_ratio, memory_order_relaxed);
+    out->delay_s = atomic_load_explicit(&e->delay_s, memory_order_relaxed);
+    out->fail = atomic_load_explicit(&e->fail, memory_order_relaxed);
+    out->delay_p50 = window_quantile(e, 0.50);
+    out->delay_p95 = window_quantile(e, 0.95);
+    out->cost_delay = atomic_load_explicit(&e->cost_delay, memory_order_relaxed);
+    out->cost_slow = atomic_load_explicit(&e->cost_slow, memory_order_relaxed);
+    return s;
+}
@@ -7,23 +7,41 @@
 #include <limits.h>
 #include <errno.h>
 #include <ctype.h>
+#include <pthread.h>
 #include "csv.h"
 #include "cgr.h"
+#include "outbuf.h"
+#include "plan_archive.h"
 
-typedef enum { FMT_JSON=0, FMT_TEXT=1 } OutputFmt;
+typedef enum { FMT_JSON=0, FMT_TEXT=1, FMT_NDJSON=2, FMT_BINARY=3 } OutputFmt;
 
 static void usage(const char* prog){
     fprintf(stderr,
     "Usage:\n"
     "  %s --contacts <file> --src <node> --dst <node> --t0 <sec> --bytes <B>\n"
-    "     [--expiry <sec>] [--k <num>] [--k-yen <num>] [--pretty] [--format text|json]\n"
+    "     [--expiry <sec>] [--k <num>] [--k-yen <num>] [--deadline <sec>] [--pretty]\n"
+    "     [--format json|ndjson|binary|text] [--prob maxp|expected [--fail-cost <sec>]] [--stats]\n"
+    "  %s --contacts <file> --queries <file> [--threads N] [--k|--k-yen|--deadline ...]\n"
     "\n"
     "Notas:\n"
     "  --k      : K rutas iterando por CONSUMO de capacidad (heurístico práctico).\n"
     "  --k-yen  : K rutas diversas estilo Yen (SIN consumir capacidad). Si ambos, prioriza --k-yen.\n"
+    "  --deadline: búsqueda inversa: salida más tardía desde src (>= t0) que llega antes de <sec>.\n"
+    "  --prob   : contactos probabilísticos (columna p_success): 'maxp' maximiza la probabilidad\n"
+    "             de entrega antes de --deadline (o t0+expiry); 'expected' minimiza la ETA esperada\n"
+    "             cobrando --fail-cost (por defecto deadline - t0) a un bundle perdido. Con --k N\n"
+    "             elige N rutas (copias) que maximizan la probabilidad conjunta. Añade \"p_delivery\".\n"
     "  --pretty : JSON con identado y saltos de línea.\n"
-    "  --format : 'json' (por defecto) o 'text' para salida legible en consola.\n",
-    prog);
+    "  --format : 'json' (por defecto), 'ndjson' (una línea, ignora --pretty),\n"
+    "             'binary' (registro LE, ver outbuf.h) o 'text' para consola.\n"
+    "  --queries: modo lote; carga el plan una vez y enruta cada consulta del fichero:\n"
+    "             CSV 'src,dst,t0,bytes[,expiry]' o NDJSON {\"src\",\"dst\",\"t0\",\"bytes\",\"expiry\",\"id\"}.\n"
+    "             Salida NDJSON (una línea por consulta, en orden, con \"query\") o binary.\n"
+    "  --threads: hilos para el modo lote (por defecto 1).\n"
+    "  --stats  : contadores de la búsqueda k=1 por stderr (labels, mejoras y contactos\n"
+    "             evaluados por motivo de rechazo).\n"
+    "  --contacts acepta también un archivo columnar .cgrp (ver cgr_pack).\n",
+    prog, prog);
 }
 
 // ✅ FIX: Validación robusta de enteros
@@ -54,79 +72,131 @@ static int parse_double_safe(const char *s, double *out){
 }
 
 /* ----------------------- Helpers de impresión JSON ----------------------- */
+// Se formatea sobre un OutBuf y se vuelca con un solo write al final.
 
-static void print_json_route_compact(const Route *R, double t0){
-    printf("{\"eta\":%.6f,\"latency\":%.6f,\"hops\":%d,\"contacts\":[",
-           R->eta, R->eta - t0, R->hops);
+static void ob_contacts(OutBuf *ob, const Route *R, const char *sep){
     for(int i=0;i<R->hops;i++){
-        printf("%s%d", (i? ",":""), R->contact_ids[i]);
+        if(i) ob_puts(ob, sep);
+        ob_int(ob, R->contact_ids[i]);
     }
-    printf("]}");
 }
 
-static void print_json_route_pretty(const Route *R, double t0, int indent){
-    const char *sp = "                                                                ";
-    int pad = indent < 64 ? indent : 64;
-    printf("%.*s{\n", pad, sp);
-    printf("%.*s  \"eta\": %.6f,\n", pad, sp, R->eta);
-    printf("%.*s  \"latency\": %.6f,\n", pad, sp, R->eta - t0);
-    printf("%.*s  \"hops\": %d,\n", pad, sp, R->hops);
-    printf("%.*s  \"contacts\": [", pad, sp);
-    for(int i=0;i<R->hops;i++){
-        printf("%s%d", (i? ", ": ""), R->contact_ids[i]);
+// Abre el objeto de resultado; en modo lote lleva delante el id de la consulta
+static void json_open(OutBuf *ob, long query){
+    ob_putc(ob, '{');
+    if(query >= 0){
+        ob_puts(ob, "\"query\":");
+        ob_int(ob, query);
+        ob_putc(ob, ',');
     }
-    printf("]\n%.*s}", pad, sp);
 }
 
-static void print_json_single(const Route *R, double t0, int pretty){
+static void ob_indent(OutBuf *ob, int n){
+    for(int i=0;i<n;i++) ob_putc(ob, ' ');
+}
+
+static void print_json_route_pretty(OutBuf *ob, const Route *R, double t0, int indent){
+    int pad = indent < 64 ? indent : 64;
+    ob_indent(ob, pad); ob_puts(ob, "{\n");
+    ob_indent(ob, pad); ob_puts(ob, "  \"eta\": ");      ob_fixed(ob, R->eta, 6);      ob_puts(ob, ",\n");
+    ob_indent(ob, pad); ob_puts(ob, "  \"latency\": ");  ob_fixed(ob, R->eta - t0, 6); ob_puts(ob, ",\n");
+    ob_indent(ob, pad); ob_puts(ob, "  \"hops\": ");     ob_int(ob, R->hops);          ob_puts(ob, ",\n");
+    ob_indent(ob, pad); ob_puts(ob, "  \"contacts\": [");
+    ob_contacts(ob, R, ", ");
+    ob_puts(ob, "]\n");
+    ob_indent(ob, pad); ob_putc(ob, '}');
+}
+
+static void print_json_single(OutBuf *ob, long query, const Route *R, double t0, int pretty){
     if(!R->found){
-        if(pretty) {
-            printf("{\n  \"found\": false\n}\n");
-        } else {
-            printf("{\"found\":false}\n");
-        }
+        if(pretty) ob_puts(ob, "{\n  \"found\": false\n}\n");
+        else { json_open(ob, query); ob_puts(ob, "\"found\":false}\n"); }
+        return;
+    }
+    if(pretty){
+        ob_puts(ob, "{\n  \"found\": true,\n  \"eta\": ");   ob_fixed(ob, R->eta, 6);
+        ob_puts(ob, ",\n  \"latency\": ");                     ob_fixed(ob, R->eta - t0, 6);
+        ob_puts(ob, ",\n  \"hops\": ");                        ob_int(ob, R->hops);
+        ob_puts(ob, ",\n  \"contacts\": [");
+        ob_contacts(ob, R, ", ");
+        ob_puts(ob, "]\n}\n");
+    } else {
+        json_open(ob, query);
+        ob_puts(ob, "\"found\":true,\"eta\":");   ob_fixed(ob, R->eta, 6);
+        ob_puts(ob, ",\"latency\":");              ob_fixed(ob, R->eta - t0, 6);
+        ob_puts(ob, ",\"hops\":");                 ob_int(ob, R->hops);
+        ob_puts(ob, ",\"contacts\":[");
+        ob_contacts(ob, R, ",");
+        ob_puts(ob, "]}\n");
+    }
+}
+
+static void print_json_multi(OutBuf *ob, long query, const Routes *RS, double t0, int pretty){
+    if(RS->count == 0){
+        if(pretty) ob_puts(ob, "{\n  \"found\": false,\n  \"routes\": []\n}\n");
+        else { json_open(ob, query); ob_puts(ob, "\"found\":false,\"routes\":[]}\n"); }
         return;
     }
     if(pretty){
-        printf("{\n  \"found\": true,\n  \"eta\": %.6f,\n  \"latency\": %.6f,\n  \"hops\": %d,\n  \"contacts\": [",
-               R->eta, R->eta - t0, R->hops);
-        for(int i=0;i<R->hops;i++){
-            printf("%s%d", (i? ", ": ""), R->contact_ids[i]);
+        ob_puts(ob, "{\n  \"found\": true,\n  \"routes\": [\n");
+        for(int r=0; r<RS->count; r++){
+            print_json_route_pretty(ob, &RS->items[r], t0, 4);
+            ob_puts(ob, (r+1<RS->count? ",\n": "\n"));
         }
-        printf("]\n}\n");
+        ob_puts(ob, "  ]\n}\n");
     } else {
-        printf("{\"found\":true,\"eta\":%.6f,\"latency\":%.6f,\"hops\":%d,\"contacts\":[",
-               R->eta, R->eta - t0, R->hops);
-        for(int i=0;i<R->hops;i++){
-            printf("%s%d", (i? ",":""), R->contact_ids[i]);
+        json_open(ob, query);
+        ob_puts(ob, "\"found\":true,\"routes\":[");
+        for(int r=0; r<RS->count; r++){
+            if(r) ob_putc(ob, ',');
+            ob_route_json(ob, &RS->items[r], t0, 6);
         }
-        printf("]}\n");
+        ob_puts(ob, "]}\n");
     }
 }
 
-static void print_json_multi(const Routes *RS, double t0, int pretty){
+static void print_json_latest(OutBuf *ob, long query, const Route *R, double ldt, double deadline, int pretty){
+    if(!R->found){
+        if(pretty) ob_puts(ob, "{\n  \"found\": false\n}\n");
+        else { json_open(ob, query); ob_puts(ob, "\"found\":false}\n"); }
+        return;
+    }
+    const char *sep = pretty ? ",\n  " : ",";
+    const char *colon = pretty ? ": " : ":";
+    if(pretty) ob_puts(ob, "{\n  \"found\": true");
+    else { json_open(ob, query); ob_puts(ob, "\"found\":true"); }
+    ob_puts(ob, sep); ob_puts(ob, "\"latest_departure\""); ob_puts(ob, colon); ob_fixed(ob, ldt, 6);
+    ob_puts(ob, sep); ob_puts(ob, "\"deadline\"");         ob_puts(ob, colon); ob_fixed(ob, deadline, 6);
+    ob_puts(ob, sep); ob_puts(ob, "\"eta\"");              ob_puts(ob, colon); ob_fixed(ob, R->eta, 6);
+    ob_puts(ob, sep); ob_puts(ob, "\"slack\"");            ob_puts(ob, colon); ob_fixed(ob, deadline - R->eta, 6);
+    ob_puts(ob, sep); ob_puts(ob, "\"hops\"");             ob_puts(ob, colon); ob_int(ob, R->hops);
+    ob_puts(ob, sep); ob_puts(ob, "\"contacts\"");         ob_puts(ob, colon); ob_putc(ob, '[');
+    ob_contacts(ob, R, pretty ? ", " : ",");
+    ob_puts(ob, pretty ? "]\n}\n" : "]}\n");
+}
+
+static void print_json_prob(OutBuf *ob, const Routes *RS, double t0, double p, int pretty){
     if(RS->count == 0){
-        if(pretty) {
-            printf("{\n  \"found\": false,\n  \"routes\": []\n}\n");
-        } else {
-            printf("{\"found\":false,\"routes\":[]}\n");
-        }
+        if(pretty) ob_puts(ob, "{\n  \"found\": false,\n  \"p_delivery\": 0,\n  \"routes\": []\n}\n");
+        else ob_puts(ob, "{\"found\":false,\"p_delivery\":0,\"routes\":[]}\n");
         return;
     }
     if(pretty){
-        printf("{\n  \"found\": true,\n  \"routes\": [\n");
+        ob_puts(ob, "{\n  \"found\": true,\n  \"p_delivery\": "); ob_fixed(ob, p, 6);
+        ob_puts(ob, ",\n  \"routes\": [\n");
         for(int r=0; r<RS->count; r++){
-            print_json_route_pretty(&RS->items[r], t0, 4);
-            printf("%s\n", (r+1<RS->count? ",": ""));
+            print_json_route_pretty(ob, &RS->items[r], t0, 4);
+            ob_puts(ob, (r+1<RS->count? ",\n": "\n"));
         }
-        printf("  ]\n}\n");
+        ob_puts(ob, "  ]\n}\n");
     } else {
-        printf("{\"found\":true,\"routes\":[");
+        ob_puts(ob, "{\"found\":true,\"p_delivery\":"); ob_fixed(ob, p, 6);
+        ob_puts(ob, ",\"routes\":[");
         for(int r=0; r<RS->count; r++){
-            print_json_route_compact(&RS->items[r], t0);
-            printf("%s", (r+1<RS->count? ",":""));
+            if(r) ob_putc(ob, ',');
+            ob_route_json(ob, &RS->items[r], t0, 6);
         }
-        printf("]}\n");
+        ob_puts(ob, "]}\n");
     }
 }
 
@@ -139,6 +209,23 @@ static void print_text_single(const Route *R, double t0){
     }
     printf("Ruta óptima (k=1)\n");
     printf("• ETA: %.3f s   • Latencia: %.3f s   • Saltos: %d\n", R->eta, R->eta - t0, R->hops);
+    printf("• Válida para salidas hasta %.3f s   • Cuello de botella: %.0f bytes\n", R->valid_until, R->bottleneck_bytes);
+    printf("• Secuencia de contactos: ");
+    for(int i=0;i<R->hops;i++){
+        if(i) printf(" → ");
+        printf("%d", R->contact_ids[i]);
+    }
+    printf("\n");
+}
+
+static void print_text_latest(const Route *R, double ldt, double deadline){
+    if(!R->found){
+        printf("No existe salida que llegue antes de %.3f s.\n", deadline);
+        return;
+    }
+    printf("Salida más tardía (deadline %.3f s)\n", deadline);
+    printf("• Salida: %.3f s   • ETA: %.3f s   • Holgura: %.3f s   • Saltos: %d\n",
+           ldt, R->eta, deadline - R->eta, R->hops);
     printf("• Secuencia de contactos: ");
     for(int i=0;i<R->hops;i++){
         if(i) printf(" → ");
@@ -209,15 +296,262 @@ static void print_text_multi_enhanced(const Routes *RS, double t0, const char *t
     }
 }
 
+/* ----------------------- Modo lote (--queries) ----------------------- */
+
+typedef struct {
+    CgrParams P;
+    long id;            // "id" del NDJSON o número de línea de consulta
+} Query;
+
+// Valor numérico de "key" en una línea JSON plana (sin anidamiento)
+static int json_num(const char *line, const char *key, double *out){
+    char pat[32];
+    snprintf(pat, sizeof(pat), "\"%s\"", key);
+    const char *p = strstr(line, pat);
+    if(!p) return 0;
+    p += strlen(pat);
+    while(isspace((unsigned char)*p)) p++;
+    if(*p++ != ':') return 0;
+    char *e;
+    double v = strtod(p, &e);
+    if(e == p) return 0;
+    *out = v;
+    return 1;
+}
+
+static int parse_query_line(const char *p, long idx, Query *q){
+    double v[5] = {-1, -1, 0, 0, 0};
+    q->id = idx;
+    if(*p == '{'){
+        double id;
+        if(!json_num(p, "src", &v[0]) || !json_num(p, "dst", &v[1]) || !json_num(p, "bytes", &v[3])) return 0;
+        json_num(p, "t0", &v[2]);
+        json_num(p, "expiry", &v[4]);
+        if(json_num(p, "id", &id)) q->id = (long)id;
+    } else {
+        int k = 0;
+        char *e;
+        while(k < 5){
+            v[k] = strtod(p, &e);
+            if(e == p) break;
+            k++;
+            p = e;
+            while(*p==' ' || *p=='\t') p++;
+            if(*p != ',') break;
+            p++;
+        }
+        if(k < 4) return 0;
+    }
+    if(v[0] < 0 || v[1] < 0 || v[2] < 0 || v[3] <= 0 || v[4] < 0) return 0;
+    q->P = (CgrParams){ .src_node=(int)v[0], .dst_node=(int)v[1], .t0=v[2],
+                        .bundle_bytes=v[3], .expiry=v[4] };
+    return 1;
+}
+
+static int load_queries(const char *path, Query **out){
+    FILE *f = fopen(path, "r");
+    if(!f) return -1;
+    int cap = 1024, n = 0;
+    long lineno = 0;
+    Query *Q = (Query*)malloc(sizeof(Query)*cap);
+    char line[1024];
+    while(Q && fgets(line, sizeof(line), f)){
+        lineno++;
+        char *p = line;
+        while(isspace((unsigned char)*p)) p++;
+        if(*p=='#' || *p==0) continue;
+        if(n >= cap){
+            cap *= 2;
+            Query *nq = (Query*)realloc(Q, sizeof(Query)*cap);
+            if(!nq){ free(Q); Q = NULL; break; }
+            Q = nq;
+        }
+        if(parse_query_line(p, n, &Q[n])) n++;
+        else fprintf(stderr, "Aviso: consulta inválida en línea %ld (ignorada)\n", lineno);
+    }
+    fclose(f);
+    if(!Q) return -1;
+    *out = Q;
+    return n;
+}
+
+typedef struct {
+    const Contact *C; int N;
+    const NeighborIndex *NI;
+    const Query *Q; int nq;
+    OutputFmt fmt;
+    int K_consume, K_yen;
+    double deadline;
+
+    int batch;               // consultas por lote
+    int n_batches;
+    OutBuf *bufs;            // lotes terminados pendientes de escribir
+    unsigned char *done;
+    int next_batch;          // siguiente lote a repartir
+    int next_write;          // siguiente lote a escribir (orden de entrada)
+    int found;
+    int err;
+    CgrSearchStats stats;    // suma de los workspaces de todos los hilos
+    pthread_mutex_t mu;
+} BatchCtx;
+
+static int route_query(const BatchCtx *B, const Query *q, OutBuf *ob, CgrWorkspace *ws){
+    int found;
+    if(B->deadline > 0.0){
+        double ldt = 0.0;
+        Route R = cgr_latest_departure(B->C, B->N, &q->P, B->NI, B->deadline, &ldt);
+        if(B->fmt == FMT_BINARY) ob_route_bin(ob, (uint32_t)q->id, &R);
+        else print_json_latest(ob, q->id, &R, ldt, B->deadline, 0);
+        found = R.found;
+        free_route(&R);
+    } else if(B->K_yen > 0 || B->K_consume > 1){
+        Routes RS = (B->K_yen > 0) ? cgr_k_yen(B->C, B->N, &q->P, B->NI, B->K_yen)
+                                   : cgr_k_routes(B->C, B->N, &q->P, B->NI, B->K_consume);
+        if(B->fmt == FMT_BINARY) ob_result_bin(ob, (uint32_t)q->id, &RS);
+        else print_json_multi(ob, q->id, &RS, q->P.t0, 0);
+        found = RS.count > 0;
+        free_routes(&RS);
+    } else {
+        Route R = ws ? cgr_best_route_ws(B->C, B->N, &q->P, B->NI, NULL, ws)
+                     : cgr_best_route(B->C, B->N, &q->P, B->NI);
+        if(B->fmt == FMT_BINARY) ob_route_bin(ob, (uint32_t)q->id, &R);
+        else print_json_single(ob, q->id, &R, q->P.t0, 0);
+        found = R.found;
+        free_route(&R);
+    }
+    return found;
+}
+
+static void* batch_worker(void *arg){
+    BatchCtx *B = (BatchCtx*)arg;
+    CgrWorkspace *ws = cgr_workspace_new(B->N);   // reutilizado por todas las consultas del hilo
+    for(;;){
+        pthread_mutex_lock(&B->mu);
+        int b = B->next_batch++;
+        pthread_mutex_unlock(&B->mu);
+        if(b >= B->n_batches) break;
+
+        OutBuf ob;
+        ob_init(&ob, 1, 0);
+        int lo = b * B->batch;
+        int hi = (lo + B->batch < B->nq) ? lo + B->batch : B->nq;
+        int found = 0;
+        for(int i=lo;i<hi;i++) found += route_query(B, &B->Q[i], &ob, ws);
+
+        // Escribir en orden: el que completa el siguiente lote vuelca todos los consecutivos
+        pthread_mutex_lock(&B->mu);
+        B->bufs[b] = ob;
+        B->done[b] = 1;
+        B->found += found;
+        while(B->next_write < B->n_batches && B->done[B->next_write]){
+            OutBuf *w = &B->bufs[B->next_write];
+            if(ob_flush(w) != 0) B->err = 1;
+            ob_free(w);
+            B->next_write++;
+        }
+        pthread_mutex_unlock(&B->mu);
+    }
+    if(ws){
+        CgrSearchStats st;
+        cgr_workspace_stats(ws, &st);
+        pthread_mutex_lock(&B->mu);
+        cgr_search_stats_add(&B->stats, &st);
+        pthread_mutex_unlock(&B->mu);
+        cgr_workspace_free(ws);
+    }
+    return NULL;
+}
+
+static void print_stats(const CgrSearchStats *st){
+    uint64_t evals = 0;
+    for(int r=0;r<CGR_REJ_COUNT;r++) evals += st->reject[r];
+    fprintf(stderr, "Búsqueda: %llu consultas (%llu con ruta), %llu labels extraídas (%llu obsoletas), %llu mejoras\n",
+            (unsigned long long)st->queries, (unsigned long long)st->found, (unsigned long long)st->pops,
+            (unsigned long long)st->stale, (unsigned long long)st->improved);
+    fprintf(stderr, "Contactos evaluados: %llu", (unsigned long long)(evals + st->bulk_rejects));
+    for(int r=0;r<CGR_REJ_COUNT;r++)
+        fprintf(stderr, "  %s %llu", cgr_reject_name((CgrReject)r), (unsigned long long)st->reject[r]);
+    if(st->bulk_evals)
+        fprintf(stderr, "  (kernel SoA: %llu evaluados, %llu descartados sin motivo)",
+                (unsigned long long)st->bulk_evals, (unsigned long long)st->bulk_rejects);
+    fprintf(stderr, "\n");
+}
+
+static int run_batch(const Contact *C, int N, const NeighborIndex *NI, const char *queries_path,
+                     int threads, OutputFmt fmt, int K_consume, int K_yen, double deadline, int stats){
+    Query *Q = NULL;
+    int nq = load_queries(queries_path, &Q);
+    if(nq < 0){ fprintf(stderr, "Error: no se pudieron leer consultas desde %s\n", queries_path); return 1; }
+
+    BatchCtx B;
+    memset(&B, 0, sizeof(B));
+    B.C = C; B.N = N; B.NI = NI; B.Q = Q; B.nq = nq;
+    B.fmt = fmt; B.K_consume = K_consume; B.K_yen = K_yen; B.deadline = deadline;
+    B.batch = 256;
+    B.n_batches = (nq + B.batch - 1) / B.batch;
+    B.bufs = (OutBuf*)calloc(B.n_batches > 0 ? B.n_batches : 1, sizeof(OutBuf));
+    B.done = (unsigned char*)calloc(B.n_batches > 0 ? B.n_batches : 1, 1);
+    if(!B.bufs || !B.done){
+        free(B.bufs); free(B.done); free(Q);
+        fprintf(stderr, "Error: sin memoria\n");
+        return 1;
+    }
+    pthread_mutex_init(&B.mu, NULL);
+
+    if(threads < 1) threads = 1;
+    if(threads > B.n_batches) threads = B.n_batches > 0 ? B.n_batches : 1;
+    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*threads);
+    int spawned = 0;
+    for(int t=1; th && t<threads; t++){
+        if(pthread_create(&th[t], NULL, batch_worker, &B) != 0) break;
+        spawned = t;
+    }
+    batch_worker(&B);          // el hilo principal también trabaja
+    for(int t=1; t<=spawned; t++) pthread_join(th[t], NULL);
+
+    fprintf(stderr, "%d consultas, %d con ruta (%d hilos)\n", nq, B.found, spawned + 1);
+    if(stats) print_stats(&B.stats);
+    int err = B.err;
+    pthread_mutex_destroy(&B.mu);
+    free(th);
+    free(B.bufs);
+    free(B.done);
+    free(Q);
+    if(err){ fprintf(stderr, "Error: no se pudo escribir la salida\n"); return 1; }
+    return 0;
+}
+
 /* ------------------------------------------------------------------- */
 
+static void emit_multi(OutBuf *ob, OutputFmt fmt, const Routes *RS, double t0, int pretty, const char *title){
+    if(fmt == FMT_TEXT) print_text_multi_enhanced(RS, t0, title);
+    else if(fmt == FMT_BINARY) ob_result_bin(ob, 0, RS);
+    else print_json_multi(ob, -1, RS, t0, pretty);
+}
+
+// Vuelca la salida (un único write) y libera
+static int finish(OutBuf *ob, NeighborIndex *NI, Contact *C){
+    int rc = ob_flush(ob);
+    ob_free(ob);
+    free_neighbor_index(NI);
+    free(C);
+    if(rc != 0){ fprintf(stderr, "Error: no se pudo escribir la salida\n"); return 1; }
+    return 0;
+}
+
 int main(int argc, char **argv){
     const char *contacts_path = NULL;
     CgrParams P = { .src_node=-1, .dst_node=-1, .t0=0.0, .bundle_bytes=0.0, .expiry=0.0 };
     int K_consume = 1;
     int K_yen = 0;
     int pretty = 0;
+    double deadline = 0.0;
     OutputFmt fmt = FMT_JSON;
+    const char *queries_path = NULL;
+    int threads = 1;
+    int prob = 0;
+    int stats = 0;
+    CgrProbCfg pcfg = { .mode=CGR_PROB_MAX_DELIVERY };
 
     // ✅ FIX: Parsing con validación
     for(int i=1;i<argc;i++){
@@ -273,6 +607,43 @@ int main(int argc, char **argv){
             }
             i++;
         }
+        else if(!strcmp(argv[i],"--deadline") && i+1<argc) {
+            if(parse_double_safe(argv[i+1], &deadline) != 0 || deadline <= 0.0){
+                fprintf(stderr, "Error: --deadline debe ser un número >0 (recibido: '%s')\n", argv[i+1]);
+                return 2;
+            }
+            i++;
+        }
+        else if(!strcmp(argv[i],"--queries") && i+1<argc) {
+            queries_path = argv[++i];
+        }
+        else if(!strcmp(argv[i],"--threads") && i+1<argc) {
+            if(parse_int_safe(argv[i+1], &threads) != 0 || threads < 1){
+                fprintf(stderr, "Error: --threads debe ser un entero ≥1 (recibido: '%s')\n", argv[i+1]);
+                return 2;
+            }
+            i++;
+        }
+        else if(!strcmp(argv[i],"--prob") && i+1<argc) {
+            const char *v = argv[++i];
+            prob = 1;
+            if(!strcmp(v,"maxp")) pcfg.mode = CGR_PROB_MAX_DELIVERY;
+            else if(!strcmp(v,"expected")) pcfg.mode = CGR_PROB_MIN_EXPECTED;
+            else {
+                fprintf(stderr, "Error: --prob debe ser maxp|expected (recibido: '%s')\n", v);
+                return 2;
+            }
+        }
+        else if(!strcmp(argv[i],"--fail-cost") && i+1<argc) {
+            if(parse_double_safe(argv[i+1], &pcfg.fail_cost) != 0){
+                fprintf(stderr, "Error: --fail-cost debe ser un número ≥0 (recibido: '%s')\n", argv[i+1]);
+                return 2;
+            }
+            i++;
+        }
+        else if(!strcmp(argv[i],"--stats")) {
+            stats = 1;
+        }
         else if(!strcmp(argv[i],"--pretty")) {
             pretty = 1;
         }
@@ -280,8 +651,10 @@ int main(int argc, char **argv){
             const char *v = argv[++i];
             if(!strcmp(v,"text")) fmt = FMT_TEXT;
             else if(!strcmp(v,"json")) fmt = FMT_JSON;
+            else if(!strcmp(v,"ndjson")) fmt = FMT_NDJSON;
+            else if(!strcmp(v,"binary")) fmt = FMT_BINARY;
             else {
-                fprintf(stderr, "Error: --format debe ser 'text' o 'json' (recibido: '%s')\n", v);
+                fprintf(stderr, "Error: --format debe ser json|ndjson|binary|text (recibido: '%s')\n", v);
                 return 2;
             }
         }
@@ -298,17 +671,25 @@ int main(int argc, char **argv){
         usage(argv[0]); 
         return 2;
     }
-    if(P.src_node < 0){
+    if(queries_path && prob){
+        fprintf(stderr, "Error: --prob no está disponible en modo lote (--queries)\n");
+        return 2;
+    }
+    if(queries_path && fmt == FMT_TEXT){
+        fprintf(stderr, "Error: --queries solo admite --format json|ndjson|binary\n");
+        return 2;
+    }
+    if(!queries_path && P.src_node < 0){
         fprintf(stderr, "Error: falta --src <nodo> o valor inválido\n");
         usage(argv[0]); 
         return 2;
     }
-    if(P.dst_node < 0){
+    if(!queries_path && P.dst_node < 0){
         fprintf(stderr, "Error: falta --dst <nodo> o valor inválido\n");
         usage(argv[0]); 
         return 2;
     }
-    if(P.bundle_bytes <= 0.0){
+    if(!queries_path && P.bundle_bytes <= 0.0){
         fprintf(stderr, "Error: --bytes debe ser > 0 (recibido: %.0f)\n", P.bundle_bytes);
         usage(argv[0]); 
         return 2;
@@ -317,48 +698,103 @@ int main(int argc, char **argv){
     if(K_yen < 0) K_yen = 0;
 
     Contact *C=NULL; 
-    int N = load_contacts_csv(contacts_path, &C);
+    size_t plen = strlen(contacts_path);
+    int N = (plen > 5 && !strcmp(contacts_path + plen - 5, ".cgrp"))
+          ? plan_archive_load(contacts_path, 0.0, -1.0, &C, NULL)
+          : (threads > 1 ? load_contacts_csv_parallel(contacts_path, threads, &C)
+                         : load_contacts_csv(contacts_path, &C));
     if(N<=0){ 
         fprintf(stderr,"Error: no se pudieron cargar contactos desde %s\n", contacts_path); 
         return 1; 
     }
 
-    NeighborIndex *NI = build_neighbor_index(C, N);
+    NeighborIndex *NI = (threads > 1) ? build_neighbor_index_parallel(C, N, 0, threads)
+                                      : build_neighbor_index(C, N);
+
+    if(queries_path){
+        // Muchas consultas sobre el mismo plan: compensa la vista SoA del índice
+        if(NI) neighbor_index_attach_soa(NI, C, N);
+        int rc = run_batch(C, N, NI, queries_path, threads, fmt, K_consume, K_yen, deadline, stats);
+        free_neighbor_index(NI);
+        free(C);
+        return rc;
+    }
+
+    if(fmt == FMT_NDJSON) pretty = 0;
+    OutBuf out;
+    ob_init(&out, 1, 0);
+
+    // Contactos probabilísticos: --deadline es el límite de entrega, no búsqueda inversa
+    if(prob){
+        pcfg.deadline = deadline;
+        double p = 0.0;
+        Routes RS = {0};
+        if(K_consume > 1){
+            RS = cgr_prob_k_routes(C, N, &P, NI, &pcfg, K_consume, &p);
+        } else {
+            Route R = cgr_prob_route(C, N, &P, NI, &pcfg, &p);
+            RS.items = (Route*)malloc(sizeof(Route));
+            if(RS.items && R.found){ RS.items[0] = R; RS.count = RS.cap = 1; }
+            else free_route(&R);
+        }
+        if(fmt == FMT_TEXT){
+            print_text_multi_enhanced(&RS, P.t0, "Rutas por fiabilidad");
+            printf("• Probabilidad de entrega: %.4f\n", p);
+        } else if(fmt == FMT_BINARY) {
+            ob_result_bin(&out, 0, &RS);
+        } else {
+            print_json_prob(&out, &RS, P.t0, p, pretty);
+        }
+        free_routes(&RS);
+        return finish(&out, NI, C);
+    }
+
+    // Búsqueda inversa (salida más tardía)
+    if(deadline > 0.0){
+        double ldt = 0.0;
+        Route R = cgr_latest_departure(C, N, &P, NI, deadline, &ldt);
+        if(fmt == FMT_TEXT) {
+            print_text_latest(&R, ldt, deadline);
+        } else if(fmt == FMT_BINARY) {
+            ob_route_bin(&out, 0, &R);
+        } else {
+            print_json_latest(&out, -1, &R, ldt, deadline, pretty);
+        }
+        free_route(&R);
+        return finish(&out, NI, C);
+    }
 
     // Prioriza --k-yen si se indica
     if(K_yen > 0){
         Routes RS = cgr_k_yen(C, N, &P, NI, K_yen);
-        if(fmt == FMT_JSON) {
-            print_json_multi(&RS, P.t0, pretty);
-        } else {
-            print_text_multi_enhanced(&RS, P.t0, "Rutas K (Yen-lite, sin consumo)");
-        }
+        emit_multi(&out, fmt, &RS, P.t0, pretty, "Rutas K (Yen-lite, sin consumo)");
         free_routes(&RS);
-        free_neighbor_index(NI);
-        free(C);
-        return 0;
+        return finish(&out, NI, C);
     }
 
     // Modo consumo
     if(K_consume == 1){
-        Route R = cgr_best_route(C, N, &P, NI);
-        if(fmt == FMT_JSON) {
-            print_json_single(&R, P.t0, pretty);
-        } else {
+        CgrWorkspace *ws = stats ? cgr_workspace_new(N) : NULL;
+        Route R = ws ? cgr_best_route_ws(C, N, &P, NI, NULL, ws) : cgr_best_route(C, N, &P, NI);
+        if(ws){
+            CgrSearchStats st;
+            cgr_workspace_stats(ws, &st);
+            print_stats(&st);
+            cgr_workspace_free(ws);
+        }
+        if(fmt == FMT_TEXT) {
             print_text_single(&R, P.t0);
+        } else if(fmt == FMT_BINARY) {
+            ob_route_bin(&out, 0, &R);
+        } else {
+            print_json_single(&out, -1, &R, P.t0, pretty);
         }
         free_route(&R);
     } else {
         Routes RS = cgr_k_routes(C, N, &P, NI, K_consume);
-        if(fmt == FMT_JSON) {
-            print_json_multi(&RS, P.t0, pretty);
-        } else {
-            print_text_multi_enhanced(&RS, P.t0, "Rutas K (consumo de capacidad)");
-        }
+        emit_multi(&out, fmt, &RS, P.t0, pretty, "Rutas K (consumo de capacidad)");
         free_routes(&RS);
     }
 
-    free_neighbor_index(NI);
-    free(C);
-    return 0;
+    return finish(&out, NI, C);
 }
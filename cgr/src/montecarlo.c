@@ -0,0 +1,305 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "montecarlo.h"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Generador por ensayo (splitmix64) y muestreo disperso
+// ═══════════════════════════════════════════════════════════════════════════
+
+static inline uint64_t mc_next(uint64_t *s) {
+    uint64_t z = (*s += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniforme en (0, 1)
+static inline double mc_u01(uint64_t *s) {
+    return ((double)(mc_next(s) >> 11) + 0.5) * 0x1p-53;
+}
+
+/* Siguiente índice > i elegido con probabilidad p (lq = log1p(-p)): el hueco
+   entre aciertos de Bernoulli es geométrico, así que se salta directamente
+   sin tirar un dado por contacto. */
+static inline int mc_skip(int i, double lq, uint64_t *s) {
+    double k = floor(log(mc_u01(s)) / lq);
+    if (k >= (double)(INT_MAX - 1) - i) return INT_MAX;
+    return i + 1 + (int)k;
+}
+
+static double mc_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Estado por hilo: copia privada del plan + registro de deshacer
+// ═══════════════════════════════════════════════════════════════════════════
+
+typedef struct
+{
+    int idx;
+    Contact orig;
+} McUndo;
+
+typedef struct
+{
+    const Contact *C;
+    int N;
+    const NeighborIndex *NI;
+    const CgrParams *Q;
+    int nq;
+    const McConfig *cfg;
+    McResult *R;
+    _Atomic int next_trial;
+    _Atomic uint64_t perturbed;
+    _Atomic int err;
+} McShared;
+
+typedef struct
+{
+    Contact *plan;          // copia privada; entre ensayos es idéntica a C
+    unsigned char *mask;    // contactos eliminados en el ensayo actual
+    int *drops;
+    McUndo *undo;
+    int n_drops, n_undo;
+    int cap_drops, cap_undo;
+    CgrWorkspace *ws;
+} McWorker;
+
+static void worker_free(McWorker *w) {
+    free(w->plan);
+    free(w->mask);
+    free(w->drops);
+    free(w->undo);
+    cgr_workspace_free(w->ws);
+}
+
+static int worker_init(McWorker *w, const Contact *C, int N) {
+    memset(w, 0, sizeof(*w));
+    w->plan = (Contact*)malloc(sizeof(Contact) * N);
+    w->mask = (unsigned char*)calloc(N, 1);
+    w->cap_drops = w->cap_undo = 64;
+    w->drops = (int*)malloc(sizeof(int) * w->cap_drops);
+    w->undo = (McUndo*)malloc(sizeof(McUndo) * w->cap_undo);
+    w->ws = cgr_workspace_new(N);
+    if (!w->plan || !w->mask || !w->drops || !w->undo || !w->ws) {
+        worker_free(w);
+        return -1;
+    }
+    memcpy(w->plan, C, sizeof(Contact) * N);
+    return 0;
+}
+
+// Copia en escritura: guarda el original antes de modificar el contacto i
+static Contact* worker_write(McWorker *w, int i) {
+    if (w->n_undo == w->cap_undo) {
+        McUndo *nu = (McUndo*)realloc(w->undo, sizeof(McUndo) * w->cap_undo * 2);
+        if (!nu) return NULL;
+        w->undo = nu;
+        w->cap_undo *= 2;
+    }
+    w->undo[w->n_undo++] = (McUndo){ i, w->plan[i] };
+    return &w->plan[i];
+}
+
+static int worker_drop(McWorker *w, int i) {
+    if (w->n_drops == w->cap_drops) {
+        int *nd = (int*)realloc(w->drops, sizeof(int) * w->cap_drops * 2);
+        if (!nd) return -1;
+        w->drops = nd;
+        w->cap_drops *= 2;
+    }
+    w->drops[w->n_drops++] = i;
+    w->mask[i] = 1;
+    return 0;
+}
+
+// Deja la copia privada como el plan original (en orden inverso: un contacto
+// tocado dos veces vuelve a su primer original)
+static void worker_restore(McWorker *w) {
+    for (int k = w->n_undo - 1; k >= 0; k--) w->plan[w->undo[k].idx] = w->undo[k].orig;
+    for (int k = 0; k < w->n_drops; k++) w->mask[w->drops[k]] = 0;
+    w->n_undo = w->n_drops = 0;
+}
+
+static int perturb(McWorker *w, int N, const McPerturb *pp, uint64_t *rng) {
+    if (pp->p_drop > 0.0) {
+        double lq = log1p(-fmin(pp->p_drop, 1.0));
+        for (int i = mc_skip(-1, lq, rng); i < N; i = mc_skip(i, lq, rng))
+            if (worker_drop(w, i) != 0) return -1;
+    }
+    if (pp->p_jitter > 0.0 && pp->jitter_s > 0.0) {
+        double lq = log1p(-fmin(pp->p_jitter, 1.0));
+        for (int i = mc_skip(-1, lq, rng); i < N; i = mc_skip(i, lq, rng)) {
+            if (w->mask[i]) continue;
+            Contact *c = worker_write(w, i);
+            if (!c) return -1;
+            c->t_start += (2.0 * mc_u01(rng) - 1.0) * pp->jitter_s;
+            c->t_end   += (2.0 * mc_u01(rng) - 1.0) * pp->jitter_s;
+            if (c->t_end < c->t_start) c->t_end = c->t_start;   // ventana vacía: inviable
+        }
+    }
+    if (pp->p_rate > 0.0) {
+        double lq = log1p(-fmin(pp->p_rate, 1.0));
+        for (int i = mc_skip(-1, lq, rng); i < N; i = mc_skip(i, lq, rng)) {
+            if (w->mask[i]) continue;
+            Contact *c = worker_write(w, i);
+            if (!c) return -1;
+            c->rate_bps *= pp->rate_lo + (pp->rate_hi - pp->rate_lo) * mc_u01(rng);
+        }
+    }
+    return 0;
+}
+
+static void* mc_worker(void *arg) {
+    McShared *S = (McShared*)arg;
+    McWorker w;
+    if (worker_init(&w, S->C, S->N) != 0) {
+        atomic_store(&S->err, 1);
+        return NULL;
+    }
+    CgrFilters F = { .banned_mask = w.mask };
+    uint64_t touched = 0;
+
+    for (;;) {
+        int t = atomic_fetch_add_explicit(&S->next_trial, 1, memory_order_relaxed);
+        if (t >= S->cfg->trials || atomic_load_explicit(&S->err, memory_order_relaxed)) break;
+
+        uint64_t rng = S->cfg->seed ^ ((uint64_t)(t + 1) * 0xD1B54A32D192ED03ULL);
+        if (perturb(&w, S->N, &S->cfg->pert, &rng) != 0) {
+            atomic_store(&S->err, 1);
+            worker_restore(&w);
+            break;
+        }
+        touched += (uint64_t)(w.n_drops + w.n_undo);
+
+        float *lat = S->R->latency + (size_t)t * S->nq;
+        for (int q = 0; q < S->nq; q++) {
+            Route r = cgr_best_route_ws(w.plan, S->N, &S->Q[q], S->NI, &F, w.ws);
+            lat[q] = r.found ? (float)(r.eta - S->Q[q].t0) : NAN;
+            free_route(&r);
+        }
+        worker_restore(&w);
+    }
+    atomic_fetch_add_explicit(&S->perturbed, touched, memory_order_relaxed);
+    worker_free(&w);
+    return NULL;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// API
+// ═══════════════════════════════════════════════════════════════════════════
+
+int mc_run(const Contact *C, int N, const NeighborIndex *NI, const CgrParams *Q, int nq,
+           const McConfig *cfg, McResult *out) {
+    if (!C || N <= 0 || !NI || !Q || nq <= 0 || !cfg || cfg->trials <= 0 || !out) return -1;
+    memset(out, 0, sizeof(*out));
+    out->trials = cfg->trials;
+    out->nq = nq;
+    out->latency = (float*)malloc(sizeof(float) * (size_t)cfg->trials * nq);
+    out->base_latency = (double*)malloc(sizeof(double) * nq);
+    out->delivered = (uint32_t*)calloc(nq, sizeof(uint32_t));
+    CgrWorkspace *ws = cgr_workspace_new(N);
+    if (!out->latency || !out->base_latency || !out->delivered || !ws) {
+        cgr_workspace_free(ws);
+        mc_result_free(out);
+        return -1;
+    }
+
+    // Referencia: el plan sin perturbar
+    for (int q = 0; q < nq; q++) {
+        Route r = cgr_best_route_ws(C, N, &Q[q], NI, NULL, ws);
+        out->base_latency[q] = r.found ? r.eta - Q[q].t0 : NAN;
+        free_route(&r);
+    }
+    cgr_workspace_free(ws);
+
+    McShared S = { .C = C, .N = N, .NI = NI, .Q = Q, .nq = nq, .cfg = cfg, .R = out };
+    atomic_init(&S.next_trial, 0);
+    atomic_init(&S.perturbed, 0);
+    atomic_init(&S.err, 0);
+
+    int threads = cfg->threads < 1 ? 1 : cfg->threads;
+    if (threads > cfg->trials) threads = cfg->trials;
+    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t) * threads);
+    int started = 1;
+    double t0 = mc_now();
+    for (int t = 1; th && t < threads; t++) {
+        if (pthread_create(&th[t], NULL, mc_worker, &S) != 0) break;
+        started++;
+    }
+    mc_worker(&S);
+    for (int t = 1; t < started; t++) pthread_join(th[t], NULL);
+    out->elapsed_s = mc_now() - t0;
+    free(th);
+
+    if (atomic_load(&S.err)) {
+        mc_result_free(out);
+        return -1;
+    }
+    out->perturbed = atomic_load(&S.perturbed);
+    for (int t = 0; t < cfg->trials; t++) {
+        const float *lat = out->latency + (size_t)t * nq;
+        for (int q = 0; q < nq; q++) out->delivered[q] += !isnan(lat[q]);
+    }
+    return 0;
+}
+
+void mc_result_free(McResult *r) {
+    if (!r) return;
+    free(r->latency);
+    free(r->base_latency);
+    free(r->delivered);
+    memset(r, 0, sizeof(*r));
+}
+
+static int cmp_float(const void *a, const void *b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+static double mc_pct(const float *sorted, int n, double p) {
+    int k = (int)ceil(p / 100.0 * n) - 1;
+    if (k < 0) k = 0;
+    if (k >= n) k = n - 1;
+    return sorted[k];
+}
+
+int mc_summary(const McResult *r, int q, McSummary *s) {
+    if (!r || !s || !r->latency || q >= r->nq) return -1;
+    memset(s, 0, sizeof(*s));
+    int q0 = q < 0 ? 0 : q, q1 = q < 0 ? r->nq : q + 1;
+    size_t total = (size_t)r->trials * (q1 - q0);
+    float *v = (float*)malloc(sizeof(float) * (total > 0 ? total : 1));
+    if (!v) return -1;
+
+    int n = 0;
+    double sum = 0.0;
+    for (int t = 0; t < r->trials; t++) {
+        const float *lat = r->latency + (size_t)t * r->nq;
+        for (int k = q0; k < q1; k++) {
+            if (isnan(lat[k])) continue;
+            v[n++] = lat[k];
+            sum += lat[k];
+        }
+    }
+    s->n = n;
+    s->delivery = total > 0 ? (double)n / (double)total : 0.0;
+    if (n > 0) {
+        qsort(v, n, sizeof(float), cmp_float);
+        s->mean = sum / n;
+        s->p50 = mc_pct(v, n, 50);
+        s->p90 = mc_pct(v, n, 90);
+        s->p99 = mc_pct(v, n, 99);
+        s->max = v[n - 1];
+    }
+    free(v);
+    return 0;
+}
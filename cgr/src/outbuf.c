@@ -0,0 +1,231 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include "outbuf.h"
+
+static const double P10D[10] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+static const unsigned long long P10U[10] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL,
+                                            1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL};
+
+static const char DIGITS2[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+void ob_init(OutBuf *ob, int fd, size_t flush_at) {
+    memset(ob, 0, sizeof(*ob));
+    ob->fd = fd;
+    ob->flush_at = flush_at;
+}
+
+void ob_free(OutBuf *ob) {
+    if (!ob) return;
+    free(ob->buf);
+    ob->buf = NULL;
+    ob->len = ob->cap = 0;
+}
+
+void ob_reset(OutBuf *ob) { ob->len = 0; }
+
+int ob_flush(OutBuf *ob) {
+    if (ob->fd < 0 || ob->len == 0) {
+        if (ob->fd >= 0) ob->len = 0;
+        return ob->err ? -1 : 0;
+    }
+    size_t off = 0;
+    while (off < ob->len) {
+        ssize_t w = write(ob->fd, ob->buf + off, ob->len - off);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            ob->err = 1;
+            break;
+        }
+        off += (size_t)w;
+    }
+    ob->len = 0;
+    return ob->err ? -1 : 0;
+}
+
+void ob_end_record(OutBuf *ob) {
+    if (ob->flush_at > 0 && ob->len >= ob->flush_at) ob_flush(ob);
+}
+
+// Garantiza `n` bytes libres; devuelve el puntero de escritura o NULL
+static char* ob_reserve(OutBuf *ob, size_t n) {
+    if (ob->len + n > ob->cap) {
+        size_t ncap = ob->cap ? ob->cap * 2 : 64 * 1024;
+        while (ncap < ob->len + n) ncap *= 2;
+        char *nb = (char*)realloc(ob->buf, ncap);
+        if (!nb) { ob->err = 1; return NULL; }
+        ob->buf = nb;
+        ob->cap = ncap;
+    }
+    return ob->buf + ob->len;
+}
+
+void ob_write(OutBuf *ob, const void *p, size_t n) {
+    char *w = ob_reserve(ob, n);
+    if (!w) return;
+    memcpy(w, p, n);
+    ob->len += n;
+}
+
+void ob_putc(OutBuf *ob, char c) {
+    char *w = ob_reserve(ob, 1);
+    if (!w) return;
+    *w = c;
+    ob->len++;
+}
+
+void ob_puts(OutBuf *ob, const char *s) { ob_write(ob, s, strlen(s)); }
+
+/* ----------------------- Números ----------------------- */
+
+static void ob_uint(OutBuf *ob, unsigned long long v) {
+    char tmp[24];
+    char *p = tmp + sizeof(tmp);
+    while (v >= 100) {
+        unsigned d = (unsigned)(v % 100) * 2;
+        v /= 100;
+        *--p = DIGITS2[d + 1];
+        *--p = DIGITS2[d];
+    }
+    if (v >= 10) {
+        unsigned d = (unsigned)v * 2;
+        *--p = DIGITS2[d + 1];
+        *--p = DIGITS2[d];
+    } else {
+        *--p = (char)('0' + v);
+    }
+    ob_write(ob, p, (size_t)(tmp + sizeof(tmp) - p));
+}
+
+void ob_int(OutBuf *ob, long long v) {
+    if (v < 0) {
+        ob_putc(ob, '-');
+        ob_uint(ob, 0ULL - (unsigned long long)v);
+    } else {
+        ob_uint(ob, (unsigned long long)v);
+    }
+}
+
+// q / 10^d con d decimales exactos (q con signo)
+static void ob_scaled(OutBuf *ob, long long q, int d) {
+    unsigned long long u = q < 0 ? 0ULL - (unsigned long long)q : (unsigned long long)q;
+    if (q < 0) ob_putc(ob, '-');
+    ob_uint(ob, u / P10U[d]);
+    if (d == 0) return;
+    char *w = ob_reserve(ob, (size_t)d + 1);
+    if (!w) return;
+    unsigned long long f = u % P10U[d];
+    w[0] = '.';
+    for (int i = d; i >= 1; i--) {
+        w[i] = (char)('0' + f % 10);
+        f /= 10;
+    }
+    ob->len += (size_t)d + 1;
+}
+
+static void ob_printf_double(OutBuf *ob, const char *fmt, int prec, double v) {
+    char tmp[512];
+    int n = snprintf(tmp, sizeof(tmp), fmt, prec, v);
+    if (n > 0) ob_write(ob, tmp, (size_t)n < sizeof(tmp) ? (size_t)n : sizeof(tmp) - 1);
+}
+
+void ob_fixed(OutBuf *ob, double v, int decimals) {
+    if (decimals < 0) decimals = 0;
+    if (decimals > 9 || !isfinite(v)) { ob_printf_double(ob, "%.*f", decimals, v); return; }
+
+    double s = v * P10D[decimals];
+    if (fabs(s) >= 9e15) { ob_printf_double(ob, "%.*f", decimals, v); return; }
+
+    // Cerca de un empate el producto redondeado puede no coincidir con el
+    // redondeo de printf sobre el valor exacto: delegar en printf.
+    double fr = fabs(s) - floor(fabs(s));
+    if (fabs(fr - 0.5) <= fabs(s) * 2.3e-16) { ob_printf_double(ob, "%.*f", decimals, v); return; }
+
+    long long q = llround(s);
+    if (q == 0 && signbit(v)) { ob_printf_double(ob, "%.*f", decimals, v); return; }   // "-0.000"
+    ob_scaled(ob, q, decimals);
+}
+
+void ob_double(OutBuf *ob, double v) {
+    if (!isfinite(v)) { ob_puts(ob, "null"); return; }   // JSON no admite inf/nan
+    if (v == 0.0) { ob_putc(ob, '0'); return; }
+
+    // Camino rápido: menor número de decimales (<= 9) que reconstruye v
+    for (int d = 0; d < 10; d++) {
+        double s = v * P10D[d];
+        if (fabs(s) >= 9e15) break;
+        long long q = llround(s);
+        if ((double)q / P10D[d] == v) { ob_scaled(ob, q, d); return; }
+    }
+
+    // %.17g siempre reconstruye un double; 15 y 16 dígitos solo si strtod vuelve a v
+    char tmp[40];
+    for (int p = 15; p <= 17; p++) {
+        snprintf(tmp, sizeof(tmp), "%.*g", p, v);
+        if (p == 17 || strtod(tmp, NULL) == v) break;
+    }
+    ob_puts(ob, tmp);
+}
+
+void ob_u32(OutBuf *ob, uint32_t v) {
+    unsigned char b[4] = {(unsigned char)v, (unsigned char)(v >> 8),
+                          (unsigned char)(v >> 16), (unsigned char)(v >> 24)};
+    ob_write(ob, b, 4);
+}
+
+void ob_i32(OutBuf *ob, int32_t v) { ob_u32(ob, (uint32_t)v); }
+
+void ob_f64(OutBuf *ob, double v) {
+    uint64_t u;
+    memcpy(&u, &v, 8);
+    unsigned char b[8];
+    for (int i = 0; i < 8; i++) b[i] = (unsigned char)(u >> (8 * i));
+    ob_write(ob, b, 8);
+}
+
+/* ----------------------- Rutas ----------------------- */
+
+static void ob_num(OutBuf *ob, double v, int decimals) {
+    if (decimals < 0) ob_double(ob, v);
+    else ob_fixed(ob, v, decimals);
+}
+
+void ob_route_json(OutBuf *ob, const Route *R, double t0, int decimals) {
+    ob_puts(ob, "{\"eta\":");
+    ob_num(ob, R->eta, decimals);
+    ob_puts(ob, ",\"latency\":");
+    ob_num(ob, R->eta - t0, decimals);
+    ob_puts(ob, ",\"hops\":");
+    ob_int(ob, R->hops);
+    ob_puts(ob, ",\"contacts\":[");
+    for (int i = 0; i < R->hops; i++) {
+        if (i) ob_putc(ob, ',');
+        ob_int(ob, R->contact_ids[i]);
+    }
+    ob_puts(ob, "]}");
+}
+
+static void ob_route_body_bin(OutBuf *ob, const Route *R) {
+    ob_u32(ob, (uint32_t)R->hops);
+    ob_f64(ob, R->eta);
+    for (int i = 0; i < R->hops; i++) ob_i32(ob, R->contact_ids[i]);
+}
+
+void ob_result_bin(OutBuf *ob, uint32_t query, const Routes *RS) {
+    ob_u32(ob, query);
+    ob_u32(ob, (uint32_t)RS->count);
+    for (int r = 0; r < RS->count; r++) ob_route_body_bin(ob, &RS->items[r]);
+}
+
+void ob_route_bin(OutBuf *ob, uint32_t query, const Route *R) {
+    ob_u32(ob, query);
+    ob_u32(ob, R->found ? 1u : 0u);
+    if (R->found) ob_route_body_bin(ob, R);
+}
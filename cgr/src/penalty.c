@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "penalty.h"
+
+CgrOverlay* overlay_new(int n, double lambda) {
+    if (n < 0) return NULL;
+    CgrOverlay *ov = (CgrOverlay*)calloc(1, sizeof(CgrOverlay));
+    if (!ov) return NULL;
+    ov->pen = (_Atomic double*)malloc(sizeof(_Atomic double) * (n > 0 ? n : 1));
+    if (!ov->pen) { free(ov); return NULL; }
+    for (int i = 0; i < n; i++) atomic_init(&ov->pen[i], 0.0);
+    ov->n = n;
+    ov->lambda = lambda;
+    return ov;
+}
+
+void overlay_free(CgrOverlay *ov) {
+    if (!ov) return;
+    free((void*)ov->pen);
+    free(ov->link_slot);
+    free(ov);
+}
+
+int overlay_bind_links(CgrOverlay *ov, LinkTable *T, const Contact *C, int N) {
+    if (!ov || !T || !C || N != ov->n) return -1;
+    int *slot = (int*)malloc(sizeof(int) * (N > 0 ? N : 1));
+    if (!slot) return -1;
+    int full = 0;
+    for (int i = 0; i < N; i++) {
+        slot[i] = link_slot(T, C[i].from, C[i].to);
+        if (slot[i] < 0) full = 1;
+    }
+    free(ov->link_slot);
+    ov->link_slot = slot;
+    ov->links = T;
+    return full ? -1 : 0;
+}
+
+double overlay_ewma(CgrOverlay *ov, int ci, double sample, double alpha) {
+    if (!ov || ci < 0 || ci >= ov->n) return 0.0;
+    double old = atomic_load_explicit(&ov->pen[ci], memory_order_relaxed);
+    double upd;
+    do {
+        upd = (1.0 - alpha) * old + alpha * sample;
+    } while (!atomic_compare_exchange_weak_explicit(&ov->pen[ci], &old, upd,
+                                                    memory_order_relaxed, memory_order_relaxed));
+    return upd;
+}
+
+typedef struct { int id, idx; } IdIdx;
+
+static int cmp_ididx(const void *a, const void *b) {
+    int x = ((const IdIdx*)a)->id, y = ((const IdIdx*)b)->id;
+    return (x > y) - (x < y);
+}
+
+// Índices de C[0..n) ordenados por id; NULL sin memoria o si algún id se
+// repite (el fichero no podría distinguir esos contactos)
+static IdIdx* id_map(const Contact *C, int n) {
+    IdIdx *map = (IdIdx*)malloc(sizeof(IdIdx) * (n > 0 ? n : 1));
+    if (!map) return NULL;
+    for (int i = 0; i < n; i++) map[i] = (IdIdx){C[i].id, i};
+    qsort(map, n, sizeof(IdIdx), cmp_ididx);
+    for (int i = 1; i < n; i++) {
+        if (map[i].id == map[i - 1].id) { free(map); return NULL; }
+    }
+    return map;
+}
+
+int overlay_save(const CgrOverlay *ov, const Contact *C, int N, const char *path) {
+    if (!ov || !C || !path) return -1;
+    int n = N < ov->n ? N : ov->n, written = 0;
+    IdIdx *map = id_map(C, n);
+    if (!map) return -1;
+    free(map);
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fprintf(f, "# id,penalty_s\n");
+    for (int i = 0; i < n; i++) {
+        double p = overlay_get(ov, i);
+        if (p == 0.0) continue;
+        fprintf(f, "%d,%.17g\n", C[i].id, p);
+        written++;
+    }
+    if (fclose(f) != 0) return -1;
+    return written;
+}
+
+int overlay_load(CgrOverlay *ov, const Contact *C, int N, const char *path) {
+    if (!ov || !C || !path) return -1;
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+
+    int n = N < ov->n ? N : ov->n;
+    IdIdx *map = id_map(C, n);
+    if (!map) { fclose(f); return -1; }
+
+    char line[256];
+    int applied = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        IdIdx key;
+        double p;
+        if (sscanf(line, "%d,%lf", &key.id, &p) != 2) continue;
+        const IdIdx *hit = (const IdIdx*)bsearch(&key, map, n, sizeof(IdIdx), cmp_ididx);
+        if (!hit) continue;
+        overlay_set(ov, hit->idx, p);
+        applied++;
+    }
+    free(map);
+    fclose(f);
+    return applied;
+}
@@ -0,0 +1,517 @@
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64     // offsets de bloque de 64 bits también en plataformas de 32
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <sys/types.h>
+#include "plan_archive.h"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Formato en disco (little-endian)
+// ═══════════════════════════════════════════════════════════════════════════
+//
+// Cabecera (40 B): "CGRP" | u32 versión | u64 n_contacts | u32 n_blocks |
+//                  u32 block_size | f64 t_min | f64 t_max
+// Directorio (36 B por bloque): u32 count | f64 t_start_min | f64 t_end_max |
+//                               u64 offset | u64 bytes
+// Bloque: columnas id, from, to, t_start, t_end, owlt, rate_bps, setup_s,
+//         residual_bytes, p_fail, una tras otra. La versión 1 no tiene
+//         p_fail (se lee como 0).
+
+#define ARCHIVE_MAGIC   "CGRP"
+#define ARCHIVE_VERSION 2u
+#define HEADER_BYTES    40
+#define DIR_ENTRY_BYTES 36
+
+#define COL_SCALED 1   // entero escalado 10^k, delta + zigzag + varint
+#define COL_XOR    2   // XOR con el previo, bytes nulos recortados
+
+typedef struct { uint8_t *p; size_t n, cap; int err; } ByteBuf;   // err: algún reserve falló
+
+typedef struct
+{
+    uint32_t count;
+    double   t_start_min;
+    double   t_end_max;
+    uint64_t offset;
+    uint64_t bytes;
+} BlockDir;
+
+static const double P10[10] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+#define SCALED_MAX 9000000000000000LL   // |v·10^k| < 9e15 en las columnas escaladas
+
+/* ----------------------- Primitivas de bytes ----------------------- */
+
+static int bb_reserve(ByteBuf *b, size_t extra) {
+    if (b->n + extra <= b->cap) return 0;
+    size_t ncap = b->cap ? b->cap * 2 : 4096;
+    while (ncap < b->n + extra) ncap *= 2;
+    uint8_t *np = (uint8_t*)realloc(b->p, ncap);
+    if (!np) { b->err = 1; return -1; }
+    b->p = np;
+    b->cap = ncap;
+    return 0;
+}
+
+static void bb_byte(ByteBuf *b, uint8_t v) {
+    if (bb_reserve(b, 1) == 0) b->p[b->n++] = v;
+}
+
+static void bb_raw(ByteBuf *b, const void *src, size_t len) {
+    if (bb_reserve(b, len) == 0) {
+        memcpy(b->p + b->n, src, len);
+        b->n += len;
+    }
+}
+
+static void bb_varint(ByteBuf *b, uint64_t v) {
+    while (v >= 0x80) {
+        bb_byte(b, (uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    bb_byte(b, (uint8_t)v);
+}
+
+static inline uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static inline int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+static inline uint64_t dbl_bits(double d) { uint64_t u; memcpy(&u, &d, 8); return u; }
+static inline double bits_dbl(uint64_t u) { double d; memcpy(&d, &u, 8); return d; }
+
+typedef struct { const uint8_t *p, *end; int err; } Reader;
+
+static uint8_t rd_byte(Reader *r) {
+    if (r->p >= r->end) { r->err = 1; return 0; }
+    return *r->p++;
+}
+
+static uint64_t rd_varint(Reader *r) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t b = rd_byte(r);
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    r->err = 1;
+    return 0;
+}
+
+static void put_u32(uint8_t *p, uint32_t v) { memcpy(p, &v, 4); }
+static void put_u64(uint8_t *p, uint64_t v) { memcpy(p, &v, 8); }
+static void put_f64(uint8_t *p, double v)   { memcpy(p, &v, 8); }
+static uint32_t get_u32(const uint8_t *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static uint64_t get_u64(const uint8_t *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static double   get_f64(const uint8_t *p) { double v; memcpy(&v, p, 8); return v; }
+
+/* ----------------------- Codificación de columnas ----------------------- */
+
+#define FIELD_INT(c, k)  ((k) == 0 ? &(c)->id : (k) == 1 ? &(c)->from : &(c)->to)
+
+static double* field_dbl(Contact *c, int k) {
+    switch (k) {
+        case 0: return &c->t_start;
+        case 1: return &c->t_end;
+        case 2: return &c->owlt;
+        case 3: return &c->rate_bps;
+        case 4: return &c->setup_s;
+        case 5: return &c->residual_bytes;
+        default: return &c->p_fail;
+    }
+}
+
+static void encode_int_col(ByteBuf *b, const Contact *C, int n, int k) {
+    int64_t prev = 0;
+    for (int i = 0; i < n; i++) {
+        int64_t v = *FIELD_INT(&C[i], k);
+        bb_varint(b, zigzag(v - prev));
+        prev = v;
+    }
+}
+
+// Menor 10^k con el que toda la columna es entera y se reconstruye exacta
+static int pick_scale(const Contact *C, int n, int k) {
+    for (int e = 0; e < 10; e++) {
+        int ok = 1;
+        for (int i = 0; i < n && ok; i++) {
+            double v = *field_dbl((Contact*)&C[i], k);
+            double s = v * P10[e];
+            if (!(fabs(s) < (double)SCALED_MAX)) { ok = 0; break; }
+            if ((double)llround(s) / P10[e] != v) ok = 0;
+        }
+        if (ok) return e;
+    }
+    return -1;
+}
+
+static void encode_dbl_col(ByteBuf *b, const Contact *C, int n, int k) {
+    int e = pick_scale(C, n, k);
+    if (e >= 0) {
+        bb_byte(b, COL_SCALED);
+        bb_byte(b, (uint8_t)e);
+        int64_t prev = 0;
+        for (int i = 0; i < n; i++) {
+            int64_t v = llround(*field_dbl((Contact*)&C[i], k) * P10[e]);
+            bb_varint(b, zigzag(v - prev));
+            prev = v;
+        }
+        return;
+    }
+
+    bb_byte(b, COL_XOR);
+    uint64_t prev = 0;
+    for (int i = 0; i < n; i++) {
+        uint64_t cur = dbl_bits(*field_dbl((Contact*)&C[i], k));
+        uint64_t x = cur ^ prev;
+        prev = cur;
+        if (x == 0) { bb_byte(b, 0); continue; }
+
+        int tz = 0, lz = 0;
+        while (!((x >> (8 * tz)) & 0xff)) tz++;
+        while (!((x >> (8 * (7 - lz))) & 0xff)) lz++;
+        int nb = 8 - tz - lz;
+        bb_byte(b, (uint8_t)((tz << 4) | nb));
+        uint64_t y = x >> (8 * tz);
+        for (int j = 0; j < nb; j++) bb_byte(b, (uint8_t)(y >> (8 * j)));
+    }
+}
+
+static int n_dbl_cols(uint32_t version) { return version >= 2 ? 7 : 6; }
+
+// Los bloques vienen del fichero: deltas y cabeceras XOR se validan antes de
+// operar con ellos para no desbordar enteros con signo ni desplazar >= 64 bits
+static int decode_block(Reader *r, Contact *C, int n, uint32_t version) {
+    for (int k = 0; k < 3; k++) {
+        int64_t prev = 0;
+        for (int i = 0; i < n; i++) {
+            int64_t d = unzigzag(rd_varint(r));
+            if (d < (int64_t)INT_MIN - prev || d > (int64_t)INT_MAX - prev) return -1;
+            prev += d;
+            *FIELD_INT(&C[i], k) = (int)prev;
+        }
+    }
+    if (version < 2) for (int i = 0; i < n; i++) C[i].p_fail = 0.0;
+    for (int k = 0; k < n_dbl_cols(version); k++) {
+        uint8_t mode = rd_byte(r);
+        if (mode == COL_SCALED) {
+            int e = rd_byte(r);
+            if (e > 9) return -1;
+            int64_t prev = 0;
+            for (int i = 0; i < n; i++) {
+                int64_t d = unzigzag(rd_varint(r));
+                if (d < -SCALED_MAX - prev || d > SCALED_MAX - prev) return -1;
+                prev += d;
+                *field_dbl(&C[i], k) = (double)prev / P10[e];
+            }
+        } else if (mode == COL_XOR) {
+            uint64_t prev = 0;
+            for (int i = 0; i < n; i++) {
+                uint8_t h = rd_byte(r);
+                if (h) {
+                    int tz = h >> 4, nb = h & 0x0f;
+                    if (nb == 0 || tz + nb > 8) return -1;
+                    uint64_t y = 0;
+                    for (int j = 0; j < nb; j++) y |= (uint64_t)rd_byte(r) << (8 * j);
+                    prev ^= y << (8 * tz);
+                }
+                *field_dbl(&C[i], k) = bits_dbl(prev);
+            }
+        } else {
+            return -1;
+        }
+    }
+    return r->err ? -1 : 0;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Escritura
+// ═══════════════════════════════════════════════════════════════════════════
+
+typedef struct { double t; int idx; } SortKey;
+
+static int cmp_sort_key(const void *a, const void *b) {
+    const SortKey *x = (const SortKey*)a, *y = (const SortKey*)b;
+    if (x->t != y->t) return (x->t < y->t) ? -1 : 1;
+    return (x->idx > y->idx) - (x->idx < y->idx);   // estable
+}
+
+int plan_archive_write(const char *path, const Contact *C, int N, int block_size) {
+    if (!path || !C || N <= 0) return -1;
+    if (block_size <= 0) block_size = PLAN_ARCHIVE_BLOCK_DEFAULT;
+
+    // Copia ordenada por t_start (requisito para saltar bloques por tiempo)
+    SortKey *keys = (SortKey*)malloc(sizeof(SortKey) * N);
+    Contact *S = (Contact*)malloc(sizeof(Contact) * N);
+    if (!keys || !S) { free(keys); free(S); return -1; }
+    for (int i = 0; i < N; i++) { keys[i].t = C[i].t_start; keys[i].idx = i; }
+    qsort(keys, N, sizeof(SortKey), cmp_sort_key);
+    for (int i = 0; i < N; i++) S[i] = C[keys[i].idx];
+    free(keys);
+
+    int n_blocks = (N + block_size - 1) / block_size;
+    BlockDir *dir = (BlockDir*)calloc(n_blocks, sizeof(BlockDir));
+    ByteBuf body = {0};
+    if (!dir) { free(S); return -1; }
+
+    double t_min = S[0].t_start, t_max = S[0].t_end;
+    uint64_t base = HEADER_BYTES + (uint64_t)n_blocks * DIR_ENTRY_BYTES;
+
+    for (int bi = 0; bi < n_blocks; bi++) {
+        int lo = bi * block_size;
+        int n = (N - lo < block_size) ? N - lo : block_size;
+        const Contact *B = S + lo;
+
+        dir[bi].count = (uint32_t)n;
+        dir[bi].t_start_min = B[0].t_start;
+        dir[bi].t_end_max = B[0].t_end;
+        for (int i = 0; i < n; i++) {
+            if (B[i].t_end > dir[bi].t_end_max) dir[bi].t_end_max = B[i].t_end;
+        }
+        if (dir[bi].t_end_max > t_max) t_max = dir[bi].t_end_max;
+
+        size_t before = body.n;
+        for (int k = 0; k < 3; k++) encode_int_col(&body, B, n, k);
+        for (int k = 0; k < n_dbl_cols(ARCHIVE_VERSION); k++) encode_dbl_col(&body, B, n, k);
+        dir[bi].offset = base + before;
+        dir[bi].bytes = body.n - before;
+    }
+    free(S);
+
+    if (body.err) {
+        free(dir); free(body.p);
+        return -1;
+    }
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        free(dir); free(body.p);
+        return -1;
+    }
+
+    uint8_t hdr[HEADER_BYTES];
+    memcpy(hdr, ARCHIVE_MAGIC, 4);
+    put_u32(hdr + 4, ARCHIVE_VERSION);
+    put_u64(hdr + 8, (uint64_t)N);
+    put_u32(hdr + 16, (uint32_t)n_blocks);
+    put_u32(hdr + 20, (uint32_t)block_size);
+    put_f64(hdr + 24, t_min);
+    put_f64(hdr + 32, t_max);
+
+    ByteBuf head = {0};
+    bb_raw(&head, hdr, HEADER_BYTES);
+    for (int bi = 0; bi < n_blocks; bi++) {
+        uint8_t e[DIR_ENTRY_BYTES];
+        put_u32(e, dir[bi].count);
+        put_f64(e + 4, dir[bi].t_start_min);
+        put_f64(e + 12, dir[bi].t_end_max);
+        put_u64(e + 20, dir[bi].offset);
+        put_u64(e + 28, dir[bi].bytes);
+        bb_raw(&head, e, DIR_ENTRY_BYTES);
+    }
+
+    int ok = !head.err && fwrite(head.p, 1, head.n, f) == head.n &&
+             fwrite(body.p, 1, body.n, f) == body.n;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) remove(path);   // no dejar un .cgrp truncado que parezca válido
+
+    free(head.p);
+    free(body.p);
+    free(dir);
+    return ok ? 0 : -1;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Lectura
+// ═══════════════════════════════════════════════════════════════════════════
+
+static BlockDir* read_header(FILE *f, PlanArchiveInfo *info) {
+    uint8_t hdr[HEADER_BYTES];
+    if (fread(hdr, 1, HEADER_BYTES, f) != HEADER_BYTES) return NULL;
+    if (memcmp(hdr, ARCHIVE_MAGIC, 4) != 0) return NULL;
+    info->version = get_u32(hdr + 4);
+    if (info->version < 1 || info->version > ARCHIVE_VERSION) return NULL;
+
+    info->n_contacts = (int64_t)get_u64(hdr + 8);
+    info->n_blocks = (int)get_u32(hdr + 16);
+    info->t_min = get_f64(hdr + 24);
+    info->t_max = get_f64(hdr + 32);
+    info->blocks_read = 0;
+    info->bytes_read = 0;
+    if (info->n_blocks <= 0) return NULL;
+
+    size_t dir_bytes = (size_t)info->n_blocks * DIR_ENTRY_BYTES;
+    uint8_t *raw = (uint8_t*)malloc(dir_bytes);
+    BlockDir *dir = (BlockDir*)malloc(sizeof(BlockDir) * info->n_blocks);
+    if (!raw || !dir || fread(raw, 1, dir_bytes, f) != dir_bytes) {
+        free(raw); free(dir);
+        return NULL;
+    }
+    // El directorio viene del fichero: cada contacto ocupa al menos un byte por
+    // columna, y el total tiene que caber en un int (los cargadores lo usan así)
+    int64_t total = 0;
+    int bad = 0;
+    for (int bi = 0; bi < info->n_blocks && !bad; bi++) {
+        const uint8_t *e = raw + (size_t)bi * DIR_ENTRY_BYTES;
+        dir[bi].count = get_u32(e);
+        dir[bi].t_start_min = get_f64(e + 4);
+        dir[bi].t_end_max = get_f64(e + 12);
+        dir[bi].offset = get_u64(e + 20);
+        dir[bi].bytes = get_u64(e + 28);
+        total += dir[bi].count;
+        uint64_t min_bytes = (uint64_t)dir[bi].count * (uint64_t)(3 + n_dbl_cols(info->version));
+        bad = total > INT_MAX || min_bytes > dir[bi].bytes || dir[bi].bytes > SIZE_MAX ||
+              dir[bi].offset > UINT64_MAX - dir[bi].bytes;
+    }
+    free(raw);
+    if (bad || total != info->n_contacts) {
+        free(dir);
+        return NULL;
+    }
+    return dir;
+}
+
+int plan_archive_info(const char *path, PlanArchiveInfo *info) {
+    if (!path || !info) return -1;
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    BlockDir *dir = read_header(f, info);
+    fclose(f);
+    if (!dir) return -1;
+    free(dir);
+    return 0;
+}
+
+// Lee y decodifica un bloque en dst[0..count)
+static int fetch_block(FILE *f, const BlockDir *d, uint32_t version, uint8_t **buf, size_t *buf_cap,
+                       Contact *dst) {
+    if (d->bytes > *buf_cap) {
+        uint8_t *nb = (uint8_t*)realloc(*buf, d->bytes);
+        if (!nb) return -1;
+        *buf = nb;
+        *buf_cap = d->bytes;
+    }
+    off_t off = (off_t)d->offset;
+    if (off < 0 || (uint64_t)off != d->offset) return -1;   // no representable en off_t
+    if (fseeko(f, off, SEEK_SET) != 0 || fread(*buf, 1, d->bytes, f) != d->bytes) return -1;
+    Reader r = {*buf, *buf + d->bytes, 0};
+    return decode_block(&r, dst, (int)d->count, version);
+}
+
+int plan_archive_load(const char *path, double t_lo, double t_hi, Contact **out_contacts,
+                      PlanArchiveInfo *info)
+{
+    if (!path || !out_contacts) return -1;
+    PlanArchiveInfo local;
+    if (!info) info = &local;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    BlockDir *dir = read_header(f, info);
+    if (!dir) { fclose(f); return -1; }
+
+    int all = (t_hi < t_lo);
+    int cap = 0, n = 0;
+    Contact *arr = NULL;
+    uint8_t *buf = NULL;
+    size_t buf_cap = 0;
+    int err = 0;
+
+    for (int bi = 0; bi < info->n_blocks; bi++) {
+        const BlockDir *d = &dir[bi];
+        // Bloques ordenados por t_start: el resto empieza después del horizonte
+        if (!all && d->t_start_min > t_hi) break;
+        if (!all && d->t_end_max < t_lo) continue;
+
+        if (n + (int)d->count > cap) {   // read_header garantiza suma de counts <= INT_MAX
+            int need = n + (int)d->count;
+            int ncap = cap ? cap : 1024;
+            while (ncap < need) ncap = (ncap > INT_MAX / 2) ? need : ncap * 2;
+            if ((size_t)ncap > SIZE_MAX / sizeof(Contact)) { err = 1; break; }
+            Contact *na = (Contact*)realloc(arr, sizeof(Contact) * ncap);
+            if (!na) { err = 1; break; }
+            arr = na;
+            cap = ncap;
+        }
+
+        // Decodificar el bloque directamente sobre el final del array
+        if (fetch_block(f, d, info->version, &buf, &buf_cap, arr + n) != 0) { err = 1; break; }
+        info->blocks_read++;
+        info->bytes_read += (int64_t)d->bytes;
+
+        if (all) {
+            n += (int)d->count;
+        } else {
+            int base = n;
+            for (uint32_t i = 0; i < d->count; i++) {
+                const Contact *c = &arr[base + i];
+                if (c->t_end >= t_lo && c->t_start <= t_hi) arr[n++] = *c;
+            }
+        }
+    }
+
+    fclose(f);
+    free(buf);
+    free(dir);
+    if (err) {
+        free(arr);
+        return -1;
+    }
+    *out_contacts = arr ? arr : (Contact*)malloc(sizeof(Contact));
+    return n;
+}
+
+/* ----------------------- Lectura bloque a bloque ----------------------- */
+
+struct PlanArchiveReader
+{
+    FILE *f;
+    BlockDir *dir;
+    PlanArchiveInfo info;
+    int next;            // próximo bloque a decodificar
+    uint8_t *buf;
+    size_t buf_cap;
+};
+
+PlanArchiveReader* plan_archive_open(const char *path, PlanArchiveInfo *info) {
+    if (!path) return NULL;
+    PlanArchiveReader *r = (PlanArchiveReader*)calloc(1, sizeof(PlanArchiveReader));
+    if (!r) return NULL;
+    r->f = fopen(path, "rb");
+    if (r->f) r->dir = read_header(r->f, &r->info);
+    if (!r->dir) {
+        plan_archive_close(r);
+        return NULL;
+    }
+    if (info) *info = r->info;
+    return r;
+}
+
+int plan_archive_next_block(PlanArchiveReader *r, Contact **buf, int *cap) {
+    if (!r || !buf || !cap) return -1;
+    if (r->next >= r->info.n_blocks) return 0;
+
+    const BlockDir *d = &r->dir[r->next];
+    if ((int)d->count > *cap) {
+        if ((uint64_t)d->count * sizeof(Contact) > SIZE_MAX) return -1;
+        Contact *na = (Contact*)realloc(*buf, sizeof(Contact) * d->count);
+        if (!na) return -1;
+        *buf = na;
+        *cap = (int)d->count;
+    }
+    if (fetch_block(r->f, d, r->info.version, &r->buf, &r->buf_cap, *buf) != 0) return -1;
+    r->next++;
+    return (int)d->count;
+}
+
+void plan_archive_rewind(PlanArchiveReader *r) {
+    if (r) r->next = 0;
+}
+
+void plan_archive_close(PlanArchiveReader *r) {
+    if (!r) return;
+    if (r->f) fclose(r->f);
+    free(r->dir);
+    free(r->buf);
+    free(r);
+}
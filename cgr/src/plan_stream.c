@@ -0,0 +1,368 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "plan_stream.h"
+#include "plan_archive.h"
+#include "csv.h"
+
+#define QUEUE_CAP_DEFAULT 16384
+#define CHUNK_DEFAULT     1024
+
+struct PlanStream
+{
+    PlanSource src;
+    PlanStreamCfg cfg;
+
+    Contact *win;           // ventana actual, en orden de t_start
+    int n_win, cap_win;
+
+    Contact *q;             // cola circular de prefetch (cfg.queue_cap)
+    int q_head, q_count;
+    Contact *tmp;           // buffer de lectura de la fuente (cfg.chunk)
+
+    int eof, err;
+    double offset;          // desplazamiento temporal acumulado por periodización
+    int wraps;
+    PlanStreamStats st;
+
+    pthread_t th;
+    int has_thread, stop;
+    pthread_mutex_t mu;
+    pthread_cond_t cv_data, cv_space;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Fuentes
+// ═══════════════════════════════════════════════════════════════════════════
+
+static int csv_read(void *ctx, Contact *out, int cap) { return csv_reader_next((CsvReader*)ctx, out, cap); }
+static int csv_rewind(void *ctx) { return csv_reader_rewind((CsvReader*)ctx); }
+static void csv_close(void *ctx) { csv_reader_close((CsvReader*)ctx); }
+
+PlanSource plan_source_csv(const char *path) {
+    PlanSource s;
+    memset(&s, 0, sizeof(s));
+    CsvReader *r = csv_reader_open(path);
+    if (!r) return s;
+    s.read = csv_read;
+    s.rewind = csv_rewind;
+    s.close = csv_close;
+    s.ctx = r;
+    return s;
+}
+
+typedef struct
+{
+    PlanArchiveReader *r;
+    Contact *blk;           // bloque decodificado actual
+    int cap, n, pos;
+} ArchiveSrc;
+
+static int archive_read(void *ctx, Contact *out, int cap) {
+    ArchiveSrc *a = (ArchiveSrc*)ctx;
+    if (a->pos >= a->n) {
+        a->n = plan_archive_next_block(a->r, &a->blk, &a->cap);
+        a->pos = 0;
+        if (a->n <= 0) return a->n;
+    }
+    int k = a->n - a->pos;
+    if (k > cap) k = cap;
+    memcpy(out, a->blk + a->pos, sizeof(Contact) * k);
+    a->pos += k;
+    return k;
+}
+
+static int archive_rewind(void *ctx) {
+    ArchiveSrc *a = (ArchiveSrc*)ctx;
+    plan_archive_rewind(a->r);
+    a->n = a->pos = 0;
+    return 0;
+}
+
+static void archive_close(void *ctx) {
+    ArchiveSrc *a = (ArchiveSrc*)ctx;
+    plan_archive_close(a->r);
+    free(a->blk);
+    free(a);
+}
+
+PlanSource plan_source_archive(const char *path) {
+    PlanSource s;
+    memset(&s, 0, sizeof(s));
+    ArchiveSrc *a = (ArchiveSrc*)calloc(1, sizeof(ArchiveSrc));
+    if (!a) return s;
+    a->r = plan_archive_open(path, NULL);
+    if (!a->r) { free(a); return s; }
+    s.read = archive_read;
+    s.rewind = archive_rewind;
+    s.close = archive_close;
+    s.ctx = a;
+    return s;
+}
+
+typedef struct
+{
+    const Contact *C;
+    int *order;             // índices de C en orden de t_start
+    int N, pos;
+} ArraySrc;
+
+typedef struct { double t; int idx; } StartKey;
+
+static int cmp_start_key(const void *a, const void *b) {
+    const StartKey *x = (const StartKey*)a, *y = (const StartKey*)b;
+    if (x->t != y->t) return (x->t < y->t) ? -1 : 1;
+    return (x->idx > y->idx) - (x->idx < y->idx);
+}
+
+static int array_read(void *ctx, Contact *out, int cap) {
+    ArraySrc *a = (ArraySrc*)ctx;
+    int k = 0;
+    while (k < cap && a->pos < a->N) out[k++] = a->C[a->order[a->pos++]];
+    return k;
+}
+
+static int array_rewind(void *ctx) {
+    ((ArraySrc*)ctx)->pos = 0;
+    return 0;
+}
+
+static void array_close(void *ctx) {
+    ArraySrc *a = (ArraySrc*)ctx;
+    free(a->order);
+    free(a);
+}
+
+PlanSource plan_source_array(const Contact *C, int N) {
+    PlanSource s;
+    memset(&s, 0, sizeof(s));
+    if (!C || N < 0) return s;
+
+    ArraySrc *a = (ArraySrc*)calloc(1, sizeof(ArraySrc));
+    StartKey *keys = (StartKey*)malloc(sizeof(StartKey) * (N > 0 ? N : 1));
+    if (a) a->order = (int*)malloc(sizeof(int) * (N > 0 ? N : 1));
+    if (!a || !keys || !a->order) {
+        if (a) free(a->order);
+        free(a); free(keys);
+        return s;
+    }
+    for (int i = 0; i < N; i++) { keys[i].t = C[i].t_start; keys[i].idx = i; }
+    qsort(keys, N, sizeof(StartKey), cmp_start_key);
+    for (int i = 0; i < N; i++) a->order[i] = keys[i].idx;
+    free(keys);
+
+    a->C = C;
+    a->N = N;
+    s.read = array_read;
+    s.rewind = array_rewind;
+    s.close = array_close;
+    s.ctx = a;
+    return s;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Lectura de la fuente y cola de prefetch
+// ═══════════════════════════════════════════════════════════════════════════
+
+// Lee hasta `room` contactos en ps->tmp aplicando la periodización.
+// Solo la llama el productor (hilo de prefetch o advance en modo síncrono).
+static int pull(PlanStream *ps, int room) {
+    int want = room < ps->cfg.chunk ? room : ps->cfg.chunk;
+    int n = ps->src.read(ps->src.ctx, ps->tmp, want);
+    if (n == 0 && ps->cfg.period > 0.0 && ps->src.rewind) {
+        if (ps->src.rewind(ps->src.ctx) != 0) return -1;
+        ps->offset += ps->cfg.period;
+        ps->wraps++;
+        n = ps->src.read(ps->src.ctx, ps->tmp, want);   // 0 otra vez = fuente vacía
+    }
+    if (n > 0 && ps->offset != 0.0) {
+        for (int i = 0; i < n; i++) {
+            ps->tmp[i].t_start += ps->offset;
+            ps->tmp[i].t_end += ps->offset;
+        }
+    }
+    return n;
+}
+
+// Con el mutex tomado (si hay hilo)
+static void queue_push(PlanStream *ps, int n) {
+    int cap = ps->cfg.queue_cap;
+    for (int i = 0; i < n; i++) {
+        ps->q[(ps->q_head + ps->q_count) % cap] = ps->tmp[i];
+        ps->q_count++;
+    }
+    ps->st.read += n;
+}
+
+static void store_result(PlanStream *ps, int n) {
+    if (n < 0) ps->err = 1;
+    else if (n == 0) ps->eof = 1;
+    else queue_push(ps, n);
+    ps->st.wraps = ps->wraps;
+}
+
+static void* prefetch_main(void *arg) {
+    PlanStream *ps = (PlanStream*)arg;
+    pthread_mutex_lock(&ps->mu);
+    while (!ps->stop) {
+        if (ps->eof || ps->err || ps->q_count == ps->cfg.queue_cap) {
+            pthread_cond_wait(&ps->cv_space, &ps->mu);
+            continue;
+        }
+        int room = ps->cfg.queue_cap - ps->q_count;
+        pthread_mutex_unlock(&ps->mu);
+
+        int n = pull(ps, room);   // E/S fuera del mutex
+
+        pthread_mutex_lock(&ps->mu);
+        store_result(ps, n);
+        pthread_cond_broadcast(&ps->cv_data);
+    }
+    pthread_mutex_unlock(&ps->mu);
+    return NULL;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// API
+// ═══════════════════════════════════════════════════════════════════════════
+
+static void stream_free(PlanStream *ps) {
+    if (ps->src.close) ps->src.close(ps->src.ctx);
+    free(ps->win);
+    free(ps->q);
+    free(ps->tmp);
+    free(ps);
+}
+
+PlanStream* plan_stream_open(PlanSource src, const PlanStreamCfg *cfg) {
+    if (!src.read || !cfg) {
+        if (src.close) src.close(src.ctx);
+        return NULL;
+    }
+    PlanStream *ps = (PlanStream*)calloc(1, sizeof(PlanStream));
+    if (!ps) {
+        if (src.close) src.close(src.ctx);
+        return NULL;
+    }
+    ps->src = src;
+    ps->cfg = *cfg;
+    if (ps->cfg.queue_cap <= 0) ps->cfg.queue_cap = QUEUE_CAP_DEFAULT;
+    if (ps->cfg.chunk <= 0) ps->cfg.chunk = CHUNK_DEFAULT;
+    if (ps->cfg.chunk > ps->cfg.queue_cap) ps->cfg.chunk = ps->cfg.queue_cap;
+
+    ps->q = (Contact*)malloc(sizeof(Contact) * ps->cfg.queue_cap);
+    ps->tmp = (Contact*)malloc(sizeof(Contact) * ps->cfg.chunk);
+    if (!ps->q || !ps->tmp) {
+        stream_free(ps);
+        return NULL;
+    }
+
+    if (ps->cfg.prefetch) {
+        pthread_mutex_init(&ps->mu, NULL);
+        pthread_cond_init(&ps->cv_data, NULL);
+        pthread_cond_init(&ps->cv_space, NULL);
+        if (pthread_create(&ps->th, NULL, prefetch_main, ps) == 0) {
+            ps->has_thread = 1;
+        } else {
+            pthread_mutex_destroy(&ps->mu);
+            pthread_cond_destroy(&ps->cv_data);
+            pthread_cond_destroy(&ps->cv_space);
+        }
+    }
+    return ps;
+}
+
+static int window_push(PlanStream *ps, const Contact *c) {
+    if (ps->n_win >= ps->cap_win) {
+        int ncap = ps->cap_win ? ps->cap_win * 2 : 1024;
+        Contact *nw = (Contact*)realloc(ps->win, sizeof(Contact) * ncap);
+        if (!nw) return -1;
+        ps->win = nw;
+        ps->cap_win = ncap;
+    }
+    ps->win[ps->n_win++] = *c;
+    return 0;
+}
+
+int plan_stream_advance(PlanStream *ps, double now) {
+    if (!ps) return -1;
+
+    // 1) Retirar lo vencido (compactación estable: la ventana sigue ordenada)
+    int w = 0;
+    for (int i = 0; i < ps->n_win; i++) {
+        if (ps->win[i].t_end >= now) ps->win[w++] = ps->win[i];
+    }
+    ps->st.retired += ps->n_win - w;
+    ps->n_win = w;
+
+    // 2) Admitir desde la cola hasta now + horizon
+    double limit = now + ps->cfg.horizon;
+    int cap = ps->cfg.queue_cap, err = 0;
+    if (ps->has_thread) pthread_mutex_lock(&ps->mu);
+    for (;;) {
+        while (ps->q_count > 0 && ps->q[ps->q_head].t_start <= limit) {
+            const Contact *c = &ps->q[ps->q_head];
+            if (c->t_end < now) {
+                ps->st.retired++;
+            } else if (window_push(ps, c) != 0) {
+                err = 1;
+                break;
+            } else {
+                ps->st.admitted++;
+            }
+            ps->q_head = (ps->q_head + 1) % cap;
+            ps->q_count--;
+        }
+        if (err || ps->q_count > 0 || ps->eof || ps->err) break;
+
+        // Cola vacía y la fuente aún puede traer contactos dentro del horizonte
+        if (ps->has_thread) {
+            ps->st.stalls++;
+            pthread_cond_signal(&ps->cv_space);
+            pthread_cond_wait(&ps->cv_data, &ps->mu);
+        } else {
+            store_result(ps, pull(ps, cap));
+        }
+    }
+    err |= ps->err;
+    ps->st.queued = ps->q_count;
+    if (ps->has_thread) {
+        pthread_cond_signal(&ps->cv_space);   // hay hueco: seguir leyendo por delante
+        pthread_mutex_unlock(&ps->mu);
+    }
+
+    ps->st.window = ps->n_win;
+    if (ps->n_win > ps->st.peak_window) ps->st.peak_window = ps->n_win;
+    return err ? -1 : ps->n_win;
+}
+
+const Contact* plan_stream_contacts(const PlanStream *ps, int *n) {
+    if (!ps) { if (n) *n = 0; return NULL; }
+    if (n) *n = ps->n_win;
+    return ps->win;
+}
+
+PlanStreamStats plan_stream_stats(PlanStream *ps) {
+    PlanStreamStats st;
+    memset(&st, 0, sizeof(st));
+    if (!ps) return st;
+    if (ps->has_thread) pthread_mutex_lock(&ps->mu);
+    st = ps->st;
+    if (ps->has_thread) pthread_mutex_unlock(&ps->mu);
+    return st;
+}
+
+void plan_stream_close(PlanStream *ps) {
+    if (!ps) return;
+    if (ps->has_thread) {
+        pthread_mutex_lock(&ps->mu);
+        ps->stop = 1;
+        pthread_cond_broadcast(&ps->cv_space);
+        pthread_mutex_unlock(&ps->mu);
+        pthread_join(ps->th, NULL);
+        pthread_mutex_destroy(&ps->mu);
+        pthread_cond_destroy(&ps->cv_data);
+        pthread_cond_destroy(&ps->cv_space);
+    }
+    stream_free(ps);
+}
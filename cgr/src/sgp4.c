@@ -0,0 +1,437 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "sgp4.h"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Constantes WGS72 (las del TLE)
+// ═══════════════════════════════════════════════════════════════════════════
+
+#define TWOPI   6.283185307179586476925286766559
+#define DEG2RAD 0.017453292519943295769236907684886
+#define X2O3    (2.0 / 3.0)
+#define J2      SGP4_J2
+#define J3      -0.00000253881
+#define J4      -0.00000165597
+#define J3OJ2   (J3 / J2)
+
+static double xke(void) {
+    return 60.0 / sqrt(SGP4_RE_KM * SGP4_RE_KM * SGP4_RE_KM / SGP4_MU);
+}
+
+const char* sgp4_error_name(int err) {
+    switch (err) {
+        case SGP4_OK:             return "ok";
+        case SGP4_ERR_ECC:        return "eccentricity";
+        case SGP4_ERR_MOTION:     return "mean_motion";
+        case SGP4_ERR_SEMILATUS:  return "semi_latus";
+        case SGP4_ERR_DECAYED:    return "decayed";
+        case SGP4_ERR_DEEP_SPACE: return "deep_space";
+        case SGP4_ERR_PARSE:      return "parse";
+        default:                  return "?";
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Inicialización (sgp4init sin la rama de espacio profundo)
+// ═══════════════════════════════════════════════════════════════════════════
+
+int sgp4_init(Sgp4Sat *s) {
+    const double XKE = xke();
+    double ss = 78.0 / SGP4_RE_KM + 1.0;
+    double qzms2t = pow((120.0 - 78.0) / SGP4_RE_KM, 4);
+
+    // initl: recupera el movimiento medio "un-Kozai" y el semieje
+    double eccsq = s->ecco * s->ecco;
+    double omeosq = 1.0 - eccsq;
+    double rteosq = sqrt(omeosq);
+    double cosio = cos(s->inclo);
+    double cosio2 = cosio * cosio;
+    double ak = pow(XKE / s->no_kozai, X2O3);
+    double d1 = 0.75 * J2 * (3.0 * cosio2 - 1.0) / (rteosq * omeosq);
+    double del = d1 / (ak * ak);
+    double adel = ak * (1.0 - del * del - del * (1.0 / 3.0 + 134.0 * del * del / 81.0));
+    del = d1 / (adel * adel);
+    s->no_unkozai = s->no_kozai / (1.0 + del);
+    s->ao = pow(XKE / s->no_unkozai, X2O3);
+    double sinio = sin(s->inclo);
+    double po = s->ao * omeosq;
+    double con42 = 1.0 - 5.0 * cosio2;
+    s->con41 = -con42 - cosio2 - cosio2;
+    double posq = po * po;
+    double rp = s->ao * (1.0 - s->ecco);
+
+    s->error = SGP4_OK;
+    if (s->ecco < 0.0 || s->ecco >= 1.0) return s->error = SGP4_ERR_ECC;
+    if (s->no_kozai <= 0.0) return s->error = SGP4_ERR_MOTION;
+    if (TWOPI / s->no_unkozai >= 225.0) return s->error = SGP4_ERR_DEEP_SPACE;
+
+    s->isimp = rp < (220.0 / SGP4_RE_KM + 1.0);
+
+    // Atmósfera: s y q0 dependen del perigeo
+    double sfour = ss, qzms24 = qzms2t;
+    double perige = (rp - 1.0) * SGP4_RE_KM;
+    if (perige < 156.0) {
+        sfour = perige - 78.0;
+        if (perige < 98.0) sfour = 20.0;
+        qzms24 = pow((120.0 - sfour) / SGP4_RE_KM, 4);
+        sfour = sfour / SGP4_RE_KM + 1.0;
+    }
+    double pinvsq = 1.0 / posq;
+    double tsi = 1.0 / (s->ao - sfour);
+    s->eta = s->ao * s->ecco * tsi;
+    double etasq = s->eta * s->eta;
+    double eeta = s->ecco * s->eta;
+    double psisq = fabs(1.0 - etasq);
+    double coef = qzms24 * pow(tsi, 4);
+    double coef1 = coef / pow(psisq, 3.5);
+    double cc2 = coef1 * s->no_unkozai *
+                 (s->ao * (1.0 + 1.5 * etasq + eeta * (4.0 + etasq)) +
+                  0.375 * J2 * tsi / psisq * s->con41 * (8.0 + 3.0 * etasq * (8.0 + etasq)));
+    s->cc1 = s->bstar * cc2;
+    double cc3 = 0.0;
+    if (s->ecco > 1.0e-4) cc3 = -2.0 * coef * tsi * J3OJ2 * s->no_unkozai * sinio / s->ecco;
+    s->x1mth2 = 1.0 - cosio2;
+    s->cc4 = 2.0 * s->no_unkozai * coef1 * s->ao * omeosq *
+             (s->eta * (2.0 + 0.5 * etasq) + s->ecco * (0.5 + 2.0 * etasq) -
+              J2 * tsi / (s->ao * psisq) *
+              (-3.0 * s->con41 * (1.0 - 2.0 * eeta + etasq * (1.5 - 0.5 * eeta)) +
+               0.75 * s->x1mth2 * (2.0 * etasq - eeta * (1.0 + etasq)) * cos(2.0 * s->argpo)));
+    s->cc5 = 2.0 * coef1 * s->ao * omeosq * (1.0 + 2.75 * (etasq + eeta) + eeta * etasq);
+
+    // Tasas seculares por J2/J4
+    double cosio4 = cosio2 * cosio2;
+    double temp1 = 1.5 * J2 * pinvsq * s->no_unkozai;
+    double temp2 = 0.5 * temp1 * J2 * pinvsq;
+    double temp3 = -0.46875 * J4 * pinvsq * pinvsq * s->no_unkozai;
+    s->mdot = s->no_unkozai + 0.5 * temp1 * rteosq * s->con41 +
+              0.0625 * temp2 * rteosq * (13.0 - 78.0 * cosio2 + 137.0 * cosio4);
+    s->argpdot = -0.5 * temp1 * con42 + 0.0625 * temp2 * (7.0 - 114.0 * cosio2 + 395.0 * cosio4) +
+                 temp3 * (3.0 - 36.0 * cosio2 + 49.0 * cosio4);
+    double xhdot1 = -temp1 * cosio;
+    s->nodedot = xhdot1 + (0.5 * temp2 * (4.0 - 19.0 * cosio2) + 2.0 * temp3 * (3.0 - 7.0 * cosio2)) * cosio;
+    s->omgcof = s->bstar * cc3 * cos(s->argpo);
+    s->xmcof = 0.0;
+    if (s->ecco > 1.0e-4) s->xmcof = -X2O3 * coef * s->bstar / eeta;
+    s->nodecf = 3.5 * omeosq * xhdot1 * s->cc1;
+    s->t2cof = 1.5 * s->cc1;
+    double den = (fabs(cosio + 1.0) > 1.5e-12) ? (1.0 + cosio) : 1.5e-12;
+    s->xlcof = -0.25 * J3OJ2 * sinio * (3.0 + 5.0 * cosio) / den;
+    s->aycof = -0.5 * J3OJ2 * sinio;
+    s->delmo = pow(1.0 + s->eta * cos(s->mo), 3);
+    s->sinmao = sin(s->mo);
+    s->x7thm1 = 7.0 * cosio2 - 1.0;
+
+    s->d2 = s->d3 = s->d4 = s->t3cof = s->t4cof = s->t5cof = 0.0;
+    if (!s->isimp) {
+        double cc1sq = s->cc1 * s->cc1;
+        s->d2 = 4.0 * s->ao * tsi * cc1sq;
+        double temp = s->d2 * tsi * s->cc1 / 3.0;
+        s->d3 = (17.0 * s->ao + sfour) * temp;
+        s->d4 = 0.5 * temp * s->ao * tsi * (221.0 * s->ao + 31.0 * sfour) * s->cc1;
+        s->t3cof = s->d2 + 2.0 * cc1sq;
+        s->t4cof = 0.25 * (3.0 * s->d3 + s->cc1 * (12.0 * s->d2 + 10.0 * cc1sq));
+        s->t5cof = 0.2 * (3.0 * s->d4 + 12.0 * s->cc1 * s->d3 + 6.0 * s->d2 * s->d2 +
+                          15.0 * cc1sq * (2.0 * s->d2 + cc1sq));
+    }
+    return SGP4_OK;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Propagación
+// ═══════════════════════════════════════════════════════════════════════════
+
+/* Parte secular (gravedad y arrastre) en t minutos: semieje (radios
+   terrestres), excentricidad, nodo, argumento del perigeo y anomalía media
+   medios, y movimiento medio. Devuelve Sgp4Error. */
+typedef struct
+{
+    double am, em, nodem, argpm, mm, nm;
+} Secular;
+
+static int sgp4_secular(const Sgp4Sat *s, double t, Secular *o) {
+    const double XKE = xke();
+    double xmdf = s->mo + s->mdot * t;
+    double argpdf = s->argpo + s->argpdot * t;
+    double nodedf = s->nodeo + s->nodedot * t;
+    double argpm = argpdf, mm = xmdf;
+    double t2 = t * t;
+    double nodem = nodedf + s->nodecf * t2;
+    double tempa = 1.0 - s->cc1 * t;
+    double tempe = s->bstar * s->cc4 * t;
+    double templ = s->t2cof * t2;
+    if (!s->isimp) {
+        double delomg = s->omgcof * t;
+        double delmtemp = 1.0 + s->eta * cos(xmdf);
+        double delm = s->xmcof * (delmtemp * delmtemp * delmtemp - s->delmo);
+        double temp = delomg + delm;
+        mm = xmdf + temp;
+        argpm = argpdf - temp;
+        double t3 = t2 * t, t4 = t3 * t;
+        tempa = tempa - s->d2 * t2 - s->d3 * t3 - s->d4 * t4;
+        tempe = tempe + s->bstar * s->cc5 * (sin(mm) - s->sinmao);
+        templ = templ + s->t3cof * t3 + t4 * (s->t4cof + t * s->t5cof);
+    }
+
+    double nm = s->no_unkozai;
+    if (nm <= 0.0) return SGP4_ERR_MOTION;
+    double am = pow(XKE / nm, X2O3) * tempa * tempa;
+    nm = XKE / pow(am, 1.5);
+    double em = s->ecco - tempe;
+    if (em >= 1.0 || em < -0.001) return SGP4_ERR_ECC;
+    if (em < 1.0e-6) em = 1.0e-6;
+    mm = mm + s->no_unkozai * templ;
+    double xlm = mm + argpm + nodem;
+    nodem = fmod(nodem, TWOPI);
+    argpm = fmod(argpm, TWOPI);
+    xlm = fmod(xlm, TWOPI);
+    mm = fmod(xlm - argpm - nodem, TWOPI);
+
+    o->am = am;
+    o->em = em;
+    o->nodem = nodem;
+    o->argpm = argpm;
+    o->mm = mm;
+    o->nm = nm;
+    return SGP4_OK;
+}
+
+int sgp4_mean_elements(const Sgp4Sat *s, double tsince_min, Sgp4Mean *m) {
+    if (s->error) return s->error;
+    Secular sc;
+    int err = sgp4_secular(s, tsince_min, &sc);
+    if (err) return err;
+    m->a_km = sc.am * SGP4_RE_KM;
+    m->ecc = sc.em;
+    m->incl = s->inclo;
+    m->node = sc.nodem;
+    m->argp = sc.argpm;
+    /* Periódicos sobre el radio: el largo de J3 desplaza el vector
+       excentricidad en aycof/p, el corto de J2 es el término de mrt en
+       sgp4_propagate y el arrastre cc5 hace oscilar e; +1 km de holgura. */
+    double pl = sc.am * (1.0 - sc.em * sc.em);
+    double temp1 = 0.5 * J2 / pl, temp2 = temp1 / pl;
+    double de = fabs(s->aycof) / pl + 2.0 * fabs(s->bstar * s->cc5);
+    double dr = 1.5 * temp2 * sqrt(1.0 - sc.em * sc.em) * fabs(s->con41) * sc.am * (1.0 + sc.em)
+              + 0.5 * temp1 * fabs(s->x1mth2);
+    m->periodic_km = SGP4_RE_KM * (sc.am * de + dr) + 1.0;
+    return SGP4_OK;
+}
+
+int sgp4_propagate(const Sgp4Sat *s, double t, double r[3], double v[3]) {
+    if (s->error) return s->error;
+    const double XKE = xke();
+    const double vkmpersec = SGP4_RE_KM * XKE / 60.0;
+
+    Secular sc;
+    int err = sgp4_secular(s, t, &sc);
+    if (err) return err;
+    double am = sc.am, em = sc.em, nodem = sc.nodem, argpm = sc.argpm, mm = sc.mm, nm = sc.nm;
+
+    // Periódicos largos
+    double sinip = sin(s->inclo), cosip = cos(s->inclo);
+    double axnl = em * cos(argpm);
+    double temp = 1.0 / (am * (1.0 - em * em));
+    double aynl = em * sin(argpm) + temp * s->aycof;
+    double xl = mm + argpm + nodem + temp * s->xlcof * axnl;
+
+    // Kepler (Newton acotado)
+    double u = fmod(xl - nodem, TWOPI);
+    double eo1 = u, tem5 = 9999.9, sineo1 = 0.0, coseo1 = 1.0;
+    for (int ktr = 1; fabs(tem5) >= 1.0e-12 && ktr <= 10; ktr++) {
+        sineo1 = sin(eo1);
+        coseo1 = cos(eo1);
+        tem5 = 1.0 - coseo1 * axnl - sineo1 * aynl;
+        tem5 = (u - aynl * coseo1 + axnl * sineo1 - eo1) / tem5;
+        if (fabs(tem5) >= 0.95) tem5 = tem5 > 0.0 ? 0.95 : -0.95;
+        eo1 = eo1 + tem5;
+    }
+
+    // Periódicos cortos
+    double ecose = axnl * coseo1 + aynl * sineo1;
+    double esine = axnl * sineo1 - aynl * coseo1;
+    double el2 = axnl * axnl + aynl * aynl;
+    double pl = am * (1.0 - el2);
+    if (pl < 0.0) return SGP4_ERR_SEMILATUS;
+    double rl = am * (1.0 - ecose);
+    double rdotl = sqrt(am) * esine / rl;
+    double rvdotl = sqrt(pl) / rl;
+    double betal = sqrt(1.0 - el2);
+    temp = esine / (1.0 + betal);
+    double sinu = am / rl * (sineo1 - aynl - axnl * temp);
+    double cosu = am / rl * (coseo1 - axnl + aynl * temp);
+    double su = atan2(sinu, cosu);
+    double sin2u = (cosu + cosu) * sinu;
+    double cos2u = 1.0 - 2.0 * sinu * sinu;
+    temp = 1.0 / pl;
+    double temp1 = 0.5 * J2 * temp;
+    double temp2 = temp1 * temp;
+
+    double mrt = rl * (1.0 - 1.5 * temp2 * betal * s->con41) + 0.5 * temp1 * s->x1mth2 * cos2u;
+    su = su - 0.25 * temp2 * s->x7thm1 * sin2u;
+    double xnode = nodem + 1.5 * temp2 * cosip * sin2u;
+    double xinc = s->inclo + 1.5 * temp2 * cosip * sinip * cos2u;
+    double mvt = rdotl - nm * temp1 * s->x1mth2 * sin2u / XKE;
+    double rvdot = rvdotl + nm * temp1 * (s->x1mth2 * cos2u + 1.5 * s->con41) / XKE;
+
+    // Orientación
+    double sinsu = sin(su), cossu = cos(su);
+    double snod = sin(xnode), cnod = cos(xnode);
+    double sini = sin(xinc), cosi = cos(xinc);
+    double xmx = -snod * cosi, xmy = cnod * cosi;
+    double ux = xmx * sinsu + cnod * cossu;
+    double uy = xmy * sinsu + snod * cossu;
+    double uz = sini * sinsu;
+    double vx = xmx * cossu - cnod * sinsu;
+    double vy = xmy * cossu - snod * sinsu;
+    double vz = sini * cossu;
+
+    r[0] = mrt * ux * SGP4_RE_KM;
+    r[1] = mrt * uy * SGP4_RE_KM;
+    r[2] = mrt * uz * SGP4_RE_KM;
+    v[0] = (mvt * ux + rvdot * vx) * vkmpersec;
+    v[1] = (mvt * uy + rvdot * vy) * vkmpersec;
+    v[2] = (mvt * uz + rvdot * vz) * vkmpersec;
+    return (mrt < 1.0) ? SGP4_ERR_DECAYED : SGP4_OK;
+}
+
+double sgp4_gmst(double t_unix) {
+    // IAU-82 (gstime de Vallado), UT1 ~ UTC
+    double tut1 = (t_unix / 86400.0 + 2440587.5 - 2451545.0) / 36525.0;
+    double temp = -6.2e-6 * tut1 * tut1 * tut1 + 0.093104 * tut1 * tut1 +
+                  (876600.0 * 3600.0 + 8640184.812866) * tut1 + 67310.54841;
+    temp = fmod(temp * DEG2RAD / 240.0, TWOPI);
+    return temp < 0.0 ? temp + TWOPI : temp;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TLE
+// ═══════════════════════════════════════════════════════════════════════════
+
+// Columnas [a, b] (1-based, inclusivas) de una línea TLE como texto
+static void field(const char *line, int a, int b, char *buf) {
+    int n = 0, len = (int)strlen(line);
+    for (int c = a; c <= b && c <= len; c++) buf[n++] = line[c - 1];
+    buf[n] = '\0';
+}
+
+static double field_f(const char *line, int a, int b) {
+    char buf[32];
+    field(line, a, b, buf);
+    return strtod(buf, NULL);
+}
+
+// Notación de exponente implícito: " 12345-3" = 0.12345e-3
+static double field_exp(const char *line, int a, int b) {
+    char buf[32], m[16];
+    field(line, a, b, buf);
+    int n = (int)strlen(buf);
+    while (n > 0 && buf[n - 1] == ' ') buf[--n] = '\0';
+    if (n < 2) return 0.0;
+    int e = atoi(buf + n - 2);     // "-4", "+0", " 0"
+    buf[n - 2] = '\0';
+    char *p = buf;
+    while (*p == ' ') p++;
+    int neg = (*p == '-');
+    if (*p == '-' || *p == '+') p++;
+    snprintf(m, sizeof(m), "0.%s", p);
+    double x = strtod(m, NULL) * pow(10.0, e);
+    return neg ? -x : x;
+}
+
+static int tle_checksum_ok(const char *line) {
+    if ((int)strlen(line) < 69 || !isdigit((unsigned char)line[68])) return 1;  // sin checksum
+    int sum = 0;
+    for (int c = 0; c < 68; c++) {
+        if (isdigit((unsigned char)line[c])) sum += line[c] - '0';
+        else if (line[c] == '-') sum++;
+    }
+    return sum % 10 == line[68] - '0';
+}
+
+// Días del 1970-01-01 al 1 de enero de `year`
+static long days_to_year(int year) {
+    long y = year - 1;
+    return 365L * (year - 1970) + (y / 4 - y / 100 + y / 400) - (1969 / 4 - 1969 / 100 + 1969 / 400);
+}
+
+int sgp4_parse_tle(const char *line0, const char *line1, const char *line2, Sgp4Sat *s) {
+    memset(s, 0, sizeof(*s));
+    s->error = SGP4_ERR_PARSE;
+    if (!line1 || !line2 || line1[0] != '1' || line2[0] != '2') return SGP4_ERR_PARSE;
+    if ((int)strlen(line1) < 61 || (int)strlen(line2) < 63) return SGP4_ERR_PARSE;
+    if (!tle_checksum_ok(line1) || !tle_checksum_ok(line2)) return SGP4_ERR_PARSE;
+
+    if (line0) {
+        const char *p = line0;
+        if (p[0] == '0' && p[1] == ' ') p += 2;   // formato "0 NOMBRE"
+        snprintf(s->name, sizeof(s->name), "%s", p);
+        int n = (int)strlen(s->name);
+        while (n > 0 && isspace((unsigned char)s->name[n - 1])) s->name[--n] = '\0';
+    }
+    s->catnum = (int)field_f(line1, 3, 7);
+    int yy = (int)field_f(line1, 19, 20);
+    double day = field_f(line1, 21, 32);
+    int year = yy < 57 ? 2000 + yy : 1900 + yy;
+    s->epoch_unix = ((double)days_to_year(year) + day - 1.0) * 86400.0;
+    s->bstar = field_exp(line1, 54, 61);
+
+    s->inclo = field_f(line2, 9, 16) * DEG2RAD;
+    s->nodeo = field_f(line2, 18, 25) * DEG2RAD;
+    char buf[16];
+    field(line2, 27, 33, buf);
+    char ecc[24];
+    snprintf(ecc, sizeof(ecc), "0.%s", buf);
+    s->ecco = strtod(ecc, NULL);
+    s->argpo = field_f(line2, 35, 42) * DEG2RAD;
+    s->mo = field_f(line2, 44, 51) * DEG2RAD;
+    s->no_kozai = field_f(line2, 53, 63) * TWOPI / 1440.0;
+    if (s->catnum != (int)field_f(line2, 3, 7)) return SGP4_ERR_PARSE;
+
+    return sgp4_init(s);
+}
+
+static void chomp(char *l) {
+    int n = (int)strlen(l);
+    while (n > 0 && (l[n - 1] == '\n' || l[n - 1] == '\r' || l[n - 1] == ' ')) l[--n] = '\0';
+}
+
+int sgp4_load_catalog(const char *path, Sgp4Sat **out, int *bad) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int cap = 1024, n = 0, nbad = 0;
+    Sgp4Sat *S = (Sgp4Sat*)malloc(sizeof(Sgp4Sat) * cap);
+    char name[128] = "", l1[160], line[160];
+    int have_name = 0, have_l1 = 0;
+    while (S && fgets(line, sizeof(line), f)) {
+        chomp(line);
+        if (!line[0] || line[0] == '#') continue;
+        if (line[0] == '1' && line[1] == ' ') {
+            snprintf(l1, sizeof(l1), "%s", line);
+            have_l1 = 1;
+        } else if (line[0] == '2' && line[1] == ' ' && have_l1) {
+            if (n == cap) {
+                cap *= 2;
+                Sgp4Sat *ns = (Sgp4Sat*)realloc(S, sizeof(Sgp4Sat) * cap);
+                if (!ns) { free(S); S = NULL; break; }
+                S = ns;
+            }
+            int err = sgp4_parse_tle(have_name ? name : NULL, l1, line, &S[n]);
+            if (err == SGP4_ERR_PARSE) nbad++;
+            else n++;
+            have_l1 = have_name = 0;
+        } else {
+            snprintf(name, sizeof(name), "%s", line);
+            have_name = 1;
+            have_l1 = 0;
+        }
+    }
+    fclose(f);
+    if (!S) return -1;
+    if (bad) *bad = nbad;
+    *out = S;
+    return n;
+}
@@ -0,0 +1,381 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "sgp4_batch.h"
+#include "eta_kernel.h"
+
+/* libmvec (glibc >= 2.35 en x86-64: sin/cos desde 2.22, atan2 desde 2.35)
+   llega con -lm como dependencia "as-needed"; sin ella solo hay ruta escalar */
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 35))
+#define SGP4B_AVX2 1
+#include <immintrin.h>
+#endif
+
+#define SGP4B_WIDTH 4
+#define TWOPI       6.283185307179586476925286766559
+
+static double xke(void) {
+    return 60.0 / sqrt(SGP4_RE_KM * SGP4_RE_KM * SGP4_RE_KM / SGP4_MU);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Columnas
+// ═══════════════════════════════════════════════════════════════════════════
+
+#define SGP4B_COLUMNS 34
+
+int sgp4_batch_init(Sgp4Batch *B, const Sgp4Sat *S, int n) {
+    memset(B, 0, sizeof(*B));
+    if (n < 0) return -1;
+    B->n = n;
+    B->npad = (n + SGP4B_WIDTH - 1) / SGP4B_WIDTH * SGP4B_WIDTH;
+    B->sat = (Sgp4Sat*)malloc(sizeof(Sgp4Sat) * (n > 0 ? n : 1));
+    B->valid = (unsigned char*)calloc(n > 0 ? n : 1, 1);
+    // Relleno a 0: los carriles sobrantes calculan basura sin efecto
+    B->block = (double*)calloc((size_t)SGP4B_COLUMNS * (B->npad > 0 ? B->npad : 1), sizeof(double));
+    if (!B->sat || !B->valid || !B->block) {
+        sgp4_batch_free(B);
+        return -1;
+    }
+    double **col[SGP4B_COLUMNS] = {
+        &B->epoch, &B->mo, &B->mdot, &B->argpo, &B->argpdot, &B->nodeo, &B->nodedot, &B->nodecf,
+        &B->cc1, &B->bcc4, &B->t2cof, &B->omgcof, &B->eta, &B->xmcof, &B->delmo, &B->d2, &B->d3, &B->d4,
+        &B->bcc5, &B->sinmao, &B->t3cof, &B->t4cof, &B->t5cof, &B->no_unkozai, &B->a0, &B->ecco,
+        &B->inclo, &B->sinip, &B->cosip, &B->aycof, &B->xlcof, &B->con41, &B->x1mth2, &B->x7thm1
+    };
+    for (int c = 0; c < SGP4B_COLUMNS; c++) *col[c] = B->block + (size_t)c * B->npad;
+
+    if (n > 0) memcpy(B->sat, S, sizeof(Sgp4Sat) * n);
+    for (int i = 0; i < n; i++) {
+        const Sgp4Sat *s = &S[i];
+        B->valid[i] = s->error == SGP4_OK;
+        if (!B->valid[i]) continue;
+        int full = !s->isimp;
+        B->epoch[i] = s->epoch_unix;
+        B->mo[i] = s->mo;
+        B->mdot[i] = s->mdot;
+        B->argpo[i] = s->argpo;
+        B->argpdot[i] = s->argpdot;
+        B->nodeo[i] = s->nodeo;
+        B->nodedot[i] = s->nodedot;
+        B->nodecf[i] = s->nodecf;
+        B->cc1[i] = s->cc1;
+        B->bcc4[i] = s->bstar * s->cc4;
+        B->t2cof[i] = s->t2cof;
+        B->omgcof[i] = full ? s->omgcof : 0.0;
+        B->eta[i] = s->eta;
+        B->xmcof[i] = full ? s->xmcof : 0.0;
+        B->delmo[i] = s->delmo;
+        B->d2[i] = full ? s->d2 : 0.0;
+        B->d3[i] = full ? s->d3 : 0.0;
+        B->d4[i] = full ? s->d4 : 0.0;
+        B->bcc5[i] = full ? s->bstar * s->cc5 : 0.0;
+        B->sinmao[i] = s->sinmao;
+        B->t3cof[i] = full ? s->t3cof : 0.0;
+        B->t4cof[i] = full ? s->t4cof : 0.0;
+        B->t5cof[i] = full ? s->t5cof : 0.0;
+        B->no_unkozai[i] = s->no_unkozai;
+        B->a0[i] = s->ao;
+        B->ecco[i] = s->ecco;
+        B->inclo[i] = s->inclo;
+        B->sinip[i] = sin(s->inclo);
+        B->cosip[i] = cos(s->inclo);
+        B->aycof[i] = s->aycof;
+        B->xlcof[i] = s->xlcof;
+        B->con41[i] = s->con41;
+        B->x1mth2[i] = s->x1mth2;
+        B->x7thm1[i] = s->x7thm1;
+    }
+    return 0;
+}
+
+void sgp4_batch_free(Sgp4Batch *B) {
+    if (!B) return;
+    free(B->sat);
+    free(B->valid);
+    free(B->block);
+    memset(B, 0, sizeof(*B));
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Escalar
+// ═══════════════════════════════════════════════════════════════════════════
+
+static int batch_scalar(const Sgp4Batch *B, double t_unix, const unsigned char *active,
+                        double *pos, double *vel, unsigned char *ok) {
+    int m = 0;
+    double vtmp[3];
+    for (int i = 0; i < B->n; i++) {
+        if (active && !active[i]) { ok[i] = 0; continue; }
+        ok[i] = sgp4_at(&B->sat[i], t_unix, pos + 3 * i, vel ? vel + 3 * i : vtmp) == SGP4_OK;
+        m += ok[i];
+    }
+    return m;
+}
+
+#ifdef SGP4B_AVX2
+
+// ═══════════════════════════════════════════════════════════════════════════
+// AVX2: 4 satélites por iteración
+// ═══════════════════════════════════════════════════════════════════════════
+
+__attribute__((target("avx2"))) __m256d _ZGVdN4v_sin(__m256d x);
+__attribute__((target("avx2"))) __m256d _ZGVdN4v_cos(__m256d x);
+__attribute__((target("avx2"))) __m256d _ZGVdN4vv_atan2(__m256d y, __m256d x);
+
+#define V4(x) _mm256_set1_pd(x)
+#define LD(col) _mm256_loadu_pd(B->col + k)
+
+__attribute__((target("avx2")))
+static inline __m256d fmod4(__m256d x, __m256d y) {
+    __m256d q = _mm256_round_pd(x / y, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    return x - q * y;
+}
+
+__attribute__((target("avx2")))
+static inline __m256d abs4(__m256d x) {
+    return _mm256_andnot_pd(V4(-0.0), x);
+}
+
+// Misma secuencia que sgp4_propagate; los errores por carril van en bad
+__attribute__((target("avx2")))
+static void sgp4_lanes_avx2(const Sgp4Batch *B, int k, double t_unix, double out[6][SGP4B_WIDTH],
+                            unsigned *bad) {
+    const double XKE = xke();
+    const __m256d vone = V4(1.0);
+    __m256d t = (V4(t_unix) - LD(epoch)) / V4(60.0);
+
+    // Seculares
+    __m256d xmdf = LD(mo) + LD(mdot) * t;
+    __m256d argpdf = LD(argpo) + LD(argpdot) * t;
+    __m256d nodedf = LD(nodeo) + LD(nodedot) * t;
+    __m256d t2 = t * t;
+    __m256d nodem = nodedf + LD(nodecf) * t2;
+    __m256d tempa = vone - LD(cc1) * t;
+    __m256d tempe = LD(bcc4) * t;
+    __m256d templ = LD(t2cof) * t2;
+    __m256d delomg = LD(omgcof) * t;
+    __m256d delmtemp = vone + LD(eta) * _ZGVdN4v_cos(xmdf);
+    __m256d delm = LD(xmcof) * (delmtemp * delmtemp * delmtemp - LD(delmo));
+    __m256d temp = delomg + delm;
+    __m256d mm = xmdf + temp;
+    __m256d argpm = argpdf - temp;
+    __m256d t3 = t2 * t, t4 = t3 * t;
+    tempa = tempa - LD(d2) * t2 - LD(d3) * t3 - LD(d4) * t4;
+    tempe = tempe + LD(bcc5) * (_ZGVdN4v_sin(mm) - LD(sinmao));
+    templ = templ + LD(t3cof) * t3 + t4 * (LD(t4cof) + t * LD(t5cof));
+
+    __m256d am = LD(a0) * tempa * tempa;
+    __m256d nm = V4(XKE) / (am * _mm256_sqrt_pd(am));
+    __m256d em = LD(ecco) - tempe;
+    unsigned err = (unsigned)_mm256_movemask_pd(_mm256_or_pd(_mm256_cmp_pd(em, vone, _CMP_GE_OQ),
+                                                             _mm256_cmp_pd(em, V4(-0.001), _CMP_LT_OQ)));
+    em = _mm256_max_pd(em, V4(1.0e-6));
+    mm = mm + LD(no_unkozai) * templ;
+    __m256d xlm = mm + argpm + nodem;
+    __m256d vtwopi = V4(TWOPI);
+    nodem = fmod4(nodem, vtwopi);
+    argpm = fmod4(argpm, vtwopi);
+    xlm = fmod4(xlm, vtwopi);
+    mm = fmod4(xlm - argpm - nodem, vtwopi);
+
+    // Periódicos largos
+    __m256d axnl = em * _ZGVdN4v_cos(argpm);
+    temp = vone / (am * (vone - em * em));
+    __m256d aynl = em * _ZGVdN4v_sin(argpm) + temp * LD(aycof);
+    __m256d xl = mm + argpm + nodem + temp * LD(xlcof) * axnl;
+
+    // Kepler: los carriles convergidos conservan seno/coseno del paso previo
+    __m256d u = fmod4(xl - nodem, vtwopi);
+    __m256d eo1 = u, sineo1 = V4(0.0), coseo1 = vone;
+    __m256d live = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    for (int ktr = 1; ktr <= 10 && _mm256_movemask_pd(live); ktr++) {
+        __m256d s = _ZGVdN4v_sin(eo1), c = _ZGVdN4v_cos(eo1);
+        sineo1 = _mm256_blendv_pd(sineo1, s, live);
+        coseo1 = _mm256_blendv_pd(coseo1, c, live);
+        __m256d tem5 = vone - coseo1 * axnl - sineo1 * aynl;
+        tem5 = (u - aynl * coseo1 + axnl * sineo1 - eo1) / tem5;
+        tem5 = _mm256_min_pd(_mm256_max_pd(tem5, V4(-0.95)), V4(0.95));
+        eo1 = _mm256_blendv_pd(eo1, eo1 + tem5, live);
+        live = _mm256_and_pd(live, _mm256_cmp_pd(abs4(tem5), V4(1.0e-12), _CMP_GE_OQ));
+    }
+
+    // Periódicos cortos
+    __m256d ecose = axnl * coseo1 + aynl * sineo1;
+    __m256d esine = axnl * sineo1 - aynl * coseo1;
+    __m256d el2 = axnl * axnl + aynl * aynl;
+    __m256d pl = am * (vone - el2);
+    err |= (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(pl, V4(0.0), _CMP_LT_OQ));
+    __m256d rl = am * (vone - ecose);
+    __m256d rdotl = _mm256_sqrt_pd(am) * esine / rl;
+    __m256d rvdotl = _mm256_sqrt_pd(pl) / rl;
+    __m256d betal = _mm256_sqrt_pd(vone - el2);
+    temp = esine / (vone + betal);
+    __m256d sinu = am / rl * (sineo1 - aynl - axnl * temp);
+    __m256d cosu = am / rl * (coseo1 - axnl + aynl * temp);
+    __m256d su = _ZGVdN4vv_atan2(sinu, cosu);
+    __m256d sin2u = (cosu + cosu) * sinu;
+    __m256d cos2u = vone - V4(2.0) * sinu * sinu;
+    temp = vone / pl;
+    __m256d temp1 = V4(0.5 * SGP4_J2) * temp;
+    __m256d temp2 = temp1 * temp;
+
+    __m256d con41 = LD(con41), x1mth2 = LD(x1mth2), cosip = LD(cosip);
+    __m256d mrt = rl * (vone - V4(1.5) * temp2 * betal * con41) + V4(0.5) * temp1 * x1mth2 * cos2u;
+    su = su - V4(0.25) * temp2 * LD(x7thm1) * sin2u;
+    __m256d xnode = nodem + V4(1.5) * temp2 * cosip * sin2u;
+    __m256d xinc = LD(inclo) + V4(1.5) * temp2 * cosip * LD(sinip) * cos2u;
+    __m256d mvt = rdotl - nm * temp1 * x1mth2 * sin2u / V4(XKE);
+    __m256d rvdot = rvdotl + nm * temp1 * (x1mth2 * cos2u + V4(1.5) * con41) / V4(XKE);
+    err |= (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(mrt, vone, _CMP_LT_OQ));
+
+    // Orientación
+    __m256d sinsu = _ZGVdN4v_sin(su), cossu = _ZGVdN4v_cos(su);
+    __m256d snod = _ZGVdN4v_sin(xnode), cnod = _ZGVdN4v_cos(xnode);
+    __m256d sini = _ZGVdN4v_sin(xinc), cosi = _ZGVdN4v_cos(xinc);
+    __m256d xmx = -snod * cosi, xmy = cnod * cosi;
+    __m256d ux = xmx * sinsu + cnod * cossu;
+    __m256d uy = xmy * sinsu + snod * cossu;
+    __m256d uz = sini * sinsu;
+    __m256d vx = xmx * cossu - cnod * sinsu;
+    __m256d vy = xmy * cossu - snod * sinsu;
+    __m256d vz = sini * cossu;
+
+    const __m256d re = V4(SGP4_RE_KM), vkm = V4(SGP4_RE_KM * XKE / 60.0);
+    _mm256_storeu_pd(out[0], mrt * ux * re);
+    _mm256_storeu_pd(out[1], mrt * uy * re);
+    _mm256_storeu_pd(out[2], mrt * uz * re);
+    _mm256_storeu_pd(out[3], (mvt * ux + rvdot * vx) * vkm);
+    _mm256_storeu_pd(out[4], (mvt * uy + rvdot * vy) * vkm);
+    _mm256_storeu_pd(out[5], (mvt * uz + rvdot * vz) * vkm);
+    *bad = err;
+}
+
+__attribute__((target("avx2")))
+static int batch_avx2(const Sgp4Batch *B, double t_unix, const unsigned char *active,
+                      double *pos, double *vel, unsigned char *ok) {
+    double out[6][SGP4B_WIDTH];
+    int m = 0;
+    for (int k = 0; k < B->n; k += SGP4B_WIDTH) {
+        int w = B->n - k < SGP4B_WIDTH ? B->n - k : SGP4B_WIDTH;
+        int any = 0;
+        for (int l = 0; l < w; l++) any |= B->valid[k + l] && (!active || active[k + l]);
+        if (!any) {
+            memset(ok + k, 0, w);
+            continue;
+        }
+        unsigned bad;
+        sgp4_lanes_avx2(B, k, t_unix, out, &bad);
+        for (int l = 0; l < w; l++) {
+            int i = k + l;
+            ok[i] = B->valid[i] && !(bad >> l & 1u) && (!active || active[i]);
+            if (!ok[i]) continue;
+            m++;
+            pos[3 * i] = out[0][l];
+            pos[3 * i + 1] = out[1][l];
+            pos[3 * i + 2] = out[2][l];
+            if (vel) {
+                vel[3 * i] = out[3][l];
+                vel[3 * i + 1] = out[4][l];
+                vel[3 * i + 2] = out[5][l];
+            }
+        }
+    }
+    return m;
+}
+
+#undef LD
+#undef V4
+
+#endif // SGP4B_AVX2
+
+// ═══════════════════════════════════════════════════════════════════════════
+// API
+// ═══════════════════════════════════════════════════════════════════════════
+
+int sgp4_batch_at(const Sgp4Batch *B, double t_unix, const unsigned char *active,
+                  double *pos, double *vel, unsigned char *ok) {
+#ifdef SGP4B_AVX2
+    if (cgr_simd_level() >= CGR_SIMD_AVX2) return batch_avx2(B, t_unix, active, pos, vel, ok);
+#endif
+    return batch_scalar(B, t_unix, active, pos, vel, ok);
+}
+
+typedef struct
+{
+    const Sgp4Batch *B;
+    const double *t;
+    int nt;
+    double *pos, *vel;
+    unsigned char *ok;
+    atomic_int next;
+} GridShared;
+
+static void* grid_worker(void *arg) {
+    GridShared *G = (GridShared*)arg;
+    size_t n = (size_t)G->B->n;
+    int k;
+    while ((k = atomic_fetch_add(&G->next, 1)) < G->nt)
+        sgp4_batch_at(G->B, G->t[k], NULL, G->pos + 3 * n * k, G->vel ? G->vel + 3 * n * k : NULL,
+                      G->ok + n * k);
+    return NULL;
+}
+
+int sgp4_batch_grid(const Sgp4Batch *B, const double *t_unix, int nt,
+                    double *pos, double *vel, unsigned char *ok, int threads) {
+    if (!B || !t_unix || nt < 0 || !pos || !ok) return -1;
+    GridShared G = { .B = B, .t = t_unix, .nt = nt, .pos = pos, .vel = vel, .ok = ok };
+    atomic_init(&G.next, 0);
+    if (threads < 1) threads = 1;
+    if (threads > nt) threads = nt > 0 ? nt : 1;
+    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t) * threads);
+    int started = 1;
+    for (int i = 1; th && i < threads; i++) {
+        if (pthread_create(&th[i], NULL, grid_worker, &G) != 0) break;
+        started++;
+    }
+    grid_worker(&G);
+    for (int i = 1; i < started; i++) pthread_join(th[i], NULL);
+    free(th);
+    return 0;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Interfaz plana (ctypes)
+// ═══════════════════════════════════════════════════════════════════════════
+
+Sgp4Batch* sgp4_batch_from_tle(const char *const *line1, const char *const *line2, int n) {
+    if (n < 0 || (n > 0 && (!line1 || !line2))) return NULL;
+    Sgp4Sat *S = (Sgp4Sat*)calloc(n > 0 ? n : 1, sizeof(Sgp4Sat));
+    Sgp4Batch *B = (Sgp4Batch*)malloc(sizeof(Sgp4Batch));
+    if (!S || !B) {
+        free(S);
+        free(B);
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) {
+        if (!line1[i] || !line2[i] || sgp4_parse_tle(NULL, line1[i], line2[i], &S[i]) == SGP4_ERR_PARSE)
+            S[i].error = SGP4_ERR_PARSE;
+    }
+    int rc = sgp4_batch_init(B, S, n);
+    free(S);
+    if (rc != 0) {
+        free(B);
+        return NULL;
+    }
+    return B;
+}
+
+void sgp4_batch_destroy(Sgp4Batch *B) {
+    sgp4_batch_free(B);
+    free(B);
+}
+
+int sgp4_batch_valid(const Sgp4Batch *B, unsigned char *valid) {
+    int m = 0;
+    for (int i = 0; i < B->n; i++) m += valid[i] = B->valid[i];
+    return m;
+}
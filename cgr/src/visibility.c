@@ -0,0 +1,566 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "visibility.h"
+
+#define VIS_PI            3.14159265358979323846
+#define VIS_DEFAULT_STEP  60.0
+#define VIS_DEFAULT_TOL   1e-3
+#define VIS_CHUNK_STEPS   256     // muestras propagadas de una vez (memoria: pasos·n·48 B)
+#define VIS_BLOCK_LINKS   256     // enlaces por unidad de trabajo de un hilo
+#define VIS_DERIV_S       0.5     // paso de la derivada en las muestras
+#define VIS_OMEGA_E       7.292115146706979e-5 // rotación terrestre (rad/s)
+#define VIS_WGS84_A       6378.137
+#define VIS_WGS84_E2      6.69437999014e-3
+#define VIS_C_KM_S        299792.458
+#define VIS_INVALID       -1e9    // g de un satélite que SGP4 no puede propagar
+
+static double vis_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline double dot3(const double *a, const double *b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline void rot_z(const double *v, double c, double s, double *o) {
+    o[0] = c * v[0] - s * v[1];
+    o[1] = s * v[0] + c * v[1];
+    o[2] = v[2];
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Funciones de visibilidad (g > 0 = línea de vista)
+// ═══════════════════════════════════════════════════════════════════════════
+
+// Elevación sobre la máscara (rad); *range = distancia estación-satélite
+static inline double g_station(const double *rs, const double *rg, const double *up, double mask,
+                               double *range) {
+    double rho[3] = { rs[0] - rg[0], rs[1] - rg[1], rs[2] - rg[2] };
+    double d = sqrt(dot3(rho, rho));
+    *range = d;
+    double se = dot3(rho, up) / d;
+    if (se > 1.0) se = 1.0;
+    if (se < -1.0) se = -1.0;
+    return asin(se) - mask;
+}
+
+/* Altura sobre la Tierra (esfera de radio ecuatorial) del punto del segmento
+   r1-r2 más cercano al centro, menos grazing; con alcance, también
+   alcance - distancia (el mínimo de las dos). */
+static inline double g_isl(const double *r1, const double *r2, double grazing, double range_km,
+                           double *range) {
+    double d[3] = { r2[0] - r1[0], r2[1] - r1[1], r2[2] - r1[2] };
+    double dd = dot3(d, d);
+    *range = sqrt(dd);
+    double s = dd > 0.0 ? -dot3(r1, d) / dd : 0.0;
+    if (s < 0.0) s = 0.0;
+    if (s > 1.0) s = 1.0;
+    double p[3] = { r1[0] + s * d[0], r1[1] + s * d[1], r1[2] + s * d[2] };
+    double g = sqrt(dot3(p, p)) - SGP4_RE_KM - grazing;
+    if (range_km > 0.0 && range_km - *range < g) g = range_km - *range;
+    return g;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Estado compartido
+// ═══════════════════════════════════════════════════════════════════════════
+
+typedef struct
+{
+    int station;            // -1 = ISL
+    int a, b;
+} VisLink;
+
+// Estado de un enlace entre trozos de muestras
+typedef struct
+{
+    double t_open;          // inicio de la ventana abierta (NAN = cerrada)
+    double dmin, dmax;
+    int clip;
+} LinkState;
+
+typedef struct
+{
+    VisWindow *w;
+    int count, cap;
+} WinVec;
+
+typedef struct
+{
+    const Sgp4Batch *B;
+    const VisStation *st;
+    int nst;
+    const VisConfig *cfg;
+    double step, tol;
+    double *mask;           // [nst] rad
+    double *st_ecef, *st_up;// [nst·3] fijos en la Tierra
+    // Trozo actual: muestras k0 .. k0 + nk - 1
+    int k0, nk;
+    double *pos, *vel;      // [nk · n · 3] TEME
+    unsigned char *ok;      // [nk · n]
+    double *st_pos, *st_upt;// [nk · nst · 3] estaciones en TEME
+    const VisLink *links;
+    LinkState *state;
+    int nlinks, blocks;
+    atomic_int next_block;
+    atomic_int err;
+    pthread_mutex_t mu;
+    WinVec out;
+    uint64_t roots, peaks;
+} VisShared;
+
+static int winvec_push(WinVec *V, const VisWindow *x) {
+    if (V->count == V->cap) {
+        int nc = V->cap ? V->cap * 2 : 256;
+        VisWindow *nw = (VisWindow*)realloc(V->w, sizeof(VisWindow) * nc);
+        if (!nw) return -1;
+        V->w = nw;
+        V->cap = nc;
+    }
+    V->w[V->count++] = *x;
+    return 0;
+}
+
+static void station_teme(const VisShared *X, int s, double t, double *r, double *up) {
+    double th = sgp4_gmst(t), c = cos(th), sn = sin(th);
+    rot_z(X->st_ecef + 3 * s, c, sn, r);
+    rot_z(X->st_up + 3 * s, c, sn, up);
+}
+
+// g exacto en cualquier t (SGP4 de los satélites del enlace)
+static double g_exact(const VisShared *X, const VisLink *L, double t, double *range) {
+    double ra[3], rb[3], va[3];
+    *range = NAN;
+    if (sgp4_at(&X->B->sat[L->a], t, ra, va) != SGP4_OK) return VIS_INVALID;
+    if (L->station >= 0) {
+        double up[3];
+        station_teme(X, L->station, t, rb, up);
+        return g_station(ra, rb, up, X->mask[L->station], range);
+    }
+    if (sgp4_at(&X->B->sat[L->b], t, rb, va) != SGP4_OK) return VIS_INVALID;
+    return g_isl(ra, rb, X->cfg->grazing_km, X->cfg->isl_range_km, range);
+}
+
+/* g en la muestra j del trozo desplazada dt segundos (solo para derivadas:
+   satélites con su velocidad, estaciones con la rotación terrestre) */
+static double g_sample(const VisShared *X, const VisLink *L, int j, double dt, double *range) {
+    size_t n = (size_t)X->B->n;
+    const unsigned char *ok = X->ok + n * j;
+    if (!ok[L->a] || (L->station < 0 && !ok[L->b])) {
+        *range = NAN;
+        return VIS_INVALID;
+    }
+    const double *pa = X->pos + 3 * (n * j + L->a), *va = X->vel + 3 * (n * j + L->a);
+    double ra[3] = { pa[0] + va[0] * dt, pa[1] + va[1] * dt, pa[2] + va[2] * dt };
+    if (L->station >= 0) {
+        const double *rg = X->st_pos + 3 * ((size_t)X->nst * j + L->station);
+        const double *up = X->st_upt + 3 * ((size_t)X->nst * j + L->station);
+        if (dt == 0.0) return g_station(ra, rg, up, X->mask[L->station], range);
+        double c = cos(VIS_OMEGA_E * dt), s = sin(VIS_OMEGA_E * dt), rg2[3], up2[3];
+        rot_z(rg, c, s, rg2);
+        rot_z(up, c, s, up2);
+        return g_station(ra, rg2, up2, X->mask[L->station], range);
+    }
+    const double *pb = X->pos + 3 * (n * j + L->b), *vb = X->vel + 3 * (n * j + L->b);
+    double rb[3] = { pb[0] + vb[0] * dt, pb[1] + vb[1] * dt, pb[2] + vb[2] * dt };
+    return g_isl(ra, rb, X->cfg->grazing_km, X->cfg->isl_range_km, range);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Bordes y máximos
+// ═══════════════════════════════════════════════════════════════════════════
+
+/* Raíz de g en [ta, tb] (signos opuestos) con regula falsi Illinois y una
+   bisección cada cuatro iteraciones para garantizar la convergencia. Devuelve
+   el extremo visible del intervalo final: la ventana nunca se reporta más
+   larga de lo que es. *range = alcance en ese extremo. */
+static double refine_root(const VisShared *X, const VisLink *L, double ta, double ga, double tb,
+                          double gb, double *range) {
+    double ra = NAN, rb = NAN;
+    int side = 0;
+    for (int it = 0; tb - ta > X->tol && it < 100; it++) {
+        double t = (it & 3) == 3 ? 0.5 * (ta + tb) : (ga * tb - gb * ta) / (ga - gb);
+        if (!(t > ta && t < tb)) t = 0.5 * (ta + tb);
+        double rt, gt = g_exact(X, L, t, &rt);
+        if ((gt > 0.0) == (gb > 0.0)) {
+            tb = t; gb = gt; rb = rt;
+            if (side == -1) ga *= 0.5;
+            side = -1;
+        } else {
+            ta = t; ga = gt; ra = rt;
+            if (side == 1) gb *= 0.5;
+            side = 1;
+        }
+    }
+    double t = ga > 0.0 ? ta : tb, r = ga > 0.0 ? ra : rb;
+    if (isnan(r)) g_exact(X, L, t, &r);
+    *range = r;
+    return t;
+}
+
+/* Máximo de sg·g en [ta, tb] (sección áurea; sg = -1 busca el mínimo);
+   *tm y *rm en el extremo. Para en cuanto g cambia de signo: basta un punto. */
+static double find_peak(const VisShared *X, const VisLink *L, double sg, double ta, double tb,
+                        double *tm, double *rm) {
+    const double ig = 0.6180339887498949;
+    double x1 = tb - ig * (tb - ta), x2 = ta + ig * (tb - ta), r1, r2;
+    double f1 = sg * g_exact(X, L, x1, &r1), f2 = sg * g_exact(X, L, x2, &r2);
+    for (int it = 0; tb - ta > X->tol && it < 80; it++) {
+        if (f1 > 0.0 || f2 > 0.0) break;
+        if (f1 < f2) {
+            ta = x1; x1 = x2; f1 = f2; r1 = r2;
+            x2 = ta + ig * (tb - ta);
+            f2 = sg * g_exact(X, L, x2, &r2);
+        } else {
+            tb = x2; x2 = x1; f2 = f1; r2 = r1;
+            x1 = tb - ig * (tb - ta);
+            f1 = sg * g_exact(X, L, x1, &r1);
+        }
+    }
+    int first = f1 >= f2;
+    *tm = first ? x1 : x2;
+    *rm = first ? r1 : r2;
+    return sg * (first ? f1 : f2);
+}
+
+/* Extremo de sg·alcance en [ta, tb] (sección áurea; sg = 1 el máximo, -1 el
+   mínimo). El alcance de un intervalo entre muestras es unimodal: si el
+   extremo cae fuera, converge al borde, que ya está contado. */
+static double range_peak(const VisShared *X, const VisLink *L, double sg, double ta, double tb) {
+    const double ig = 0.6180339887498949;
+    double x1 = tb - ig * (tb - ta), x2 = ta + ig * (tb - ta), r1, r2;
+    g_exact(X, L, x1, &r1);
+    g_exact(X, L, x2, &r2);
+    for (int it = 0; tb - ta > X->tol && it < 80; it++) {
+        if (sg * r1 > sg * r2) {
+            tb = x2; x2 = x1; r2 = r1;
+            x1 = tb - ig * (tb - ta);
+            g_exact(X, L, x1, &r1);
+        } else {
+            ta = x1; x1 = x2; r1 = r2;
+            x2 = ta + ig * (tb - ta);
+            g_exact(X, L, x2, &r2);
+        }
+    }
+    return sg * r1 > sg * r2 ? r1 : r2;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Barrido por enlace
+// ═══════════════════════════════════════════════════════════════════════════
+
+typedef struct
+{
+    WinVec win;
+    uint64_t roots, peaks;
+    int oom;
+} VisLocal;
+
+static void window_open(LinkState *S, double t, double range, int clip) {
+    S->t_open = t;
+    S->dmin = S->dmax = range;
+    S->clip = clip;
+}
+
+static inline void window_range(LinkState *S, double range) {
+    if (isnan(range) || isnan(S->t_open)) return;
+    if (range < S->dmin) S->dmin = range;
+    if (range > S->dmax) S->dmax = range;
+}
+
+/* Tramo visible [ta, tb] de un intervalo cuyo alcance tiene un extremo
+   entre las muestras (ext = 1 máximo, -1 mínimo, 0 ninguno): las muestras
+   y los bordes no lo ven, y max_km es la cota del retardo. */
+static void window_span(const VisShared *X, const VisLink *L, LinkState *S, int ext, double ta, double tb) {
+    if (ext && tb > ta) window_range(S, range_peak(X, L, ext, ta, tb));
+}
+
+static void window_close(VisLocal *W, const VisLink *L, LinkState *S, double t, double range, int clip) {
+    window_range(S, range);
+    VisWindow w = { .station = L->station, .a = L->a, .b = L->b, .t_start = S->t_open, .t_end = t,
+                    .min_km = S->dmin, .max_km = S->dmax, .owlt_s = S->dmax / VIS_C_KM_S,
+                    .clip = S->clip | clip };
+    S->t_open = NAN;
+    if (w.t_end > w.t_start && winvec_push(&W->win, &w) != 0) W->oom = 1;
+}
+
+/* Un intervalo [t_{j-1}, t_j] del enlace: cambio de signo -> raíz. Sin
+   cambio, un extremo de g entre las muestras puede esconder una ventana
+   corta (las dos negativas) o un corte corto (las dos positivas): si las
+   derivadas en los bordes tienen signos opuestos y la intersección de las
+   tangentes (cota de g cerca del extremo) cruza el cero, se busca el
+   extremo. Igual con el alcance: si su derivada cambia de signo, el
+   extremo se busca en el tramo visible. */
+static void scan_interval(const VisShared *X, VisLocal *W, const VisLink *L, LinkState *S, int j,
+                          double ga, double ra, double gb, double rb) {
+    double ta = X->cfg->t_begin + (X->k0 + j - 1) * X->step;
+    double tb = X->cfg->t_begin + (X->k0 + j) * X->step;
+    if (tb > X->cfg->t_end) tb = X->cfg->t_end;
+    double r;
+    if (ga == VIS_INVALID || gb == VIS_INVALID) {
+        // Satélite sin propagación válida: se corta en la última muestra buena
+        if (!isnan(S->t_open)) window_close(W, L, S, ta, NAN, 0);
+        if (gb > 0.0 && gb != VIS_INVALID) window_open(S, tb, rb, 0);
+        return;
+    }
+    // Derivadas en los bordes (alcance en ta + VIS_DERIV_S y tb - VIS_DERIV_S)
+    double ra1, rb1;
+    double da = (g_sample(X, L, j - 1, VIS_DERIV_S, &ra1) - ga) / VIS_DERIV_S;
+    double db = (gb - g_sample(X, L, j, -VIS_DERIV_S, &rb1)) / VIS_DERIV_S;
+    int ext = ra1 > ra && rb1 > rb ? 1 : ra1 < ra && rb1 < rb ? -1 : 0;
+    if (ga > 0.0 && gb > 0.0) {
+        double ts = (gb - ga + da * ta - db * tb) / (da - db);
+        if (da < 0.0 && db > 0.0 && ga + da * (ts - ta) < 0.0) {
+            W->peaks++;
+            double tm, rm, gm = find_peak(X, L, -1.0, ta, tb, &tm, &rm);
+            if (gm <= 0.0) {
+                double t0 = refine_root(X, L, ta, ga, tm, gm, &r);
+                window_span(X, L, S, ext, ta, t0);
+                window_close(W, L, S, t0, r, 0);
+                double t1 = refine_root(X, L, tm, gm, tb, gb, &r);
+                W->roots += 2;
+                window_open(S, t1, r, 0);
+                window_span(X, L, S, ext, t1, tb);
+                window_range(S, rb);
+                return;
+            }
+        }
+        window_span(X, L, S, ext, ta, tb);
+        window_range(S, rb);
+        return;
+    }
+    if (ga > 0.0) {
+        double t = refine_root(X, L, ta, ga, tb, gb, &r);
+        W->roots++;
+        window_span(X, L, S, ext, ta, t);
+        window_close(W, L, S, t, r, 0);
+        return;
+    }
+    if (gb > 0.0) {
+        double t = refine_root(X, L, ta, ga, tb, gb, &r);
+        W->roots++;
+        window_open(S, t, r, 0);
+        window_span(X, L, S, ext, t, tb);
+        window_range(S, rb);
+        return;
+    }
+    if (!(da > 0.0 && db < 0.0)) return;
+    double ts = (gb - ga + da * ta - db * tb) / (da - db);
+    if (ga + da * (ts - ta) <= 0.0) return;
+    W->peaks++;
+    double tm, rm, gm = find_peak(X, L, 1.0, ta, tb, &tm, &rm);
+    if (gm <= 0.0) return;
+    double t0 = refine_root(X, L, ta, ga, tm, gm, &r);
+    window_open(S, t0, r, 0);
+    window_range(S, rm);
+    double t1 = refine_root(X, L, tm, gm, tb, gb, &r);
+    W->roots += 2;
+    window_span(X, L, S, ext, t0, t1);
+    window_close(W, L, S, t1, r, 0);
+}
+
+static void scan_link(const VisShared *X, VisLocal *W, const VisLink *L, LinkState *S) {
+    double rp, r, gp = g_sample(X, L, 0, 0.0, &rp);
+    // Primera muestra del intervalo: ventana ya abierta en t_begin
+    if (X->k0 == 0 && gp > 0.0 && gp != VIS_INVALID) window_open(S, X->cfg->t_begin, rp, VIS_CLIP_START);
+    for (int j = 1; j < X->nk; j++) {
+        double g = g_sample(X, L, j, 0.0, &r);
+        scan_interval(X, W, L, S, j, gp, rp, g, r);
+        gp = g;
+        rp = r;
+    }
+}
+
+static void* vis_worker(void *arg) {
+    VisShared *X = (VisShared*)arg;
+    VisLocal W = { 0 };
+    int b;
+    while (!W.oom && !atomic_load(&X->err) && (b = atomic_fetch_add(&X->next_block, 1)) < X->blocks) {
+        int l1 = (b + 1) * VIS_BLOCK_LINKS;
+        if (l1 > X->nlinks) l1 = X->nlinks;
+        for (int l = b * VIS_BLOCK_LINKS; l < l1; l++) scan_link(X, &W, &X->links[l], &X->state[l]);
+    }
+    pthread_mutex_lock(&X->mu);
+    X->roots += W.roots;
+    X->peaks += W.peaks;
+    for (int k = 0; !W.oom && k < W.win.count; k++)
+        if (winvec_push(&X->out, &W.win.w[k]) != 0) W.oom = 1;
+    pthread_mutex_unlock(&X->mu);
+    if (W.oom) atomic_store(&X->err, 1);
+    free(W.win.w);
+    return NULL;
+}
+
+static int run_workers(VisShared *X, int threads) {
+    atomic_init(&X->next_block, 0);
+    if (threads < 1) threads = 1;
+    if (threads > X->blocks) threads = X->blocks;
+    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t) * (threads > 0 ? threads : 1));
+    int started = 1;
+    for (int t = 1; th && t < threads; t++) {
+        if (pthread_create(&th[t], NULL, vis_worker, X) != 0) break;
+        started++;
+    }
+    vis_worker(X);
+    for (int t = 1; t < started; t++) pthread_join(th[t], NULL);
+    free(th);
+    return atomic_load(&X->err) ? -1 : 0;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// API
+// ═══════════════════════════════════════════════════════════════════════════
+
+static int cmp_window(const void *x, const void *y) {
+    const VisWindow *a = (const VisWindow*)x, *b = (const VisWindow*)y;
+    if (a->t_start != b->t_start) return a->t_start < b->t_start ? -1 : 1;
+    if (a->station != b->station) return a->station < b->station ? -1 : 1;
+    if (a->a != b->a) return a->a < b->a ? -1 : 1;
+    return (a->b > b->b) - (a->b < b->b);
+}
+
+static void station_setup(VisShared *X) {
+    for (int s = 0; s < X->nst; s++) {
+        const VisStation *g = &X->st[s];
+        double lat = g->lat_deg * VIS_PI / 180.0, lon = g->lon_deg * VIS_PI / 180.0;
+        double sl = sin(lat), cl = cos(lat);
+        double nr = VIS_WGS84_A / sqrt(1.0 - VIS_WGS84_E2 * sl * sl);
+        double *r = X->st_ecef + 3 * s, *up = X->st_up + 3 * s;
+        r[0] = (nr + g->alt_km) * cl * cos(lon);
+        r[1] = (nr + g->alt_km) * cl * sin(lon);
+        r[2] = (nr * (1.0 - VIS_WGS84_E2) + g->alt_km) * sl;
+        up[0] = cl * cos(lon);
+        up[1] = cl * sin(lon);
+        up[2] = sl;
+        X->mask[s] = g->min_elev_deg * VIS_PI / 180.0;
+    }
+}
+
+static VisLink* build_links(const Sgp4Batch *B, int nst, int isl, int *count) {
+    size_t nv = 0;
+    for (int i = 0; i < B->n; i++) nv += B->valid[i];
+    size_t cap = (size_t)nst * nv + (isl ? nv * (nv - (nv > 0)) / 2 : 0);
+    if (cap > (size_t)0x7fffffff) return NULL;
+    VisLink *L = (VisLink*)malloc(sizeof(VisLink) * (cap > 0 ? cap : 1));
+    if (!L) return NULL;
+    int m = 0;
+    for (int s = 0; s < nst; s++)
+        for (int i = 0; i < B->n; i++)
+            if (B->valid[i]) L[m++] = (VisLink){ s, i, -1 };
+    if (isl)
+        for (int a = 0; a < B->n; a++)
+            for (int b = a + 1; B->valid[a] && b < B->n; b++)
+                if (B->valid[b]) L[m++] = (VisLink){ -1, a, b };
+    *count = m;
+    return L;
+}
+
+int vis_windows(const Sgp4Batch *B, const VisStation *st, int nst, const VisConfig *cfg, VisResult *out) {
+    if (!out) return -1;
+    memset(out, 0, sizeof(*out));
+    if (!B || !cfg || nst < 0 || (nst > 0 && !st) || !(cfg->t_end >= cfg->t_begin)) return -1;
+
+    double t0 = vis_now();
+    VisShared X;
+    memset(&X, 0, sizeof(X));
+    X.B = B;
+    X.st = st;
+    X.nst = nst;
+    X.cfg = cfg;
+    X.step = cfg->step_s > 0.0 ? cfg->step_s : VIS_DEFAULT_STEP;
+    X.tol = cfg->tol_s > 0.0 ? cfg->tol_s : VIS_DEFAULT_TOL;
+    atomic_init(&X.err, 0);
+    // Última muestra en t_end aunque no caiga en el paso
+    int steps = (int)ceil((cfg->t_end - cfg->t_begin) / X.step - 1e-9) + 1;
+    if (steps < 2) steps = 2;
+    int chunk = VIS_CHUNK_STEPS + 1;
+    size_t n = (size_t)B->n;
+
+    X.links = build_links(B, nst, cfg->isl, &X.nlinks);
+    X.state = (LinkState*)malloc(sizeof(LinkState) * (X.nlinks > 0 ? X.nlinks : 1));
+    X.mask = (double*)malloc(sizeof(double) * (nst > 0 ? nst : 1));
+    X.st_ecef = (double*)malloc(sizeof(double) * 3 * (nst > 0 ? nst : 1));
+    X.st_up = (double*)malloc(sizeof(double) * 3 * (nst > 0 ? nst : 1));
+    X.pos = (double*)malloc(sizeof(double) * 3 * n * chunk + 1);
+    X.vel = (double*)malloc(sizeof(double) * 3 * n * chunk + 1);
+    X.ok = (unsigned char*)malloc(n * chunk + 1);
+    X.st_pos = (double*)malloc(sizeof(double) * 3 * (nst > 0 ? nst : 1) * chunk);
+    X.st_upt = (double*)malloc(sizeof(double) * 3 * (nst > 0 ? nst : 1) * chunk);
+    double *tk = (double*)malloc(sizeof(double) * chunk);
+    int rc = -1;
+    if (!X.links || !X.state || !X.mask || !X.st_ecef || !X.st_up || !X.pos || !X.vel || !X.ok ||
+        !X.st_pos || !X.st_upt || !tk)
+        goto done;
+    station_setup(&X);
+    for (int l = 0; l < X.nlinks; l++) X.state[l].t_open = NAN;
+    X.blocks = (X.nlinks + VIS_BLOCK_LINKS - 1) / VIS_BLOCK_LINKS;
+    pthread_mutex_init(&X.mu, NULL);
+
+    rc = 0;
+    // Trozos de muestras que se solapan en una (la última de uno es la primera del siguiente)
+    for (int k0 = 0; rc == 0 && k0 < steps - 1; k0 += VIS_CHUNK_STEPS) {
+        X.k0 = k0;
+        X.nk = steps - k0 < chunk ? steps - k0 : chunk;
+        for (int j = 0; j < X.nk; j++) {
+            tk[j] = cfg->t_begin + (k0 + j) * X.step;
+            if (tk[j] > cfg->t_end) tk[j] = cfg->t_end;
+            for (int s = 0; s < nst; s++)
+                station_teme(&X, s, tk[j], X.st_pos + 3 * ((size_t)nst * j + s), X.st_upt + 3 * ((size_t)nst * j + s));
+        }
+        if (sgp4_batch_grid(B, tk, X.nk, X.pos, X.vel, X.ok, cfg->threads) != 0) rc = -1;
+        else if (X.blocks > 0) rc = run_workers(&X, cfg->threads);
+    }
+    // Ventanas abiertas al final del intervalo
+    if (rc == 0) {
+        VisLocal W = { .win = X.out };
+        for (int l = 0; l < X.nlinks; l++) {
+            if (isnan(X.state[l].t_open)) continue;
+            double r;
+            g_exact(&X, &X.links[l], cfg->t_end, &r);
+            window_close(&W, &X.links[l], &X.state[l], cfg->t_end, r, VIS_CLIP_END);
+        }
+        X.out = W.win;
+        if (W.oom) rc = -1;
+    }
+    pthread_mutex_destroy(&X.mu);
+    if (rc == 0) {
+        qsort(X.out.w, X.out.count, sizeof(VisWindow), cmp_window);
+        out->items = X.out.w;
+        out->count = X.out.count;
+        X.out.w = NULL;
+    }
+    out->links = (uint64_t)X.nlinks;
+    out->steps = steps;
+    out->roots = X.roots;
+    out->peaks = X.peaks;
+
+done:
+    free((void*)X.links);
+    free(X.state);
+    free(X.mask);
+    free(X.st_ecef);
+    free(X.st_up);
+    free(X.pos);
+    free(X.vel);
+    free(X.ok);
+    free(X.st_pos);
+    free(X.st_upt);
+    free(X.out.w);
+    free(tk);
+    out->elapsed_s = vis_now() - t0;
+    return rc;
+}
+
+void vis_result_free(VisResult *r) {
+    if (!r) return;
+    free(r->items);
+    r->items = NULL;
+    r->count = 0;
+}
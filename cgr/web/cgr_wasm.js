@@ -0,0 +1,150 @@
+// Browser front of the C routing core compiled to WebAssembly (make wasm →
+// cgr_core.js + cgr_core.wasm; API in include/cgr_wasm.h).
+//
+// Contacts live in the module's linear memory as C `Contact` structs. The
+// plan is written in place through Int32Array / Float64Array views over that
+// memory (no serialization, no intermediate copy) and read back the same way,
+// so residual capacity can be updated between queries without re-uploading.
+// Views are rebuilt on every plan() call: growing the WASM memory detaches
+// the old ones.
+//
+// Route objects have the same shape as the JS router's (found, eta, latency,
+// hops, contact_ids, nodes), with contact_ids mapped back to the record ids
+// given to setContacts.
+
+(function (root) {
+  'use strict';
+
+  // Indices of cgrw_layout() (CGRW_L_* in cgr_wasm.h)
+  const L_SIZE = 0, L_ID = 1, L_FROM = 2, L_TO = 3, L_T_START = 4, L_T_END = 5,
+        L_OWLT = 6, L_RATE = 7, L_SETUP = 8, L_RESIDUAL = 9, L_P_FAIL = 10, L_COUNT = 11;
+
+  class CgrWasm {
+    // factory: the CgrCore function from cgr_core.js
+    static async load(factory, moduleArgs) {
+      return new CgrWasm(await factory(moduleArgs || {}));
+    }
+
+    constructor(mod) {
+      this.mod = mod;
+      const L = new Int32Array(mod.HEAPU8.buffer, mod._cgrw_layout(), L_COUNT).slice();
+      if (L[L_SIZE] % 8 !== 0) throw new Error('cgr_wasm: unexpected Contact layout');
+      this.stride = L[L_SIZE];
+      // Field offsets in elements of the matching view
+      this.f = {
+        id: L[L_ID] / 4, from: L[L_FROM] / 4, to: L[L_TO] / 4,
+        t_start: L[L_T_START] / 8, t_end: L[L_T_END] / 8, owlt: L[L_OWLT] / 8,
+        rate_bps: L[L_RATE] / 8, setup_s: L[L_SETUP] / 8,
+        residual_bytes: L[L_RESIDUAL] / 8, p_fail: L[L_P_FAIL] / 8
+      };
+      this.recordIds = null;  // contact id (index) → caller's record id
+      this.toNode = null;     // contact id → destination node, for route.nodes
+    }
+
+    // Views over the current plan: contact k has its ints at i32[k * i32Stride + f.*]
+    // and its doubles at f64[k * f64Stride + f.*]
+    plan() {
+      const n = this.mod._cgrw_plan_count();
+      const ptr = this.mod._cgrw_plan_ptr();
+      const buf = this.mod.HEAPU8.buffer;
+      return {
+        count: n, f: this.f,
+        i32Stride: this.stride / 4, f64Stride: this.stride / 8,
+        i32: new Int32Array(buf, ptr, n * this.stride / 4),
+        f64: new Float64Array(buf, ptr, n * this.stride / 8)
+      };
+    }
+
+    // Plan from contact records { id, from, to, t_start, t_end, owlt, setup_s,
+    // rate_bps, residual_bytes[, p_fail] } (the records of contactRecords)
+    setContacts(records) {
+      const n = records.length;
+      if (!this.mod._cgrw_plan_alloc(n)) throw new Error('cgr_wasm: out of memory');
+      const v = this.plan(), f = this.f;
+      for (let k = 0; k < n; k++) {
+        const r = records[k];
+        const i = k * v.i32Stride, d = k * v.f64Stride;
+        v.i32[i + f.id] = k;
+        v.i32[i + f.from] = r.from;
+        v.i32[i + f.to] = r.to;
+        v.f64[d + f.t_start] = r.t_start;
+        v.f64[d + f.t_end] = r.t_end;
+        v.f64[d + f.owlt] = r.owlt;
+        v.f64[d + f.rate_bps] = r.rate_bps;
+        v.f64[d + f.setup_s] = r.setup_s;
+        v.f64[d + f.residual_bytes] = r.residual_bytes;
+        v.f64[d + f.p_fail] = r.p_fail || 0;
+      }
+      this.commit();
+      this.recordIds = records.map(r => r.id);
+    }
+
+    // Plan from CSV text (id,from,to,t_start,t_end,owlt_s,rate_bps,setup_s,residual_bytes[,p_success])
+    loadCsv(text) {
+      const bytes = new TextEncoder().encode(text);
+      const p = this.mod._malloc(bytes.length || 1);
+      if (!p) throw new Error('cgr_wasm: out of memory');
+      this.mod.HEAPU8.set(bytes, p);
+      const n = this.mod._cgrw_plan_load_csv(p, bytes.length);
+      this.mod._free(p);
+      if (n < 0) throw new Error('cgr_wasm: cannot load plan');
+      this.recordIds = null;
+      this._mapNodes();
+      return n;
+    }
+
+    // After editing nodes or windows through plan() (not needed for residual_bytes / p_fail)
+    commit() {
+      if (this.mod._cgrw_plan_commit() !== 0) throw new Error('cgr_wasm: cannot index plan');
+      this._mapNodes();
+    }
+
+    _mapNodes() {
+      const v = this.plan();
+      this.toNode = new Map();
+      for (let k = 0; k < v.count; k++) {
+        this.toNode.set(v.i32[k * v.i32Stride + v.f.id], v.i32[k * v.i32Stride + v.f.to]);
+      }
+    }
+
+    // Best route; expiry is relative to t0 (0 = none)
+    route(src, dst, t0, bytes, expiry = 0) {
+      const n = this.mod._cgrw_route(src, dst, t0, bytes, expiry);
+      return n > 0 ? this._results(src, t0)[0] : { found: false };
+    }
+
+    // Up to k routes: Yen (loopless alternatives) or, with yen = false, the
+    // capacity-consuming sequence of cgr_k_routes
+    kRoutes(src, dst, t0, bytes, k, { yen = true, expiry = 0 } = {}) {
+      const n = this.mod._cgrw_k_routes(src, dst, t0, bytes, expiry, k, yen ? 1 : 0);
+      return n > 0 ? this._results(src, t0) : [];
+    }
+
+    _results(src, t0) {
+      const m = this.mod, buf = m.HEAPU8.buffer;
+      const count = m._cgrw_result_count();
+      const off = new Int32Array(buf, m._cgrw_result_offsets(), count + 1);
+      const etas = new Float64Array(buf, m._cgrw_result_etas(), count);
+      const ids = new Int32Array(buf, m._cgrw_result_ids(), off[count]);
+      const routes = [];
+      for (let r = 0; r < count; r++) {
+        const cids = Array.from(ids.subarray(off[r], off[r + 1]));
+        const nodes = [src].concat(cids.map(id => this.toNode.get(id)));
+        routes.push({
+          found: true, eta: etas[r], latency: etas[r] - t0, hops: cids.length,
+          contact_ids: this.recordIds ? cids.map(id => this.recordIds[id]) : cids, nodes
+        });
+      }
+      return routes;
+    }
+
+    free() {
+      this.mod._cgrw_plan_free();
+      this.recordIds = null;
+      this.toNode = null;
+    }
+  }
+
+  if (typeof module === 'object' && module.exports) module.exports = { CgrWasm };
+  else root.CgrWasm = CgrWasm;
+})(typeof self !== 'undefined' ? self : this);
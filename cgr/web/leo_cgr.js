@@ -0,0 +1,396 @@
+// Constellation geometry, contact windows and the JavaScript CGR router of
+// index.html. Shared with web/bench.html so both run the same code on the same
+// constellation. Classic scripts: everything here is global and reads the
+// page's `config` and `contactGraph` (and buildContactGraph, which
+// cgrEnhancedSearch calls to widen the horizon).
+
+// =============== CONSTANTS ===============
+const EARTH_RADIUS = 6_371_000; // meters
+const C = 299_792_458; // m/s
+const ORBITAL_PERIOD_SIM = 6000; // seconds (animation period)
+
+function getSatellitePosition(plane, satIndex, meanAnomalyStart, inclination, raan, tSec) {
+  const meanMotion = (2 * Math.PI) / ORBITAL_PERIOD_SIM;
+  const meanAnomalyDeg = meanAnomalyStart + (meanMotion * tSec * 180 / Math.PI);
+
+  const a = EARTH_RADIUS + config.altitude;
+  const incRad = Cesium.Math.toRadians(inclination);
+  const raanRad = Cesium.Math.toRadians(raan);
+  const maRad = Cesium.Math.toRadians(meanAnomalyDeg);
+
+  const x = a * (Math.cos(raanRad) * Math.cos(maRad) - Math.sin(raanRad) * Math.sin(maRad) * Math.cos(incRad));
+  const y = a * (Math.sin(raanRad) * Math.cos(maRad) + Math.cos(raanRad) * Math.sin(maRad) * Math.cos(incRad));
+  const z = a * Math.sin(maRad) * Math.sin(incRad);
+
+  return new Cesium.Cartesian3(x, y, z);
+}
+
+// =============== CONSTELLATION ===============
+// Walker-like shell: ~9 satellites per plane, alternating 53/58 deg planes
+function makeConstellation(satCount) {
+  const sats = [];
+  const planes = Math.max(1, Math.round(satCount / 9)); // e.g., 27 => 3 planes
+  const satsPerPlane = Math.round(satCount / planes);
+  const baseInclination = 53; // degrees
+  const raanStep = 360 / planes;
+
+  let idCounter = 1;
+
+  for (let p = 0; p < planes; p++) {
+    const raan = (p * raanStep) % 360;
+    for (let s = 0; s < satsPerPlane; s++) {
+      const meanAnomalyStart = (s * 360 / satsPerPlane) % 360;
+      sats.push({
+        id: idCounter++,
+        plane: p,
+        index: s,
+        meanAnomalyStart,
+        inclination: baseInclination + (p % 2 === 0 ? 0 : 5),
+        raan,
+        entity: null
+      });
+    }
+  }
+  return sats.slice(0, satCount);
+}
+
+// =============== CONTACT WINDOWS ===============
+function calculateLinkQuality(distance, sat1, sat2) {
+  const maxDist = 5_500_000; // 5500 km
+  const distanceFactor = Math.max(0, 1 - (distance / maxDist)); // 0..1
+  const planeDiversity = Math.abs(sat1.plane - sat2.plane) / 2;
+  const altitudeFactor = (config.altitude >= config.leoMinAlt && config.altitude <= config.leoMaxAlt) ? 1.0 : 0.7;
+  const q = (distanceFactor * 0.6 + planeDiversity * 0.2 + altitudeFactor * 0.2);
+  return Math.max(0.05, Math.min(1, q));
+}
+
+function classifyLinkType(s1, s2, distance) {
+  const inLEO = (config.altitude >= config.leoMinAlt && config.altitude <= config.leoMaxAlt);
+  if (!inLEO) return 'rf';
+  const samePlane = (s1.plane === s2.plane);
+  const okIntra = samePlane && (distance <= config.opticalMaxDistIntra);
+  const okInter = !samePlane && (distance <= config.opticalMaxDistInter);
+  return (okIntra || okInter) ? 'optical' : 'rf';
+}
+
+// Link margin at t (m): > 0 while the pair is within range and the line of
+// sight clears the Earth plus LOS_GRAZING of atmosphere
+const LOS_GRAZING = 80_000;        // meters
+const LINK_MAX_DISTANCE = 5_500_000; // meters
+function linkMargin(s1, s2, t) {
+  const p1 = getSatellitePosition(s1.plane, s1.index, s1.meanAnomalyStart, s1.inclination, s1.raan, t);
+  const p2 = getSatellitePosition(s2.plane, s2.index, s2.meanAnomalyStart, s2.inclination, s2.raan, t);
+  const dx = p2.x - p1.x, dy = p2.y - p1.y, dz = p2.z - p1.z;
+  const dd = dx * dx + dy * dy + dz * dz;
+  const d = Math.sqrt(dd);
+  // Point of the segment closest to the Earth's center
+  const s = dd > 0 ? Math.min(1, Math.max(0, -(p1.x * dx + p1.y * dy + p1.z * dz) / dd)) : 0;
+  const h = Math.hypot(p1.x + s * dx, p1.y + s * dy, p1.z + s * dz) - EARTH_RADIUS - LOS_GRAZING;
+  return { g: Math.min(h, LINK_MAX_DISTANCE - d), d };
+}
+
+// Coarse sampling brackets each visibility change; bisection then pins the
+// edge to EDGE_TOL, so t_start/t_end do not depend on the step
+function findOptimalContactWindows(s1, s2, startTime, endTime) {
+  const windows = [];
+  const timeStep = 30;                // seconds (bracketing only)
+  const EDGE_TOL = 1e-3;              // seconds
+  const edge = (ta, tb, visibleAtA) => {
+    while (tb - ta > EDGE_TOL) {
+      const tm = 0.5 * (ta + tb);
+      if ((linkMargin(s1, s2, tm).g > 0) === visibleAtA) ta = tm; else tb = tm;
+    }
+    return visibleAtA ? ta : tb;      // visible side of the final bracket
+  };
+  let open = null;
+  const first = linkMargin(s1, s2, startTime);
+  if (first.g > 0) open = { start: startTime, distance: first.d, maxDistance: first.d };
+
+  for (let t0 = startTime; t0 < endTime; t0 += timeStep) {
+    const t1 = Math.min(t0 + timeStep, endTime);
+    const cur = linkMargin(s1, s2, t1);
+    if (!open && cur.g > 0) {
+      const ts = edge(t0, t1, false);
+      const d0 = linkMargin(s1, s2, ts).d;
+      open = { start: ts, distance: Math.min(d0, cur.d), maxDistance: Math.max(d0, cur.d) };
+    } else if (open && cur.g <= 0) {
+      const te = edge(t0, t1, true);
+      const d1 = linkMargin(s1, s2, te).d;
+      open.end = te;
+      open.distance = Math.min(open.distance, d1);
+      open.maxDistance = Math.max(open.maxDistance, d1);
+      if (open.end - open.start > 30) windows.push(open);
+      open = null;
+    } else if (open) {
+      open.distance = Math.min(open.distance, cur.d);
+      open.maxDistance = Math.max(open.maxDistance, cur.d);
+    }
+  }
+  if (open) {
+    open.end = endTime;
+    if (open.end - open.start > 30) windows.push(open);
+  }
+  return windows;
+}
+
+// Link capacity by type (bps). The JS router ignores it; the C core (WASM)
+// also counts the transmission time and the residual capacity of each window
+const LINK_RATE_BPS = { optical: 1e9, rf: 2e8 };
+
+// Contact records of every satellite pair over [t0, t1], both directions.
+// onWindow(s1, s2, type) is called once per window (index.html draws the link)
+function contactRecords(sats, t0, t1, onWindow) {
+  const records = [];
+  for (let i = 0; i < sats.length; i++) {
+    for (let j = i + 1; j < sats.length; j++) {
+      const s1 = sats[i], s2 = sats[j];
+      const wins = findOptimalContactWindows(s1, s2, t0, t1);
+
+      wins.forEach((w) => {
+        const quality = calculateLinkQuality(w.distance, s1, s2);
+        const type = classifyLinkType(s1, s2, w.distance); // LEO + distance → optical (blue) or RF (orange)
+        const owlt = w.maxDistance / C;     // longest range in the window
+        const setup_s = 0.2 + (1 - quality) * 0.6;
+        const rate_bps = LINK_RATE_BPS[type];
+        const residual_bytes = Math.max(0, w.end - w.start - setup_s) * rate_bps / 8;
+
+        const idF = `C_${s1.id}_${s2.id}_${Math.round(w.start)}`;
+        const idB = `C_${s2.id}_${s1.id}_${Math.round(w.start)}`;
+
+        const recF = { id: idF, from: s1.id, to: s2.id, t_start: w.start, t_end: w.end, owlt, setup_s, rate_bps, residual_bytes, type, quality };
+        const recB = { id: idB, from: s2.id, to: s1.id, t_start: w.start, t_end: w.end, owlt, setup_s, rate_bps, residual_bytes, type, quality };
+
+        records.push(recF, recB);
+        if (onWindow) onWindow(s1, s2, type);
+      });
+    }
+  }
+  return records;
+}
+
+// =============== CGR CLASSIC & ENHANCED ===============
+function cgrClassicSearch(srcId, dstId, t0, bundle_bytes) {
+  const distances = {};
+  const arrivalTimes = {};
+  const previous = {};
+  const unvisited = new Set();
+  const contacts = contactGraph;
+
+  for (let i = 0; i < contacts.length; i++) {
+    distances[i] = Infinity;
+    arrivalTimes[i] = t0;
+    previous[i] = null;
+    unvisited.add(i);
+  }
+
+  // seed from src
+  contacts.forEach((c, idx) => {
+    if (c.from === srcId && c.t_start <= t0 && c.t_end > t0) {
+      const eta = t0 + c.owlt + c.setup_s;
+      if (eta <= c.t_end) {
+        distances[idx] = eta - t0;
+        arrivalTimes[idx] = eta;
+      }
+    }
+  });
+
+  let best_end = null;
+  let best_eta = Infinity;
+
+  while (unvisited.size > 0) {
+    let current_idx = null;
+    let min_dist = Infinity;
+    unvisited.forEach(idx => {
+      if (distances[idx] < min_dist) { min_dist = distances[idx]; current_idx = idx; }
+    });
+    if (current_idx === null || min_dist === Infinity) break;
+    unvisited.delete(current_idx);
+
+    const current = contacts[current_idx];
+    if (current.to === dstId) { best_end = current_idx; best_eta = arrivalTimes[current_idx]; break; }
+
+    contacts.forEach((n, nj) => {
+      if (!unvisited.has(nj)) return;
+      if (n.from !== current.to) return;
+      if (n.t_start > arrivalTimes[current_idx]) return;
+      if (n.t_end <= arrivalTimes[current_idx]) return;
+      const eta_n = arrivalTimes[current_idx] + n.owlt + n.setup_s;
+      if (eta_n > n.t_end) return;
+      const new_dist = eta_n - t0;
+      if (new_dist < distances[nj]) {
+        distances[nj] = new_dist;
+        arrivalTimes[nj] = eta_n;
+        previous[nj] = current_idx;
+      }
+    });
+  }
+
+  if (best_end === null) return { found: false };
+
+  const path = [];
+  const nodes = [dstId];
+  let cur = best_end;
+  while (cur !== null) {
+    path.unshift(contacts[cur].id);
+    if (previous[cur] !== null) nodes.unshift(contacts[cur].from);
+    cur = previous[cur];
+  }
+  return { found: true, eta: best_eta, latency: best_eta - t0, hops: path.length, contact_ids: path, nodes };
+}
+
+function cgrEnhancedInternal(srcId, dstId, t0, bundle_bytes) {
+  const contacts = contactGraph;
+  const distances = {};
+  const arrivalTimes = {};
+  const previous = {};
+  const nodeQuality = {};
+  const unvisited = new Set();
+
+  for (let i = 0; i < contacts.length; i++) {
+    distances[i] = Infinity;
+    arrivalTimes[i] = t0;
+    previous[i] = null;
+    nodeQuality[i] = contacts[i].quality || 1.0;
+    unvisited.add(i);
+  }
+
+  // quality-weighted seeding
+  contacts.forEach((c, idx) => {
+    if (c.from !== srcId) return;
+    if (c.t_start > t0 || c.t_end <= t0) return;
+    const eta = t0 + c.owlt + c.setup_s;
+    if (eta > c.t_end) return;
+    const weighted = (eta - t0) * (2.0 - (c.quality || 1));
+    distances[idx] = weighted;
+    arrivalTimes[idx] = eta;
+  });
+
+  let best_end = null;
+  let best_eta = Infinity;
+  let iterations = 0;
+  const maxIterations = contacts.length * 2;
+
+  while (unvisited.size > 0 && iterations < maxIterations) {
+    iterations++;
+    let current_idx = null;
+    let min_eff = Infinity;
+
+    unvisited.forEach(idx => {
+      const qBoost = nodeQuality[idx] * 0.9;
+      const eff = distances[idx] * qBoost;
+      if (eff < min_eff) { min_eff = eff; current_idx = idx; }
+    });
+
+    if (current_idx === null || distances[current_idx] === Infinity) break;
+    unvisited.delete(current_idx);
+
+    const current = contacts[current_idx];
+    if (current.to === dstId) { best_end = current_idx; best_eta = arrivalTimes[current_idx]; break; }
+
+    contacts.forEach((n, nj) => {
+      if (!unvisited.has(nj)) return;
+      if (n.from !== current.to) return;
+      if (n.t_start > arrivalTimes[current_idx]) return;
+      if (n.t_end <= arrivalTimes[current_idx]) return;
+
+      let effective_setup = n.setup_s;
+      const qDiff = Math.abs((current.quality || 1) - (n.quality || 1));
+      effective_setup += qDiff * 0.2;
+      // slight preference for optical in LEO
+      if (n.type === 'optical') effective_setup *= 0.85;
+
+      const eta_n = arrivalTimes[current_idx] + n.owlt + effective_setup;
+      if (eta_n > n.t_end) return;
+
+      const new_dist = (eta_n - t0) * (2.0 - (n.quality || 1));
+      if (new_dist < distances[nj]) {
+        distances[nj] = new_dist;
+        arrivalTimes[nj] = eta_n;
+        previous[nj] = current_idx;
+        nodeQuality[nj] = (nodeQuality[current_idx] + (n.quality || 1)) / 2;
+      }
+    });
+  }
+
+  if (best_end === null) return { found: false };
+
+  const path = [];
+  const nodes = [dstId];
+  let cur = best_end;
+  while (cur !== null) {
+    path.unshift(contacts[cur].id);
+    if (previous[cur] !== null) nodes.unshift(contacts[cur].from);
+    cur = previous[cur];
+  }
+  return { found: true, eta: best_eta, latency: best_eta - t0, hops: path.length, contact_ids: path, nodes };
+}
+
+function cgrEnhancedSearch(srcId, dstId, t0, bundle_bytes) {
+  let result = cgrEnhancedInternal(srcId, dstId, t0, bundle_bytes);
+
+  if (!result.found) {
+    const oldH = config.planningHorizon;
+    config.planningHorizon = Math.max(oldH, 60 * 60);
+    buildContactGraph();
+    result = cgrEnhancedInternal(srcId, dstId, t0, bundle_bytes);
+    config.planningHorizon = oldH;
+    buildContactGraph();
+  }
+
+  if (!result.found) result = cgrClassicSearch(srcId, dstId, t0, bundle_bytes);
+
+  // last resort: direct link if a valid window exists
+  if (!result.found) {
+    const t1 = t0 + config.planningHorizon;
+    let best = null;
+    contactGraph.forEach(c => {
+      if (c.from === srcId && c.to === dstId && c.t_end > t0 && c.t_start <= t1) {
+        const start = Math.max(t0, c.t_start);
+        const eta = start + c.owlt + c.setup_s;
+        if (eta <= c.t_end) {
+          const lat = eta - t0;
+          if (!best || lat < best.latency) best = { found: true, eta, latency: lat, hops: 1, contact_ids: [c.id], nodes: [srcId, dstId] };
+        }
+      }
+    });
+    if (best) result = best;
+  }
+  return result;
+}
+
+function kYenRoutes(srcId, dstId, t0, bundle_bytes, k) {
+  const routes = [];
+  const base = (config.routingAlgorithm === 'cgr-enhanced' || config.routingAlgorithm === 'auto')
+    ? cgrEnhancedSearch(srcId, dstId, t0, bundle_bytes)
+    : cgrClassicSearch(srcId, dstId, t0, bundle_bytes);
+
+  if (!base.found) return routes;
+  routes.push(base);
+
+  for (let i = 1; i < k; i++) {
+    const ref = routes[0];
+    let added = false;
+
+    for (let spur = 0; spur < ref.hops && !added; spur++) {
+      const bannedId = ref.contact_ids[spur];
+      const old = contactGraph;
+      contactGraph = old.filter(c => c.id !== bannedId);
+
+      const alt = (config.routingAlgorithm === 'cgr-enhanced' || config.routingAlgorithm === 'auto')
+        ? cgrEnhancedSearch(srcId, dstId, t0, bundle_bytes)
+        : cgrClassicSearch(srcId, dstId, t0, bundle_bytes);
+
+      contactGraph = old;
+
+      if (alt.found) {
+        const isDup = routes.some(r =>
+          r.hops === alt.hops &&
+          r.contact_ids.length === alt.contact_ids.length &&
+          r.contact_ids.every((id, j) => id === alt.contact_ids[j])
+        );
+        if (!isDup) { routes.push(alt); added = true; }
+      }
+    }
+  }
+  return routes;
+}
@@ -0,0 +1,115 @@
+#!/usr/bin/env node
+// Smoke test of the WebAssembly build (make wasm-test): loads cgr_core.js in
+// Node through CgrWasm and checks that the best route and the Yen K routes
+// of every node pair match the native ./cgr batch mode on the same plans.
+// The empty plan must load and return no routes.
+//
+// Usage: node web/wasm_smoke.js [plan.csv ...]   (run from cgr/)
+
+'use strict';
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { execFileSync } = require('child_process');
+
+const HERE = __dirname;
+const ROOT = path.join(HERE, '..');
+const CORE = path.join(HERE, 'cgr_core.js');
+const CLI = path.join(ROOT, 'cgr');
+const K = 3;
+const EPS = 1e-6;   // ./cgr prints ETAs with 6 decimals
+
+function fail(msg) {
+  console.error('wasm smoke: ' + msg);
+  process.exit(1);
+}
+
+if (!fs.existsSync(CORE)) fail(CORE + ' not found (make wasm needs emcc)');
+if (!fs.existsSync(CLI)) fail(CLI + ' not found (make cgr)');
+
+const CgrCore = require(CORE);
+const { CgrWasm } = require(path.join(HERE, 'cgr_wasm.js'));
+
+// All node pairs at a few departure times and sizes
+function queriesFor(planText) {
+  const nodes = new Set();
+  let tmax = 0;
+  for (const line of planText.split('\n')) {
+    const t = line.trim();
+    if (!t || t[0] === '#') continue;
+    const f = t.split(',').map(s => s.trim());
+    if (f.length < 9 || isNaN(+f[0])) continue;
+    nodes.add(+f[1]);
+    nodes.add(+f[2]);
+    tmax = Math.max(tmax, +f[4]);
+  }
+  const Q = [];
+  for (const s of nodes) {
+    for (const d of nodes) {
+      if (s === d) continue;
+      for (const t0 of [0, tmax / 3, (2 * tmax) / 3]) {
+        for (const bytes of [1e3, 5e7]) Q.push({ src: s, dst: d, t0, bytes });
+      }
+    }
+  }
+  return Q;
+}
+
+function nativeRoutes(planPath, Q, extra) {
+  const qPath = path.join(os.tmpdir(), 'cgr_wasm_smoke_' + process.pid + '.csv');
+  fs.writeFileSync(qPath, Q.map(q => `${q.src},${q.dst},${q.t0},${q.bytes}`).join('\n') + '\n');
+  try {
+    const out = execFileSync(CLI, ['--contacts', planPath, '--queries', qPath].concat(extra),
+                             { encoding: 'utf8', stdio: ['ignore', 'pipe', 'ignore'] });
+    return out.trim().split('\n').map(l => JSON.parse(l));
+  } finally {
+    fs.unlinkSync(qPath);
+  }
+}
+
+function sameRoute(w, n, what) {
+  if (Math.abs(w.eta - n.eta) > EPS || w.hops !== n.hops ||
+      w.contact_ids.join(',') !== n.contacts.join(',')) {
+    fail(`${what}: wasm eta=${w.eta} [${w.contact_ids}] vs native eta=${n.eta} [${n.contacts}]`);
+  }
+}
+
+function checkPlan(router, planPath) {
+  const text = fs.readFileSync(planPath, 'utf8');
+  const n = router.loadCsv(text);
+  if (n <= 0) fail(`${planPath}: loadCsv returned ${n}`);
+  const Q = queriesFor(text);
+  const best = nativeRoutes(planPath, Q, []);
+  const yen = nativeRoutes(planPath, Q, ['--k-yen', String(K)]);
+  if (best.length !== Q.length || yen.length !== Q.length) fail(`${planPath}: native output size`);
+
+  let found = 0;
+  Q.forEach((q, i) => {
+    const what = `${path.basename(planPath)} ${q.src}->${q.dst} t0=${q.t0} bytes=${q.bytes}`;
+    const w = router.route(q.src, q.dst, q.t0, q.bytes);
+    if (w.found !== best[i].found) fail(`${what}: found ${w.found} vs native ${best[i].found}`);
+    if (w.found) { sameRoute(w, best[i], what); found++; }
+
+    const wk = router.kRoutes(q.src, q.dst, q.t0, q.bytes, K);
+    if (wk.length !== yen[i].routes.length) fail(`${what}: ${wk.length} Yen routes vs native ${yen[i].routes.length}`);
+    wk.forEach((r, j) => sameRoute(r, yen[i].routes[j], `${what} yen #${j}`));
+  });
+  console.log(`wasm smoke: ${path.basename(planPath)}: ${n} contacts, ${Q.length} queries (${found} routed) match ./cgr`);
+}
+
+async function main() {
+  const plans = process.argv.length > 2 ? process.argv.slice(2)
+    : ['data/contacts.csv', 'data/contacts_realistic.csv'].map(p => path.join(ROOT, p));
+  const router = await CgrWasm.load(CgrCore);
+
+  router.setContacts([]);
+  if (router.route(100, 200, 0, 1e3).found || router.kRoutes(100, 200, 0, 1e3, K).length) {
+    fail('empty plan returned a route');
+  }
+  for (const p of plans) checkPlan(router, p);
+  router.free();
+  console.log('wasm smoke: OK');
+}
+
+main().catch(e => fail(e && e.stack ? e.stack : String(e)));
@@ -0,0 +1,218 @@
+"""
+Batch SGP4 propagation through the native CGR library (cgr/libcgr_sgp4.so).
+
+The library propagates many satellites at many instants in one call
+(coefficients stored per column, 4 satellites per AVX2 iteration; see
+cgr/include/sgp4_batch.h). Build it with `make pylib` in cgr/. Without it,
+available() is False and callers keep using Skyfield.
+
+Positions come out in TEME, the frame SGP4 works in. Helpers convert them
+to geodetic sub-points (WGS84, Earth rotation by GMST) and to an
+approximate GCRS (IAU-76 precession; nutation, below 1 km in LEO, is
+ignored), which is close enough to Skyfield's output for plots and listings.
+"""
+
+import ctypes
+import os
+from typing import List, Optional, Sequence, Tuple
+
+import numpy as np
+
+_LIB_NAME = 'libcgr_sgp4.so'
+_lib = None
+_lib_error: Optional[str] = None
+
+_WGS84_A_KM = 6378.137
+_WGS84_E2 = 6.69437999014e-3
+_ARCSEC = np.pi / (180.0 * 3600.0)
+
+
+def _load() -> Optional[ctypes.CDLL]:
+    global _lib, _lib_error
+    if _lib is not None or _lib_error is not None:
+        return _lib
+    path = os.environ.get('CGR_SGP4_LIB') or os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), '..', 'cgr', _LIB_NAME)
+    try:
+        lib = ctypes.CDLL(path)
+    except OSError as e:
+        _lib_error = str(e)
+        return None
+    c_double_p = ctypes.POINTER(ctypes.c_double)
+    c_uchar_p = ctypes.POINTER(ctypes.c_ubyte)
+    lib.sgp4_batch_from_tle.argtypes = [ctypes.POINTER(ctypes.c_char_p),
+                                        ctypes.POINTER(ctypes.c_char_p), ctypes.c_int]
+    lib.sgp4_batch_from_tle.restype = ctypes.c_void_p
+    lib.sgp4_batch_destroy.argtypes = [ctypes.c_void_p]
+    lib.sgp4_batch_destroy.restype = None
+    lib.sgp4_batch_valid.argtypes = [ctypes.c_void_p, c_uchar_p]
+    lib.sgp4_batch_valid.restype = ctypes.c_int
+    lib.sgp4_batch_grid.argtypes = [ctypes.c_void_p, c_double_p, ctypes.c_int,
+                                    c_double_p, c_double_p, c_uchar_p, ctypes.c_int]
+    lib.sgp4_batch_grid.restype = ctypes.c_int
+    lib.sgp4_gmst.argtypes = [ctypes.c_double]
+    lib.sgp4_gmst.restype = ctypes.c_double
+    _lib = lib
+    return _lib
+
+
+def available() -> bool:
+    """True when the native library could be loaded."""
+    return _load() is not None
+
+
+def load_error() -> Optional[str]:
+    """Why the library is not available (None when it is)."""
+    _load()
+    return _lib_error
+
+
+def _ptr(a: np.ndarray, ctype):
+    return a.ctypes.data_as(ctypes.POINTER(ctype))
+
+
+class BatchPropagator:
+    """
+    A set of TLEs ready for batch propagation. Satellites whose elements
+    SGP4 cannot handle (deep space, decayed, unreadable) are marked invalid
+    in `valid` and never produce positions.
+    """
+
+    def __init__(self, line1s: Sequence[str], line2s: Sequence[str]):
+        lib = _load()
+        if lib is None:
+            raise RuntimeError(f"{_LIB_NAME} not available: {_lib_error}")
+        if len(line1s) != len(line2s):
+            raise ValueError("line1s and line2s must have the same length")
+        self.n = len(line1s)
+        l1 = (ctypes.c_char_p * self.n)(*[s.encode('ascii', 'replace') for s in line1s])
+        l2 = (ctypes.c_char_p * self.n)(*[s.encode('ascii', 'replace') for s in line2s])
+        self._lib = lib
+        self._handle = lib.sgp4_batch_from_tle(l1, l2, self.n)
+        if not self._handle:
+            raise MemoryError("sgp4_batch_from_tle failed")
+        self.valid = np.zeros(self.n, dtype=np.uint8)
+        lib.sgp4_batch_valid(self._handle, _ptr(self.valid, ctypes.c_ubyte))
+        self.valid = self.valid.astype(bool)
+
+    def close(self) -> None:
+        if self._handle:
+            self._lib.sgp4_batch_destroy(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+    def propagate(self, unix_times: Sequence[float], threads: int = 0
+                  ) -> Tuple[np.ndarray, np.ndarray, np.ndarray]:
+        """
+        TEME position (km) and velocity (km/s) of every satellite at every
+        instant (Unix seconds, UTC). Returns pos and vel shaped (nt, n, 3)
+        and ok shaped (nt, n); entries with ok False are undefined.
+        """
+        t = np.ascontiguousarray(unix_times, dtype=np.float64).reshape(-1)
+        nt = t.size
+        pos = np.empty((nt, self.n, 3), dtype=np.float64)
+        vel = np.empty((nt, self.n, 3), dtype=np.float64)
+        ok = np.zeros((nt, self.n), dtype=np.uint8)
+        if nt and self.n:
+            threads = threads or os.cpu_count() or 1
+            rc = self._lib.sgp4_batch_grid(self._handle, _ptr(t, ctypes.c_double), nt,
+                                           _ptr(pos, ctypes.c_double), _ptr(vel, ctypes.c_double),
+                                           _ptr(ok, ctypes.c_ubyte), threads)
+            if rc != 0:
+                raise RuntimeError("sgp4_batch_grid failed")
+        return pos, vel, ok.astype(bool)
+
+
+def gmst(unix_times: Sequence[float]) -> np.ndarray:
+    """Greenwich mean sidereal time (rad, IAU-82) at each instant."""
+    lib = _load()
+    if lib is None:
+        raise RuntimeError(f"{_LIB_NAME} not available: {_lib_error}")
+    return np.array([lib.sgp4_gmst(float(t)) for t in np.reshape(unix_times, -1)])
+
+
+def teme_to_geodetic(pos: np.ndarray, unix_times: Sequence[float]
+                     ) -> Tuple[np.ndarray, np.ndarray, np.ndarray]:
+    """
+    Sub-point of TEME positions shaped (nt, ..., 3): latitude and longitude
+    in degrees (WGS84) and altitude in km. Polar motion is ignored.
+    """
+    pos = np.asarray(pos, dtype=np.float64)
+    theta = gmst(unix_times).reshape((-1,) + (1,) * (pos.ndim - 2))
+    c, s = np.cos(theta), np.sin(theta)
+    x = c * pos[..., 0] + s * pos[..., 1]
+    y = -s * pos[..., 0] + c * pos[..., 1]
+    z = pos[..., 2]
+    rxy = np.hypot(x, y)
+    lat = np.arctan2(z, rxy)
+    for _ in range(6):
+        sl = np.sin(lat)
+        rn = _WGS84_A_KM / np.sqrt(1.0 - _WGS84_E2 * sl * sl)
+        lat = np.arctan2(z + rn * _WGS84_E2 * sl, rxy)
+    sl = np.sin(lat)
+    alt = rxy * np.cos(lat) + z * sl - _WGS84_A_KM * np.sqrt(1.0 - _WGS84_E2 * sl * sl)
+    return np.degrees(lat), np.degrees(np.arctan2(y, x)), alt
+
+
+def teme_to_gcrs(pos: np.ndarray, unix_times: Sequence[float]) -> np.ndarray:
+    """
+    Approximate GCRS (J2000) positions from TEME ones shaped (nt, ..., 3):
+    TEME is taken as the mean equator and equinox of date and IAU-76
+    precession is undone.
+    """
+    pos = np.asarray(pos, dtype=np.float64)
+    ttt = (np.reshape(unix_times, -1) / 86400.0 + 2440587.5 - 2451545.0) / 36525.0
+    zeta = (2306.2181 * ttt + 0.30188 * ttt ** 2 + 0.017998 * ttt ** 3) * _ARCSEC
+    theta = (2004.3109 * ttt - 0.42665 * ttt ** 2 - 0.041833 * ttt ** 3) * _ARCSEC
+    z = (2306.2181 * ttt + 1.09468 * ttt ** 2 + 0.018203 * ttt ** 3) * _ARCSEC
+    cz, sz = np.cos(zeta), np.sin(zeta)
+    ct, st = np.cos(theta), np.sin(theta)
+    cZ, sZ = np.cos(z), np.sin(z)
+    # Mean of date -> J2000: transpose of P = R3(-z) R2(theta) R3(-zeta)
+    p = np.empty((ttt.size, 3, 3))
+    p[:, 0, 0] = cZ * ct * cz - sZ * sz
+    p[:, 0, 1] = -cZ * ct * sz - sZ * cz
+    p[:, 0, 2] = -cZ * st
+    p[:, 1, 0] = sZ * ct * cz + cZ * sz
+    p[:, 1, 1] = -sZ * ct * sz + cZ * cz
+    p[:, 1, 2] = -sZ * st
+    p[:, 2, 0] = st * cz
+    p[:, 2, 1] = -st * sz
+    p[:, 2, 2] = ct
+    p = p.reshape((ttt.size,) + (1,) * (pos.ndim - 2) + (3, 3))
+    return np.einsum('...ji,...j->...i', p, pos)
+
+
+def subpoints(line1: str, line2: str, unix_times: Sequence[float]
+              ) -> Optional[List[dict]]:
+    """
+    One satellite over many instants: dicts with unix_time, latitude,
+    longitude, altitude_km and x_km/y_km/z_km (approximate GCRS), skipping
+    instants where SGP4 fails. None when the library is missing or the
+    elements are outside what the native SGP4 supports (deep space).
+    """
+    if not available():
+        return None
+    prop = BatchPropagator([line1], [line2])
+    if not prop.valid[0]:
+        return None
+    t = np.asarray(unix_times, dtype=np.float64).reshape(-1)
+    pos, _, ok = prop.propagate(t, threads=1)
+    lat, lon, alt = teme_to_geodetic(pos, t)
+    gcrs = teme_to_gcrs(pos, t)
+    out = []
+    for k in range(t.size):
+        if not ok[k, 0]:
+            continue
+        out.append({
+            'unix_time': float(t[k]),
+            'latitude': float(lat[k, 0]),
+            'longitude': float(lon[k, 0]),
+            'altitude_km': float(alt[k, 0]),
+            'x_km': float(gcrs[k, 0, 0]),
+            'y_km': float(gcrs[k, 0, 1]),
+            'z_km': float(gcrs[k, 0, 2]),
+        })
+    return out
@@ -17,9 +17,13 @@ Date: October 2025
 import requests
 import numpy as np
 import matplotlib.pyplot as plt
-from datetime import datetime, timedelta
+from datetime import datetime, timedelta, timezone
 import json
 import os
+import csv
+import bisect
+import subprocess
+import tempfile
 from skyfield.api import load, EarthSatellite
 from skyfield.timelib import Time
 import pandas as pd
@@ -35,6 +39,12 @@ except ImportError:
     SCIPY_AVAILABLE = False
     print("⚠️ SciPy not available - using alternative methods for probability")
 
+# Batch SGP4 from the CGR library (cgr/libcgr_sgp4.so, `make pylib`)
+try:
+    import native_sgp4
+except ImportError:
+    native_sgp4 = None
+
 # Imports for 3D visualization
 from mpl_toolkits.mplot3d import Axes3D
 import plotly.graph_objects as go
@@ -546,6 +556,13 @@ class SatelliteAnalyzer:
             total_points = days_ahead * 2  # Every 12 hours = 2 points per day
             print(f"📊 Calculating {total_points} positions for {days_ahead} days...")
             
+            start_unix = start_time.utc_datetime().timestamp()
+            native = self._native_track(satellite_name, [start_unix + hours * 3600.0
+                                                         for hours in range(0, days_ahead * 24, 12)])
+            if native is not None:
+                print(f"✅ Successfully calculated {len(native)} positions (native batch SGP4)")
+                return native
+            
             for hours in range(0, days_ahead * 24, 12):
                 try:
                     t = self.ts.tt_jd(start_time.tt + hours / 24)
@@ -572,6 +589,80 @@ class SatelliteAnalyzer:
             print(f"❌ Error in calculate_future_positions: {str(e)}")
             return []
     
+    def _native_track(self, satellite_name: str, unix_times: List[float]) -> Optional[List[Dict]]:
+        """
+        Positions of one satellite at many instants through the native batch
+        propagator, in the same format as calculate_future_positions (x/y/z
+        approximately GCRS). None when the library is not built or the
+        orbit is deep space, so the caller falls back to Skyfield.
+        """
+        if native_sgp4 is None:
+            return None
+        data = self.satellites[satellite_name]
+        try:
+            track = native_sgp4.subpoints(data['line1'], data['line2'], unix_times)
+        except (OSError, RuntimeError, ValueError):
+            return None
+        if track is None:
+            return None
+        for p in track:
+            p['datetime'] = datetime.fromtimestamp(p.pop('unix_time'), tz=timezone.utc)
+        return track
+    
+    def _orbit_band_km(self, name: str, days_ahead: float) -> Tuple[float, float]:
+        """
+        Perigee/apogee radii (km) a satellite can reach over the next days,
+        from its TLE mean elements: the lower edge also covers the decay
+        implied by the mean motion derivative (line 1, rev/day^2)
+        """
+        data = self.satellites[name]
+        ecc = float('0.' + data['line2'][26:33].strip())
+        n_revday = float(data['line2'][52:63])
+        ndot_half = float(data['line1'][33:43])
+        n = n_revday * 2 * np.pi / 86400.0  # rad/s
+        a = (398600.4418 / n**2) ** (1 / 3)
+        decay = 2.0 / 3.0 * a * abs(2.0 * ndot_half * days_ahead) / n_revday
+        return a * (1 - ecc) - decay, a * (1 + ecc)
+
+    def band_prefilter(self, satellite1_name: str, threshold_km: float,
+                       days_ahead: float = 7, margin_km: float = 15.0) -> List[str]:
+        """
+        Satellites whose perigee/apogee band overlaps satellite1's within
+        threshold_km: the only ones that can come that close. margin_km
+        covers the periodic perturbations that mean elements leave out.
+        Bands are kept sorted by perigee, so only the prefix whose perigee
+        is below satellite1's apogee is scanned.
+
+        Returns:
+            List[str]: Candidate names, closest altitude first
+        """
+        key = (len(self.satellites), days_ahead)
+        if getattr(self, '_band_index', None) is None or self._band_index['key'] != key:
+            bands = []
+            for name in self.satellites:
+                try:
+                    lo, hi = self._orbit_band_km(name, days_ahead)
+                except (ValueError, KeyError, ZeroDivisionError):
+                    continue
+                bands.append((lo, hi, name))
+            bands.sort()
+            self._band_index = {'key': key, 'bands': bands, 'lo': [b[0] for b in bands]}
+
+        index = self._band_index
+        lo1, hi1 = self._orbit_band_km(satellite1_name, days_ahead)
+        reach = threshold_km + 2 * margin_km
+        end = bisect.bisect_right(index['lo'], hi1 + reach)
+        partners = [(lo, hi, name) for lo, hi, name in index['bands'][:end]
+                    if hi >= lo1 - reach and name != satellite1_name]
+        mid1 = 0.5 * (lo1 + hi1)
+        partners.sort(key=lambda b: abs(0.5 * (b[0] + b[1]) - mid1))
+
+        total = len(index['bands']) - 1
+        if total > 0:
+            print(f"📉 Band prefilter: {len(partners)} of {total} satellites can come within "
+                  f"{threshold_km} km ({100.0 * len(partners) / total:.1f}%)")
+        return [name for _, _, name in partners]
+
     def analyze_collision_risk(self, satellite1_name: str, satellite2_name: str = None, 
                              threshold_km: float = 10.0, days_ahead: int = 180) -> Dict:
         """
@@ -598,11 +689,10 @@ class SatelliteAnalyzer:
             if satellite2_name in self.satellites:
                 satellites_to_check[satellite2_name] = self.satellites[satellite2_name]
         else:
-            # Analyze against a sample of satellites (first 100 for efficiency)
-            sat_names = list(self.satellites.keys())[:100]
-            for name in sat_names:
-                if name != satellite1_name:
-                    satellites_to_check[name] = self.satellites[name]
+            # Analyze against a sample (100 for efficiency) of the satellites
+            # whose altitude band can bring them within threshold
+            for name in self.band_prefilter(satellite1_name, threshold_km, days_ahead)[:100]:
+                satellites_to_check[name] = self.satellites[name]
         
         print(f"🔍 Analyzing {len(satellites_to_check)} satellites for possible collisions...")
         
@@ -684,10 +774,8 @@ class SatelliteAnalyzer:
                     satellites_to_check[satellite2_name] = self.satellites[satellite2_name]
             else:
                 # Use smaller sample for detailed analysis
-                sat_names = list(self.satellites.keys())[:20]
-                for name in sat_names:
-                    if name != satellite1_name:
-                        satellites_to_check[name] = self.satellites[name]
+                for name in self.band_prefilter(satellite1_name, threshold_km, days_ahead)[:20]:
+                    satellites_to_check[name] = self.satellites[name]
             
             print(f"🔬 Advanced collision analysis for {len(satellites_to_check)} satellites...")
             print("   📊 Calculating orbital perturbations...")
@@ -1073,21 +1161,32 @@ class SatelliteAnalyzer:
             
         satellite = self.satellites[satellite_name]['satellite']
         
-        # Calculate positions for visualization
+        # Calculate positions for visualization (every 10 minutes)
         positions = []
-        times = []
+        altitudes = []
+        time_hours = []
         
         start_time = self.ts.now()
-        for minutes in range(0, hours * 60, 10):  # Every 10 minutes
-            t = self.ts.tt_jd(start_time.tt + minutes / (24 * 60))
-            geocentric = satellite.at(t)
-            subpoint = geocentric.subpoint()
-            
-            positions.append([
-                subpoint.longitude.degrees,
-                subpoint.latitude.degrees
-            ])
-            times.append(t.utc_datetime())
+        start_unix = start_time.utc_datetime().timestamp()
+        track = self._native_track(satellite_name, [start_unix + minutes * 60.0
+                                                    for minutes in range(0, hours * 60, 10)])
+        if track is not None:
+            for p in track:
+                positions.append([p['longitude'], p['latitude']])
+                altitudes.append(p['altitude_km'])
+                time_hours.append((p['datetime'].timestamp() - start_unix) / 3600.0)
+        else:
+            for minutes in range(0, hours * 60, 10):
+                t = self.ts.tt_jd(start_time.tt + minutes / (24 * 60))
+                geocentric = satellite.at(t)
+                subpoint = geocentric.subpoint()
+                
+                positions.append([
+                    subpoint.longitude.degrees,
+                    subpoint.latitude.degrees
+                ])
+                altitudes.append(subpoint.elevation.km)
+                time_hours.append(minutes / 60)
         
         positions = np.array(positions)
         
@@ -1116,14 +1215,6 @@ class SatelliteAnalyzer:
         
         # Subplot 2: Altitude vs time
         plt.subplot(1, 2, 2)
-        altitudes = []
-        for minutes in range(0, hours * 60, 10):
-            t = self.ts.tt_jd(start_time.tt + minutes / (24 * 60))
-            geocentric = satellite.at(t)
-            subpoint = geocentric.subpoint()
-            altitudes.append(subpoint.elevation.km)
-        
-        time_hours = [i/6 for i in range(len(altitudes))]  # Every 10 min = 1/6 hour
         plt.plot(time_hours, altitudes, 'r-', linewidth=2)
         plt.xlabel('Time (hours)')
         plt.ylabel('Altitude (km)')
@@ -1522,7 +1613,15 @@ class SatelliteAnalyzer:
             
         Returns:
             List[Dict]: List of collision cases found
+
+        When the native screening engine (cgr/cgr_conj) has been built, the
+        whole catalog is screened with it and max_satellites is ignored; the
+        sampled pairwise search below is only the fallback.
         """
+        native_cases = self._find_collision_cases_native(threshold_km, days_ahead)
+        if native_cases is not None:
+            return native_cases
+
         print(f"🔍 EXHAUSTIVE SEARCH FOR COLLISION CASES")
         print(f"📊 Analyzing up to {max_satellites} satellites...")
         print(f"📏 Threshold: {threshold_km} km | 📅 Period: {days_ahead} days")
@@ -1603,6 +1702,83 @@ class SatelliteAnalyzer:
         print(f"✅ Search completed. Cases found: {len(collision_cases)}")
         return collision_cases
     
+    def _find_collision_cases_native(self, threshold_km: float,
+                                     days_ahead: int) -> Optional[List[Dict]]:
+        """
+        Screen the full catalog with the native SGP4 engine (cgr/cgr_conj).
+        Returns None when the binary is missing or fails, so the caller can
+        fall back to the Python search.
+        """
+        binary = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                              '..', 'cgr', 'cgr_conj')
+        if not os.access(binary, os.X_OK) or not self.satellites:
+            return None
+
+        print(f"🔍 NATIVE CONJUNCTION SCREENING ({len(self.satellites)} satellites)")
+        print(f"📏 Threshold: {threshold_km} km | 📅 Period: {days_ahead} days")
+        print("-" * 60)
+
+        names_by_catnum = {}
+        start = datetime.now(timezone.utc).timestamp()
+        with tempfile.TemporaryDirectory() as tmp:
+            tle_path = os.path.join(tmp, 'catalog.tle')
+            out_path = os.path.join(tmp, 'conjunctions.csv')
+            with open(tle_path, 'w') as f:
+                for name, data in self.satellites.items():
+                    names_by_catnum.setdefault(data['line1'][2:7].strip(), name)
+                    f.write(f"{name}\n{data['line1']}\n{data['line2']}\n")
+            try:
+                run = subprocess.run(
+                    [binary, '--tle', tle_path, '--threshold', str(threshold_km),
+                     '--days', str(days_ahead), '--start', f"{start:.3f}",
+                     '--threads', str(os.cpu_count() or 1), '--out', out_path],
+                    capture_output=True, text=True)
+            except OSError as e:
+                print(f"⚠️ Native screening unavailable ({e}) - using Python search")
+                return None
+            if run.returncode != 0:
+                print(f"⚠️ Native screening failed - using Python search")
+                print(run.stderr.strip())
+                return None
+            for line in run.stderr.strip().splitlines():
+                print(f"   {line}")
+            with open(out_path) as f:
+                rows = list(csv.DictReader(l for l in f if not l.startswith('#')))
+
+        collision_cases = []
+        skipped = 0
+        for row in rows:
+            name1 = names_by_catnum.get(row['catnum_a'].strip(), row['name_a'])
+            name2 = names_by_catnum.get(row['catnum_b'].strip(), row['name_b'])
+            # cgr_conj reports the names it parsed; one we cannot map back to
+            # a loaded satellite has no Skyfield object to propagate
+            if name1 not in self.satellites or name2 not in self.satellites:
+                skipped += 1
+                continue
+            t = self.ts.from_datetime(
+                datetime.fromtimestamp(float(row['tca_unix']), tz=timezone.utc))
+            pos1 = self.satellites[name1]['satellite'].at(t).position.km
+            pos2 = self.satellites[name2]['satellite'].at(t).position.km
+            collision_cases.append({
+                'satellite1': name1,
+                'satellite2': name2,
+                'datetime': t.utc_datetime(),
+                'distance_km': float(row['miss_km']),
+                'hours_from_now': int((float(row['tca_unix']) - start) // 3600),
+                'satellite1_pos': pos1,
+                'satellite2_pos': pos2,
+                'relative_velocity_estimated': float(row['vrel_kms']) * 1000.0
+            })
+
+        for case in collision_cases[:5]:
+            print(f"🚨 CASE FOUND: {case['satellite1']} vs {case['satellite2']}")
+            print(f"   📅 {case['datetime'].strftime('%Y-%m-%d %H:%M')} UTC")
+            print(f"   📏 Distance: {case['distance_km']:.2f} km")
+        if skipped:
+            print(f"⚠️ Skipped {skipped} conjunctions with satellites not in the loaded catalog")
+        print(f"✅ Search completed. Cases found: {len(collision_cases)}")
+        return collision_cases
+
     def _estimate_relative_velocity(self, pos1: np.ndarray, pos2: np.ndarray, 
                                   distance_km: float) -> float:
         """Estimate relative velocity based on positions and distance"""